@@ -4,29 +4,36 @@
 //
 
 //
-//     RGBA to YUV422
+//     RGBA to YUV422 (UYVY)
 //
 // Y sampled at every pixel
 // U and V sampled at every second pixel 
 //
+// Drawn into an FBO half the output width: each RGBA8 texel holds one
+// U Y0 V Y1 pixel pair, so reading it back gives packed UYVY.
+//
 
 precision highp float;
 
-uniform sampler2D tex;     // fbo texture to draw to
 uniform sampler2D rgbatex; // rgba source texture
-vec2 texCoord;             // Texture coords from the vertex shader
+uniform vec2 outputSize;    // output size in pixels (twice the fbo width)
+
+#define SAMPLE texture2D
 
 void main()
 {
 
 	// Get the pixel color from the rgba texture
-	// U and V from the first of every second pixel
+	// U and V from the average of every pair of pixels
 	// Y0 and Y1 luminance from each of the pair
-	vec4 rgba0 = texture2D(rgbatex, vec2(texCoord.x*2, texCoord.y));
-	vec4 rgba1 = texture2D(rgbatex, vec2(texCoord.x*2+1, texCoord.y));
-
+	// (each output texel holds two pixels; the source is sampled at the
+	// output size, so any scaling happens here too)
+	float x = floor(gl_FragCoord.x) * 2.0;
+	vec4 rgba0 = SAMPLE(rgbatex, vec2((x + 0.5) / outputSize.x, gl_FragCoord.y / outputSize.y));
+	vec4 rgba1 = SAMPLE(rgbatex, vec2((x + 1.5) / outputSize.x, gl_FragCoord.y / outputSize.y));
+	
 	// Calculate Y0 Y1 U V
-	// NDI uses Rec.719 for 720p and 1920p
+	// NDI uses Rec.709 for 720p and 1080p
 	//
 	// BT.709
 	// https://gist.github.com/yohhoy/dafa5a47dade85d8b40625261af3776a
@@ -36,19 +43,19 @@ void main()
 	// Cr = (R-Y) / 1.5748
 	//
 	float y0 =  0.2126*rgba0.r + 0.7152*rgba0.g + 0.0722*rgba0.b;
-	float y1 =  0.2226*rgba1.r + 0.7152*rgba1.g + 0.0722*rgba1.b;
-	float u  =  (rgba0.b-y0) / 1.8556;
-	float v  =  (rgba0.r-y0) / 1.5748;
+	float y1 =  0.2126*rgba1.r + 0.7152*rgba1.g + 0.0722*rgba1.b;
+	float u  =  ((rgba0.b-y0) + (rgba1.b-y1)) / (2.0*1.8556);
+	float v  =  ((rgba0.r-y0) + (rgba1.r-y1)) / (2.0*1.5748);
 	
 	// Convert Y from 0-255 to 16-235
 	// (0-1 to 0.06274-0.92156)
 	//  y = (y/1.16438)+0.06274
 	y0 = y0/1.16438 + 0.06274;
 	y1 = y1/1.16438 + 0.06274;
-		
-	// Adjust u and v to 0-1 range
-	u += 0.5;
-	v += 0.5;
+	
+	// Convert U and V from -0.5-0.5 to 16-240 around 128
+	u = u/1.13839 + 0.50196;
+	v = v/1.13839 + 0.50196;
 
 	// u y0 v y1
 	vec4 yuv422 = vec4(0.0);
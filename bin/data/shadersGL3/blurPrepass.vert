@@ -0,0 +1,26 @@
+OF_GLSL_SHADER_HEADER
+#extension GL_ARB_explicit_attrib_location : enable
+#extension GL_ARB_explicit_uniform_location : enable
+
+//plain uniforms get the explicit locations shadersGL4 uses where the driver
+//supports them, so a cached program binary can be restored (see ShaderLoader)
+#ifdef GL_ARB_explicit_uniform_location
+#define UNIFORM_LOCATION(n) layout(location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
+
+// these are for the programmable pipeline system
+UNIFORM_LOCATION(0) uniform mat4 modelViewProjectionMatrix;
+
+in vec4 position;
+in vec2 texcoord;
+
+out vec2 texCoordVarying;
+
+void main()
+{
+    texCoordVarying = texcoord;
+
+	gl_Position = modelViewProjectionMatrix * position;
+}
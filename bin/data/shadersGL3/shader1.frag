@@ -1,158 +1,369 @@
 OF_GLSL_SHADER_HEADER
+#extension GL_ARB_explicit_attrib_location : enable
+#extension GL_ARB_explicit_uniform_location : enable
+
+//plain uniforms get the explicit locations shadersGL4 uses where the driver
+//supports them, so a cached program binary can be restored (see ShaderLoader)
+#ifdef GL_ARB_explicit_uniform_location
+#define UNIFORM_LOCATION(n) layout(location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
 
-uniform int ch1HdAspectOn;
-uniform int ch2HdAspectOn;
-uniform vec2 ch1HdAspectXYFix;
 const float PI=3.1415926535;
 const float TWO_PI=6.2831855;
 
-uniform sampler2D ch1Tex;
-uniform sampler2D ch2Tex;
-uniform sampler2D tex0; //fb2 for now
-uniform sampler2D fb1TemporalFilter;
-
-uniform vec2 input1XYFix;
-
-
-uniform float inverseWidth1;
-uniform float inverseHeight1;
-
-// Input resolution uniforms
-uniform float input1Width;
-uniform float input1Height;
-
-uniform float hdFixX;
-uniform float hdFixY;
-
-
-
-uniform float ratio;
-
-uniform float width;
-uniform float height;
-uniform float inverseWidth;
-uniform float inverseHeight;
-
-uniform float ch1AspectRatio;
-uniform float ch1HdZCrib;
-uniform float ch1ScaleFix;
-
-uniform vec2 ch1XYDisplace;
-uniform float ch1ZDisplace;
-uniform float ch1Rotate;
-uniform vec3 ch1HSBAttenuate;
-uniform float ch1Posterize;
-uniform float ch1PosterizeInvert;
-uniform int ch1PosterizeSwitch;
-uniform float ch1KaleidoscopeAmount;
-uniform float ch1KaleidoscopeSlice;
-uniform float ch1BlurAmount;
-uniform float ch1BlurRadius;
-uniform float ch1SharpenAmount;
-uniform float ch1SharpenRadius;
-uniform float ch1FiltersBoost;
-
-uniform int ch1HMirror;
-uniform int ch1VMirror;
-uniform int ch1HFlip;
-uniform int ch1VFlip;
-uniform int ch1HueInvert;
-uniform int ch1SaturationInvert;
-uniform int ch1BrightInvert;
-uniform int ch1RGBInvert;
-uniform int ch1GeoOverflow;
-uniform int ch1Solarize;
-
-uniform float ch2AspectRatio;
-uniform float ch2HdZCrib;
-uniform float ch2ScaleFix;
-
-
-uniform float ch2MixAmount;
-uniform vec3 ch2KeyValue;
-uniform float ch2KeyThreshold;
-uniform float ch2KeySoft;
-uniform int ch2MixType;
-uniform int ch2MixOverflow;
-uniform int ch2KeyOrder;
-
-uniform vec2 ch2XYDisplace;
-uniform float ch2ZDisplace;
-uniform float ch2Rotate;
-uniform vec3 ch2HSBAttenuate;
-uniform float ch2Posterize;
-uniform float ch2PosterizeInvert;
-uniform int ch2PosterizeSwitch;
-uniform float ch2KaleidoscopeAmount;
-uniform float ch2KaleidoscopeSlice;
-uniform float ch2BlurAmount;
-uniform float ch2BlurRadius;
-uniform float ch2SharpenAmount;
-uniform float ch2SharpenRadius;
-uniform float ch2FiltersBoost;
-
-uniform int ch2HMirror;
-uniform int ch2VMirror;
-uniform int ch2HFlip;
-uniform int ch2VFlip;
-uniform int ch2HueInvert;
-uniform int ch2SaturationInvert;
-uniform int ch2BrightInvert;
-uniform int ch2RGBInvert;
-uniform int ch2GeoOverflow;
-uniform int ch2Solarize;
-
-uniform float fb1MixAmount;
-uniform vec3 fb1KeyValue;
-uniform float fb1KeyThreshold;
-uniform float fb1KeySoft;
-uniform int fb1MixType;
-uniform int fb1MixOverflow;
-uniform int fb1KeyOrder;
-
-uniform vec2 fb1XYDisplace;
-uniform float fb1ZDisplace;
-uniform float fb1Rotate;
-uniform vec4 fb1ShearMatrix;
-uniform float fb1KaleidoscopeAmount;
-uniform float fb1KaleidoscopeSlice;
-uniform int fb1HMirror;
-uniform int fb1VMirror;
-uniform int fb1HFlip;
-uniform int fb1VFlip;
-uniform int	fb1RotateMode;
-uniform	int fb1GeoOverflow;
-
-uniform vec3 fb1HSBOffset;
-uniform vec3 fb1HSBAttenuate;
-uniform vec3 fb1HSBPowmap;
-uniform float fb1HueShaper;
-
-uniform float fb1Posterize;
-uniform float fb1PosterizeInvert;
-uniform int fb1PosterizeSwitch;
-uniform int fb1HueInvert;
-uniform int fb1SaturationInvert;
-uniform int fb1BrightInvert;
-
-//fb1 filters
-uniform	float fb1BlurAmount;
-uniform	float fb1BlurRadius;
-uniform	float fb1SharpenAmount;
-uniform	float fb1SharpenRadius;
-uniform	float fb1TemporalFilter1Amount;
-uniform	float fb1TemporalFilter1Resonance;
-uniform	float fb1TemporalFilter2Amount;
-uniform	float fb1TemporalFilter2Resonance;
-uniform float fb1FiltersBoost;
-
-uniform float ch1CribX;
-uniform float ch2CribX;
-uniform float cribY;
+UNIFORM_LOCATION(4) uniform sampler2D ch1Tex;
+UNIFORM_LOCATION(5) uniform sampler2D ch2Tex;
+//feedback history, one texture array layer per past frame (-1 = empty)
+//newest frames in fb1History, older ones in fb1HistoryOlder (lower quality)
+UNIFORM_LOCATION(6) uniform sampler2DArray fb1History;
+UNIFORM_LOCATION(7) uniform sampler2DArray fb1HistoryOlder;
+UNIFORM_LOCATION(8) uniform int fb1DelayTier;
+UNIFORM_LOCATION(9) uniform int fb1DelayLayer;
+UNIFORM_LOCATION(10) uniform int fb1TemporalLayer;
+
+//blur/sharpen pre-pass results, bound when <layer>BlurPrepass is 1 (see BlurPrepass)
+UNIFORM_LOCATION(11) uniform sampler2D ch1Prepass;
+UNIFORM_LOCATION(12) uniform sampler2D ch2Prepass;
+UNIFORM_LOCATION(13) uniform sampler2D fb1Prepass;
+
+//colour chain LUTs, sampled when <layer>ColorLutOn is 1 (see ColorLut)
+UNIFORM_LOCATION(14) uniform sampler3D ch1ColorLut;
+UNIFORM_LOCATION(15) uniform sampler3D ch2ColorLut;
+UNIFORM_LOCATION(16) uniform sampler3D fb1ColorLut;
+
+//channels processed by an earlier pass, sampled when block1Stage is 2 (see ChannelCache)
+UNIFORM_LOCATION(17) uniform sampler2D ch1Cache;
+UNIFORM_LOCATION(18) uniform sampler2D ch2Cache;
+
+//baked per-layer coordinates, sampled when <layer>WarpOn is 1 (see WarpMapCache)
+UNIFORM_LOCATION(19) uniform sampler2D ch1WarpMap;
+UNIFORM_LOCATION(20) uniform sampler2D ch2WarpMap;
+UNIFORM_LOCATION(21) uniform sampler2D fb1WarpMap;
+
+//parameters, uploaded as one uniform buffer (see ParamBuffer)
+//int switches are #defined to constants in specialized variants
+//(see ShaderVariantCache); their slots stay so the layout matches
+layout(std140) uniform Block1Params {
+    //per-layer coordinate transforms, composed on the CPU (see LayerTransform)
+    mat3 ch1PreTransform;
+    mat3 ch1Transform;
+    mat3 ch2PreTransform;
+    mat3 ch2Transform;
+    mat3 fb1PreTransform;
+    mat3 fb1Transform;
+
+    vec2 input1XYFix;
+
+    float inverseWidth1;
+    float inverseHeight1;
+
+    // Input resolution uniforms
+    float input1Width;
+    float input1Height;
+
+    float hdFixX;
+    float hdFixY;
+
+    float ratio;
+
+    float width;
+    float height;
+    float inverseWidth;
+    float inverseHeight;
+
+    vec3 ch1HSBAttenuate;
+    float ch1Posterize;
+    float ch1PosterizeInvert;
+#ifdef ch1PosterizeSwitch
+    int ch1PosterizeSwitchBaked;
+#else
+    int ch1PosterizeSwitch;
+#endif
+    float ch1KaleidoscopeAmount;
+    float ch1KaleidoscopeSlice;
+    float ch1BlurAmount;
+    float ch1BlurRadius;
+    float ch1SharpenAmount;
+    float ch1SharpenRadius;
+    float ch1FiltersBoost;
+
+#ifdef ch1HMirror
+    int ch1HMirrorBaked;
+#else
+    int ch1HMirror;
+#endif
+#ifdef ch1VMirror
+    int ch1VMirrorBaked;
+#else
+    int ch1VMirror;
+#endif
+#ifdef ch1HueInvert
+    int ch1HueInvertBaked;
+#else
+    int ch1HueInvert;
+#endif
+#ifdef ch1SaturationInvert
+    int ch1SaturationInvertBaked;
+#else
+    int ch1SaturationInvert;
+#endif
+#ifdef ch1BrightInvert
+    int ch1BrightInvertBaked;
+#else
+    int ch1BrightInvert;
+#endif
+#ifdef ch1RGBInvert
+    int ch1RGBInvertBaked;
+#else
+    int ch1RGBInvert;
+#endif
+#ifdef ch1GeoOverflow
+    int ch1GeoOverflowBaked;
+#else
+    int ch1GeoOverflow;
+#endif
+#ifdef ch1Solarize
+    int ch1SolarizeBaked;
+#else
+    int ch1Solarize;
+#endif
+
+    float ch2MixAmount;
+    vec3 ch2KeyValue;
+    float ch2KeyThreshold;
+    float ch2KeySoft;
+#ifdef ch2MixType
+    int ch2MixTypeBaked;
+#else
+    int ch2MixType;
+#endif
+#ifdef ch2MixOverflow
+    int ch2MixOverflowBaked;
+#else
+    int ch2MixOverflow;
+#endif
+#ifdef ch2KeyOrder
+    int ch2KeyOrderBaked;
+#else
+    int ch2KeyOrder;
+#endif
+
+    vec3 ch2HSBAttenuate;
+    float ch2Posterize;
+    float ch2PosterizeInvert;
+#ifdef ch2PosterizeSwitch
+    int ch2PosterizeSwitchBaked;
+#else
+    int ch2PosterizeSwitch;
+#endif
+    float ch2KaleidoscopeAmount;
+    float ch2KaleidoscopeSlice;
+    float ch2BlurAmount;
+    float ch2BlurRadius;
+    float ch2SharpenAmount;
+    float ch2SharpenRadius;
+    float ch2FiltersBoost;
+
+#ifdef ch2HMirror
+    int ch2HMirrorBaked;
+#else
+    int ch2HMirror;
+#endif
+#ifdef ch2VMirror
+    int ch2VMirrorBaked;
+#else
+    int ch2VMirror;
+#endif
+#ifdef ch2HueInvert
+    int ch2HueInvertBaked;
+#else
+    int ch2HueInvert;
+#endif
+#ifdef ch2SaturationInvert
+    int ch2SaturationInvertBaked;
+#else
+    int ch2SaturationInvert;
+#endif
+#ifdef ch2BrightInvert
+    int ch2BrightInvertBaked;
+#else
+    int ch2BrightInvert;
+#endif
+#ifdef ch2RGBInvert
+    int ch2RGBInvertBaked;
+#else
+    int ch2RGBInvert;
+#endif
+#ifdef ch2GeoOverflow
+    int ch2GeoOverflowBaked;
+#else
+    int ch2GeoOverflow;
+#endif
+#ifdef ch2Solarize
+    int ch2SolarizeBaked;
+#else
+    int ch2Solarize;
+#endif
+
+    float fb1MixAmount;
+    vec3 fb1KeyValue;
+    float fb1KeyThreshold;
+    float fb1KeySoft;
+#ifdef fb1MixType
+    int fb1MixTypeBaked;
+#else
+    int fb1MixType;
+#endif
+#ifdef fb1MixOverflow
+    int fb1MixOverflowBaked;
+#else
+    int fb1MixOverflow;
+#endif
+#ifdef fb1KeyOrder
+    int fb1KeyOrderBaked;
+#else
+    int fb1KeyOrder;
+#endif
+
+    float fb1KaleidoscopeAmount;
+    float fb1KaleidoscopeSlice;
+#ifdef fb1HMirror
+    int fb1HMirrorBaked;
+#else
+    int fb1HMirror;
+#endif
+#ifdef fb1VMirror
+    int fb1VMirrorBaked;
+#else
+    int fb1VMirror;
+#endif
+#ifdef fb1GeoOverflow
+    int fb1GeoOverflowBaked;
+#else
+    int fb1GeoOverflow;
+#endif
+
+    vec3 fb1HSBOffset;
+    vec3 fb1HSBAttenuate;
+    vec3 fb1HSBPowmap;
+    float fb1HueShaper;
+
+    float fb1Posterize;
+    float fb1PosterizeInvert;
+#ifdef fb1PosterizeSwitch
+    int fb1PosterizeSwitchBaked;
+#else
+    int fb1PosterizeSwitch;
+#endif
+#ifdef fb1HueInvert
+    int fb1HueInvertBaked;
+#else
+    int fb1HueInvert;
+#endif
+#ifdef fb1SaturationInvert
+    int fb1SaturationInvertBaked;
+#else
+    int fb1SaturationInvert;
+#endif
+#ifdef fb1BrightInvert
+    int fb1BrightInvertBaked;
+#else
+    int fb1BrightInvert;
+#endif
+
+    //fb1 filters
+    float fb1BlurAmount;
+    float fb1BlurRadius;
+    float fb1SharpenAmount;
+    float fb1SharpenRadius;
+    float fb1TemporalFilter1Amount;
+    float fb1TemporalFilter1Resonance;
+    float fb1TemporalFilter2Amount;
+    float fb1TemporalFilter2Resonance;
+    float fb1FiltersBoost;
+
+    //blur/sharpen pre-pass in use per layer (see BlurPrepass)
+#ifdef ch1BlurPrepass
+    int ch1BlurPrepassBaked;
+#else
+    int ch1BlurPrepass;
+#endif
+#ifdef ch2BlurPrepass
+    int ch2BlurPrepassBaked;
+#else
+    int ch2BlurPrepass;
+#endif
+#ifdef fb1BlurPrepass
+    int fb1BlurPrepassBaked;
+#else
+    int fb1BlurPrepass;
+#endif
+
+    //colour chain LUT in use per layer (see ColorLut)
+#ifdef ch1ColorLutOn
+    int ch1ColorLutOnBaked;
+#else
+    int ch1ColorLutOn;
+#endif
+#ifdef ch2ColorLutOn
+    int ch2ColorLutOnBaked;
+#else
+    int ch2ColorLutOn;
+#endif
+#ifdef fb1ColorLutOn
+    int fb1ColorLutOnBaked;
+#else
+    int fb1ColorLutOn;
+#endif
+
+    //layer can reach the output, 0 skips its fetches (see RenderPaths)
+#ifdef ch1LayerOn
+    int ch1LayerOnBaked;
+#else
+    int ch1LayerOn;
+#endif
+#ifdef ch2LayerOn
+    int ch2LayerOnBaked;
+#else
+    int ch2LayerOn;
+#endif
+
+    //0 = single pass, 1 = channels only (ch1 to output 0, ch2 to output 1),
+    //2 = feedback and mix, reading the channels from ch1Cache/ch2Cache,
+    //3 = bake the ch1/ch2/fb1 warp maps (coordinates to outputs 0/1/2)
+#ifdef block1Stage
+    int block1StageBaked;
+#else
+    int block1Stage;
+#endif
+
+    //layer reads its coordinates from its warp map (see WarpMapCache)
+#ifdef ch1WarpOn
+    int ch1WarpOnBaked;
+#else
+    int ch1WarpOn;
+#endif
+#ifdef ch2WarpOn
+    int ch2WarpOnBaked;
+#else
+    int ch2WarpOn;
+#endif
+#ifdef fb1WarpOn
+    int fb1WarpOnBaked;
+#else
+    int fb1WarpOn;
+#endif
+};
 
 in vec2 texCoordVarying;
 
-out vec4 outputColor;
+layout(location = 0) out vec4 outputColor;
+//same color, written straight into the feedback history layer
+layout(location = 1) out vec4 historyColor;
+//warp map bake only (block1Stage 3): fb1 coordinates
+layout(location = 2) out vec4 fb1WarpOutput;
 
 //color space conversions
 vec3 rgb2hsb(vec3 c)
@@ -173,6 +384,13 @@ vec3 hsb2rgb(vec3 c)
     return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
 }
 
+//3D LUT lookup of a colour chain baked on the CPU (see ColorLut),
+//nodes at the texel centres
+vec3 colorLut(sampler3D lut, vec3 c){
+	float size=float(textureSize(lut,0).x);
+	return textureLod(lut,clamp(c,0.0,1.0)*((size-1.0)/size)+0.5/size,0.0).rgb;
+}
+
 float hueShaper(float inHue,float shaper){
 	inHue=fract(abs(inHue+shaper*sin(inHue*0.3184713) ));
 	return inHue;
@@ -250,6 +468,102 @@ vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord,
     return vec4(hsb2rgb(colorBlurHsb), 1.0);
 }
 
+//same as above, sampling one layer of a texture array
+vec4 blurAndSharpen(sampler2DArray blurAndSharpenTex, float layer, vec2 coord,
+		float sharpenAmount, float sharpenRadius, float sharpenBoost,
+		float blurRadius, float blurAmount) {
+	vec4 originalColor = texture(blurAndSharpenTex, vec3(coord, layer));
+	
+	// Early exit: if blur and sharpen are both disabled, return original color
+	// This saves 16 texture samples per call when filters are off
+	if (blurAmount < 0.001 && sharpenAmount < 0.001) {
+		return originalColor;
+	}
+	
+	vec2 texSize = vec2(textureSize(blurAndSharpenTex, 0).xy);
+
+	vec2 blurSize = vec2(blurRadius) / (texSize - vec2(1));
+	vec2 sharpenSize = vec2(sharpenRadius) / (texSize - vec2(1));
+
+	//blur - 8 samples box blur
+	vec4 colorBlur = originalColor;
+	if (blurAmount >= 0.001) {
+		colorBlur = texture(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1, 1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2( 0, 1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1, 1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1, 0), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1,-1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2( 0,-1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1,-1), layer))
+	                  + texture(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1, 0), layer));
+		colorBlur *= 0.125;
+		colorBlur = mix(originalColor, colorBlur, blurAmount);
+	}
+
+	//sharpen - sample brightness using dot product (faster than HSB conversion)
+	//Using luminance weights: 0.299*R + 0.587*G + 0.114*B
+	vec3 colorBlurHsb = rgb2hsb(colorBlur.rgb);
+	
+	if (sharpenAmount >= 0.001) {
+		const vec3 lumWeights = vec3(0.299, 0.587, 0.114);
+		float color_sharpen_bright =
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1, 0), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1, 0), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 0, 1), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 0,-1), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1, 1), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1, 1), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1,-1), layer)).rgb, lumWeights)+
+			dot(texture(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1,-1), layer)).rgb, lumWeights);
+
+	    color_sharpen_bright *= 0.125;
+	    colorBlurHsb.z -= sharpenAmount * color_sharpen_bright;
+	}
+
+    // Use mix() instead of if() to avoid branching
+    float boostFactor = mix(1.0, 1.0 + sharpenAmount + sharpenBoost, step(0.001, sharpenAmount));
+    colorBlurHsb.z *= boostFactor;
+
+    return vec4(hsb2rgb(colorBlurHsb), 1.0);
+}
+
+//blurAndSharpen reading the BlurPrepass neighbourhood texture instead of
+//taking 16 taps: rgb is the average of the 8 blur taps, a the average
+//brightness of the 8 sharpen taps around coord
+vec4 blurAndSharpenPrepass(sampler2D blurAndSharpenTex, sampler2D prepassTex, vec2 coord,
+		float sharpenAmount, float sharpenBoost, float blurAmount) {
+	vec4 originalColor = texture(blurAndSharpenTex, coord);
+	vec4 neighbours = texture(prepassTex, coord);
+
+	vec4 colorBlur=mix(originalColor,vec4(neighbours.rgb,originalColor.a),blurAmount);
+
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*neighbours.a;
+
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
+vec4 blurAndSharpenPrepass(sampler2DArray blurAndSharpenTex, float layer, sampler2D prepassTex, vec2 coord,
+		float sharpenAmount, float sharpenBoost, float blurAmount) {
+	vec4 originalColor = texture(blurAndSharpenTex, vec3(coord, layer));
+	vec4 neighbours = texture(prepassTex, coord);
+
+	vec4 colorBlur=mix(originalColor,vec4(neighbours.rgb,originalColor.a),blurAmount);
+
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*neighbours.a;
+
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
 
 vec2 rotate(vec2 coord,float theta,int mode){
 
@@ -384,19 +698,6 @@ vec2 kaleidoscope1(vec2 inCoord, float segment, float slice){
 }
 
 
-//takes in coords and shears them
-vec2 shear(vec2 inCoord, vec4 shearMatrix){
-	inCoord.x-=width/2.0;
-	inCoord.y-=height/2.0;
-
-	inCoord.x=shearMatrix.x*inCoord.x+shearMatrix.y*inCoord.y;
-	inCoord.y=shearMatrix.z*inCoord.x+shearMatrix.w*inCoord.y;
-
-	inCoord.x+=width/2.0;
-	inCoord.y+=height/2.0;
-	return inCoord;
-}
-
 
 float mirror(float a){
 	if(a > 0.0) return a;
@@ -607,36 +908,11 @@ float solarize(float inBright){
 	return inBright;
 }
 
-void main()
-{
-	//CHANNEL1-
+//per-layer coordinates: everything the geometry parameters do to a pixel
+vec2 ch1Geometry(){
 	// input coords
-	vec2 ch1UV = texCoordVarying;
-	vec2 ch1Coords = ch1UV*vec2(width,height);
-
-	ch1Coords.x*=ch1AspectRatio;
-	//this centers image but not coords
-	ch1Coords.x-=ch1CribX;
-
-	//this centers coords so scaling works properly around the center
-	ch1Coords-=vec2(width/2.0, height/2.0);
-	ch1Coords*=ch1ScaleFix+ch1HdZCrib;
-	ch1Coords+=vec2(width/2.0, height/2.0);
-
-	//new hd fix attempt
-	if(ch1HdAspectOn==1){
-		ch1Coords=ch1UV*vec2(width,height);
-		ch1Coords.y=ch1HdAspectXYFix.y*ch1Coords.y;
-		ch1Coords.x=ch1HdAspectXYFix.x*ch1Coords.x;
-	}
-
-
-	if(ch1HFlip==1){
-		ch1Coords.x=width-ch1Coords.x;
-	}
-	if(ch1VFlip==1){
-		ch1Coords.y=height-ch1Coords.y;
-	}
+	//input mapping and flips, composed on the CPU (see LayerTransform)
+	vec2 ch1Coords=(ch1PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
 
 	if(ch1HMirror==1){
         if(ch1Coords.x>width/2.0){ch1Coords.x=abs(width-ch1Coords.x);}
@@ -648,24 +924,90 @@ void main()
 	ch1Coords=kaleidoscope1(ch1Coords,ch1KaleidoscopeAmount,ch1KaleidoscopeSlice);
 
 
-	ch1Coords+=ch1XYDisplace;
-
-	//zdisplace
-	ch1Coords-=vec2(width/2.0,height/2.0);
-	ch1Coords=ch1Coords*(ch1ZDisplace);
-	//gonna need to double check this
-	//ch1Coords=ch1Coords*(1.0+ch1ZDisplace+ch1HdZCrib);
-	ch1Coords+=vec2(width/2.0,height/2.0);
-
-	ch1Coords=rotate1(ch1Coords,ch1Rotate,0);
+	//displace, zoom and rotate, composed on the CPU (see LayerTransform)
+	ch1Coords=(ch1Transform*vec3(ch1Coords,1.0)).xy;
 
 	if(ch1GeoOverflow==1){ch1Coords=wrapCoord1(ch1Coords);}
 	if(ch1GeoOverflow==2){ch1Coords=mirrorCoord1(ch1Coords);}
 
+	return ch1Coords;
+}
+
+vec2 ch2Geometry(){
+	//input mapping and flips, composed on the CPU (see LayerTransform)
+	vec2 ch2Coords=(ch2PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
+
+	if(ch2HMirror==1){
+        if(ch2Coords.x>width/2.0){ch2Coords.x=abs(width-ch2Coords.x);}
+    }//endifhflip1
+    if(ch2VMirror==1){
+        if(ch2Coords.y>height/2.0){ch2Coords.y=abs(height-ch2Coords.y);}
+    }//endifvflip1
+
+	ch2Coords=kaleidoscope1(ch2Coords,ch2KaleidoscopeAmount,ch2KaleidoscopeSlice);
+
+
+	//displace, zoom and rotate, composed on the CPU (see LayerTransform)
+	ch2Coords=(ch2Transform*vec3(ch2Coords,1.0)).xy;
+
+	if(ch2GeoOverflow==1){ch2Coords=wrapCoord1(ch2Coords);}
+	if(ch2GeoOverflow==2){ch2Coords=mirrorCoord1(ch2Coords);}
+
+	return ch2Coords;
+}
+
+vec2 fb1Geometry(){
+	//flips, composed on the CPU (see LayerTransform)
+	vec2 fb1Coords=(fb1PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
+
+
+	if(fb1HMirror==1){
+        if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
+    }//endifhflip1
+    if(fb1VMirror==1){
+        if(fb1Coords.y>height/2){fb1Coords.y=abs(height-fb1Coords.y);}
+    }//endifvflip1
+
+	fb1Coords=kaleidoscope(fb1Coords,fb1KaleidoscopeAmount,fb1KaleidoscopeSlice);
+	/*
+	if(fb1HMirror==1){
+        //if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
+        if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
+    }//endifhflip1
+    if(fb1VMirror==1){
+        if(fb1Coords.y>height/2){fb1Coords.y=abs(height-fb1Coords.y);}
+    }//endifvflip1
+    */
+	//fb1Coords=kaleidoscope(fb1Coords,5.0,fb1KaleidoscopeSlice);
+	//displace, zoom, rotate and shear, composed on the CPU (see LayerTransform)
+	fb1Coords=(fb1Transform*vec3(fb1Coords,1.0)).xy;
+
+	if(fb1GeoOverflow==1){fb1Coords=wrapCoord(fb1Coords);}
+	if(fb1GeoOverflow==2){fb1Coords=mirrorCoord(fb1Coords);}
+
+	return fb1Coords;
+}
+
+//CHANNEL1-
+vec4 channel1Color(){
+	//geometry, from the baked warp map while its parameters are still (see WarpMapCache)
+	vec2 ch1Coords;
+	if(ch1WarpOn==1){ch1Coords=texture(ch1WarpMap,texCoordVarying).xy;}
+	else{ch1Coords=ch1Geometry();}
+
 
 	//add blur and sharpen here
-	vec4 ch1Color=blurAndSharpen(ch1Tex,(ch1Coords/vec2(width,height)),ch1SharpenAmount,ch1SharpenRadius,
-		ch1FiltersBoost,ch1BlurRadius,ch1BlurAmount);
+	vec4 ch1Color=vec4(0.0);
+	if(ch1LayerOn==0){
+		//culled, doesn't reach the output
+	}
+	else if(ch1BlurPrepass==1){
+		ch1Color=blurAndSharpenPrepass(ch1Tex,ch1Prepass,(ch1Coords/vec2(width,height)),ch1SharpenAmount,ch1FiltersBoost,ch1BlurAmount);
+	}
+	else{
+		ch1Color=blurAndSharpen(ch1Tex,(ch1Coords/vec2(width,height)),ch1SharpenAmount,ch1SharpenRadius,
+			ch1FiltersBoost,ch1BlurRadius,ch1BlurAmount);
+	}
 
     //vec4 ch1Color = texture(ch1Tex, ch1Coords/vec2(width,height));
 	//ch1Color.rgb=1.0-ch1Color.rgb;
@@ -678,39 +1020,44 @@ void main()
     //ch1Color.rgb+=ch1HSBAttenuate;
     //experiment more with this...
 	//ch1Color.rgb+=(1.0-ch1HSBAttenuate);
-	vec3 ch1ColorHSB=rgb2hsb(ch1Color.rgb);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(ch1ColorLutOn==1){
+		ch1Color.rgb=colorLut(ch1ColorLut,ch1Color.rgb);
+	}
+	else{
+		vec3 ch1ColorHSB=rgb2hsb(ch1Color.rgb);
 
-	//ch1ColorHSB*=ch1HSBAttenuate;
-	ch1ColorHSB=pow(ch1ColorHSB,ch1HSBAttenuate);
+		//ch1ColorHSB*=ch1HSBAttenuate;
+		ch1ColorHSB=pow(ch1ColorHSB,ch1HSBAttenuate);
 
 
-	//inverts
-	if(ch1HueInvert==1){ch1ColorHSB.x=1.0-ch1ColorHSB.x;}
-	if(ch1SaturationInvert==1){ch1ColorHSB.y=1.0-ch1ColorHSB.y;}
-	if(ch1BrightInvert==1){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
+		//inverts
+		if(ch1HueInvert==1){ch1ColorHSB.x=1.0-ch1ColorHSB.x;}
+		if(ch1SaturationInvert==1){ch1ColorHSB.y=1.0-ch1ColorHSB.y;}
+		if(ch1BrightInvert==1){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
 
-	ch1ColorHSB.x=fract(ch1ColorHSB.x);
+		ch1ColorHSB.x=fract(ch1ColorHSB.x);
 
-	if(ch1Solarize==1){
-		ch1ColorHSB.z=solarize(ch1ColorHSB.z);
-		//if(ch1ColorHSB.z>.5){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
-	}
+		if(ch1Solarize==1){
+			ch1ColorHSB.z=solarize(ch1ColorHSB.z);
+			//if(ch1ColorHSB.z>.5){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
+		}
 
-	ch1Color.rgb=hsb2rgb(ch1ColorHSB);
+		ch1Color.rgb=hsb2rgb(ch1ColorHSB);
 
 
-	if(ch1RGBInvert==1){ch1Color.rgb=1.0-ch1Color.rgb;}
+		if(ch1RGBInvert==1){ch1Color.rgb=1.0-ch1Color.rgb;}
+	}
 
 	if(ch1PosterizeSwitch==1){
 		ch1Color.rgb=colorQuantize(ch1Color.rgb,ch1Posterize,ch1PosterizeInvert);
 	}
 
+	return ch1Color;
+}
 
-
-
-
-
-
+//CHANNEL2
+vec4 channel2Color(){
 	/*
 	//CHANNEL2
 	vec2 ch2Coords=texCoordVarying*ratio;
@@ -738,153 +1085,127 @@ void main()
 
 
 	// CHANNEL2
-	// Input coords - use texCoordVarying directly, input textures are scaled to internal resolution
-	vec2 ch2Coords = texCoordVarying*vec2(width,height);
-
-	// Apply aspect ratio adjustment
-	ch2Coords.x *= ch2AspectRatio;
-
-	// Apply crib offset
-	ch2Coords.x -= ch2CribX;
-
-	// Apply scale around center
-	ch2Coords -= vec2(width/2.0, height/2.0);
-	ch2Coords *= ch2ScaleFix + ch2HdZCrib;
-	ch2Coords += vec2(width/2.0, height/2.0);
-
-	// HD aspect fix override
-	if(ch2HdAspectOn==1){
-		ch2Coords = texCoordVarying*vec2(width,height);
-		ch2Coords.y = ch1HdAspectXYFix.y * ch2Coords.y;
-		ch2Coords.x = ch1HdAspectXYFix.x * ch2Coords.x;
+	//geometry, from the baked warp map while its parameters are still (see WarpMapCache)
+	vec2 ch2Coords;
+	if(ch2WarpOn==1){ch2Coords=texture(ch2WarpMap,texCoordVarying).xy;}
+	else{ch2Coords=ch2Geometry();}
+
+	vec4 ch2Color=vec4(0.0);
+	if(ch2LayerOn==0){
+		//culled, doesn't reach the output
 	}
-
-
-	if(ch2HFlip==1){
-		ch2Coords.x=width-ch2Coords.x;
+	else if(ch2BlurPrepass==1){
+		ch2Color=blurAndSharpenPrepass(ch2Tex,ch2Prepass,(ch2Coords/vec2(width,height)),ch2SharpenAmount,ch2FiltersBoost,ch2BlurAmount);
 	}
-	if(ch2VFlip==1){
-		ch2Coords.y=height-ch2Coords.y;
+	else{
+		ch2Color=blurAndSharpen(ch2Tex,(ch2Coords/vec2(width,height)),ch2SharpenAmount,ch2SharpenRadius,
+			ch2FiltersBoost,ch2BlurRadius,ch2BlurAmount);
 	}
 
-	if(ch2HMirror==1){
-        if(ch2Coords.x>width/2.0){ch2Coords.x=abs(width-ch2Coords.x);}
-    }//endifhflip1
-    if(ch2VMirror==1){
-        if(ch2Coords.y>height/2.0){ch2Coords.y=abs(height-ch2Coords.y);}
-    }//endifvflip1
-
-	ch2Coords=kaleidoscope1(ch2Coords,ch2KaleidoscopeAmount,ch2KaleidoscopeSlice);
-
-
-	ch2Coords+=ch2XYDisplace;
-
-	//zdisplace
-	ch2Coords-=vec2(width/2.0,height/2.0);
-	ch2Coords=ch2Coords*(ch2ZDisplace);
-	//gonna need to double check this
-	//ch2Coords=ch2Coords*(1.0+ch2ZDisplace+ch2HdZCrib);
-	ch2Coords+=vec2(width/2.0,height/2.0);
-
-	ch2Coords=rotate1(ch2Coords,ch2Rotate,0);
-
-	if(ch2GeoOverflow==1){ch2Coords=wrapCoord1(ch2Coords);}
-	if(ch2GeoOverflow==2){ch2Coords=mirrorCoord1(ch2Coords);}
-
-	vec4 ch2Color=blurAndSharpen(ch2Tex,(ch2Coords/vec2(width,height)),ch2SharpenAmount,ch2SharpenRadius,
-		ch2FiltersBoost,ch2BlurRadius,ch2BlurAmount);
-
 
 	//clamp shits out
 	if(ch2Coords.x>width || ch2Coords.y>height || ch2Coords.x<0.0 || ch2Coords.y<0.0){
 		ch2Color=vec4(0.0);
 	}
 
-	vec3 ch2ColorHSB=rgb2hsb(ch2Color.rgb);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(ch2ColorLutOn==1){
+		ch2Color.rgb=colorLut(ch2ColorLut,ch2Color.rgb);
+	}
+	else{
+		vec3 ch2ColorHSB=rgb2hsb(ch2Color.rgb);
 
-	ch2ColorHSB=pow(ch2ColorHSB,ch2HSBAttenuate);
+		ch2ColorHSB=pow(ch2ColorHSB,ch2HSBAttenuate);
 
-	//ch2ColorHSB*=ch2HSBAttenuate;
+		//ch2ColorHSB*=ch2HSBAttenuate;
 
-	/*
-	if(ch2PosterizeSwitch==1){
-		ch2ColorHSB=colorQuantize(ch2ColorHSB,ch2Posterize,ch2PosterizeInvert);
-	}
-	*/
+		/*
+		if(ch2PosterizeSwitch==1){
+			ch2ColorHSB=colorQuantize(ch2ColorHSB,ch2Posterize,ch2PosterizeInvert);
+		}
+		*/
 
-	//inverts
-	if(ch2HueInvert==1){ch2ColorHSB.x=1.0-ch2ColorHSB.x;}
-	if(ch2SaturationInvert==1){ch2ColorHSB.y=1.0-ch2ColorHSB.y;}
-	if(ch2BrightInvert==1){ch2ColorHSB.z=1.0-ch2ColorHSB.z;}
+		//inverts
+		if(ch2HueInvert==1){ch2ColorHSB.x=1.0-ch2ColorHSB.x;}
+		if(ch2SaturationInvert==1){ch2ColorHSB.y=1.0-ch2ColorHSB.y;}
+		if(ch2BrightInvert==1){ch2ColorHSB.z=1.0-ch2ColorHSB.z;}
 
-	ch2ColorHSB.x=fract(ch2ColorHSB.x);
+		ch2ColorHSB.x=fract(ch2ColorHSB.x);
 
-	if(ch2Solarize==1){
-		ch2ColorHSB.z=solarize(ch2ColorHSB.z);
-		//if(ch1ColorHSB.z>.5){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
-	}
+		if(ch2Solarize==1){
+			ch2ColorHSB.z=solarize(ch2ColorHSB.z);
+			//if(ch1ColorHSB.z>.5){ch1ColorHSB.z=1.0-ch1ColorHSB.z;}
+		}
 
-	ch2Color.rgb=hsb2rgb(ch2ColorHSB);
+		ch2Color.rgb=hsb2rgb(ch2ColorHSB);
 
 
-	if(ch2RGBInvert==1){ch2Color.rgb=1.0-ch2Color.rgb;}
+		if(ch2RGBInvert==1){ch2Color.rgb=1.0-ch2Color.rgb;}
+	}
 
 	if(ch2PosterizeSwitch==1){
 		ch2Color.rgb=colorQuantize(ch2Color.rgb,ch2Posterize,ch2PosterizeInvert);
 	}
 
+	return ch2Color;
+}
 
+void main()
+{
+	//warp map bake: each layer's coordinates instead of colours (see WarpMapCache)
+	if(block1Stage==3){
+		outputColor=vec4(ch1Geometry(),0.0,1.0);
+		historyColor=vec4(ch2Geometry(),0.0,1.0);
+		fb1WarpOutput=vec4(fb1Geometry(),0.0,1.0);
+		return;
+	}
 
-
-
-
-	//fb1
-	vec2 fb1Coords=texCoordVarying*vec2(width,height);
-	vec2 center=vec2(width/2.0,height/2.0);
-	//geometry
-	if(fb1HFlip==1){
-		fb1Coords.x=width-fb1Coords.x;
+	//channels, or their results cached by an earlier pass (see ChannelCache)
+	vec4 ch1Color=vec4(0.0);
+	vec4 ch2Color=vec4(0.0);
+	if(block1Stage==2){
+		if(ch1LayerOn==1){ch1Color=texture(ch1Cache,texCoordVarying);}
+		if(ch2LayerOn==1){ch2Color=texture(ch2Cache,texCoordVarying);}
 	}
-	if(fb1VFlip==1){
-		fb1Coords.y=height-fb1Coords.y;
+	else{
+		ch1Color=channel1Color();
+		ch2Color=channel2Color();
+	}
+	if(block1Stage==1){
+		outputColor=ch1Color;
+		historyColor=ch2Color;
+		return;
 	}
 
 
-	if(fb1HMirror==1){
-        if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
-    }//endifhflip1
-    if(fb1VMirror==1){
-        if(fb1Coords.y>height/2){fb1Coords.y=abs(height-fb1Coords.y);}
-    }//endifvflip1
-
-	fb1Coords=kaleidoscope(fb1Coords,fb1KaleidoscopeAmount,fb1KaleidoscopeSlice);
-	/*
-	if(fb1HMirror==1){
-        //if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
-        if(fb1Coords.x>width/2){fb1Coords.x=abs(width-fb1Coords.x);}
-    }//endifhflip1
-    if(fb1VMirror==1){
-        if(fb1Coords.y>height/2){fb1Coords.y=abs(height-fb1Coords.y);}
-    }//endifvflip1
-    */
-	//fb1Coords=kaleidoscope(fb1Coords,5.0,fb1KaleidoscopeSlice);
-	fb1Coords+=fb1XYDisplace;
-	fb1Coords-=center;
-	fb1Coords*=fb1ZDisplace;
-	fb1Coords+=center;
-
-	fb1Coords=rotate(fb1Coords,fb1Rotate,fb1RotateMode);
-
-	fb1Coords=shear(fb1Coords,fb1ShearMatrix);
-
-	if(fb1GeoOverflow==1){fb1Coords=wrapCoord(fb1Coords);}
-	if(fb1GeoOverflow==2){fb1Coords=mirrorCoord(fb1Coords);}
+	//fb1
+	//geometry, from the baked warp map while its parameters are still (see WarpMapCache)
+	vec2 fb1Coords;
+	if(fb1WarpOn==1){fb1Coords=texture(fb1WarpMap,texCoordVarying).xy;}
+	else{fb1Coords=fb1Geometry();}
 
 
 
 	//vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord, float sharpenAmount, float sharpenRadius, float sharpenBoost,float blurRadius,float blurAmount)
-	vec4 fb1Color=blurAndSharpen(tex0,(fb1Coords/vec2(width,height)),fb1SharpenAmount,fb1SharpenRadius,
-		fb1FiltersBoost,fb1BlurRadius,fb1BlurAmount);
+	vec4 fb1Color=vec4(0.0,0.0,0.0,1.0);
+	if(fb1DelayLayer>=0 && fb1DelayTier==0){
+		if(fb1BlurPrepass==1){
+			fb1Color=blurAndSharpenPrepass(fb1History,float(fb1DelayLayer),fb1Prepass,(fb1Coords/vec2(width,height)),fb1SharpenAmount,fb1FiltersBoost,fb1BlurAmount);
+		}
+		else{
+			fb1Color=blurAndSharpen(fb1History,float(fb1DelayLayer),(fb1Coords/vec2(width,height)),fb1SharpenAmount,fb1SharpenRadius,
+				fb1FiltersBoost,fb1BlurRadius,fb1BlurAmount);
+		}
+	}
+	else if(fb1DelayLayer>=0){
+		if(fb1BlurPrepass==1){
+			fb1Color=blurAndSharpenPrepass(fb1HistoryOlder,float(fb1DelayLayer),fb1Prepass,(fb1Coords/vec2(width,height)),fb1SharpenAmount,fb1FiltersBoost,fb1BlurAmount);
+		}
+		else{
+			fb1Color=blurAndSharpen(fb1HistoryOlder,float(fb1DelayLayer),(fb1Coords/vec2(width,height)),fb1SharpenAmount,fb1SharpenRadius,
+				fb1FiltersBoost,fb1BlurRadius,fb1BlurAmount);
+		}
+	}
 
 	//vec4 fb1Color=texture(tex0, fb1Coords);
 
@@ -898,29 +1219,35 @@ void main()
 	}
 
 	//fb1 color biz
-	vec3 fb1ColorHSB=rgb2hsb(fb1Color.rgb);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(fb1ColorLutOn==1){
+		fb1Color.rgb=colorLut(fb1ColorLut,fb1Color.rgb);
+	}
+	else{
+		vec3 fb1ColorHSB=rgb2hsb(fb1Color.rgb);
 
-	fb1ColorHSB.x=hueShaper(fb1ColorHSB.x,fb1HueShaper);
-	fb1ColorHSB+=fb1HSBOffset;
-	fb1ColorHSB*=fb1HSBAttenuate;
-	fb1ColorHSB=pow(fb1ColorHSB,fb1HSBPowmap);
+		fb1ColorHSB.x=hueShaper(fb1ColorHSB.x,fb1HueShaper);
+		fb1ColorHSB+=fb1HSBOffset;
+		fb1ColorHSB*=fb1HSBAttenuate;
+		fb1ColorHSB=pow(fb1ColorHSB,fb1HSBPowmap);
 
-	/*
-	if(fb1PosterizeSwitch==1){
-		fb1ColorHSB=colorQuantize(fb1ColorHSB,fb1Posterize,fb1PosterizeInvert);
-	}
-	*/
-	//inverts
-	if(fb1HueInvert==1){fb1ColorHSB.x=1.0-fb1ColorHSB.x;}
-	if(fb1SaturationInvert==1){fb1ColorHSB.y=1.0-fb1ColorHSB.y;}
-	if(fb1BrightInvert==1){fb1ColorHSB.z=1.0-fb1ColorHSB.z;}
+		/*
+		if(fb1PosterizeSwitch==1){
+			fb1ColorHSB=colorQuantize(fb1ColorHSB,fb1Posterize,fb1PosterizeInvert);
+		}
+		*/
+		//inverts
+		if(fb1HueInvert==1){fb1ColorHSB.x=1.0-fb1ColorHSB.x;}
+		if(fb1SaturationInvert==1){fb1ColorHSB.y=1.0-fb1ColorHSB.y;}
+		if(fb1BrightInvert==1){fb1ColorHSB.z=1.0-fb1ColorHSB.z;}
 
 
-	fb1ColorHSB.x=fract(fb1ColorHSB.x);
-	fb1ColorHSB.y=clamp(fb1ColorHSB.y,0.0,1.0);
-	fb1ColorHSB.z=clamp(fb1ColorHSB.z,0.0,1.0);
+		fb1ColorHSB.x=fract(fb1ColorHSB.x);
+		fb1ColorHSB.y=clamp(fb1ColorHSB.y,0.0,1.0);
+		fb1ColorHSB.z=clamp(fb1ColorHSB.z,0.0,1.0);
 
-	fb1Color.rgb=hsb2rgb(fb1ColorHSB);
+		fb1Color.rgb=hsb2rgb(fb1ColorHSB);
+	}
 
 	if(fb1PosterizeSwitch==1){
 		fb1Color.rgb=colorQuantize(fb1Color.rgb,fb1Posterize,fb1PosterizeInvert);
@@ -938,7 +1265,10 @@ void main()
 		fb1KeySoft,fb1KeyValue,fb1KeyOrder,fb1MixOverflow,vec4(0.0,0.0,0.0,0.0),0);
 
 	//temporal filter
-	vec4 temporalFilter1Color=texture(fb1TemporalFilter,texCoordVarying);
+	vec4 temporalFilter1Color=vec4(0.0,0.0,0.0,1.0);
+	if(fb1TemporalLayer>=0){
+		temporalFilter1Color=texture(fb1History,vec3(texCoordVarying,float(fb1TemporalLayer)));
+	}
 	vec3 temporalFilter1ColorHSB=rgb2hsb(temporalFilter1Color.rgb);
 	vec3 temporalFilter2ColorHSB=temporalFilter1ColorHSB;
 
@@ -958,4 +1288,5 @@ void main()
 
 	outColor.a=1.0;
 	outputColor=outColor;
+	historyColor=outColor;
 }
@@ -0,0 +1,54 @@
+#version 460
+
+//separable blur/sharpen neighbourhood pre-pass (see BlurPrepass)
+//
+//blurAndSharpen() averages 8 blur taps (a 3x3 ring at blurRadius) and the
+//brightness of 8 sharpen taps (a 3x3 ring at sharpenRadius). A 3x3 box is
+//separable, so pass 0 sums 3 horizontal taps, pass 1 sums 3 vertical taps
+//of that and subtracts the centre to get the ring:
+//  rgb = average blur colour, a = average sharpen brightness
+
+layout(location = 4) uniform sampler2D srcTex;
+layout(location = 5) uniform sampler2DArray srcArray;
+layout(location = 6) uniform int srcLayer;            //-1 = read srcTex, otherwise this srcArray layer
+layout(location = 7) uniform sampler2D horizontalTex;  //pass 0 result, read in pass 1
+layout(location = 8) uniform int pass;
+layout(location = 9) uniform vec2 blurStep;            //tap spacing in texture coordinates
+layout(location = 10) uniform vec2 sharpenStep;
+
+in vec2 texCoordVarying;
+
+out vec4 outputColor;
+
+vec4 source(vec2 uv){
+	if(srcLayer<0){
+		return textureLod(srcTex, uv, 0);
+	}
+	return textureLod(srcArray, vec3(uv, float(srcLayer)), 0);
+}
+
+//same as rgb2hsb(c).z
+float bright(vec4 c){
+	return max(c.r,max(c.g,c.b));
+}
+
+vec4 horizontal(vec2 uv, vec2 offset){
+	return textureLod(horizontalTex, uv + offset, 0);
+}
+
+void main()
+{
+	vec2 uv=texCoordVarying;
+	vec4 center=source(uv);
+
+	if(pass==0){
+		vec3 blur=source(uv-vec2(blurStep.x,0.0)).rgb+center.rgb+source(uv+vec2(blurStep.x,0.0)).rgb;
+		float sharpen=bright(source(uv-vec2(sharpenStep.x,0.0)))+bright(center)+bright(source(uv+vec2(sharpenStep.x,0.0)));
+		outputColor=vec4(blur,sharpen);
+	}
+	else{
+		vec3 blur=horizontal(uv,vec2(0.0,-blurStep.y)).rgb+horizontal(uv,vec2(0.0)).rgb+horizontal(uv,vec2(0.0,blurStep.y)).rgb;
+		float sharpen=horizontal(uv,vec2(0.0,-sharpenStep.y)).a+horizontal(uv,vec2(0.0)).a+horizontal(uv,vec2(0.0,sharpenStep.y)).a;
+		outputColor=vec4((blur-center.rgb)*0.125,(sharpen-bright(center))*0.125);
+	}
+}
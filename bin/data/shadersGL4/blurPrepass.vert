@@ -0,0 +1,16 @@
+#version 460
+
+// these are for the programmable pipeline system
+layout(location = 0) uniform mat4 modelViewProjectionMatrix;  // locations 0-3
+
+in vec4 position;
+in vec2 texcoord;
+
+out vec2 texCoordVarying;
+
+void main()
+{
+    texCoordVarying = texcoord;
+
+	gl_Position = modelViewProjectionMatrix * position;
+}
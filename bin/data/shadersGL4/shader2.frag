@@ -1,120 +1,246 @@
 #version 460
 
-uniform int block2InputHdAspectOn;
-uniform vec2 block2InputHdAspectXYFix;
-
 const float PI=3.1415926535;
 const float TWO_PI=6.2831855;
 
-
-uniform sampler2D block2InputTex;
-uniform sampler2D tex0; //fb2 for now
-uniform sampler2D fb2TemporalFilter;
-
-uniform float ratio;
-uniform float block2AspectRatio;
-
-uniform float width;
-uniform float height;
-uniform float inverseWidth;
-uniform float inverseHeight;
-uniform float inverseWidth1;
-uniform float inverseHeight1;
-
-// Input resolution uniforms
-uniform float input1Width;
-uniform float input1Height;
-
-uniform int block2InputMasterSwitch;
-
-uniform float block2InputWidth;
-uniform float block2InputHeight;
-uniform float block2InputWidthHalf;
-uniform float block2InputHeightHalf;
-
-uniform float block2InputAspectRatio;
-uniform float block2InputHdZCrib;
-uniform float block2InputScaleFix;
-uniform float block2InputCribX;
-
-uniform vec2 block2InputXYDisplace;
-uniform float block2InputZDisplace;
-uniform float block2InputRotate;
-uniform vec3 block2InputHSBAttenuate;
-uniform float block2InputPosterize;
-uniform float block2InputPosterizeInvert;
-uniform int block2InputPosterizeSwitch;
-uniform float block2InputKaleidoscopeAmount;
-uniform float block2InputKaleidoscopeSlice;
-uniform float block2InputBlurAmount;
-uniform float block2InputBlurRadius;
-uniform float block2InputSharpenAmount;
-uniform float block2InputSharpenRadius;
-uniform float block2InputFiltersBoost;
-
-
-uniform int block2InputHMirror;
-uniform int block2InputVMirror;
-uniform int block2InputHFlip;
-uniform int block2InputVFlip;
-uniform int block2InputHueInvert;
-uniform int block2InputSaturationInvert;
-uniform int block2InputBrightInvert;
-uniform int block2InputRGBInvert;
-uniform int block2InputGeoOverflow;
-uniform int block2InputSolarize;
-
-
-uniform float fb2MixAmount;
-uniform vec3 fb2KeyValue;
-uniform float fb2KeyThreshold;
-uniform float fb2KeySoft;
-uniform int fb2MixType;
-uniform int fb2MixOverflow;
-uniform int fb2KeyOrder;
-
-uniform vec2 fb2XYDisplace;
-uniform float fb2ZDisplace;
-uniform float fb2Rotate;
-uniform vec4 fb2ShearMatrix;
-uniform float fb2KaleidoscopeAmount;
-uniform float fb2KaleidoscopeSlice;
-uniform int fb2HMirror;
-uniform int fb2VMirror;
-uniform int fb2HFlip;
-uniform int fb2VFlip;
-
-uniform int	fb2RotateMode;
-uniform	int fb2GeoOverflow;
-
-uniform vec3 fb2HSBOffset;
-uniform vec3 fb2HSBAttenuate;
-uniform vec3 fb2HSBPowmap;
-uniform float fb2HueShaper;
-
-uniform float fb2Posterize;
-uniform float fb2PosterizeInvert;
-uniform int fb2PosterizeSwitch;
-uniform int fb2HueInvert;
-uniform int fb2SaturationInvert;
-uniform int fb2BrightInvert;
-
-//fb2 filters
-uniform	float fb2BlurAmount;
-uniform	float fb2BlurRadius;
-uniform	float fb2SharpenAmount;
-uniform	float fb2SharpenRadius;
-uniform	float fb2TemporalFilter1Amount;
-uniform	float fb2TemporalFilter1Resonance;
-uniform	float fb2TemporalFilter2Amount;
-uniform	float fb2TemporalFilter2Resonance;
-uniform float fb2FiltersBoost;
+//plain uniforms have explicit locations so a cached program binary
+//can be restored (see ShaderLoader)
+layout(location = 4) uniform sampler2D block2InputTex;
+//feedback history, one texture array layer per past frame (-1 = empty)
+//newest frames in fb2History, older ones in fb2HistoryOlder (lower quality)
+layout(location = 5) uniform sampler2DArray fb2History;
+layout(location = 6) uniform sampler2DArray fb2HistoryOlder;
+layout(location = 7) uniform int fb2DelayTier;
+layout(location = 8) uniform int fb2DelayLayer;
+layout(location = 9) uniform int fb2TemporalLayer;
+
+//blur/sharpen pre-pass results, bound when <layer>BlurPrepass is 1 (see BlurPrepass)
+layout(location = 10) uniform sampler2D block2InputPrepass;
+layout(location = 11) uniform sampler2D fb2Prepass;
+
+//colour chain LUTs, sampled when <layer>ColorLutOn is 1 (see ColorLut)
+layout(location = 12) uniform sampler3D block2InputColorLut;
+layout(location = 13) uniform sampler3D fb2ColorLut;
+
+//baked fb2 coordinates, sampled when fb2WarpOn is 1 (see WarpMapCache)
+layout(location = 14) uniform sampler2D fb2WarpMap;
+
+//parameters, uploaded as one uniform buffer (see ParamBuffer)
+//int switches are #defined to constants in specialized variants
+//(see ShaderVariantCache); their slots stay so the layout matches
+layout(std140) uniform Block2Params {
+    //per-layer coordinate transforms, composed on the CPU (see LayerTransform)
+    mat3 block2InputPreTransform;
+    mat3 block2InputTransform;
+    mat3 fb2PreTransform;
+    mat3 fb2Transform;
+
+    float ratio;
+    float block2AspectRatio;
+
+    float width;
+    float height;
+    float inverseWidth;
+    float inverseHeight;
+    float inverseWidth1;
+    float inverseHeight1;
+
+    // Input resolution uniforms
+    float input1Width;
+    float input1Height;
+
+    float block2InputWidth;
+    float block2InputHeight;
+    float block2InputWidthHalf;
+    float block2InputHeightHalf;
+
+    vec3 block2InputHSBAttenuate;
+    float block2InputPosterize;
+    float block2InputPosterizeInvert;
+#ifdef block2InputPosterizeSwitch
+    int block2InputPosterizeSwitchBaked;
+#else
+    int block2InputPosterizeSwitch;
+#endif
+    float block2InputKaleidoscopeAmount;
+    float block2InputKaleidoscopeSlice;
+    float block2InputBlurAmount;
+    float block2InputBlurRadius;
+    float block2InputSharpenAmount;
+    float block2InputSharpenRadius;
+    float block2InputFiltersBoost;
+
+#ifdef block2InputHMirror
+    int block2InputHMirrorBaked;
+#else
+    int block2InputHMirror;
+#endif
+#ifdef block2InputVMirror
+    int block2InputVMirrorBaked;
+#else
+    int block2InputVMirror;
+#endif
+#ifdef block2InputHueInvert
+    int block2InputHueInvertBaked;
+#else
+    int block2InputHueInvert;
+#endif
+#ifdef block2InputSaturationInvert
+    int block2InputSaturationInvertBaked;
+#else
+    int block2InputSaturationInvert;
+#endif
+#ifdef block2InputBrightInvert
+    int block2InputBrightInvertBaked;
+#else
+    int block2InputBrightInvert;
+#endif
+#ifdef block2InputRGBInvert
+    int block2InputRGBInvertBaked;
+#else
+    int block2InputRGBInvert;
+#endif
+#ifdef block2InputGeoOverflow
+    int block2InputGeoOverflowBaked;
+#else
+    int block2InputGeoOverflow;
+#endif
+#ifdef block2InputSolarize
+    int block2InputSolarizeBaked;
+#else
+    int block2InputSolarize;
+#endif
+
+    float fb2MixAmount;
+    vec3 fb2KeyValue;
+    float fb2KeyThreshold;
+    float fb2KeySoft;
+#ifdef fb2MixType
+    int fb2MixTypeBaked;
+#else
+    int fb2MixType;
+#endif
+#ifdef fb2MixOverflow
+    int fb2MixOverflowBaked;
+#else
+    int fb2MixOverflow;
+#endif
+#ifdef fb2KeyOrder
+    int fb2KeyOrderBaked;
+#else
+    int fb2KeyOrder;
+#endif
+
+    float fb2KaleidoscopeAmount;
+    float fb2KaleidoscopeSlice;
+#ifdef fb2HMirror
+    int fb2HMirrorBaked;
+#else
+    int fb2HMirror;
+#endif
+#ifdef fb2VMirror
+    int fb2VMirrorBaked;
+#else
+    int fb2VMirror;
+#endif
+
+#ifdef fb2GeoOverflow
+    int fb2GeoOverflowBaked;
+#else
+    int fb2GeoOverflow;
+#endif
+
+    vec3 fb2HSBOffset;
+    vec3 fb2HSBAttenuate;
+    vec3 fb2HSBPowmap;
+    float fb2HueShaper;
+
+    float fb2Posterize;
+    float fb2PosterizeInvert;
+#ifdef fb2PosterizeSwitch
+    int fb2PosterizeSwitchBaked;
+#else
+    int fb2PosterizeSwitch;
+#endif
+#ifdef fb2HueInvert
+    int fb2HueInvertBaked;
+#else
+    int fb2HueInvert;
+#endif
+#ifdef fb2SaturationInvert
+    int fb2SaturationInvertBaked;
+#else
+    int fb2SaturationInvert;
+#endif
+#ifdef fb2BrightInvert
+    int fb2BrightInvertBaked;
+#else
+    int fb2BrightInvert;
+#endif
+
+    //fb2 filters
+    float fb2BlurAmount;
+    float fb2BlurRadius;
+    float fb2SharpenAmount;
+    float fb2SharpenRadius;
+    float fb2TemporalFilter1Amount;
+    float fb2TemporalFilter1Resonance;
+    float fb2TemporalFilter2Amount;
+    float fb2TemporalFilter2Resonance;
+    float fb2FiltersBoost;
+
+    //blur/sharpen pre-pass in use per layer (see BlurPrepass)
+#ifdef block2InputBlurPrepass
+    int block2InputBlurPrepassBaked;
+#else
+    int block2InputBlurPrepass;
+#endif
+#ifdef fb2BlurPrepass
+    int fb2BlurPrepassBaked;
+#else
+    int fb2BlurPrepass;
+#endif
+
+    //colour chain LUT in use per layer (see ColorLut)
+#ifdef block2InputColorLutOn
+    int block2InputColorLutOnBaked;
+#else
+    int block2InputColorLutOn;
+#endif
+#ifdef fb2ColorLutOn
+    int fb2ColorLutOnBaked;
+#else
+    int fb2ColorLutOn;
+#endif
+
+    //layer can reach the output, 0 skips its fetches (see RenderPaths)
+#ifdef block2InputLayerOn
+    int block2InputLayerOnBaked;
+#else
+    int block2InputLayerOn;
+#endif
+
+    //0 = render, 1 = bake the fb2 warp map (coordinates to output 0)
+#ifdef block2Stage
+    int block2StageBaked;
+#else
+    int block2Stage;
+#endif
+    //fb2 reads its coordinates from its warp map (see WarpMapCache)
+#ifdef fb2WarpOn
+    int fb2WarpOnBaked;
+#else
+    int fb2WarpOn;
+#endif
+};
 
 
 
 in vec2 texCoordVarying;
 
-out vec4 outputColor;
+layout(location = 0) out vec4 outputColor;
+//same color, written straight into the feedback history layer
+layout(location = 1) out vec4 historyColor;
 
 //color space conversions
 vec3 rgb2hsb(vec3 c)
@@ -135,6 +261,13 @@ vec3 hsb2rgb(vec3 c)
     return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
 }
 
+//3D LUT lookup of a colour chain baked on the CPU (see ColorLut),
+//nodes at the texel centres
+vec3 colorLut(sampler3D lut, vec3 c){
+	float size=float(textureSize(lut,0).x);
+	return textureLod(lut,clamp(c,0.0,1.0)*((size-1.0)/size)+0.5/size,0.0).rgb;
+}
+
 
 float hueShaper(float inHue,float shaper){
 	inHue=fract(abs(inHue+shaper*sin(inHue*0.3184713) ));
@@ -154,6 +287,13 @@ vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord,
 		float sharpenAmount, float sharpenRadius, float sharpenBoost,
 		float blurRadius, float blurAmount) {
 	vec4 originalColor = textureLod(blurAndSharpenTex, coord, 0);
+	
+	// Early exit: if blur and sharpen are both disabled, return original color
+	// This saves 16 texture samples per call when filters are off
+	if (blurAmount < 0.001 && sharpenAmount < 0.001) {
+		return originalColor;
+	}
+	
 	vec2 texSize = vec2(textureSize(blurAndSharpenTex, 0));
 
 	vec2 blurSize = vec2(blurRadius) / (texSize - vec2(1));
@@ -198,6 +338,99 @@ vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord,
     return vec4(hsb2rgb(colorBlurHsb),1.0);
 }
 
+//same as above, sampling one layer of a texture array
+vec4 blurAndSharpen(sampler2DArray blurAndSharpenTex, float layer, vec2 coord,
+		float sharpenAmount, float sharpenRadius, float sharpenBoost,
+		float blurRadius, float blurAmount) {
+	vec4 originalColor = textureLod(blurAndSharpenTex, vec3(coord, layer), 0);
+	
+	// Early exit: if blur and sharpen are both disabled, return original color
+	// This saves 16 texture samples per call when filters are off
+	if (blurAmount < 0.001 && sharpenAmount < 0.001) {
+		return originalColor;
+	}
+	
+	vec2 texSize = vec2(textureSize(blurAndSharpenTex, 0).xy);
+
+	vec2 blurSize = vec2(blurRadius) / (texSize - vec2(1));
+	vec2 sharpenSize = vec2(sharpenRadius) / (texSize - vec2(1));
+
+	//blur
+	vec4 colorBlur = textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1, 1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2( 0, 1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1, 1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1, 0), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2(-1,-1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2( 0,-1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1,-1), layer), 0)
+                  + textureLod(blurAndSharpenTex, vec3(coord + blurSize*vec2( 1, 0), layer), 0);
+
+	colorBlur*=.125;
+
+	colorBlur=mix(originalColor,colorBlur,blurAmount);
+
+	//sharpen
+	float color_sharpen_bright =
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1, 0), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1, 0), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 0, 1), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 0,-1), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1, 1), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1, 1), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2( 1,-1), layer), 0).rgb).z+
+		rgb2hsb(textureLod(blurAndSharpenTex, vec3(coord + sharpenSize*vec2(-1,-1), layer), 0).rgb).z;
+
+    color_sharpen_bright=color_sharpen_bright*.125;
+
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*color_sharpen_bright;
+
+    //try baking in the sharpenBoost into the amount
+    //this does not work so well over here lol
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
+//blurAndSharpen reading the BlurPrepass neighbourhood texture instead of
+//taking 16 taps: rgb is the average of the 8 blur taps, a the average
+//brightness of the 8 sharpen taps around coord
+vec4 blurAndSharpenPrepass(sampler2D blurAndSharpenTex, sampler2D prepassTex, vec2 coord,
+		float sharpenAmount, float sharpenBoost, float blurAmount) {
+	vec4 originalColor = textureLod(blurAndSharpenTex, coord, 0);
+	vec4 neighbours = textureLod(prepassTex, coord, 0);
+
+	vec4 colorBlur=mix(originalColor,vec4(neighbours.rgb,originalColor.a),blurAmount);
+
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*neighbours.a;
+
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
+vec4 blurAndSharpenPrepass(sampler2DArray blurAndSharpenTex, float layer, sampler2D prepassTex, vec2 coord,
+		float sharpenAmount, float sharpenBoost, float blurAmount) {
+	vec4 originalColor = textureLod(blurAndSharpenTex, vec3(coord, layer), 0);
+	vec4 neighbours = textureLod(prepassTex, coord, 0);
+
+	vec4 colorBlur=mix(originalColor,vec4(neighbours.rgb,originalColor.a),blurAmount);
+
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*neighbours.a;
+
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
 vec2 rotate(vec2 coord,float theta,int mode){
 
 	vec2 rotate_coord=vec2(0,0);
@@ -331,32 +564,6 @@ vec2 kaleidoscope1(vec2 inCoord, float segment, float slice){
 }
 
 
-//takes in coords and shears them
-vec2 shear(vec2 inCoord, vec4 shearMatrix){
-	inCoord.x-=width/2.0;
-	inCoord.y-=height/2.0;
-
-	inCoord.x=shearMatrix.x*inCoord.x+shearMatrix.y*inCoord.y;
-	inCoord.y=shearMatrix.z*inCoord.x+shearMatrix.w*inCoord.y;
-
-	inCoord.x+=width/2.0;
-	inCoord.y+=height/2.0;
-	return inCoord;
-}
-
-//takes in coords and shears them
-vec2 shear1(vec2 inCoord, vec4 shearMatrix){
-	inCoord.x-=block2InputWidthHalf;
-	inCoord.y-=block2InputHeightHalf;
-
-	inCoord.x=shearMatrix.x*inCoord.x+shearMatrix.y*inCoord.y;
-	inCoord.y=shearMatrix.z*inCoord.x+shearMatrix.w*inCoord.y;
-
-	inCoord.x+=block2InputWidthHalf;
-	inCoord.y+=block2InputHeightHalf;
-	return inCoord;
-}
-
 float mirror(float a){
 	if(a > 0.0) return a;
 	return -(1.0 + a);
@@ -561,8 +768,37 @@ float solarize(float inBright){
 	return inBright;
 }
 
+//fb2 coordinates: everything the geometry parameters do to a pixel
+vec2 fb2Geometry(){
+	//flips, composed on the CPU (see LayerTransform)
+	vec2 fb2Coords=(fb2PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
+
+	if(fb2HMirror==1){
+        if(fb2Coords.x.x>width/2){fb2Coords.x=abs(width-fb2Coords.x);}
+    }//endifhflip1
+    if(fb2VMirror==1){
+        if(fb2Coords.y>height/2){fb2Coords.y=abs(height-fb2Coords.y);}
+    }//endifvflip1
+
+	fb2Coords=kaleidoscope(fb2Coords,fb2KaleidoscopeAmount,fb2KaleidoscopeSlice);
+
+	//displace, zoom, rotate and shear, composed on the CPU (see LayerTransform)
+	fb2Coords=(fb2Transform*vec3(fb2Coords,1.0)).xy;
+
+	if(fb2GeoOverflow==1){fb2Coords=wrapCoord(fb2Coords);}
+	if(fb2GeoOverflow==2){fb2Coords=mirrorCoord(fb2Coords);}
+
+	return fb2Coords;
+}
+
 void main()
 {
+	//warp map bake: fb2's coordinates instead of colours (see WarpMapCache)
+	if(block2Stage==1){
+		outputColor=vec4(fb2Geometry(),0.0,1.0);
+		return;
+	}
+
 	// Normalized UV for block2 input (sampler2D expects 0..1)
 	vec2 block2InputUV = texCoordVarying;
 
@@ -583,40 +819,8 @@ void main()
 
 
 	//NEW FIXED input scaling and repositioning
-	vec2 block2InputCoords=block2InputUV*vec2(width,height);
-
-	//if inputs are from usb/spout/ndi and not from block1
-	if(block2InputMasterSwitch==1){
-		// Use texCoordVarying directly - input textures are scaled to internal resolution
-		block2InputCoords = block2InputUV*vec2(width,height);
-
-		// Apply aspect ratio adjustment
-		block2InputCoords.x *= block2InputAspectRatio;
-
-		// Apply crib offset
-		block2InputCoords.x -= block2InputCribX;
-
-		// Apply scale around center
-		block2InputCoords -= vec2(width/2.0, height/2.0);
-		block2InputCoords *= block2InputScaleFix + block2InputHdZCrib;
-		block2InputCoords += vec2(width/2.0, height/2.0);
-
-		// HD aspect fix override
-		if(block2InputHdAspectOn==1){
-			block2InputCoords = block2InputUV*vec2(width,height);
-			block2InputCoords.y = block2InputHdAspectXYFix.y * block2InputCoords.y;
-			block2InputCoords.x = block2InputHdAspectXYFix.x * block2InputCoords.x;
-		}
-
-	}
-
-
-	if(block2InputHFlip==1){
-		block2InputCoords.x=block2InputWidth-block2InputCoords.x;
-	}
-	if(block2InputVFlip==1){
-		block2InputCoords.y=block2InputHeight-block2InputCoords.y;
-	}
+	//input mapping and flips, composed on the CPU (see LayerTransform)
+	vec2 block2InputCoords=(block2InputPreTransform*vec3(block2InputUV*vec2(width,height),1.0)).xy;
 
 	if(block2InputHMirror==1){
         if(block2InputCoords.x.x>block2InputWidthHalf){block2InputCoords.x=abs(block2InputWidth-block2InputCoords.x);}
@@ -636,28 +840,25 @@ void main()
 	//block2InputCoords=kaleidoscope1(block2InputCoords,block2InputKaleidoscopeAmount,block2InputKaleidoscopeSlice);
 
 
-	block2InputCoords+=block2InputXYDisplace;
-
-	//zdisplace
-	block2InputCoords-=vec2(block2InputWidthHalf,block2InputHeightHalf);
-	block2InputCoords=block2InputCoords*(block2InputZDisplace);
-	//gonna need to double check this
-	//block2InputCoords=block2InputCoords*(1.0+block2InputZDisplace+block2InputHdZCrib);
-	block2InputCoords+=vec2(block2InputWidthHalf,block2InputHeightHalf);
-	if(block2InputWidth==width){
-		block2InputCoords=rotate(block2InputCoords,block2InputRotate,0);
-	}
-	if(block2InputWidth==width){
-		block2InputCoords=rotate1(block2InputCoords,block2InputRotate,0);
-	}
+	//displace, zoom and rotate, composed on the CPU (see LayerTransform)
+	block2InputCoords=(block2InputTransform*vec3(block2InputCoords,1.0)).xy;
 
 	//got to fix these...
 	if(block2InputGeoOverflow==1){block2InputCoords=wrapCoord1(block2InputCoords, block2InputWidth,block2InputHeight);}
 	if(block2InputGeoOverflow==2){block2InputCoords=mirrorCoord1(block2InputCoords, block2InputWidth,block2InputHeight);}
 
 
-	vec4 block2InputColor=blurAndSharpen(block2InputTex,(block2InputCoords/vec2(width,height)),block2InputSharpenAmount,block2InputSharpenRadius,
-		block2InputFiltersBoost,block2InputBlurRadius,block2InputBlurAmount);
+	vec4 block2InputColor=vec4(0.0);
+	if(block2InputLayerOn==0){
+		//culled, doesn't reach the output
+	}
+	else if(block2InputBlurPrepass==1){
+		block2InputColor=blurAndSharpenPrepass(block2InputTex,block2InputPrepass,(block2InputCoords/vec2(width,height)),block2InputSharpenAmount,block2InputFiltersBoost,block2InputBlurAmount);
+	}
+	else{
+		block2InputColor=blurAndSharpen(block2InputTex,(block2InputCoords/vec2(width,height)),block2InputSharpenAmount,block2InputSharpenRadius,
+			block2InputFiltersBoost,block2InputBlurRadius,block2InputBlurAmount);
+	}
     //vec4 block2InputColor = texture(block2InputTex, block2InputCoords/vec2(width,height));
 	//block2InputColor.rgb=1.0-block2InputColor.rgb;
 
@@ -668,28 +869,34 @@ void main()
 
     //experiment more with this...
 	//block2InputColor.rgb+=(1.0-block2InputHSBAttenuate);
-	vec3 block2InputColorHSB=rgb2hsb(block2InputColor.rgb);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(block2InputColorLutOn==1){
+		block2InputColor.rgb=colorLut(block2InputColorLut,block2InputColor.rgb);
+	}
+	else{
+		vec3 block2InputColorHSB=rgb2hsb(block2InputColor.rgb);
 
-	//block2InputColorHSB*=block2InputHSBAttenuate;
+		//block2InputColorHSB*=block2InputHSBAttenuate;
 
-	block2InputColorHSB=pow(block2InputColorHSB,block2InputHSBAttenuate);
+		block2InputColorHSB=pow(block2InputColorHSB,block2InputHSBAttenuate);
 
-	//inverts
-	if(block2InputHueInvert==1){block2InputColorHSB.x=1.0-block2InputColorHSB.x;}
-	if(block2InputSaturationInvert==1){block2InputColorHSB.y=1.0-block2InputColorHSB.y;}
-	if(block2InputBrightInvert==1){block2InputColorHSB.z=1.0-block2InputColorHSB.z;}
+		//inverts
+		if(block2InputHueInvert==1){block2InputColorHSB.x=1.0-block2InputColorHSB.x;}
+		if(block2InputSaturationInvert==1){block2InputColorHSB.y=1.0-block2InputColorHSB.y;}
+		if(block2InputBrightInvert==1){block2InputColorHSB.z=1.0-block2InputColorHSB.z;}
 
-	block2InputColorHSB.x=fract(block2InputColorHSB.x);
+		block2InputColorHSB.x=fract(block2InputColorHSB.x);
 
-	if(block2InputSolarize==1){
-		block2InputColorHSB.z=solarize(block2InputColorHSB.z);
-		//if(block2InputColorHSB.z>.5){block2InputColorHSB.z=1.0-block2InputColorHSB.z;}
-	}
+		if(block2InputSolarize==1){
+			block2InputColorHSB.z=solarize(block2InputColorHSB.z);
+			//if(block2InputColorHSB.z>.5){block2InputColorHSB.z=1.0-block2InputColorHSB.z;}
+		}
 
-	block2InputColor.rgb=hsb2rgb(block2InputColorHSB);
+		block2InputColor.rgb=hsb2rgb(block2InputColorHSB);
 
 
-	if(block2InputRGBInvert==1){block2InputColor.rgb=1.0-block2InputColor.rgb;}
+		if(block2InputRGBInvert==1){block2InputColor.rgb=1.0-block2InputColor.rgb;}
+	}
 
 	if(block2InputPosterizeSwitch==1){
 		block2InputColor.rgb=colorQuantize(block2InputColor.rgb,block2InputPosterize,block2InputPosterizeInvert);
@@ -711,42 +918,33 @@ void main()
 
 
 	//fb2
-	vec2 fb2Coords=texCoordVarying*vec2(width,height);
-	vec2 center=vec2(width/2.0,height/2.0);
-	//geometry
-	if(fb2HFlip==1){
-		fb2Coords.x=width-fb2Coords.x;
-	}
-	if(fb2VFlip==1){
-		fb2Coords.y=height-fb2Coords.y;
-	}
-
-	if(fb2HMirror==1){
-        if(fb2Coords.x.x>width/2){fb2Coords.x=abs(width-fb2Coords.x);}
-    }//endifhflip1
-    if(fb2VMirror==1){
-        if(fb2Coords.y>height/2){fb2Coords.y=abs(height-fb2Coords.y);}
-    }//endifvflip1
-
-	fb2Coords=kaleidoscope(fb2Coords,fb2KaleidoscopeAmount,fb2KaleidoscopeSlice);
-
-	fb2Coords+=fb2XYDisplace;
-	fb2Coords-=center;
-	fb2Coords*=fb2ZDisplace;
-	fb2Coords+=center;
-
-	fb2Coords=rotate(fb2Coords,fb2Rotate,fb2RotateMode);
-
-	fb2Coords=shear(fb2Coords,fb2ShearMatrix);
-
-	if(fb2GeoOverflow==1){fb2Coords=wrapCoord(fb2Coords);}
-	if(fb2GeoOverflow==2){fb2Coords=mirrorCoord(fb2Coords);}
+	//geometry, from the baked warp map while its parameters are still (see WarpMapCache)
+	vec2 fb2Coords;
+	if(fb2WarpOn==1){fb2Coords=texture(fb2WarpMap,texCoordVarying).xy;}
+	else{fb2Coords=fb2Geometry();}
 
 
 
 	//vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord, float sharpenAmount, float sharpenRadius, float sharpenBoost,float blurRadius,float blurAmount)
-	vec4 fb2Color=blurAndSharpen(tex0,(fb2Coords/vec2(width,height)),fb2SharpenAmount,fb2SharpenRadius,
-		fb2FiltersBoost,fb2BlurRadius,fb2BlurAmount);
+	vec4 fb2Color=vec4(0.0,0.0,0.0,1.0);
+	if(fb2DelayLayer>=0 && fb2DelayTier==0){
+		if(fb2BlurPrepass==1){
+			fb2Color=blurAndSharpenPrepass(fb2History,float(fb2DelayLayer),fb2Prepass,(fb2Coords/vec2(width,height)),fb2SharpenAmount,fb2FiltersBoost,fb2BlurAmount);
+		}
+		else{
+			fb2Color=blurAndSharpen(fb2History,float(fb2DelayLayer),(fb2Coords/vec2(width,height)),fb2SharpenAmount,fb2SharpenRadius,
+				fb2FiltersBoost,fb2BlurRadius,fb2BlurAmount);
+		}
+	}
+	else if(fb2DelayLayer>=0){
+		if(fb2BlurPrepass==1){
+			fb2Color=blurAndSharpenPrepass(fb2HistoryOlder,float(fb2DelayLayer),fb2Prepass,(fb2Coords/vec2(width,height)),fb2SharpenAmount,fb2FiltersBoost,fb2BlurAmount);
+		}
+		else{
+			fb2Color=blurAndSharpen(fb2HistoryOlder,float(fb2DelayLayer),(fb2Coords/vec2(width,height)),fb2SharpenAmount,fb2SharpenRadius,
+				fb2FiltersBoost,fb2BlurRadius,fb2BlurAmount);
+		}
+	}
 
 	//vec4 fb2Color=texture(tex0, fb2Coords/vec2(width,height));
 
@@ -760,28 +958,34 @@ void main()
 	}
 
 	//fb2 color biz
-	vec3 fb2ColorHSB=rgb2hsb(fb2Color.rgb);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(fb2ColorLutOn==1){
+		fb2Color.rgb=colorLut(fb2ColorLut,fb2Color.rgb);
+	}
+	else{
+		vec3 fb2ColorHSB=rgb2hsb(fb2Color.rgb);
 
-	fb2ColorHSB.x=hueShaper(fb2ColorHSB.x,fb2HueShaper);
-	fb2ColorHSB+=fb2HSBOffset;
-	fb2ColorHSB*=fb2HSBAttenuate;
-	fb2ColorHSB=pow(fb2ColorHSB,fb2HSBPowmap);
+		fb2ColorHSB.x=hueShaper(fb2ColorHSB.x,fb2HueShaper);
+		fb2ColorHSB+=fb2HSBOffset;
+		fb2ColorHSB*=fb2HSBAttenuate;
+		fb2ColorHSB=pow(fb2ColorHSB,fb2HSBPowmap);
 
-	/*
-	if(fb2PosterizeSwitch==1){
-		fb2ColorHSB=colorQuantize(fb2ColorHSB,fb2Posterize,fb2PosterizeInvert);
-	}
-	*/
-	//inverts
-	if(fb2HueInvert==1){fb2ColorHSB.x=1.0-fb2ColorHSB.x;}
-	if(fb2SaturationInvert==1){fb2ColorHSB.y=1.0-fb2ColorHSB.y;}
-	if(fb2BrightInvert==1){fb2ColorHSB.z=1.0-fb2ColorHSB.z;}
+		/*
+		if(fb2PosterizeSwitch==1){
+			fb2ColorHSB=colorQuantize(fb2ColorHSB,fb2Posterize,fb2PosterizeInvert);
+		}
+		*/
+		//inverts
+		if(fb2HueInvert==1){fb2ColorHSB.x=1.0-fb2ColorHSB.x;}
+		if(fb2SaturationInvert==1){fb2ColorHSB.y=1.0-fb2ColorHSB.y;}
+		if(fb2BrightInvert==1){fb2ColorHSB.z=1.0-fb2ColorHSB.z;}
 
 
-	fb2ColorHSB.x=fract(fb2ColorHSB.x);
-	fb2ColorHSB.y=clamp(fb2ColorHSB.y,0.0,1.0);
-	fb2ColorHSB.z=clamp(fb2ColorHSB.z,0.0,1.0);
-	fb2Color.rgb=hsb2rgb(fb2ColorHSB);
+		fb2ColorHSB.x=fract(fb2ColorHSB.x);
+		fb2ColorHSB.y=clamp(fb2ColorHSB.y,0.0,1.0);
+		fb2ColorHSB.z=clamp(fb2ColorHSB.z,0.0,1.0);
+		fb2Color.rgb=hsb2rgb(fb2ColorHSB);
+	}
 
 	if(fb2PosterizeSwitch==1){
 		fb2Color.rgb=colorQuantize(fb2Color.rgb,fb2Posterize,fb2PosterizeInvert);
@@ -795,7 +999,10 @@ void main()
 	//temporal filter
 	//experiment more with temporal filter displacement
 	//vec4 temporalFilter1Color=texture(fb2TemporalFilter,texCoordVarying+vec2(.01,.01));
-	vec4 temporalFilter1Color=texture(fb2TemporalFilter,texCoordVarying);
+	vec4 temporalFilter1Color=vec4(0.0,0.0,0.0,1.0);
+	if(fb2TemporalLayer>=0){
+		temporalFilter1Color=texture(fb2History,vec3(texCoordVarying,float(fb2TemporalLayer)));
+	}
 	vec3 temporalFilter1ColorHSB=rgb2hsb(temporalFilter1Color.rgb);
 	vec3 temporalFilter2ColorHSB=temporalFilter1ColorHSB;
 
@@ -816,4 +1023,5 @@ void main()
 	outColor.a=1.0;
 
 	outputColor=outColor;
+	historyColor=outColor;
 }
@@ -3,100 +3,300 @@
 const float PI=3.1415926535;
 const float TWO_PI=6.2831855;
 
-
-uniform sampler2D block2Output;
-uniform sampler2D block1Output;
-
-uniform float ratio;
-
-uniform float width;
-uniform float height;
-uniform float inverseWidth;
-uniform float inverseHeight;
-
-
-//block1 geo
-uniform vec2 block1XYDisplace;
-uniform float block1ZDisplace;
-uniform float block1Rotate;
-uniform vec4 block1ShearMatrix;
-uniform float block1KaleidoscopeAmount;
-uniform float block1KaleidoscopeSlice;
-uniform int block1HMirror;
-uniform int block1VMirror;
-uniform int	block1RotateMode;
-uniform	int block1GeoOverflow;
-uniform int block1HFlip;
-uniform int block1VFlip;
-
-//block1 colorize
-uniform int block1ColorizeSwitch;
-uniform int block1ColorizeHSB_RGB;
-uniform vec3 block1ColorizeBand1;
-uniform vec3 block1ColorizeBand2;
-uniform vec3 block1ColorizeBand3;
-uniform vec3 block1ColorizeBand4;
-uniform vec3 block1ColorizeBand5;
-
-//block1 filters
-uniform	float block1BlurAmount;
-uniform	float block1BlurRadius;
-uniform	float block1SharpenAmount;
-uniform	float block1SharpenRadius;
-uniform float block1FiltersBoost;
-uniform float block1Dither;
-uniform int block1DitherSwitch;
-uniform int block1DitherType;
-
-//block2 geo
-uniform vec2 block2XYDisplace;
-uniform float block2ZDisplace;
-uniform float block2Rotate;
-uniform vec4 block2ShearMatrix;
-uniform float block2KaleidoscopeAmount;
-uniform float block2KaleidoscopeSlice;
-uniform int block2HMirror;
-uniform int block2VMirror;
-uniform int	block2RotateMode;
-uniform	int block2GeoOverflow;
-uniform int block2HFlip;
-uniform int block2VFlip;
-
-//block2 colorize
-uniform int block2ColorizeSwitch;
-uniform int block2ColorizeHSB_RGB;
-uniform vec3 block2ColorizeBand1;
-uniform vec3 block2ColorizeBand2;
-uniform vec3 block2ColorizeBand3;
-uniform vec3 block2ColorizeBand4;
-uniform vec3 block2ColorizeBand5;
-
-//block2 filters
-uniform	float block2BlurAmount;
-uniform	float block2BlurRadius;
-uniform	float block2SharpenAmount;
-uniform	float block2SharpenRadius;
-uniform float block2FiltersBoost;
-uniform float block2Dither;
-uniform int block2DitherSwitch;
-uniform int block2DitherType;
-
-
-//final mix
-uniform float finalMixAmount;
-uniform vec3 finalKeyValue;
-uniform float finalKeyThreshold;
-uniform float finalKeySoft;
-uniform int finalMixType;
-uniform int finalMixOverflow;
-uniform int finalKeyOrder;
-
-//matrix mixer
-uniform int matrixMixType;
-uniform int matrixMixOverflow;
-uniform vec3 bgRGBIntoFgRed;
-uniform vec3 bgRGBIntoFgGreen;
-uniform vec3 bgRGBIntoFgBlue;
+//plain uniforms have explicit locations so a cached program binary
+//can be restored (see ShaderLoader)
+layout(location = 4) uniform sampler2D block2Output;
+layout(location = 5) uniform sampler2D block1Output;
+
+//blur/sharpen pre-pass results, bound when <layer>BlurPrepass is 1 (see BlurPrepass)
+layout(location = 6) uniform sampler2D block1Prepass;
+layout(location = 7) uniform sampler2D block2Prepass;
+
+//colour chain LUTs, sampled when <layer>ColorLutOn is 1 (see ColorLut)
+layout(location = 8) uniform sampler3D block1ColorLut;
+layout(location = 9) uniform sampler3D block2ColorLut;
+
+//Block2's input layer, sampled in place of block2Output when Block2 is
+//fused into this pass (block2Fused 1, see PipelineManager::updateBlock2Fusion)
+layout(location = 10) uniform sampler2D block2InputTex;
+layout(location = 11) uniform sampler2D block2InputPrepass;
+layout(location = 12) uniform sampler3D block2InputColorLut;
+
+//parameters, uploaded as one uniform buffer (see ParamBuffer)
+//int switches are #defined to constants in specialized variants
+//(see ShaderVariantCache); their slots stay so the layout matches
+layout(std140) uniform Block3Params {
+    //per-layer coordinate transforms, composed on the CPU (see LayerTransform)
+    mat3 block1PreTransform;
+    mat3 block1Transform;
+    mat3 block2PreTransform;
+    mat3 block2Transform;
+
+    float ratio;
+
+    float width;
+    float height;
+    float inverseWidth;
+    float inverseHeight;
+
+    //block1 geo
+    float block1KaleidoscopeAmount;
+    float block1KaleidoscopeSlice;
+#ifdef block1HMirror
+    int block1HMirrorBaked;
+#else
+    int block1HMirror;
+#endif
+#ifdef block1VMirror
+    int block1VMirrorBaked;
+#else
+    int block1VMirror;
+#endif
+#ifdef block1GeoOverflow
+    int block1GeoOverflowBaked;
+#else
+    int block1GeoOverflow;
+#endif
+
+    //block1 colorize
+#ifdef block1ColorizeSwitch
+    int block1ColorizeSwitchBaked;
+#else
+    int block1ColorizeSwitch;
+#endif
+#ifdef block1ColorizeHSB_RGB
+    int block1ColorizeHSB_RGBBaked;
+#else
+    int block1ColorizeHSB_RGB;
+#endif
+    vec3 block1ColorizeBand1;
+    vec3 block1ColorizeBand2;
+    vec3 block1ColorizeBand3;
+    vec3 block1ColorizeBand4;
+    vec3 block1ColorizeBand5;
+
+    //block1 filters
+    float block1BlurAmount;
+    float block1BlurRadius;
+    float block1SharpenAmount;
+    float block1SharpenRadius;
+    float block1FiltersBoost;
+    float block1Dither;
+#ifdef block1DitherSwitch
+    int block1DitherSwitchBaked;
+#else
+    int block1DitherSwitch;
+#endif
+#ifdef block1DitherType
+    int block1DitherTypeBaked;
+#else
+    int block1DitherType;
+#endif
+
+    //block2 geo
+    float block2KaleidoscopeAmount;
+    float block2KaleidoscopeSlice;
+#ifdef block2HMirror
+    int block2HMirrorBaked;
+#else
+    int block2HMirror;
+#endif
+#ifdef block2VMirror
+    int block2VMirrorBaked;
+#else
+    int block2VMirror;
+#endif
+#ifdef block2GeoOverflow
+    int block2GeoOverflowBaked;
+#else
+    int block2GeoOverflow;
+#endif
+
+    //block2 colorize
+#ifdef block2ColorizeSwitch
+    int block2ColorizeSwitchBaked;
+#else
+    int block2ColorizeSwitch;
+#endif
+#ifdef block2ColorizeHSB_RGB
+    int block2ColorizeHSB_RGBBaked;
+#else
+    int block2ColorizeHSB_RGB;
+#endif
+    vec3 block2ColorizeBand1;
+    vec3 block2ColorizeBand2;
+    vec3 block2ColorizeBand3;
+    vec3 block2ColorizeBand4;
+    vec3 block2ColorizeBand5;
+
+    //block2 filters
+    float block2BlurAmount;
+    float block2BlurRadius;
+    float block2SharpenAmount;
+    float block2SharpenRadius;
+    float block2FiltersBoost;
+    float block2Dither;
+#ifdef block2DitherSwitch
+    int block2DitherSwitchBaked;
+#else
+    int block2DitherSwitch;
+#endif
+#ifdef block2DitherType
+    int block2DitherTypeBaked;
+#else
+    int block2DitherType;
+#endif
+
+    //final mix
+    float finalMixAmount;
+    vec3 finalKeyValue;
+    float finalKeyThreshold;
+    float finalKeySoft;
+#ifdef finalMixType
+    int finalMixTypeBaked;
+#else
+    int finalMixType;
+#endif
+#ifdef finalMixOverflow
+    int finalMixOverflowBaked;
+#else
+    int finalMixOverflow;
+#endif
+#ifdef finalKeyOrder
+    int finalKeyOrderBaked;
+#else
+    int finalKeyOrder;
+#endif
+
+    //matrix mixer
+#ifdef matrixMixType
+    int matrixMixTypeBaked;
+#else
+    int matrixMixType;
+#endif
+#ifdef matrixMixOverflow
+    int matrixMixOverflowBaked;
+#else
+    int matrixMixOverflow;
+#endif
+    vec3 bgRGBIntoFgRed;
+    vec3 bgRGBIntoFgGreen;
+    vec3 bgRGBIntoFgBlue;
+
+    //blur/sharpen pre-pass in use per layer (see BlurPrepass)
+#ifdef block1BlurPrepass
+    int block1BlurPrepassBaked;
+#else
+    int block1BlurPrepass;
+#endif
+#ifdef block2BlurPrepass
+    int block2BlurPrepassBaked;
+#else
+    int block2BlurPrepass;
+#endif
+
+    //colour chain LUT in use per layer (see ColorLut)
+#ifdef block1ColorLutOn
+    int block1ColorLutOnBaked;
+#else
+    int block1ColorLutOn;
+#endif
+#ifdef block2ColorLutOn
+    int block2ColorLutOnBaked;
+#else
+    int block2ColorLutOn;
+#endif
+
+    //layer can reach the output, 0 skips its fetches (see RenderPaths)
+#ifdef block1LayerOn
+    int block1LayerOnBaked;
+#else
+    int block1LayerOn;
+#endif
+#ifdef block2LayerOn
+    int block2LayerOnBaked;
+#else
+    int block2LayerOn;
+#endif
+
+    //Block2 fused into this pass: its input layer parameters, as in shader2
+#ifdef block2Fused
+    int block2FusedBaked;
+#else
+    int block2Fused;
+#endif
+    mat3 block2InputPreTransform;
+    mat3 block2InputTransform;
+    float block2InputWidth;
+    float block2InputHeight;
+    float block2InputWidthHalf;
+    float block2InputHeightHalf;
+    vec3 block2InputHSBAttenuate;
+    float block2InputPosterize;
+    float block2InputPosterizeInvert;
+#ifdef block2InputPosterizeSwitch
+    int block2InputPosterizeSwitchBaked;
+#else
+    int block2InputPosterizeSwitch;
+#endif
+    float block2InputKaleidoscopeAmount;
+    float block2InputKaleidoscopeSlice;
+    float block2InputBlurAmount;
+    float block2InputBlurRadius;
+    float block2InputSharpenAmount;
+    float block2InputSharpenRadius;
+    float block2InputFiltersBoost;
+#ifdef block2InputHMirror
+    int block2InputHMirrorBaked;
+#else
+    int block2InputHMirror;
+#endif
+#ifdef block2InputVMirror
+    int block2InputVMirrorBaked;
+#else
+    int block2InputVMirror;
+#endif
+#ifdef block2InputHueInvert
+    int block2InputHueInvertBaked;
+#else
+    int block2InputHueInvert;
+#endif
+#ifdef block2InputSaturationInvert
+    int block2InputSaturationInvertBaked;
+#else
+    int block2InputSaturationInvert;
+#endif
+#ifdef block2InputBrightInvert
+    int block2InputBrightInvertBaked;
+#else
+    int block2InputBrightInvert;
+#endif
+#ifdef block2InputRGBInvert
+    int block2InputRGBInvertBaked;
+#else
+    int block2InputRGBInvert;
+#endif
+#ifdef block2InputGeoOverflow
+    int block2InputGeoOverflowBaked;
+#else
+    int block2InputGeoOverflow;
+#endif
+#ifdef block2InputSolarize
+    int block2InputSolarizeBaked;
+#else
+    int block2InputSolarize;
+#endif
+#ifdef block2InputBlurPrepass
+    int block2InputBlurPrepassBaked;
+#else
+    int block2InputBlurPrepass;
+#endif
+#ifdef block2InputColorLutOn
+    int block2InputColorLutOnBaked;
+#else
+    int block2InputColorLutOn;
+#endif
+};
 
 
 
@@ -125,6 +325,13 @@ vec3 hsb2rgb(vec3 c)
     return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
 }
 
+//3D LUT lookup of a colour chain baked on the CPU (see ColorLut),
+//nodes at the texel centres
+vec3 colorLut(sampler3D lut, vec3 c){
+	float size=float(textureSize(lut,0).x);
+	return textureLod(lut,clamp(c,0.0,1.0)*((size-1.0)/size)+0.5/size,0.0).rgb;
+}
+
 //general signal utilities
 float wrap(float inColor){
 
@@ -247,21 +454,6 @@ vec2 kaleidoscope(vec2 inCoord, float segment, float slice){
 	return inCoord;
 }
 
-//takes in coords and shears them
-vec2 shear(vec2 inCoord, vec4 shearMatrix){
-	inCoord.x-=width/2.0;
-	inCoord.y-=height/2.0;
-
-	//vec2 outCoord=vec2(0.0,0.0);
-
-	inCoord.x=shearMatrix.x*inCoord.x+shearMatrix.y*inCoord.y;
-	inCoord.y=shearMatrix.z*inCoord.x+shearMatrix.w*inCoord.y;
-
-	inCoord.x+=width/2.0;
-	inCoord.y+=height/2.0;
-	return inCoord;
-}
-
 
 //MIX
 //fg is foreground color, bg is background
@@ -414,6 +606,13 @@ vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord,
 		float sharpenAmount, float sharpenRadius, float sharpenBoost,
 		float blurRadius, float blurAmount) {
 	vec4 originalColor = textureLod(blurAndSharpenTex, coord, 0);
+	
+	// Early exit: if blur and sharpen are both disabled, return original color
+	// This saves 16 texture samples per call when filters are off
+	if (blurAmount < 0.001 && sharpenAmount < 0.001) {
+		return originalColor;
+	}
+	
 	vec2 texSize = vec2(textureSize(blurAndSharpenTex, 0));
 
 	vec2 blurSize = vec2(blurRadius) / (texSize - vec2(1));
@@ -458,22 +657,141 @@ vec4 blurAndSharpen(sampler2D blurAndSharpenTex, vec2 coord,
     return vec4(hsb2rgb(colorBlurHsb),1.0);
 }
 
+//blurAndSharpen reading the BlurPrepass neighbourhood texture instead of
+//taking 16 taps: rgb is the average of the 8 blur taps, a the average
+//brightness of the 8 sharpen taps around coord
+vec4 blurAndSharpenPrepass(sampler2D blurAndSharpenTex, sampler2D prepassTex, vec2 coord,
+		float sharpenAmount, float sharpenBoost, float blurAmount) {
+	vec4 originalColor = textureLod(blurAndSharpenTex, coord, 0);
+	vec4 neighbours = textureLod(prepassTex, coord, 0);
 
-void main()
-{
+	vec4 colorBlur=mix(originalColor,vec4(neighbours.rgb,originalColor.a),blurAmount);
 
-	//BLOCK1
-	vec2 block1Coords=texCoordVarying*vec2(width,height);
+    vec3 colorBlurHsb=rgb2hsb(colorBlur.rgb);
+    colorBlurHsb.z-=(sharpenAmount)*neighbours.a;
 
-	//GEO
-	vec2 center=vec2(width/2.0,height/2.0);
-	//geometry
-	if(block1HFlip==1){
-		block1Coords.x=width-block1Coords.x;
+    if(sharpenAmount>0){
+        colorBlurHsb.z*=(1.0+sharpenAmount+sharpenBoost);
+    }
+
+    return vec4(hsb2rgb(colorBlurHsb),1.0);
+}
+
+
+//BLOCK2 INPUT, FUSED
+//shader2's input layer, evaluated here when Block2 would only pass it
+//through to its output (see PipelineManager::updateBlock2Fusion). Same
+//steps as shader2, in Block2's pixel space.
+vec3 colorQuantize(vec3 inColor, float amount, float amountInvert){
+	return floor(inColor*amount)*amountInvert;
+}
+
+float solarize(float inBright){
+	if(inBright>.5){inBright=1.0-inBright;}
+	return inBright;
+}
+
+//shader2's rotate()/rotate1(), 0 = circular, 1 = keeps the aspect ratio
+vec2 block2InputRotate(vec2 coord,float theta,int mode){
+	vec2 size=vec2(block2InputWidth,block2InputHeight);
+	vec2 center_coord=coord-0.5*size;
+	if(mode==1){center_coord/=size;}
+	vec2 rotate_coord=vec2(center_coord.x*cos(theta)-center_coord.y*sin(theta),
+		center_coord.x*sin(theta)+center_coord.y*cos(theta));
+	if(mode==1){rotate_coord*=size;}
+	return rotate_coord+0.5*size;
+}
+
+//shader2's kaleidoscope() (mode 1) and kaleidoscope1() (mode 0)
+vec2 block2InputKaleidoscope(vec2 inCoord, float segment, float slice, int mode){
+	if(segment>0.0){
+		vec2 size=vec2(block2InputWidth,block2InputHeight);
+		inCoord=block2InputRotate(inCoord,slice,mode);
+		inCoord=2.0*(inCoord/size)-1.0;
+
+		float radius=sqrt( dot(inCoord,inCoord) );
+		float angle=atan(inCoord.y,inCoord.x);
+		float segmentAngle=TWO_PI/segment;
+		angle-=segmentAngle*floor(angle/segmentAngle);
+		angle=min(angle,segmentAngle-angle);
+		inCoord=radius*vec2(cos(angle),sin(angle));
+
+		inCoord=.5*(inCoord+1.0)*size;
+		inCoord=block2InputRotate(inCoord,-slice,mode);
 	}
-	if(block1VFlip==1){
-		block1Coords.y=height-block1Coords.y;
+	return inCoord;
+}
+
+//Block2's output at uv (0..1)
+vec4 block2InputFused(vec2 uv){
+	vec2 size=vec2(block2InputWidth,block2InputHeight);
+	vec2 block2InputCoords=(block2InputPreTransform*vec3(uv*size,1.0)).xy;
+
+	if(block2InputHMirror==1){
+		if(block2InputCoords.x>block2InputWidthHalf){block2InputCoords.x=abs(block2InputWidth-block2InputCoords.x);}
 	}
+	if(block2InputVMirror==1){
+		if(block2InputCoords.y>block2InputHeightHalf){block2InputCoords.y=abs(block2InputHeight-block2InputCoords.y);}
+	}
+
+	block2InputCoords=block2InputKaleidoscope(block2InputCoords,block2InputKaleidoscopeAmount,block2InputKaleidoscopeSlice,1);
+	block2InputCoords=block2InputKaleidoscope(block2InputCoords,block2InputKaleidoscopeAmount,block2InputKaleidoscopeSlice,0);
+
+	block2InputCoords=(block2InputTransform*vec3(block2InputCoords,1.0)).xy;
+
+	if(block2InputGeoOverflow==1){block2InputCoords=mod(block2InputCoords,size);}
+	if(block2InputGeoOverflow==2){
+		vec2 sizeLess=size-1.0;
+		block2InputCoords.x=sizeLess.x-mirror(mod(block2InputCoords.x,2.0*sizeLess.x)-sizeLess.x-1.0);
+		block2InputCoords.y=sizeLess.y-mirror(mod(block2InputCoords.y,2.0*sizeLess.y)-sizeLess.y-1.0);
+	}
+
+	vec4 block2InputColor;
+	if(block2InputBlurPrepass==1){
+		block2InputColor=blurAndSharpenPrepass(block2InputTex,block2InputPrepass,block2InputCoords/size,block2InputSharpenAmount,block2InputFiltersBoost,block2InputBlurAmount);
+	}
+	else{
+		block2InputColor=blurAndSharpen(block2InputTex,block2InputCoords/size,block2InputSharpenAmount,block2InputSharpenRadius,
+			block2InputFiltersBoost,block2InputBlurRadius,block2InputBlurAmount);
+	}
+
+	if(block2InputCoords.x>block2InputWidth || block2InputCoords.y> block2InputHeight || block2InputCoords.x<0.0 || block2InputCoords.y<0.0){
+		block2InputColor=vec4(0.0);
+	}
+
+	if(block2InputColorLutOn==1){
+		block2InputColor.rgb=colorLut(block2InputColorLut,block2InputColor.rgb);
+	}
+	else{
+		vec3 block2InputColorHSB=pow(rgb2hsb(block2InputColor.rgb),block2InputHSBAttenuate);
+
+		if(block2InputHueInvert==1){block2InputColorHSB.x=1.0-block2InputColorHSB.x;}
+		if(block2InputSaturationInvert==1){block2InputColorHSB.y=1.0-block2InputColorHSB.y;}
+		if(block2InputBrightInvert==1){block2InputColorHSB.z=1.0-block2InputColorHSB.z;}
+
+		block2InputColorHSB.x=fract(block2InputColorHSB.x);
+
+		if(block2InputSolarize==1){block2InputColorHSB.z=solarize(block2InputColorHSB.z);}
+
+		block2InputColor.rgb=hsb2rgb(block2InputColorHSB);
+
+		if(block2InputRGBInvert==1){block2InputColor.rgb=1.0-block2InputColor.rgb;}
+	}
+
+	if(block2InputPosterizeSwitch==1){
+		block2InputColor.rgb=colorQuantize(block2InputColor.rgb,block2InputPosterize,block2InputPosterizeInvert);
+	}
+
+	//with fb2 out of the mix Block2 writes its input layer, clamped
+	return vec4(clamp(block2InputColor.rgb,0.0,1.0),1.0);
+}
+
+void main()
+{
+
+	//BLOCK1
+	//flips, composed on the CPU (see LayerTransform)
+	vec2 block1Coords=(block1PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
 
 	if(block1HMirror==1){
         if(block1Coords.x.x>width/2){block1Coords.x=abs(width-block1Coords.x);}
@@ -484,22 +802,25 @@ void main()
 
 	block1Coords=kaleidoscope(block1Coords,block1KaleidoscopeAmount,block1KaleidoscopeSlice);
 
-	block1Coords+=block1XYDisplace;
-	block1Coords-=center;
-	block1Coords*=block1ZDisplace;
-	block1Coords+=center;
-
-	block1Coords=rotate(block1Coords,block1Rotate,block1RotateMode);
-
-	block1Coords=shear(block1Coords,block1ShearMatrix);
+	//displace, zoom, rotate and shear, composed on the CPU (see LayerTransform)
+	block1Coords=(block1Transform*vec3(block1Coords,1.0)).xy;
 
 	if(block1GeoOverflow==1){block1Coords=wrapCoord(block1Coords);}
 	if(block1GeoOverflow==2){block1Coords=mirrorCoord(block1Coords);}
 
 
 
-	vec4 block1Color=blurAndSharpen(block1Output,(block1Coords/vec2(width,height)),block1SharpenAmount,block1SharpenRadius,
-		block1FiltersBoost,block1BlurRadius,block1BlurAmount);
+	vec4 block1Color=vec4(0.0);
+	if(block1LayerOn==0){
+		//culled, doesn't reach the output
+	}
+	else if(block1BlurPrepass==1){
+		block1Color=blurAndSharpenPrepass(block1Output,block1Prepass,(block1Coords/vec2(width,height)),block1SharpenAmount,block1FiltersBoost,block1BlurAmount);
+	}
+	else{
+		block1Color=blurAndSharpen(block1Output,(block1Coords/vec2(width,height)),block1SharpenAmount,block1SharpenRadius,
+			block1FiltersBoost,block1BlurRadius,block1BlurAmount);
+	}
 
 	if(block1GeoOverflow==0){
 		if(block1Coords.x>width || block1Coords.y> height || block1Coords.x<0.0 || block1Coords.y<0.0){
@@ -509,60 +830,67 @@ void main()
 
 	//vec4 block1Color=texture(block1Output, block1Coords/vec2(width,height));
 
-	vec3 block1ColorHSB=rgb2hsb(block1Color.rgb);
-
-	//BLOCK1 COLORIZE
-	if(block1ColorizeSwitch==1){
-		vec3 colorizedRGB=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB1=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB2=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB3=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB4=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB5=vec3(0.0,0.0,0.0);
-
-
-		if(block1ColorizeHSB_RGB==0){
-			//assign bands
-			vec3 colorizedHSB1=block1ColorizeBand1+vec3(0.0,0.0,block1ColorHSB.z);
-			vec3 colorizedHSB2=block1ColorizeBand2+vec3(0.0,0.0,block1ColorHSB.z);
-			vec3 colorizedHSB3=block1ColorizeBand3+vec3(0.0,0.0,block1ColorHSB.z);
-			vec3 colorizedHSB4=block1ColorizeBand4+vec3(0.0,0.0,block1ColorHSB.z);
-			vec3 colorizedHSB5=block1ColorizeBand5+vec3(0.0,0.0,block1ColorHSB.z);
-
-			//convert to rgb
-			colorizedRGB1=hsb2rgb(colorizedHSB1);
-			colorizedRGB2=hsb2rgb(colorizedHSB2);
-			colorizedRGB3=hsb2rgb(colorizedHSB3);
-			colorizedRGB4=hsb2rgb(colorizedHSB4);
-			colorizedRGB5=hsb2rgb(colorizedHSB5);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(block1ColorLutOn==1){
+		block1Color.rgb=colorLut(block1ColorLut,block1Color.rgb);
+	}
+	else{
+		vec3 block1ColorHSB=rgb2hsb(block1Color.rgb);
+
+		//BLOCK1 COLORIZE
+		if(block1ColorizeSwitch==1){
+			vec3 colorizedRGB=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB1=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB2=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB3=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB4=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB5=vec3(0.0,0.0,0.0);
+
+
+			if(block1ColorizeHSB_RGB==0){
+				//assign bands
+				vec3 colorizedHSB1=block1ColorizeBand1+vec3(0.0,0.0,block1ColorHSB.z);
+				vec3 colorizedHSB2=block1ColorizeBand2+vec3(0.0,0.0,block1ColorHSB.z);
+				vec3 colorizedHSB3=block1ColorizeBand3+vec3(0.0,0.0,block1ColorHSB.z);
+				vec3 colorizedHSB4=block1ColorizeBand4+vec3(0.0,0.0,block1ColorHSB.z);
+				vec3 colorizedHSB5=block1ColorizeBand5+vec3(0.0,0.0,block1ColorHSB.z);
+
+				//convert to rgb
+				colorizedRGB1=hsb2rgb(colorizedHSB1);
+				colorizedRGB2=hsb2rgb(colorizedHSB2);
+				colorizedRGB3=hsb2rgb(colorizedHSB3);
+				colorizedRGB4=hsb2rgb(colorizedHSB4);
+				colorizedRGB5=hsb2rgb(colorizedHSB5);
 
-		}
+			}
 
-		if(block1ColorizeHSB_RGB==1){
-			colorizedRGB1=block1ColorizeBand1+block1Color.rgb;
-			colorizedRGB2=block1ColorizeBand2+block1Color.rgb;
-			colorizedRGB3=block1ColorizeBand3+block1Color.rgb;
-			colorizedRGB4=block1ColorizeBand4+block1Color.rgb;
-			colorizedRGB5=block1ColorizeBand5+block1Color.rgb;
+			if(block1ColorizeHSB_RGB==1){
+				colorizedRGB1=block1ColorizeBand1+block1Color.rgb;
+				colorizedRGB2=block1ColorizeBand2+block1Color.rgb;
+				colorizedRGB3=block1ColorizeBand3+block1Color.rgb;
+				colorizedRGB4=block1ColorizeBand4+block1Color.rgb;
+				colorizedRGB5=block1ColorizeBand5+block1Color.rgb;
 
-		}
+			}
 
-		if(block1ColorHSB.z<.25){
-			colorizedRGB=mix(colorizedRGB1,colorizedRGB2,block1ColorHSB.z*4.0);
-		}
-		if(block1ColorHSB.z>.25 && block1ColorHSB.z<.5){
-			colorizedRGB=mix(colorizedRGB2,colorizedRGB3,(block1ColorHSB.z-.25)*4.0);
-		}
-		if(block1ColorHSB.z>.5 && block1ColorHSB.z<.75){
-			colorizedRGB=mix(colorizedRGB3,colorizedRGB4,(block1ColorHSB.z-.5)*4.0);
-		}
-		if(block1ColorHSB.z>.75){
-			colorizedRGB=mix(colorizedRGB4,colorizedRGB5,(block1ColorHSB.z-.75)*4.0);
-		}
+			if(block1ColorHSB.z<.25){
+				colorizedRGB=mix(colorizedRGB1,colorizedRGB2,block1ColorHSB.z*4.0);
+			}
+			if(block1ColorHSB.z>.25 && block1ColorHSB.z<.5){
+				colorizedRGB=mix(colorizedRGB2,colorizedRGB3,(block1ColorHSB.z-.25)*4.0);
+			}
+			if(block1ColorHSB.z>.5 && block1ColorHSB.z<.75){
+				colorizedRGB=mix(colorizedRGB3,colorizedRGB4,(block1ColorHSB.z-.5)*4.0);
+			}
+			if(block1ColorHSB.z>.75){
+				colorizedRGB=mix(colorizedRGB4,colorizedRGB5,(block1ColorHSB.z-.75)*4.0);
+			}
 
-		block1Color.rgb=colorizedRGB;
+			block1Color.rgb=colorizedRGB;
+		}
 	}
 
+
 	//dither
 	if(block1DitherSwitch==1){
 		 //rgb mode?
@@ -579,17 +907,8 @@ void main()
 
 
 	//block2
-	vec2 block2Coords=texCoordVarying*vec2(width,height);
-
-	//GEO
-	//vec2 center=vec2(640,360);
-	//geometry
-	if(block2HFlip==1){
-		block2Coords.x=width-block2Coords.x;
-	}
-	if(block2VFlip==1){
-		block2Coords.y=height-block2Coords.y;
-	}
+	//flips, composed on the CPU (see LayerTransform)
+	vec2 block2Coords=(block2PreTransform*vec3(texCoordVarying*vec2(width,height),1.0)).xy;
 
 	if(block2HMirror==1){
         if(block2Coords.x.x>width/2){block2Coords.x=abs(width-block2Coords.x);}
@@ -600,22 +919,29 @@ void main()
 
 	block2Coords=kaleidoscope(block2Coords,block2KaleidoscopeAmount,block2KaleidoscopeSlice);
 
-	block2Coords+=block2XYDisplace;
-	block2Coords-=center;
-	block2Coords*=block2ZDisplace;
-	block2Coords+=center;
-
-	block2Coords=rotate(block2Coords,block2Rotate,block2RotateMode);
-
-	block2Coords=shear(block2Coords,block2ShearMatrix);
+	//displace, zoom, rotate and shear, composed on the CPU (see LayerTransform)
+	block2Coords=(block2Transform*vec3(block2Coords,1.0)).xy;
 
 	if(block2GeoOverflow==1){block2Coords=wrapCoord(block2Coords);}
 	if(block2GeoOverflow==2){block2Coords=mirrorCoord(block2Coords);}
 
 
 
-	vec4 block2Color=blurAndSharpen(block2Output,(block2Coords/vec2(width,height)),block2SharpenAmount,block2SharpenRadius,
-		block2FiltersBoost,block2BlurRadius,block2BlurAmount);
+	vec4 block2Color=vec4(0.0);
+	if(block2LayerOn==0){
+		//culled, doesn't reach the output
+	}
+	else if(block2Fused==1){
+		//Block2 fused into this pass, no blur/sharpen on this layer
+		block2Color=block2InputFused(block2Coords/vec2(width,height));
+	}
+	else if(block2BlurPrepass==1){
+		block2Color=blurAndSharpenPrepass(block2Output,block2Prepass,(block2Coords/vec2(width,height)),block2SharpenAmount,block2FiltersBoost,block2BlurAmount);
+	}
+	else{
+		block2Color=blurAndSharpen(block2Output,(block2Coords/vec2(width,height)),block2SharpenAmount,block2SharpenRadius,
+			block2FiltersBoost,block2BlurRadius,block2BlurAmount);
+	}
 
 	if(block2GeoOverflow==0){
 		if(block2Coords.x>width || block2Coords.y> height || block2Coords.x<0.0 || block2Coords.y<0.0){
@@ -628,60 +954,67 @@ void main()
 
 
 
-	vec3 block2ColorHSB=rgb2hsb(block2Color.rgb);
-
-	//block2 COLORIZE
-	if(block2ColorizeSwitch==1){
-		vec3 colorizedRGB=vec3(0.0,0.0,0.0);
-
-		vec3 colorizedRGB1=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB2=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB3=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB4=vec3(0.0,0.0,0.0);
-		vec3 colorizedRGB5=vec3(0.0,0.0,0.0);
-
-
-		if(block2ColorizeHSB_RGB==0){
-			//assign bands
-			vec3 colorizedHSB1=block2ColorizeBand1+vec3(0.0,0.0,block2ColorHSB.z);
-			vec3 colorizedHSB2=block2ColorizeBand2+vec3(0.0,0.0,block2ColorHSB.z);
-			vec3 colorizedHSB3=block2ColorizeBand3+vec3(0.0,0.0,block2ColorHSB.z);
-			vec3 colorizedHSB4=block2ColorizeBand4+vec3(0.0,0.0,block2ColorHSB.z);
-			vec3 colorizedHSB5=block2ColorizeBand5+vec3(0.0,0.0,block2ColorHSB.z);
+	//pointwise colour chain, baked into a 3D LUT when possible (see ColorLut)
+	if(block2ColorLutOn==1){
+		block2Color.rgb=colorLut(block2ColorLut,block2Color.rgb);
+	}
+	else{
+		vec3 block2ColorHSB=rgb2hsb(block2Color.rgb);
+
+		//block2 COLORIZE
+		if(block2ColorizeSwitch==1){
+			vec3 colorizedRGB=vec3(0.0,0.0,0.0);
+
+			vec3 colorizedRGB1=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB2=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB3=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB4=vec3(0.0,0.0,0.0);
+			vec3 colorizedRGB5=vec3(0.0,0.0,0.0);
+
+
+			if(block2ColorizeHSB_RGB==0){
+				//assign bands
+				vec3 colorizedHSB1=block2ColorizeBand1+vec3(0.0,0.0,block2ColorHSB.z);
+				vec3 colorizedHSB2=block2ColorizeBand2+vec3(0.0,0.0,block2ColorHSB.z);
+				vec3 colorizedHSB3=block2ColorizeBand3+vec3(0.0,0.0,block2ColorHSB.z);
+				vec3 colorizedHSB4=block2ColorizeBand4+vec3(0.0,0.0,block2ColorHSB.z);
+				vec3 colorizedHSB5=block2ColorizeBand5+vec3(0.0,0.0,block2ColorHSB.z);
+
+				//convert to rgb
+				colorizedRGB1=hsb2rgb(colorizedHSB1);
+				colorizedRGB2=hsb2rgb(colorizedHSB2);
+				colorizedRGB3=hsb2rgb(colorizedHSB3);
+				colorizedRGB4=hsb2rgb(colorizedHSB4);
+				colorizedRGB5=hsb2rgb(colorizedHSB5);
 
-			//convert to rgb
-			colorizedRGB1=hsb2rgb(colorizedHSB1);
-			colorizedRGB2=hsb2rgb(colorizedHSB2);
-			colorizedRGB3=hsb2rgb(colorizedHSB3);
-			colorizedRGB4=hsb2rgb(colorizedHSB4);
-			colorizedRGB5=hsb2rgb(colorizedHSB5);
+			}
 
-		}
+			if(block2ColorizeHSB_RGB==1){
+				colorizedRGB1=block2ColorizeBand1+block2Color.rgb;
+				colorizedRGB2=block2ColorizeBand2+block2Color.rgb;
+				colorizedRGB3=block2ColorizeBand3+block2Color.rgb;
+				colorizedRGB4=block2ColorizeBand4+block2Color.rgb;
+				colorizedRGB5=block2ColorizeBand5+block2Color.rgb;
 
-		if(block2ColorizeHSB_RGB==1){
-			colorizedRGB1=block2ColorizeBand1+block2Color.rgb;
-			colorizedRGB2=block2ColorizeBand2+block2Color.rgb;
-			colorizedRGB3=block2ColorizeBand3+block2Color.rgb;
-			colorizedRGB4=block2ColorizeBand4+block2Color.rgb;
-			colorizedRGB5=block2ColorizeBand5+block2Color.rgb;
+			}
 
-		}
+			if(block2ColorHSB.z<.25){
+				colorizedRGB=mix(colorizedRGB1,colorizedRGB2,block2ColorHSB.z*4.0);
+			}
+			if(block2ColorHSB.z>.25 && block2ColorHSB.z<.5){
+				colorizedRGB=mix(colorizedRGB2,colorizedRGB3,(block2ColorHSB.z-.25)*4.0);
+			}
+			if(block2ColorHSB.z>.5 && block2ColorHSB.z<.75){
+				colorizedRGB=mix(colorizedRGB3,colorizedRGB4,(block2ColorHSB.z-.5)*4.0);
+			}
+			if(block2ColorHSB.z>.75){
+				colorizedRGB=mix(colorizedRGB4,colorizedRGB5,(block2ColorHSB.z-.75)*4.0);
+			}
 
-		if(block2ColorHSB.z<.25){
-			colorizedRGB=mix(colorizedRGB1,colorizedRGB2,block2ColorHSB.z*4.0);
-		}
-		if(block2ColorHSB.z>.25 && block2ColorHSB.z<.5){
-			colorizedRGB=mix(colorizedRGB2,colorizedRGB3,(block2ColorHSB.z-.25)*4.0);
-		}
-		if(block2ColorHSB.z>.5 && block2ColorHSB.z<.75){
-			colorizedRGB=mix(colorizedRGB3,colorizedRGB4,(block2ColorHSB.z-.5)*4.0);
+			block2Color.rgb=colorizedRGB;
 		}
-		if(block2ColorHSB.z>.75){
-			colorizedRGB=mix(colorizedRGB4,colorizedRGB5,(block2ColorHSB.z-.75)*4.0);
-		}
-
-		block2Color.rgb=colorizedRGB;
 	}
+
 	//dither
 	if(block2DitherSwitch==1){
 		 //rgb mode?
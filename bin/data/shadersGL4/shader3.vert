@@ -1,7 +1,7 @@
 #version 460
 
 // these are for the programmable pipeline system
-uniform mat4 modelViewProjectionMatrix;
+layout(location = 0) uniform mat4 modelViewProjectionMatrix;  // locations 0-3
 
 in vec4 position;
 in vec2 texcoord;
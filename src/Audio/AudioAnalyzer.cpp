@@ -1,4 +1,5 @@
 #include "AudioAnalyzer.h"
+#include "../Core/FrameTracer.h"
 
 namespace dragonwaves {
 
@@ -217,6 +218,7 @@ void AudioAnalyzer::close() {
 }
 
 void AudioAnalyzer::update() {
+    TraceScope trace("AudioAnalyzer::update");
     if (!settings.enabled || !streamSetup) {
         return;
     }
@@ -390,6 +392,8 @@ void AudioAnalyzer::setDevice(int deviceIndex) {
 }
 
 void AudioAnalyzer::audioIn(ofSoundBuffer& buffer) {
+    FrameTracer::getInstance().setThreadName("audio");
+    TraceScope trace("AudioAnalyzer::audioIn");
     const float* input = buffer.getBuffer().data();
     int nFrames = buffer.getNumFrames();
     int nChannels = buffer.getNumChannels();
@@ -424,6 +428,8 @@ void AudioAnalyzer::audioIn(ofSoundBuffer& buffer) {
 }
 
 void AudioAnalyzer::audioIn(float* input, int bufferSize, int nChannels) {
+    FrameTracer::getInstance().setThreadName("audio");
+    TraceScope trace("AudioAnalyzer::audioIn");
     // Calculate volume (RMS)
     float vol = 0.0f;
     for (int i = 0; i < bufferSize; i++) {
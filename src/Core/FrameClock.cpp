@@ -0,0 +1,24 @@
+#include "FrameClock.h"
+
+namespace dragonwaves {
+
+void FrameClock::setFixedFps(float fps) {
+    fixedStep = fps > 0.0f ? 1.0f / fps : 0.0f;
+    frameNum = 0;
+    ofLogNotice("FrameClock") << (isFixed() ? "Fixed step " + ofToString(fixedStep * 1000.0f, 3) + " ms" : "Wall clock");
+}
+
+void FrameClock::tick() {
+    frameNum++;
+}
+
+float FrameClock::getDeltaTime() const {
+    return isFixed() ? fixedStep : (float)ofGetLastFrameTime();
+}
+
+float FrameClock::getElapsedTime() const {
+    // Frame count times the step, so the time doesn't drift with float accumulation
+    return isFixed() ? (float)(frameNum * (double)fixedStep) : ofGetElapsedTimef();
+}
+
+} // namespace dragonwaves
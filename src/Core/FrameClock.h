@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Time base for everything that animates (LFOs, tempo, audio modulation
+// smoothing, input frame rate stats)
+//
+// Live it follows the wall clock. With a fixed frame rate every tick()
+// advances exactly 1/fps, so an offline render is the same whatever speed
+// the hardware manages.
+//==============================================================================
+class FrameClock {
+public:
+    static FrameClock& getInstance() {
+        static FrameClock instance;
+        return instance;
+    }
+
+    // Fixed step of 1/fps per frame; 0 follows the wall clock
+    void setFixedFps(float fps);
+    bool isFixed() const { return fixedStep > 0.0f; }
+
+    // Once per frame, before anything reads the clock
+    void tick();
+
+    // Seconds since the previous frame / since startup
+    float getDeltaTime() const;
+    float getElapsedTime() const;
+
+    uint64_t getFrameNum() const { return frameNum; }
+
+private:
+    FrameClock() = default;
+
+    float fixedStep = 0.0f;
+    uint64_t frameNum = 0;
+};
+
+} // namespace dragonwaves
@@ -0,0 +1,160 @@
+#include "FrameTracer.h"
+#include <chrono>
+#include <fstream>
+
+namespace dragonwaves {
+
+//==============================================================================
+// One thread's ring. A slot's sequence number is odd while its owner writes
+// it and 2 * (index + 1) once event `index` is complete.
+//==============================================================================
+struct TraceEvent {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> begin{0};
+    std::atomic<uint64_t> end{0};
+};
+
+struct TraceThreadBuffer {
+    int threadId = 0;
+    std::string threadName;             // guarded by FrameTracer::buffersMutex
+    std::atomic<bool> retired{false};   // owner exited, free for the next new thread
+    std::atomic<uint64_t> head{0};      // events written so far
+    std::unique_ptr<TraceEvent[]> events{new TraceEvent[FrameTracer::RING_SIZE]};
+};
+
+namespace {
+
+struct ThreadSlot {
+    TraceThreadBuffer* buffer = nullptr;
+    std::string name;
+    ~ThreadSlot() {
+        if (buffer) buffer->retired.store(true);
+    }
+};
+
+thread_local ThreadSlot threadSlot;
+
+} // namespace
+
+FrameTracer::FrameTracer() = default;
+
+FrameTracer::~FrameTracer() = default;
+
+uint64_t FrameTracer::now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+void FrameTracer::setEnabled(bool e) {
+    if (e == isEnabled()) return;
+    enabled.store(e, std::memory_order_relaxed);
+    ofLogNotice("FrameTracer") << (e ? "Enabled" : "Disabled");
+}
+
+void FrameTracer::setThreadName(const std::string& name) {
+    if (threadSlot.name == name) return;
+    threadSlot.name = name;
+    if (threadSlot.buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        threadSlot.buffer->threadName = name;
+    }
+}
+
+TraceThreadBuffer* FrameTracer::getThreadBuffer() {
+    if (threadSlot.buffer) return threadSlot.buffer;
+
+    // First section on this thread: take over an exited thread's ring or add one
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    TraceThreadBuffer* buffer = nullptr;
+    for (auto& candidate : buffers) {
+        if (candidate->retired.load()) {
+            buffer = candidate.get();
+            buffer->retired.store(false);
+            break;
+        }
+    }
+    if (!buffer) {
+        buffers.push_back(std::make_unique<TraceThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->threadId = nextThreadId++;
+    }
+    buffer->threadName = threadSlot.name.empty() ? "thread " + ofToString(buffer->threadId) : threadSlot.name;
+    threadSlot.buffer = buffer;
+    return buffer;
+}
+
+void FrameTracer::record(const char* name, uint64_t beginMicros, uint64_t endMicros) {
+    TraceThreadBuffer* buffer = getThreadBuffer();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[index % RING_SIZE];
+
+    event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(beginMicros, std::memory_order_relaxed);
+    event.end.store(endMicros, std::memory_order_relaxed);
+    event.sequence.store(2 * index + 2, std::memory_order_release);
+
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+bool FrameTracer::dump(const std::string& path, float seconds) {
+    uint64_t cutoff = now();
+    uint64_t window = (uint64_t)(std::max(seconds, 0.0f) * 1.0e6f);
+    cutoff = cutoff > window ? cutoff - window : 0;
+
+    ofJson traceEvents = ofJson::array();
+    int eventCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (auto& buffer : buffers) {
+            traceEvents.push_back({
+                { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", buffer->threadId },
+                { "args", { { "name", buffer->threadName } } }
+            });
+
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t first = head > (uint64_t)RING_SIZE ? head - RING_SIZE : 0;
+            for (uint64_t i = first; i < head; i++) {
+                TraceEvent& event = buffer->events[i % RING_SIZE];
+                uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+                if (sequence != 2 * i + 2) continue;
+                const char* name = event.name.load(std::memory_order_relaxed);
+                uint64_t begin = event.begin.load(std::memory_order_relaxed);
+                uint64_t end = event.end.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                // Overwritten by the owner while we read it
+                if (event.sequence.load(std::memory_order_relaxed) != sequence) continue;
+                if (end < cutoff) continue;
+
+                traceEvents.push_back({
+                    { "name", name }, { "cat", "cpu" }, { "ph", "X" },
+                    { "ts", begin }, { "dur", end - begin }, { "pid", 1 }, { "tid", buffer->threadId }
+                });
+                eventCount++;
+            }
+        }
+    }
+
+    ofJson trace;
+    trace["traceEvents"] = traceEvents;
+    trace["displayTimeUnit"] = "ms";
+
+    std::ofstream file(ofToDataPath(path, true));
+    if (!file) {
+        ofLogError("FrameTracer") << "Could not write " << path;
+        return false;
+    }
+    file << trace.dump();
+    ofLogNotice("FrameTracer") << "Wrote " << eventCount << " sections (last " << seconds << " s) to " << path;
+    return true;
+}
+
+bool FrameTracer::dump(float seconds) {
+    ofDirectory::createDirectory("traces", true, true);
+    return dump("traces/trace-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json", seconds);
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+#include <mutex>
+
+namespace dragonwaves {
+
+struct TraceThreadBuffer;
+
+//==============================================================================
+// CPU frame-phase tracer
+//
+// TraceScope marks a section of a frame (or of a worker thread's loop).
+// Finished sections go into a ring owned by the calling thread: the owner is
+// the only writer, so recording takes no locks, and a dump reads the rings
+// concurrently, skipping any slot that was overwritten while it read.
+//
+// Disabled (the default) a scope costs one relaxed atomic load, so the
+// scopes stay compiled in. Enabled, the last RING_SIZE sections per thread
+// are kept and dump() writes the requested window as Chrome trace-event
+// JSON (chrome://tracing, ui.perfetto.dev).
+//==============================================================================
+class FrameTracer {
+public:
+    static constexpr int RING_SIZE = 16384;     // sections kept per thread
+
+    static FrameTracer& getInstance() {
+        static FrameTracer instance;
+        return instance;
+    }
+
+    // Microseconds on a steady clock, the trace's time base
+    static uint64_t now();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Label the calling thread in exported traces (cheap to repeat)
+    void setThreadName(const std::string& name);
+
+    // A finished section on the calling thread; `name` must be a string literal
+    void record(const char* name, uint64_t beginMicros, uint64_t endMicros);
+
+    // Write the last `seconds` of every thread's sections; returns false on failure
+    bool dump(const std::string& path, float seconds);
+    // Same, to data/traces/trace-<timestamp>.json
+    bool dump(float seconds);
+
+private:
+    // Out of line, where TraceThreadBuffer is complete
+    FrameTracer();
+    ~FrameTracer();
+    FrameTracer(const FrameTracer&) = delete;
+    FrameTracer& operator=(const FrameTracer&) = delete;
+
+    std::atomic<bool> enabled{false};
+
+    std::mutex buffersMutex;    // buffer list and thread names, not the rings
+    std::vector<std::unique_ptr<TraceThreadBuffer>> buffers;
+    int nextThreadId = 1;
+
+    TraceThreadBuffer* getThreadBuffer();
+};
+
+//==============================================================================
+// Times the enclosing scope when tracing is on
+//==============================================================================
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name(name), active(FrameTracer::getInstance().isEnabled()),
+          begin(active ? FrameTracer::now() : 0) {}
+
+    ~TraceScope() {
+        if (active) FrameTracer::getInstance().record(name, begin, FrameTracer::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t begin;
+};
+
+} // namespace dragonwaves
@@ -106,15 +106,40 @@ void DisplaySettings::loadFromJson(const ofJson& json) {
         input2Height = display.value("input2Height", 480);
         internalWidth = display.value("internalWidth", 1280);
         internalHeight = display.value("internalHeight", 720);
+        block1Scale = display.value("block1Scale", 1.0f);
+        block2Scale = display.value("block2Scale", 1.0f);
+        block1UpdateInterval = display.value("block1UpdateInterval", 1);
+        block2UpdateInterval = display.value("block2UpdateInterval", 1);
+        resolutionGovernor = display.value("resolutionGovernor", false);
+        resolutionGovernorMinScale = display.value("resolutionGovernorMinScale", 0.5f);
         outputWidth = display.value("outputWidth", 1280);
         outputHeight = display.value("outputHeight", 720);
         ndiSendWidth = display.value("ndiSendWidth", 1280);
         ndiSendHeight = display.value("ndiSendHeight", 720);
+        ndiSendUyvy = display.value("ndiSendUyvy", false);
 #if OFAPP_HAS_SPOUT
         spoutSendWidth = display.value("spoutSendWidth", 1280);
         spoutSendHeight = display.value("spoutSendHeight", 720);
 #endif
         targetFPS = display.value("targetFPS", 30);
+        zeroCopyFeedback = display.value("zeroCopyFeedback", true);
+        feedbackMemoryBudgetMB = display.value("feedbackMemoryBudgetMB", 1024);
+        feedbackFullQualityFrames = display.value("feedbackFullQualityFrames", 30);
+        feedbackOlderTierFormat = display.value("feedbackOlderTierFormat", 0);
+        shaderVariants = display.value("shaderVariants", true);
+        shaderBinaryCache = display.value("shaderBinaryCache", true);
+        blurPrepass = display.value("blurPrepass", true);
+        blurPrepassScale = display.value("blurPrepassScale", 0.5f);
+        colorLut = display.value("colorLut", true);
+        deadPathElision = display.value("deadPathElision", true);
+        passFusion = display.value("passFusion", true);
+        channelCache = display.value("channelCache", true);
+        warpMaps = display.value("warpMaps", true);
+        gpuProfiler = display.value("gpuProfiler", true);
+        gpuStatsOverlay = display.value("gpuStatsOverlay", false);
+        frameTracing = display.value("frameTracing", false);
+        traceSeconds = display.value("traceSeconds", 10.0f);
+        readbackRingDepth = display.value("readbackRingDepth", 3);
     }
 }
 
@@ -125,15 +150,40 @@ void DisplaySettings::saveToJson(ofJson& json) const {
     json["display"]["input2Height"] = input2Height;
     json["display"]["internalWidth"] = internalWidth;
     json["display"]["internalHeight"] = internalHeight;
+    json["display"]["block1Scale"] = block1Scale;
+    json["display"]["block2Scale"] = block2Scale;
+    json["display"]["block1UpdateInterval"] = block1UpdateInterval;
+    json["display"]["block2UpdateInterval"] = block2UpdateInterval;
+    json["display"]["resolutionGovernor"] = resolutionGovernor;
+    json["display"]["resolutionGovernorMinScale"] = resolutionGovernorMinScale;
     json["display"]["outputWidth"] = outputWidth;
     json["display"]["outputHeight"] = outputHeight;
     json["display"]["ndiSendWidth"] = ndiSendWidth;
     json["display"]["ndiSendHeight"] = ndiSendHeight;
+    json["display"]["ndiSendUyvy"] = ndiSendUyvy;
 #if OFAPP_HAS_SPOUT
     json["display"]["spoutSendWidth"] = spoutSendWidth;
     json["display"]["spoutSendHeight"] = spoutSendHeight;
 #endif
     json["display"]["targetFPS"] = targetFPS;
+    json["display"]["zeroCopyFeedback"] = zeroCopyFeedback;
+    json["display"]["feedbackMemoryBudgetMB"] = feedbackMemoryBudgetMB;
+    json["display"]["feedbackFullQualityFrames"] = feedbackFullQualityFrames;
+    json["display"]["feedbackOlderTierFormat"] = feedbackOlderTierFormat;
+    json["display"]["shaderVariants"] = shaderVariants;
+    json["display"]["shaderBinaryCache"] = shaderBinaryCache;
+    json["display"]["blurPrepass"] = blurPrepass;
+    json["display"]["blurPrepassScale"] = blurPrepassScale;
+    json["display"]["colorLut"] = colorLut;
+    json["display"]["deadPathElision"] = deadPathElision;
+    json["display"]["passFusion"] = passFusion;
+    json["display"]["channelCache"] = channelCache;
+    json["display"]["warpMaps"] = warpMaps;
+    json["display"]["gpuProfiler"] = gpuProfiler;
+    json["display"]["gpuStatsOverlay"] = gpuStatsOverlay;
+    json["display"]["frameTracing"] = frameTracing;
+    json["display"]["traceSeconds"] = traceSeconds;
+    json["display"]["readbackRingDepth"] = readbackRingDepth;
 }
 
 //==============================================================================
@@ -292,6 +342,8 @@ void SettingsManager::reload() {
     // Check for resolution/FPS changes
     if (oldDisplay.internalWidth != display.internalWidth ||
         oldDisplay.internalHeight != display.internalHeight ||
+        oldDisplay.block1Scale != display.block1Scale ||
+        oldDisplay.block2Scale != display.block2Scale ||
         oldDisplay.outputWidth != display.outputWidth ||
         oldDisplay.outputHeight != display.outputHeight ||
         oldDisplay.input1Width != display.input1Width ||
@@ -371,6 +423,8 @@ void SettingsManager::applyDisplaySettings(const DisplaySettings& newSettings) {
     // Check if resolution changed
     if (display.internalWidth != newSettings.internalWidth ||
         display.internalHeight != newSettings.internalHeight ||
+        display.block1Scale != newSettings.block1Scale ||
+        display.block2Scale != newSettings.block2Scale ||
         display.outputWidth != newSettings.outputWidth ||
         display.outputHeight != newSettings.outputHeight ||
         display.input1Width != newSettings.input1Width ||
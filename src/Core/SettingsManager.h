@@ -29,6 +29,20 @@ struct DisplaySettings {
     int internalWidth = 1280;
     int internalHeight = 720;
     
+    // Block1/Block2 render at this fraction of the internal resolution
+    // (0.25 - 1, upsampled by their readers) and every N frames (1 - 8,
+    // holding their last output in between)
+    float block1Scale = 1.0f;
+    float block2Scale = 1.0f;
+    int block1UpdateInterval = 1;
+    int block2UpdateInterval = 1;
+    
+    // Lower Block1/Block2's resolution (down to resolutionGovernorMinScale)
+    // while frames run over the targetFPS budget, and raise it again once
+    // there is headroom
+    bool resolutionGovernor = false;
+    float resolutionGovernorMinScale = 0.5f;
+    
     // Output window resolution
     int outputWidth = 1280;
     int outputHeight = 720;
@@ -37,6 +51,10 @@ struct DisplaySettings {
     int ndiSendWidth = 1280;
     int ndiSendHeight = 720;
     
+    // Send NDI as UYVY 4:2:2, converted on the GPU (half the readback of
+    // RGBA, no alpha)
+    bool ndiSendUyvy = false;
+    
 #if OFAPP_HAS_SPOUT
     int spoutSendWidth = 1280;
     int spoutSendHeight = 720;
@@ -45,6 +63,68 @@ struct DisplaySettings {
     // Performance
     int targetFPS = 30;
     
+    // Block1/Block2 write feedback history as a second shader output instead
+    // of a separate copy into the delay buffer (one fewer pass per block).
+    // Needs GL 4.5 or GL_ARB_texture_barrier, copies otherwise.
+    bool zeroCopyFeedback = true;
+    
+    // Video memory budget for both feedback delay buffers (0 = unlimited).
+    // Caps the longest usable delay; buffers only grow as far as needed.
+    int feedbackMemoryBudgetMB = 1024;
+    
+    // Tiered feedback history: the newest N frames stay full quality, older
+    // frames are stored at half resolution (0) or 16-bit RGB565 (1) and
+    // upsampled on read. 0 keeps every frame at full quality.
+    int feedbackFullQualityFrames = 30;
+    int feedbackOlderTierFormat = 0;
+    
+    // Compile block shaders specialized for the current switch settings
+    // (mirrors, mix types...) and use them once ready
+    bool shaderVariants = true;
+    
+    // Cache linked shader programs on disk (data/shaderCache) for faster startup
+    bool shaderBinaryCache = true;
+    
+    // Compute blur/sharpen neighbourhoods in a separable pre-pass at
+    // blurPrepassScale of the layer resolution (0.25 - 1)
+    bool blurPrepass = true;
+    float blurPrepassScale = 0.5f;
+    
+    // Bake the per-layer colour chains into 3D LUTs once their parameters
+    // settle (layers a LUT can't represent stay analytic)
+    bool colorLut = true;
+    
+    // Skip layers, feedback history writes and whole blocks that can't reach
+    // the screen, senders, recorder or preview with the current parameters
+    bool deadPathElision = true;
+    
+    // Fold Block2 into Block3's pass when it only passes its input layer
+    // through (feedback out of the mix) and only Block3 reads it
+    bool passFusion = true;
+    
+    // Keep Block1's processed ch1/ch2 across frames and only redo them when
+    // their input delivers a new frame or their parameters change
+    bool channelCache = true;
+    
+    // Bake each layer's geometry (mirrors, kaleidoscope, displace/zoom/
+    // rotate/shear) into a coordinate texture while its parameters are still
+    bool warpMaps = true;
+    
+    // Time each pipeline stage on the GPU (GUI, OSC /gravity/stats/gpu/*),
+    // optionally drawn over the output window
+    bool gpuProfiler = true;
+    bool gpuStatsOverlay = false;
+    
+    // Record CPU frame phases for Chrome trace export ('t' key or OSC
+    // /gravity/trace/dump writes the last traceSeconds)
+    bool frameTracing = false;
+    float traceSeconds = 10.0f;
+    
+    // Readbacks in flight per frame bus stream (2 - 8). Deeper rides out a
+    // GPU running further behind; a frame whose readback isn't done yet is
+    // skipped rather than waited for.
+    int readbackRingDepth = 3;
+    
     // Getters/Setters for JSON binding
     void loadFromJson(const ofJson& json);
     void saveToJson(ofJson& json) const;
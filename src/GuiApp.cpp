@@ -21,6 +21,8 @@
 #include "ofApp.h"
 #include "Audio/AudioAnalyzer.h"
 #include "Tempo/TempoManager.h"
+#include "ShaderPipeline/GpuProfiler.h"
+#include "Core/FrameTracer.h"
 
 #include "iostream"
 
@@ -131,59 +133,7 @@ void GuiApp::setup(){
 	updateLocalIP();
 	allArrayClear();
 	
-	// Initialize LFO sync arrays to false (disabled by default)
-	for (int i = 0; i < PARAMETER_ARRAY_LENGTH; i++) {
-		ch1AdjustLfoSync[i] = false;
-		ch1AdjustLfoDivision[i] = 2; // Default to 1/4
-		ch2MixAndKeyLfoSync[i] = false;
-		ch2MixAndKeyLfoDivision[i] = 2;
-		ch2AdjustLfoSync[i] = false;
-		ch2AdjustLfoDivision[i] = 2;
-		fb1MixAndKeyLfoSync[i] = false;
-		fb1MixAndKeyLfoDivision[i] = 2;
-		fb1Geo1Lfo1Sync[i] = false;
-		fb1Geo1Lfo1Division[i] = 2;
-		fb1Geo1Lfo2Sync[i] = false;
-		fb1Geo1Lfo2Division[i] = 2;
-		fb1Color1Lfo1Sync[i] = false;
-		fb1Color1Lfo1Division[i] = 2;
-		block2InputAdjustLfoSync[i] = false;
-		block2InputAdjustLfoDivision[i] = 2;
-		fb2MixAndKeyLfoSync[i] = false;
-		fb2MixAndKeyLfoDivision[i] = 2;
-		fb2Geo1Lfo1Sync[i] = false;
-		fb2Geo1Lfo1Division[i] = 2;
-		fb2Geo1Lfo2Sync[i] = false;
-		fb2Geo1Lfo2Division[i] = 2;
-		fb2Color1Lfo1Sync[i] = false;
-		fb2Color1Lfo1Division[i] = 2;
-		block1Geo1Lfo1Sync[i] = false;
-		block1Geo1Lfo1Division[i] = 2;
-		block1Geo1Lfo2Sync[i] = false;
-		block1Geo1Lfo2Division[i] = 2;
-		block1ColorizeLfo1Sync[i] = false;
-		block1ColorizeLfo1Division[i] = 2;
-		block1ColorizeLfo2Sync[i] = false;
-		block1ColorizeLfo2Division[i] = 2;
-		block1ColorizeLfo3Sync[i] = false;
-		block1ColorizeLfo3Division[i] = 2;
-		block2Geo1Lfo1Sync[i] = false;
-		block2Geo1Lfo1Division[i] = 2;
-		block2Geo1Lfo2Sync[i] = false;
-		block2Geo1Lfo2Division[i] = 2;
-		block2ColorizeLfo1Sync[i] = false;
-		block2ColorizeLfo1Division[i] = 2;
-		block2ColorizeLfo2Sync[i] = false;
-		block2ColorizeLfo2Division[i] = 2;
-		block2ColorizeLfo3Sync[i] = false;
-		block2ColorizeLfo3Division[i] = 2;
-		matrixMixLfo1Sync[i] = false;
-		matrixMixLfo1Division[i] = 2;
-		matrixMixLfo2Sync[i] = false;
-		matrixMixLfo2Division[i] = 2;
-		finalMixAndKeyLfoSync[i] = false;
-		finalMixAndKeyLfoDivision[i] = 2;
-	}
+	initializeLfoSync();
 
 	//lets do the buffering of a save state in the setup so we just have one on tap at all times
 	//but we might want to change this later to only happen as a one shot when called
@@ -256,6 +206,72 @@ void GuiApp::setup(){
 
 }
 
+//-------------------------------------------------------------------------------
+void GuiApp::setupHeadless(){
+	allArrayClear();
+	initializeLfoSync();
+	for(int i=0;i<arrayLength;i++){
+		macroData[i]=0;
+	}
+}
+
+//-------------------------------------------------------------------------------
+void GuiApp::initializeLfoSync(){
+	// LFO sync off by default
+	for (int i = 0; i < PARAMETER_ARRAY_LENGTH; i++) {
+		ch1AdjustLfoSync[i] = false;
+		ch1AdjustLfoDivision[i] = 2; // Default to 1/4
+		ch2MixAndKeyLfoSync[i] = false;
+		ch2MixAndKeyLfoDivision[i] = 2;
+		ch2AdjustLfoSync[i] = false;
+		ch2AdjustLfoDivision[i] = 2;
+		fb1MixAndKeyLfoSync[i] = false;
+		fb1MixAndKeyLfoDivision[i] = 2;
+		fb1Geo1Lfo1Sync[i] = false;
+		fb1Geo1Lfo1Division[i] = 2;
+		fb1Geo1Lfo2Sync[i] = false;
+		fb1Geo1Lfo2Division[i] = 2;
+		fb1Color1Lfo1Sync[i] = false;
+		fb1Color1Lfo1Division[i] = 2;
+		block2InputAdjustLfoSync[i] = false;
+		block2InputAdjustLfoDivision[i] = 2;
+		fb2MixAndKeyLfoSync[i] = false;
+		fb2MixAndKeyLfoDivision[i] = 2;
+		fb2Geo1Lfo1Sync[i] = false;
+		fb2Geo1Lfo1Division[i] = 2;
+		fb2Geo1Lfo2Sync[i] = false;
+		fb2Geo1Lfo2Division[i] = 2;
+		fb2Color1Lfo1Sync[i] = false;
+		fb2Color1Lfo1Division[i] = 2;
+		block1Geo1Lfo1Sync[i] = false;
+		block1Geo1Lfo1Division[i] = 2;
+		block1Geo1Lfo2Sync[i] = false;
+		block1Geo1Lfo2Division[i] = 2;
+		block1ColorizeLfo1Sync[i] = false;
+		block1ColorizeLfo1Division[i] = 2;
+		block1ColorizeLfo2Sync[i] = false;
+		block1ColorizeLfo2Division[i] = 2;
+		block1ColorizeLfo3Sync[i] = false;
+		block1ColorizeLfo3Division[i] = 2;
+		block2Geo1Lfo1Sync[i] = false;
+		block2Geo1Lfo1Division[i] = 2;
+		block2Geo1Lfo2Sync[i] = false;
+		block2Geo1Lfo2Division[i] = 2;
+		block2ColorizeLfo1Sync[i] = false;
+		block2ColorizeLfo1Division[i] = 2;
+		block2ColorizeLfo2Sync[i] = false;
+		block2ColorizeLfo2Division[i] = 2;
+		block2ColorizeLfo3Sync[i] = false;
+		block2ColorizeLfo3Division[i] = 2;
+		matrixMixLfo1Sync[i] = false;
+		matrixMixLfo1Division[i] = 2;
+		matrixMixLfo2Sync[i] = false;
+		matrixMixLfo2Division[i] = 2;
+		finalMixAndKeyLfoSync[i] = false;
+		finalMixAndKeyLfoDivision[i] = 2;
+	}
+}
+
 
 //-------------------------------------------------------------------------------
 void GuiApp::indexSaveStateNames(){
@@ -883,6 +899,7 @@ void GuiApp::jsonListToArray(ofJson jsonFile, string listName, float outArray[])
 //GoToDraw
 //--------------------------------------------------------------
 void GuiApp::draw(){
+	dragonwaves::TraceScope trace("GuiApp::draw");
 
 	int debugAdjust=0;
 
@@ -6408,18 +6425,130 @@ void GuiApp::draw(){
 				// ========== FRAME RATE ==========
 				ImGui::Text("FRAME RATE");
 				ImGui::Spacing();
+				// Longest delay the feedback buffers can hold (memory budget and tiering)
+				int maxDelayFrames = (mainApp && mainApp->pipeline) ? mainApp->pipeline->getMaxDelayFrames()
+					: dragonwaves::DelayBuffer::MAX_FRAMES - 2;
 				if (ImGui::SliderInt("Target FPS", &targetFPS, 1, 60)) {
 					// Set flag for main app to apply
 					fpsChangeRequested = true;
 					// Send OSC
 					if (mainApp) {
 						mainApp->sendOscParameter("/gravity/settings/fps", (float)targetFPS);
-						// Send delay time in seconds (pastFramesSize=120 / fps)
-						float secDelay = 120.0f / (float)targetFPS;
+						// Send delay time in seconds (delay buffer capacity / fps)
+						float secDelay = (float)maxDelayFrames / (float)targetFPS;
 						mainApp->sendOscParameter("/gravity/settings/secDelay", roundf(secDelay * 100.0f) / 100.0f);
 					}
 				}
-				ImGui::TextDisabled("Current: %.1f FPS | Max Delay: %.2f sec", ofGetFrameRate(), 120.0f / (float)targetFPS);
+				ImGui::TextDisabled("Current: %.1f FPS | Max Delay: %.2f sec", ofGetFrameRate(), (float)maxDelayFrames / (float)targetFPS);
+				if (mainApp && mainApp->pipeline) {
+					auto& fb1Buffer = mainApp->pipeline->getFB1DelayBuffer();
+					auto& fb2Buffer = mainApp->pipeline->getFB2DelayBuffer();
+					ImGui::TextDisabled("Feedback memory: %.0f MB (fb1 %d / fb2 %d of %d frames)",
+						mainApp->pipeline->getFeedbackMemoryBytes() / (1024.0f * 1024.0f),
+						fb1Buffer.getSize(), fb2Buffer.getSize(), fb1Buffer.getCapacityLimit());
+					if (fb1Buffer.isTiered()) {
+						ImGui::TextDisabled("Tiered history: %d full quality frames | flat storage would be %.0f MB",
+							fb1Buffer.getFullQualitySize() - 1,
+							mainApp->pipeline->getFeedbackFlatMemoryBytes() / (1024.0f * 1024.0f));
+					}
+					// Per-block GPU time, generic program vs specialized variant
+					dragonwaves::ShaderBlock* blocks[] = { &mainApp->pipeline->getBlock1(), &mainApp->pipeline->getBlock2(), &mainApp->pipeline->getBlock3() };
+					for (dragonwaves::ShaderBlock* block : blocks) {
+						const auto& timer = block->getGpuTimer();
+						const auto& cache = block->getVariantCache();
+						ImGui::TextDisabled("%s GPU: %.2f ms generic | %.2f ms specialized%s | %d variants",
+							block->getName().c_str(), timer.getAverageMs(0), timer.getAverageMs(1),
+							block->isSpecialized() ? " (active)" : "", cache.getSize());
+					}
+					ImGui::TextDisabled("Blur/sharpen pre-pass: %d passes this frame",
+						mainApp->pipeline->getBlurPrepassCount());
+					// Colour chains currently sampled from a baked LUT
+					int lutsActive = 0;
+					int lutsTotal = 0;
+					float lutError = 0.0f;
+					for (dragonwaves::ShaderBlock* block : blocks) {
+						lutsActive += block->getActiveColorLutCount();
+						lutsTotal += block->getColorLutCount();
+						lutError = std::max(lutError, block->getColorLutMaxError());
+					}
+					ImGui::TextDisabled("Colour LUTs: %d of %d layers baked | max error %.1f / 255",
+						lutsActive, lutsTotal, lutError);
+					// Culling: blocks no consumer reads are skipped or idle
+					const auto& graph = mainApp->pipeline->getRenderGraph();
+					ImGui::TextDisabled("Passes executed: %d this frame | Block1 %s, Block2 %s, Block3 %s",
+						mainApp->pipeline->getPassesExecuted(),
+						dragonwaves::RenderGraph::getStateName(graph.getState(dragonwaves::RenderGraph::BLOCK1)),
+						mainApp->pipeline->isBlock2Fused() ? "fused into Block3" :
+							dragonwaves::RenderGraph::getStateName(graph.getState(dragonwaves::RenderGraph::BLOCK2)),
+						dragonwaves::RenderGraph::getStateName(graph.getState(dragonwaves::RenderGraph::BLOCK3)));
+					// Block1 channels read back from the cache instead of re-processed
+					const auto& channelCache = mainApp->pipeline->getChannelCache();
+					if (channelCache.isSplit()) {
+						ImGui::TextDisabled("Channel cache: %d channel(s) reused", channelCache.getReusedCount());
+					} else {
+						ImGui::TextDisabled("Channel cache: %s", channelCache.isEnabled() ? "single pass" : "off");
+					}
+					// Layer coordinates read from baked warp maps vs worked out per pixel
+					auto warpStats = mainApp->pipeline->getWarpMapStats();
+					uint64_t warpLookups = warpStats.hits + warpStats.misses;
+					ImGui::TextDisabled("Warp maps: %llu hits, %llu misses (%.0f%%) | %llu bakes",
+						(unsigned long long)warpStats.hits, (unsigned long long)warpStats.misses,
+						warpLookups ? 100.0 * warpStats.hits / warpLookups : 0.0,
+						(unsigned long long)warpStats.bakes);
+					// Per-block resolution scale and update rate
+					auto& b1Fbo = mainApp->pipeline->getBlock1Fbo();
+					auto& b2Fbo = mainApp->pipeline->getBlock2Fbo();
+					ImGui::TextDisabled("Block1 %.0fx%.0f every %d frame(s) | Block2 %.0fx%.0f every %d frame(s)",
+						b1Fbo.getWidth(), b1Fbo.getHeight(), graph.getUpdateInterval(dragonwaves::RenderGraph::BLOCK1),
+						b2Fbo.getWidth(), b2Fbo.getHeight(), graph.getUpdateInterval(dragonwaves::RenderGraph::BLOCK2));
+					// Dynamic resolution governor and its most recent change
+					auto& governor = mainApp->pipeline->getResolutionGovernor();
+					if (governor.isEnabled()) {
+						ImGui::TextDisabled("Resolution governor: scale %.3f%s | frame %.1f ms | %d changes logged",
+							governor.getScale(), governor.isLocked() ? " (locked)" : "",
+							governor.getFrameMs(), (int)governor.getLog().size());
+						if (!governor.getLog().empty()) {
+							const auto& change = governor.getLog().back();
+							ImGui::TextDisabled("Last change: %.3f -> %.3f at %.0f s (%.1f ms, budget %.1f ms)",
+								change.fromScale, change.toScale, change.time, change.frameMs, change.budgetMs);
+						}
+					}
+				}
+				// Frame bus readbacks: frames skipped because the GPU hadn't finished
+				if (mainApp && mainApp->outputManager) {
+					auto busStats = mainApp->outputManager->getFrameBus().getStats();
+					ImGui::TextDisabled("Readback: %d stream(s), ring of %d%s | %llu frames, %llu not ready (skipped), %llu dropped",
+						busStats.streams, mainApp->outputManager->getFrameBus().getRingDepth(),
+						busStats.persistent ? " (persistent)" : "",
+						(unsigned long long)busStats.transfer.transfers,
+						(unsigned long long)busStats.transfer.stalls,
+						(unsigned long long)busStats.transfer.dropped);
+					// NDI sender threads: frames waiting, replaced before sending, queue to submit time
+					for (int b = dragonwaves::RenderGraph::BLOCK1; b <= dragonwaves::RenderGraph::BLOCK3; b++) {
+						auto* ndi = mainApp->outputManager->getNdiSender((dragonwaves::RenderGraph::Node)b);
+						if (!ndi || !ndi->isEnabled()) continue;
+						auto ndiStats = ndi->getStats();
+						ImGui::TextDisabled("NDI %s: queue %d/%d | %llu sent, %llu dropped | %.2f ms (max %.2f)",
+							ndi->getName().c_str(), ndiStats.queued, dragonwaves::NdiOutputSender::QUEUE_DEPTH,
+							(unsigned long long)ndiStats.sent, (unsigned long long)ndiStats.dropped,
+							ndiStats.latencyMs, ndiStats.maxLatencyMs);
+					}
+				}
+				// GPU time per pipeline stage over the last WINDOW measured frames
+				auto& profiler = dragonwaves::GpuProfiler::getInstance();
+				if (profiler.isEnabled()) {
+					ImGui::Spacing();
+					ImGui::Text("GPU STAGES");
+					ImGui::Checkbox("Show on output window", &gpuStatsOverlay);
+					for (int s = 0; s < dragonwaves::GpuProfiler::STAGE_COUNT; s++) {
+						auto stage = (dragonwaves::GpuProfiler::Stage)s;
+						const auto& stats = profiler.getStats(stage);
+						if (stats.samples == 0) continue;
+						ImGui::TextDisabled("%-9s %.2f ms | min %.2f | avg %.2f | p99 %.2f (%d frames)",
+							dragonwaves::GpuProfiler::getStageName(stage),
+							stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms, stats.samples);
+					}
+				}
 				ImGui::Spacing();
 				ImGui::Separator();
 				ImGui::Spacing();
@@ -6660,18 +6789,17 @@ void GuiApp::draw(){
 				ImGui::Text("NDI OUTPUT");
 				ImGui::Spacing();
 
-				// COMMENTED OUT - Only using Block 3 for Spout/NDI output
-				// #if OFAPP_HAS_SPOUT
-				// ImGui::Checkbox("Send Block 1 (GwBlock1)", &spoutSendBlock1);
-				// ImGui::SameLine(columnWidth + 20);
-				// #endif
-				// ImGui::Checkbox("Send Block 1 (GwBlock1)##ndi", &ndiSendBlock1);
+#if OFAPP_HAS_SPOUT
+				ImGui::Checkbox("Send Block 1 (GwBlock1)", &spoutSendBlock1);
+				ImGui::SameLine(columnWidth + 20);
+#endif
+				ImGui::Checkbox("Send Block 1 (GwBlock1)##ndi", &ndiSendBlock1);
 
-				// #if OFAPP_HAS_SPOUT
-				// ImGui::Checkbox("Send Block 2 (GwBlock2)", &spoutSendBlock2);
-				// ImGui::SameLine(columnWidth + 20);
-				// #endif
-				// ImGui::Checkbox("Send Block 2 (GwBlock2)##ndi", &ndiSendBlock2);
+#if OFAPP_HAS_SPOUT
+				ImGui::Checkbox("Send Block 2 (GwBlock2)", &spoutSendBlock2);
+				ImGui::SameLine(columnWidth + 20);
+#endif
+				ImGui::Checkbox("Send Block 2 (GwBlock2)##ndi", &ndiSendBlock2);
 
 #if OFAPP_HAS_SPOUT
 				ImGui::Checkbox("Send Block 3 - Final (GwBlock3)", &spoutSendBlock3);
@@ -6685,6 +6813,7 @@ void GuiApp::draw(){
 #else
 				ImGui::TextDisabled("Enable to share framebuffers via NDI");
 #endif
+				ImGui::TextDisabled("Smaller sends share one downscale chain per block");
 
 				ImGui::Spacing();
 				ImGui::Separator();
@@ -7153,6 +7282,7 @@ void GuiApp::draw(){
 
 //--------------------------------------------------------------
 void GuiApp::saveEverything(){
+	dragonwaves::TraceScope trace("GuiApp::saveEverything");
 
 	//save MACROS
 	//save macroData
@@ -8556,16 +8686,21 @@ void GuiApp::saveEverything(){
 
 //--------------------------------------------------------------
 void GuiApp::loadEverything(){
-	ofJson loadBuffer;
+	dragonwaves::TraceScope trace("GuiApp::loadEverything");
 	//heres where we put some logic for multiple save states
-	ofFile f1;
 	// Load from current load bank using new path structure
 	if (loadPresetCount > 0 && loadStateSelectSwitch < loadPresetCount) {
-		f1.open(loadBankPath + "/" + loadPresetFileNames[loadStateSelectSwitch]);
+		loadPresetFile(loadBankPath + "/" + loadPresetFileNames[loadStateSelectSwitch]);
 	} else {
 		// Fallback to legacy path if no presets in bank
-		f1.open("saveStates/"+saveStateNames[loadStateSelectSwitch]+".json");
+		loadPresetFile("saveStates/"+saveStateNames[loadStateSelectSwitch]+".json");
 	}
+}
+
+//--------------------------------------------------------------
+void GuiApp::loadPresetFile(const string& path){
+	ofJson loadBuffer;
+	ofFile f1(path);
 	f1>>loadBuffer;
 	//fb1FramebufferClearSwitch=1;
 	//didn't feel like fucking around with extra procedures
@@ -58501,16 +58636,14 @@ void GuiApp::saveVideoOscSettings() {
 #endif
 
 #if OFAPP_HAS_SPOUT
-    // COMMENTED OUT - Only using Block 3 for Spout output
-    // settings["video"]["spoutOutput"]["sendBlock1"] = spoutSendBlock1;
-    // settings["video"]["spoutOutput"]["sendBlock2"] = spoutSendBlock2;
+    settings["video"]["spoutOutput"]["sendBlock1"] = spoutSendBlock1;
+    settings["video"]["spoutOutput"]["sendBlock2"] = spoutSendBlock2;
     settings["video"]["spoutOutput"]["sendBlock3"] = spoutSendBlock3;
 #endif
 
     // NDI outputs
-    // COMMENTED OUT - Only using Block 3 for NDI output
-    // settings["video"]["ndiOutput"]["sendBlock1"] = ndiSendBlock1;
-    // settings["video"]["ndiOutput"]["sendBlock2"] = ndiSendBlock2;
+    settings["video"]["ndiOutput"]["sendBlock1"] = ndiSendBlock1;
+    settings["video"]["ndiOutput"]["sendBlock2"] = ndiSendBlock2;
     settings["video"]["ndiOutput"]["sendBlock3"] = ndiSendBlock3;
 
     // Resolutions
@@ -58635,13 +58768,12 @@ void GuiApp::loadVideoOscSettings() {
 
 #if OFAPP_HAS_SPOUT
         if (settings["video"].contains("spoutOutput")) {
-            // COMMENTED OUT - Only using Block 3 for Spout output
-            // if (settings["video"]["spoutOutput"].contains("sendBlock1")) {
-            //     spoutSendBlock1 = settings["video"]["spoutOutput"]["sendBlock1"];
-            // }
-            // if (settings["video"]["spoutOutput"].contains("sendBlock2")) {
-            //     spoutSendBlock2 = settings["video"]["spoutOutput"]["sendBlock2"];
-            // }
+            if (settings["video"]["spoutOutput"].contains("sendBlock1")) {
+                spoutSendBlock1 = settings["video"]["spoutOutput"]["sendBlock1"];
+            }
+            if (settings["video"]["spoutOutput"].contains("sendBlock2")) {
+                spoutSendBlock2 = settings["video"]["spoutOutput"]["sendBlock2"];
+            }
             if (settings["video"]["spoutOutput"].contains("sendBlock3")) {
                 spoutSendBlock3 = settings["video"]["spoutOutput"]["sendBlock3"];
             }
@@ -58650,13 +58782,12 @@ void GuiApp::loadVideoOscSettings() {
 
         // NDI outputs
         if (settings["video"].contains("ndiOutput")) {
-            // COMMENTED OUT - Only using Block 3 for NDI output
-            // if (settings["video"]["ndiOutput"].contains("sendBlock1")) {
-            //     ndiSendBlock1 = settings["video"]["ndiOutput"]["sendBlock1"];
-            // }
-            // if (settings["video"]["ndiOutput"].contains("sendBlock2")) {
-            //     ndiSendBlock2 = settings["video"]["ndiOutput"]["sendBlock2"];
-            // }
+            if (settings["video"]["ndiOutput"].contains("sendBlock1")) {
+                ndiSendBlock1 = settings["video"]["ndiOutput"]["sendBlock1"];
+            }
+            if (settings["video"]["ndiOutput"].contains("sendBlock2")) {
+                ndiSendBlock2 = settings["video"]["ndiOutput"]["sendBlock2"];
+            }
             if (settings["video"]["ndiOutput"].contains("sendBlock3")) {
                 ndiSendBlock3 = settings["video"]["ndiOutput"]["sendBlock3"];
             }
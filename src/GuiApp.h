@@ -106,6 +106,8 @@ public:
 	shared_ptr<ofAppBaseWindow> guiWindow;
 	void sendOscIfChanged(const string& address, float value);
 	void setup();
+	// Parameter state only, no window or ImGui (offline rendering)
+	void setupHeadless();
 	void update();
 	void draw();
 	void exit();
@@ -189,6 +191,7 @@ public:
 	void loadBLOCK_1();
 
 	void loadEverything();
+	void loadPresetFile(const string& path);
 
 	void arrayToJsonList(ofJson jsonFile, string blockName, string listName, float inArray[]);
 	void arrayToJsonList(string listName, float inArray[]);//assume: theres a global existing json file we refer to.
@@ -281,9 +284,8 @@ public:
 	void toggleVideoRecording();
 
 	// NDI Output Settings
-	// COMMENTED OUT - Only using Block 3 for NDI output
-	// bool ndiSendBlock1 = false;  // Enable NDI output for Block 1
-	// bool ndiSendBlock2 = false;  // Enable NDI output for Block 2
+	bool ndiSendBlock1 = false;  // Enable NDI output for Block 1
+	bool ndiSendBlock2 = false;  // Enable NDI output for Block 2
 	bool ndiSendBlock3 = false;  // Enable NDI output for Block 3 (final)
 
 	// NDI send resolution
@@ -293,6 +295,7 @@ public:
 	// Performance Settings
 	int targetFPS = 30;  // Target frame rate (1-60)
 	bool fpsChangeRequested = false;  // Flag to apply FPS change in main app
+	bool gpuStatsOverlay = false;  // GPU stage timings over the output window
 
 	// Resolution Settings
 	// Input resolutions (for webcam/NDI/Spout capture scaling)
@@ -1433,6 +1436,7 @@ public:
 
 	/*Arrays & midi 2 gui*/
 	void allArrayClear();
+	void initializeLfoSync();
 	void midi2Gui(bool midiActive[], float params[], bool midiSwitch);
 
 	//reset
@@ -1,4 +1,5 @@
 #include "InputManager.h"
+#include "../ShaderPipeline/GpuProfiler.h"
 
 namespace dragonwaves {
 
@@ -23,12 +24,15 @@ void InputSlot::update() {
         source->update();
         if (source->isFrameNew()) {
             // Draw to FBO at internal resolution
+            auto& profiler = GpuProfiler::getInstance();
+            profiler.begin(GpuProfiler::INPUT);
             fbo.begin();
             ofViewport(0, 0, fbo.getWidth(), fbo.getHeight());
             ofSetupScreenOrtho(fbo.getWidth(), fbo.getHeight());
             ofClear(0, 0, 0, 255);
             source->getTexture().draw(0, 0, fbo.getWidth(), fbo.getHeight());
             fbo.end();
+            profiler.end(GpuProfiler::INPUT);
         }
     }
 }
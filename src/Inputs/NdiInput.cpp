@@ -1,4 +1,6 @@
 #include "NdiInput.h"
+#include "../Core/FrameTracer.h"
+#include "../Core/FrameClock.h"
 
 namespace dragonwaves {
 
@@ -35,6 +37,7 @@ bool NdiInput::setup(int width, int height) {
 }
 
 void NdiInput::update() {
+    TraceScope trace("NdiInput::update");
     if (!initialized) return;
     
     // Receive directly into texture
@@ -45,7 +48,7 @@ void NdiInput::update() {
     receiverConnected = receiver.ReceiverConnected();
     
     // Calculate received FPS (only count actual new frames)
-    float now = ofGetElapsedTimef();
+    float now = FrameClock::getInstance().getElapsedTime();
     float delta = now - lastFrameTime;
     lastFrameTime = now;
     
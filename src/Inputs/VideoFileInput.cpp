@@ -22,6 +22,10 @@ bool VideoFileInput::setup(int width, int height) {
 void VideoFileInput::update() {
     if (!initialized) return;
     
+    if (frameStepping) {
+        if (!player.isPaused()) player.setPaused(true);
+        player.nextFrame();
+    }
     player.update();
 }
 
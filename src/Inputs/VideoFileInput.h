@@ -36,6 +36,10 @@ public:
     float getDuration() const;
     bool isPlaying() const;
     
+    // Advance exactly one video frame per update() instead of playing in
+    // real time (offline rendering)
+    void setFrameStepping(bool stepping) { frameStepping = stepping; }
+    
     std::string getFilePath() const { return filePath; }
     
 private:
@@ -43,6 +47,7 @@ private:
     std::string filePath;
     bool looping = true;
     float speed = 1.0f;
+    bool frameStepping = false;
 };
 
 } // namespace dragonwaves
@@ -0,0 +1,556 @@
+#include "FrameBus.h"
+#include "../ShaderPipeline/PipelineManager.h"
+#include "../ShaderPipeline/GpuProfiler.h"
+#include "../Core/FrameTracer.h"
+#include "../ShaderLoader.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+
+namespace dragonwaves {
+
+//==============================================================================
+// AsyncPixelTransfer
+//==============================================================================
+bool AsyncPixelTransfer::isPersistentMappingSupported() {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    if (!ofGetGLRenderer()) return false;
+    int major = ofGetGLRenderer()->getGLVersionMajor();
+    int minor = ofGetGLRenderer()->getGLVersionMinor();
+    return major > 4 || (major == 4 && minor >= 4) || ofGLCheckExtension("GL_ARB_buffer_storage");
+#endif
+}
+
+bool AsyncPixelTransfer::allocateSlots(bool persistentMapping) {
+    size_t bufferSize = width * height * (format == OF_PIXELS_UYVY ? 2 : 4);
+
+    for (int i = 0; i < depth; i++) {
+        Slot& slot = slots[i];
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+#ifndef TARGET_OPENGLES
+        if (persistentMapping) {
+            GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, flags);
+            slot.mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bufferSize, flags);
+            if (!slot.mapped) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                for (int j = 0; j <= i; j++) {
+                    glDeleteBuffers(1, &slots[j].pbo);
+                    slots[j] = Slot();
+                }
+                return false;
+            }
+            continue;
+        }
+#endif
+        glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void AsyncPixelTransfer::setup(int w, int h, int d, ofPixelFormat f) {
+    width = w;
+    height = h;
+    format = f;
+    depth = ofClamp(d, MIN_DEPTH, MAX_DEPTH);
+
+    persistent = isPersistentMappingSupported() && allocateSlots(true);
+    if (!persistent) {
+        allocateSlots(false);
+    }
+
+    writeIndex = 0;
+    pendingCount = 0;
+    initialized = true;
+
+    ofLogNotice("AsyncPixelTransfer") << "Setup " << w << "x" << h << (format == OF_PIXELS_UYVY ? " UYVY" : "")
+                                      << ", " << depth << " buffers"
+                                      << (persistent ? " (persistently mapped)" : "");
+}
+
+void AsyncPixelTransfer::cleanup() {
+    if (!initialized) return;
+
+    // Check if we have a valid OpenGL context before deleting buffers
+    // This prevents crashes during application shutdown
+    if (glfwGetCurrentContext() == nullptr) {
+        ofLogWarning("AsyncPixelTransfer") << "No OpenGL context - skipping PBO cleanup";
+    } else {
+        reset();
+        for (int i = 0; i < depth; i++) {
+            // Deleting a buffer unmaps it
+            if (slots[i].pbo != 0) glDeleteBuffers(1, &slots[i].pbo);
+        }
+    }
+
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        slots[i] = Slot();
+    }
+    width = 0;
+    height = 0;
+    persistent = false;
+    initialized = false;
+}
+
+void AsyncPixelTransfer::releaseSlot(Slot& slot) {
+    if (slot.fence) {
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+}
+
+void AsyncPixelTransfer::reset() {
+    for (int i = 0; i < depth; i++) {
+        releaseSlot(slots[i]);
+    }
+    pendingCount = 0;
+}
+
+void AsyncPixelTransfer::resize(int w, int h) {
+    int d = depth;
+    ofPixelFormat f = format;
+    cleanup();
+    setup(w, h, d, f);
+}
+
+void AsyncPixelTransfer::setDepth(int d) {
+    d = ofClamp(d, MIN_DEPTH, MAX_DEPTH);
+    if (d == depth) return;
+    if (!initialized) {
+        depth = d;
+        return;
+    }
+    int w = width;
+    int h = height;
+    ofPixelFormat f = format;
+    cleanup();
+    setup(w, h, d, f);
+}
+
+void AsyncPixelTransfer::beginTransfer(ofFbo& sourceFbo, uint64_t tag) {
+    if (!initialized) return;
+
+    // Ring full: the oldest readback was never collected, reuse its buffer
+    if (pendingCount == depth) {
+        releaseSlot(slots[oldestPending()]);
+        pendingCount--;
+        stats.dropped++;
+    }
+
+    Slot& slot = slots[writeIndex];
+
+    // Bind PBO and read pixels (UYVY packs two pixels per RGBA texel)
+    int readWidth = format == OF_PIXELS_UYVY ? width / 2 : width;
+    sourceFbo.bind();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, readWidth, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    sourceFbo.unbind();
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.tag = tag;
+    writeIndex = (writeIndex + 1) % depth;
+    pendingCount++;
+}
+
+bool AsyncPixelTransfer::endTransfer(ofPixels& dest, uint64_t* tag) {
+    if (!initialized) return false;
+
+    if (ordered) {
+        if (pendingCount == 0) return false;
+        int index = oldestPending();
+        GLenum result = glClientWaitSync(slots[index].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            // Still in flight: wait only if the next readback would overwrite it
+            if (pendingCount < depth) return false;
+            stats.stalls++;
+            result = glClientWaitSync(slots[index].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);  // 1 s
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) return false;
+        }
+        releaseSlot(slots[index]);
+        pendingCount--;
+        if (!copySlot(slots[index], dest)) return false;
+        if (tag) *tag = slots[index].tag;
+        return true;
+    }
+
+    // Collect every finished readback, oldest first, keeping the newest.
+    // Polling with a zero timeout never blocks.
+    int newest = -1;
+    while (pendingCount > 0) {
+        int index = oldestPending();
+        GLenum result = glClientWaitSync(slots[index].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+        releaseSlot(slots[index]);
+        pendingCount--;
+        if (newest >= 0) stats.dropped++;
+        newest = index;
+    }
+
+    if (newest < 0) {
+        // Nothing finished: a blocking map would have stalled here
+        if (pendingCount > 0) stats.stalls++;
+        return false;
+    }
+
+    if (!copySlot(slots[newest], dest)) return false;
+    if (tag) *tag = slots[newest].tag;
+    return true;
+}
+
+bool AsyncPixelTransfer::copySlot(Slot& slot, ofPixels& dest) {
+    bool copied = false;
+    if (persistent) {
+        dest.setFromPixels(slot.mapped, width, height, format);
+        copied = true;
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        GLubyte* ptr = (GLubyte*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (ptr) {
+            dest.setFromPixels(ptr, width, height, format);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            copied = true;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (copied) stats.transfers++;
+    return copied;
+}
+
+//==============================================================================
+// FrameBus
+//==============================================================================
+FrameBus::FrameBus() {
+}
+
+FrameBus::~FrameBus() {
+    release();
+}
+
+FrameBus::Stream* FrameBus::findStream(RenderGraph::Node source, int width, int height, ofPixelFormat format) const {
+    for (auto& stream : streams) {
+        if (stream->source == source && stream->width == width && stream->height == height &&
+            stream->format == format) {
+            return stream.get();
+        }
+    }
+    return nullptr;
+}
+
+void FrameBus::request(RenderGraph::Node source, int width, int height, ofPixelFormat format, bool ordered, int held) {
+    Stream* stream = findStream(source, width, height, format);
+    if (!stream) {
+        streams.push_back(std::make_unique<Stream>());
+        stream = streams.back().get();
+        stream->source = source;
+        stream->width = width;
+        stream->height = height;
+        stream->format = format;
+        ofLogVerbose("FrameBus") << "New stream: block " << (source + 1) << " at "
+                                 << (width > 0 ? ofToString(width) + "x" + ofToString(height) : "source size")
+                                 << (format == OF_PIXELS_UYVY ? " UYVY" : "");
+    }
+    // In order if any consumer asks for it this frame
+    uint64_t now = ofGetFrameNum();
+    bool again = stream->lastRequest == now;
+    stream->ordered = (again && stream->ordered) || ordered;
+    stream->held = (again ? stream->held : 0) + std::max(held, 1);
+    stream->lastRequest = now;
+}
+
+BusFramePtr FrameBus::latest(RenderGraph::Node source, int width, int height, ofPixelFormat format) const {
+    Stream* stream = findStream(source, width, height, format);
+    return stream ? stream->latest : nullptr;
+}
+
+const std::vector<BusFramePtr>& FrameBus::published(RenderGraph::Node source, int width, int height,
+                                                    ofPixelFormat format) const {
+    static const std::vector<BusFramePtr> none;
+    Stream* stream = findStream(source, width, height, format);
+    return stream ? stream->published : none;
+}
+
+ofFbo* FrameBus::pyramidLevel(RenderGraph::Node source, ofTexture& full, int width, int height) {
+    // Deepest level still at least width x height
+    int level = -1;
+    int w = full.getWidth();
+    int h = full.getHeight();
+    while (level + 1 < MAX_LEVELS && (w + 1) / 2 >= width && (h + 1) / 2 >= height) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        level++;
+    }
+    if (level < 0) return nullptr;
+    
+    // Each level from the one above it, at most once per frame
+    Pyramid& pyramid = pyramids[source];
+    uint64_t now = ofGetFrameNum();
+    pyramid.lastUse = now;
+    ofTexture* above = &full;
+    w = full.getWidth();
+    h = full.getHeight();
+    for (int i = 0; i <= level; i++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ofFbo& fbo = pyramid.levels[i];
+        if (fbo.getWidth() != w || fbo.getHeight() != h) {
+            fbo.allocate(w, h, GL_RGBA);
+            pyramid.builtFrame[i] = 0;
+        }
+        if (pyramid.builtFrame[i] != now) {
+            fbo.begin();
+            ofViewport(0, 0, w, h);
+            ofSetupScreenOrtho(w, h);
+            ofClear(0, 0, 0, 255);
+            above->draw(0, 0, w, h);
+            fbo.end();
+            pyramid.builtFrame[i] = now;
+        }
+        above = &fbo.getTexture();
+    }
+    return &pyramid.levels[level];
+}
+
+ofTexture& FrameBus::downscaled(RenderGraph::Node source, ofTexture& full, int width, int height) {
+    ofFbo* level = pyramidLevel(source, full, width, height);
+    return level ? level->getTexture() : full;
+}
+
+bool FrameBus::isUyvySupported() {
+    if (!uyvyShaderTried) {
+        uyvyShaderTried = true;
+#ifdef TARGET_OPENGLES
+        std::string dir = "rgba2yuv/ES2/";
+#else
+        std::string dir = ofIsGLProgrammableRenderer() ? "rgba2yuv/GL3/" : "rgba2yuv/GL2/";
+#endif
+        ShaderLoader::loadFromPaths(uyvyShader, dir + "rgba2yuv.vert", dir + "rgba2yuv.frag");
+    }
+    return uyvyShader.isLoaded();
+}
+
+std::shared_ptr<BusFrame> FrameBus::takeFrame(Stream& stream) {
+    // Recycle a published frame every consumer has let go of
+    for (auto& frame : stream.pool) {
+        if (frame.use_count() == 1) {
+            return frame;
+        }
+    }
+    if ((int)stream.pool.size() >= stream.poolLimit) {
+        // Consumers are behind: skip publishing rather than allocate
+        return nullptr;
+    }
+    stream.pool.push_back(std::make_shared<BusFrame>());
+    return stream.pool.back();
+}
+
+void FrameBus::update(PipelineManager& pipeline) {
+    TraceScope trace("FrameBus::update");
+    uint64_t now = ofGetFrameNum();
+    auto& profiler = GpuProfiler::getInstance();
+
+    // Downscale chains nobody has used for a while
+    for (auto& pyramid : pyramids) {
+        if (pyramid.lastUse != 0 && now - pyramid.lastUse > RELEASE_FRAMES) {
+            releasePyramid(pyramid);
+        }
+    }
+
+    for (auto it = streams.begin(); it != streams.end();) {
+        Stream& stream = **it;
+        stream.alias = nullptr;
+        stream.published.clear();
+
+        if (stream.lastRequest != now) {
+            // Not wanted this frame: what's in flight would be stale by the
+            // next request, and after a while the buffers go too
+            stream.transfer.reset();
+            stream.latest.reset();
+            if (now - stream.lastRequest > RELEASE_FRAMES) {
+                ofLogVerbose("FrameBus") << "Releasing idle stream: block " << (stream.source + 1);
+                retireStream(stream);
+                it = streams.erase(it);
+                continue;
+            }
+            ++it;
+            continue;
+        }
+
+        ofFbo& output = stream.source == RenderGraph::BLOCK1 ? pipeline.getBlock1Fbo()
+                      : stream.source == RenderGraph::BLOCK2 ? pipeline.getBlock2Fbo()
+                      : pipeline.getBlock3Fbo();
+        int outputWidth = output.getWidth();
+        int outputHeight = output.getHeight();
+        int width = stream.width > 0 ? stream.width : outputWidth;
+        int height = stream.height > 0 ? stream.height : outputHeight;
+        bool uyvy = stream.format == OF_PIXELS_UYVY;
+        if (uyvy) width &= ~1;
+        if (width <= 0 || height <= 0 || (uyvy && !isUyvySupported())) {
+            ++it;
+            continue;
+        }
+
+        // Another request for the same pixels already read them back
+        for (auto& other : streams) {
+            if (other.get() == &stream) break;
+            if (other->lastRequest == now && !other->alias && other->source == stream.source &&
+                other->transfer.getWidth() == width && other->transfer.getHeight() == height &&
+                other->transfer.getFormat() == stream.format && other->ordered == stream.ordered) {
+                stream.alias = other.get();
+                break;
+            }
+        }
+        if (stream.alias) {
+            // Its consumers hold the alias's frames
+            Stream& shared = *stream.alias;
+            shared.held += stream.held;
+            shared.poolLimit = std::max(shared.poolLimit, poolLimit(shared));
+            retireStream(stream);
+            stream.latest = stream.alias->latest;
+            stream.published = stream.alias->published;
+            ++it;
+            continue;
+        }
+
+        if (stream.transfer.getWidth() != width || stream.transfer.getHeight() != height) {
+            stream.transfer.cleanup();
+            stream.transfer.setup(width, height, ringDepth, stream.format);
+        }
+        stream.transfer.setOrdered(stream.ordered);
+        stream.poolLimit = std::max(stream.poolLimit, poolLimit(stream));
+
+        // In order: hand out every finished readback before this frame's
+        // goes in, so a full ring waits instead of overwriting one
+        if (stream.ordered) {
+            publish(stream);
+        }
+
+        // Scale on the GPU from the nearest level of the block's downscale
+        // chain if the stream isn't at the block's own size, and pack UYVY
+        // in the same pass
+        profiler.begin(GpuProfiler::READBACK);
+        ofFbo* level = pyramidLevel(stream.source, output.getTexture(), width, height);
+        ofFbo* readFbo = level ? level : &output;
+        ofTexture& scaleSource = readFbo->getTexture();
+        if (uyvy) {
+            int packedWidth = width / 2;
+            if (stream.scaleFbo.getWidth() != packedWidth || stream.scaleFbo.getHeight() != height) {
+                stream.scaleFbo.allocate(packedWidth, height, GL_RGBA);
+            }
+            stream.scaleFbo.begin();
+            ofPushStyle();
+            ofDisableAlphaBlending();   // alpha carries Y1
+            ofViewport(0, 0, packedWidth, height);
+            ofSetupScreenOrtho(packedWidth, height);
+            uyvyShader.begin();
+            uyvyShader.setUniformTexture("rgbatex", scaleSource, 1);
+            uyvyShader.setUniform2f("outputSize", width, height);
+            ofDrawRectangle(0, 0, packedWidth, height);
+            uyvyShader.end();
+            ofPopStyle();
+            stream.scaleFbo.end();
+            readFbo = &stream.scaleFbo;
+        } else if (width != readFbo->getWidth() || height != readFbo->getHeight()) {
+            if (stream.scaleFbo.getWidth() != width || stream.scaleFbo.getHeight() != height) {
+                stream.scaleFbo.allocate(width, height, GL_RGBA);
+            }
+            stream.scaleFbo.begin();
+            ofViewport(0, 0, width, height);
+            ofSetupScreenOrtho(width, height);
+            ofClear(0, 0, 0, 255);
+            scaleSource.draw(0, 0, width, height);
+            stream.scaleFbo.end();
+            readFbo = &stream.scaleFbo;
+        } else if (stream.scaleFbo.isAllocated()) {
+            stream.scaleFbo.clear();
+        }
+        stream.transfer.beginTransfer(*readFbo, now);
+        profiler.end(GpuProfiler::READBACK);
+
+        // Otherwise publish the newest finished readback, if any has finished
+        if (!stream.ordered) {
+            publish(stream);
+        }
+
+        ++it;
+    }
+}
+
+void FrameBus::publish(Stream& stream) {
+    // Every finished readback in order, or just the newest. A readback
+    // left when the pool runs out is collected later (or superseded).
+    while (true) {
+        std::shared_ptr<BusFrame> frame = takeFrame(stream);
+        if (!frame) break;
+        uint64_t renderedFrame = 0;
+        if (!stream.transfer.endTransfer(frame->pixels, &renderedFrame)) break;
+        frame->frameNum = renderedFrame;
+        stream.latest = frame;
+        stream.published.push_back(frame);
+        if (!stream.ordered) break;
+    }
+}
+
+int FrameBus::poolLimit(const Stream& stream) const {
+    // What the consumers hold, plus the bus's own references (latest and
+    // this update's published frames) and the frame being filled
+    return stream.held + (stream.ordered ? ringDepth : 1) + 1;
+}
+
+void FrameBus::retireStream(Stream& stream) {
+    // Free the buffers, keeping the counters in the totals
+    stream.transfer.cleanup();
+    const auto& stats = stream.transfer.getStats();
+    retired.transfers += stats.transfers;
+    retired.stalls += stats.stalls;
+    retired.dropped += stats.dropped;
+    stream.transfer = AsyncPixelTransfer();
+}
+
+void FrameBus::releasePyramid(Pyramid& pyramid) {
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        pyramid.levels[i].clear();
+        pyramid.builtFrame[i] = 0;
+    }
+    pyramid.lastUse = 0;
+}
+
+void FrameBus::release() {
+    for (auto& stream : streams) {
+        retireStream(*stream);
+    }
+    streams.clear();
+    for (auto& pyramid : pyramids) {
+        releasePyramid(pyramid);
+    }
+}
+
+void FrameBus::setRingDepth(int depth) {
+    depth = ofClamp(depth, AsyncPixelTransfer::MIN_DEPTH, AsyncPixelTransfer::MAX_DEPTH);
+    if (depth == ringDepth) return;
+    ringDepth = depth;
+    for (auto& stream : streams) {
+        stream->transfer.setDepth(ringDepth);
+    }
+    ofLogNotice("FrameBus") << "Readback ring depth " << ringDepth;
+}
+
+FrameBus::Stats FrameBus::getStats() const {
+    Stats result;
+    result.transfer = retired;
+    for (auto& stream : streams) {
+        const auto& stats = stream->transfer.getStats();
+        result.transfer.transfers += stats.transfers;
+        result.transfer.stalls += stats.stalls;
+        result.transfer.dropped += stats.dropped;
+        if (stream->transfer.getWidth() > 0) {
+            result.streams++;
+            result.persistent = result.persistent || stream->transfer.isPersistent();
+        }
+    }
+    return result;
+}
+
+} // namespace dragonwaves
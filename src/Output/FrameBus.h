@@ -0,0 +1,243 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../ShaderPipeline/RenderGraph.h"
+#include <memory>
+
+namespace dragonwaves {
+
+class PipelineManager;
+
+//==============================================================================
+// Async PBO readback of an FBO through a ring of fenced buffers
+//
+// Every readback is fenced. endTransfer() polls the fences without waiting
+// and returns the newest finished readback; if none has finished yet the
+// frame is skipped (a stall: a plain glMapBuffer would have blocked there)
+// rather than stalling the render loop. A readback still unread when the
+// ring wraps around is dropped.
+//
+// In ordered mode (setOrdered) endTransfer() instead returns the oldest
+// finished readback and is called until it returns false, so every readback
+// comes out once, in order. Nothing is dropped: with the ring full it waits
+// for the oldest (counted as a stall).
+//
+// Where GL_ARB_buffer_storage is available (GL 4.4) the buffers are mapped
+// once, persistently, so a finished readback is a plain memcpy.
+//
+// OF_PIXELS_UYVY reads a width/2 x height RGBA8 FBO that already holds
+// packed UYVY (see FrameBus) as a width x height UYVY image.
+//==============================================================================
+class AsyncPixelTransfer {
+public:
+    static constexpr int MIN_DEPTH = 2;
+    static constexpr int MAX_DEPTH = 8;
+
+    struct Stats {
+        uint64_t transfers = 0;     // readbacks copied out
+        uint64_t stalls = 0;        // polls where nothing had finished yet
+        uint64_t dropped = 0;       // readbacks overwritten or superseded unread
+    };
+
+    static bool isPersistentMappingSupported();
+
+    void setup(int width, int height, int depth = 3, ofPixelFormat format = OF_PIXELS_RGBA);
+    void cleanup();
+
+    // Begin transfer - call after rendering to source FBO. `tag` comes back
+    // from the endTransfer() that returns this readback.
+    void beginTransfer(ofFbo& sourceFbo, uint64_t tag = 0);
+
+    // Copy the newest finished transfer into `dest` (the oldest in ordered
+    // mode); false if none has finished (or after reset()). Only waits for
+    // the GPU in ordered mode with the ring full.
+    bool endTransfer(ofPixels& dest, uint64_t* tag = nullptr);
+
+    void setOrdered(bool ordered) { this->ordered = ordered; }
+    bool isOrdered() const { return ordered; }
+
+    // Forget pending transfers
+    void reset();
+
+    // Reallocate at a new size, keeping the depth
+    void resize(int width, int height);
+    void setDepth(int depth);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getDepth() const { return depth; }
+    ofPixelFormat getFormat() const { return format; }
+    bool isPersistent() const { return persistent; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;             // set while the readback is pending
+        const unsigned char* mapped = nullptr;  // persistent mapping
+        uint64_t tag = 0;
+    };
+
+    Slot slots[MAX_DEPTH];
+    int depth = 3;
+    int writeIndex = 0;         // slot the next readback goes to
+    int pendingCount = 0;       // pending slots, oldest first, ending before writeIndex
+    int width = 0;
+    int height = 0;
+    ofPixelFormat format = OF_PIXELS_RGBA;
+    bool persistent = false;
+    bool ordered = false;
+    bool initialized = false;
+    Stats stats;
+
+    bool copySlot(Slot& slot, ofPixels& dest);
+    int oldestPending() const { return (writeIndex - pendingCount + depth) % depth; }
+    bool allocateSlots(bool persistentMapping);
+    void releaseSlot(Slot& slot);
+};
+
+//==============================================================================
+// CPU copy of a block output, shared read-only by every consumer that asked
+// for it. Never written once published, so it can be kept on any thread.
+//==============================================================================
+struct BusFrame {
+    ofPixels pixels;            // RGBA8, or UYVY if requested as such
+    uint64_t frameNum = 0;      // ofGetFrameNum() of the render it came from
+};
+typedef std::shared_ptr<const BusFrame> BusFramePtr;
+
+//==============================================================================
+// Frame bus: one GPU readback per block output (and size) per frame
+//
+// Consumers that need block outputs on the CPU (NDI senders, video recorder,
+// preview, color picker) request() them each frame; after the pipeline has
+// rendered, update() reads each requested stream back once and every
+// consumer of it gets the same reference-counted frame from latest().
+//
+// Requests that come out at the same size (e.g. 0 and the block's actual
+// size) share one readback.
+//
+// A stream can also be read back as UYVY 4:2:2 (what NDI sends natively),
+// converted on the GPU by the rgba2yuv shader: half the bytes to read back
+// and copy. The width is rounded down to even.
+//
+// Scaled streams (and Spout, through downscaled()) start from a per-block
+// chain of half-size levels built once per frame, so each consumer only
+// draws from the nearest level at or above its size - or reads that level
+// directly when the sizes match.
+//
+// Readback is asynchronous, so latest() trails the render by a frame. A
+// stream keeps its buffers for a while after its last request, so consumers
+// that come and go don't reallocate them every time.
+//
+// latest() skips frames whose readback was superseded before it was
+// collected. A consumer that needs every frame (the recorder, which encodes
+// at a fixed rate) requests the stream in order and takes published(): all
+// frames the update completed, oldest first.
+//==============================================================================
+class FrameBus {
+public:
+    FrameBus();
+    ~FrameBus();
+
+    // Read `source` back this frame at width x height (0 = its own size,
+    // anything else is scaled on the GPU first), as OF_PIXELS_RGBA or
+    // OF_PIXELS_UYVY. `ordered` keeps every readback of the stream this
+    // frame (for published()), at the cost of waiting when the ring is full.
+    // `held` is how many of its frames the consumer may keep at once (the
+    // stream's pool is sized for all its consumers).
+    void request(RenderGraph::Node source, int width = 0, int height = 0,
+                 ofPixelFormat format = OF_PIXELS_RGBA, bool ordered = false, int held = 1);
+
+    // Newest completed frame of that stream; null until the first one
+    BusFramePtr latest(RenderGraph::Node source, int width = 0, int height = 0,
+                       ofPixelFormat format = OF_PIXELS_RGBA) const;
+
+    // Frames the last update() completed for that stream, oldest first (at
+    // most one unless it was requested in order)
+    const std::vector<BusFramePtr>& published(RenderGraph::Node source, int width = 0, int height = 0,
+                                              ofPixelFormat format = OF_PIXELS_RGBA) const;
+
+    // `full` (the output of `source`) or the smallest level of its
+    // downscale chain still at least width x height. Builds the levels
+    // needed on first use each frame.
+    ofTexture& downscaled(RenderGraph::Node source, ofTexture& full, int width, int height);
+    
+    // Loads the UYVY conversion shader if needed; false if it won't load
+    // (UYVY streams then never publish a frame)
+    bool isUyvySupported();
+
+    // After PipelineManager::processFrame(): issue this frame's readbacks
+    // and publish the completed ones
+    void update(PipelineManager& pipeline);
+
+    // Free all streams (needs the GL context)
+    void release();
+
+    // Readbacks in flight per stream (see AsyncPixelTransfer)
+    void setRingDepth(int depth);
+    int getRingDepth() const { return ringDepth; }
+
+    // Totals over all streams since startup
+    struct Stats {
+        int streams = 0;            // currently allocated
+        bool persistent = false;    // buffers persistently mapped
+        AsyncPixelTransfer::Stats transfer;
+    };
+    Stats getStats() const;
+
+    int getStreamCount() const { return (int)streams.size(); }
+
+    // Frames idle before a stream's buffers are freed
+    static constexpr int RELEASE_FRAMES = 120;
+
+    // Half-size levels per block at most (1/256 of the output)
+    static constexpr int MAX_LEVELS = 8;
+    
+
+private:
+    struct Stream {
+        RenderGraph::Node source = RenderGraph::BLOCK3;
+        int width = 0;                  // as requested (0 = source size)
+        int height = 0;
+        ofPixelFormat format = OF_PIXELS_RGBA;
+        bool ordered = false;           // requested in order this frame
+        int held = 0;                   // frames its consumers may keep, this frame
+        Stream* alias = nullptr;        // same source, size and format as an earlier stream this frame
+        ofFbo scaleFbo;                 // scaled, or packed UYVY at half width
+        AsyncPixelTransfer transfer;
+        uint64_t lastRequest = 0;
+        BusFramePtr latest;
+        std::vector<BusFramePtr> published;
+        // Published frames, recycled once nobody holds them. Grows up to
+        // poolLimit (the most its consumers have needed); when every frame
+        // is held, publishing waits for one to come back.
+        std::vector<std::shared_ptr<BusFrame>> pool;
+        int poolLimit = 0;
+    };
+
+    struct Pyramid {
+        ofFbo levels[MAX_LEVELS];       // level i is 1/2^(i+1) of the source
+        uint64_t builtFrame[MAX_LEVELS] = {};
+        uint64_t lastUse = 0;
+    };
+    
+    // Level of source's chain for width x height (built), or null for full size
+    ofFbo* pyramidLevel(RenderGraph::Node source, ofTexture& full, int width, int height);
+    
+    Stream* findStream(RenderGraph::Node source, int width, int height, ofPixelFormat format) const;
+    std::shared_ptr<BusFrame> takeFrame(Stream& stream);   // null if all are held
+    void publish(Stream& stream);          // collect finished readbacks
+    int poolLimit(const Stream& stream) const;
+    void retireStream(Stream& stream);     // frees its buffers
+    void releasePyramid(Pyramid& pyramid);
+
+    std::vector<std::unique_ptr<Stream>> streams;
+    Pyramid pyramids[RenderGraph::NODE_COUNT];
+    int ringDepth = 3;
+    AsyncPixelTransfer::Stats retired;  // counters of released streams
+    ofShader uyvyShader;
+    bool uyvyShaderTried = false;
+};
+
+} // namespace dragonwaves
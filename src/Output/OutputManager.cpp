@@ -1,98 +1,11 @@
 #include "OutputManager.h"
-#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+#include "../Core/FrameTracer.h"
 
 namespace dragonwaves {
 
 // Static member definition for shutdown tracking
 bool NdiOutputSender::isShuttingDown = false;
 
-//==============================================================================
-// AsyncPixelTransfer
-//==============================================================================
-void AsyncPixelTransfer::setup(int w, int h) {
-    width = w;
-    height = h;
-    
-    pixels.allocate(width, height, OF_PIXELS_RGBA);
-    
-    size_t bufferSize = width * height * 4;  // RGBA
-    
-    glGenBuffers(2, pbo);
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[0]);
-    glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, NULL, GL_STREAM_READ);
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[1]);
-    glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, NULL, GL_STREAM_READ);
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    
-    pboIndex = 0;
-    pboNextIndex = 1;
-    frameCount = 0;
-    initialized = true;
-    
-    ofLogNotice("AsyncPixelTransfer") << "Setup " << w << "x" << h;
-}
-
-void AsyncPixelTransfer::cleanup() {
-    if (!initialized) return;
-    
-    // Check if we have a valid OpenGL context before deleting buffers
-    // This prevents crashes during application shutdown
-    if (glfwGetCurrentContext() == nullptr) {
-        ofLogWarning("AsyncPixelTransfer") << "No OpenGL context - skipping PBO cleanup";
-        pbo[0] = 0;
-        pbo[1] = 0;
-        initialized = false;
-        return;
-    }
-    
-    // Only delete if we have valid buffer IDs
-    if (pbo[0] != 0 || pbo[1] != 0) {
-        glDeleteBuffers(2, pbo);
-    }
-    pbo[0] = 0;
-    pbo[1] = 0;
-    initialized = false;
-}
-
-void AsyncPixelTransfer::resize(int w, int h) {
-    cleanup();
-    setup(w, h);
-}
-
-void AsyncPixelTransfer::beginTransfer(ofFbo& sourceFbo) {
-    if (!initialized) return;
-    
-    // Bind PBO and read pixels
-    sourceFbo.bind();
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[pboIndex]);
-    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    sourceFbo.unbind();
-}
-
-ofPixels& AsyncPixelTransfer::endTransfer() {
-    if (!initialized) {
-        return pixels;
-    }
-    
-    // Read previous frame data
-    if (frameCount > 0) {
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[pboNextIndex]);
-        GLubyte* ptr = (GLubyte*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
-        if (ptr) {
-            pixels.setFromPixels(ptr, width, height, OF_PIXELS_RGBA);
-            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
-        }
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    }
-    
-    // Swap indices
-    std::swap(pboIndex, pboNextIndex);
-    frameCount++;
-    
-    return pixels;
-}
-
 //==============================================================================
 // OutputSender
 //==============================================================================
@@ -145,83 +58,154 @@ NdiOutputSender::~NdiOutputSender() {
     // 2. The OS reclaims all resources when the process exits
     // 3. A "resource leak" on process exit is harmless
     
+    // The thread has to go before the members it uses
+    stopSending();
     active = false;
     enabled = false;
-    
-    // Only clean up PBO if we have a valid context and aren't shutting down
-    if (!isShuttingDown) {
-        try {
-            pboTransfer.cleanup();
-        } catch (...) {
-            // Ignore PBO cleanup errors
-        }
-    }
 }
 
 void NdiOutputSender::setup(int w, int h) {
-    width = w;
-    height = h;
+    int newWidth = format == OF_PIXELS_UYVY ? (w & ~1) : w;
+    if (newWidth == width && h == height) return;
     
-    // Allocate scale FBO if needed
-    scaleFbo.allocate(width, height, GL_RGBA);
-    scaleFbo.begin();
-    ofClear(0, 0, 0, 255);
-    scaleFbo.end();
+    // A running sender is recreated at the new size
+    bool wasEnabled = enabled;
+    setEnabled(false);
+    width = newWidth;
+    height = h;
+    setEnabled(wasEnabled);
     
-    // Setup PBO transfer
-    pboTransfer.setup(width, height);
+    // Scaling and readback happen in the frame bus, which is asked for
+    // this size (see OutputManager::requestFrames)
+    ofLogNotice("NdiOutputSender") << name << " setup " << width << "x" << height
+                                   << (format == OF_PIXELS_UYVY ? " UYVY" : "");
+}
+
+void NdiOutputSender::setFormat(ofPixelFormat f) {
+    if (f == format) return;
     
-    ofLogNotice("NdiOutputSender") << name << " setup " << w << "x" << h;
+    // The sender's format is fixed when it's created
+    bool wasEnabled = enabled;
+    setEnabled(false);
+    format = f;
+    setEnabled(wasEnabled);
 }
 
-void NdiOutputSender::send(ofTexture& texture) {
+void NdiOutputSender::send(const BusFramePtr& frame) {
+    TraceScope trace("NdiOutputSender::send");
     if (!enabled || width == 0 || height == 0) return;
-    
-    std::lock_guard<std::mutex> lock(mtx);
-    
-    // Create sender if needed (only once)
-    if (!active) {
-        if (!sender.CreateSender(name.c_str(), width, height)) {
-            ofLogError("NdiOutputSender") << "Failed to create sender: " << name;
-            return;
+    if (!frame || frame->frameNum == lastFrameNum) return;
+    
+    const ofPixels& pixels = frame->pixels;
+    if (!pixels.isAllocated() || pixels.getWidth() != width || pixels.getHeight() != height ||
+        pixels.getPixelFormat() != format) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (queueCount == QUEUE_DEPTH) {
+            // The thread is behind: skip the oldest rather than add latency
+            queue[queueHead] = QueuedFrame();
+            queueHead = (queueHead + 1) % QUEUE_DEPTH;
+            queueCount--;
+            stats.dropped++;
         }
-        active = true;
-        ofLogNotice("NdiOutputSender") << "Created sender: " << name;
+        QueuedFrame& slot = queue[(queueHead + queueCount) % QUEUE_DEPTH];
+        slot.frame = frame;
+        slot.queuedMicros = ofGetElapsedTimeMicros();
+        queueCount++;
+    }
+    queueCondition.notify_one();
+    lastFrameNum = frame->frameNum;
+}
+
+void NdiOutputSender::threadedFunction() {
+    FrameTracer::getInstance().setThreadName("ndi " + name);
+    while (isThreadRunning()) {
+        QueuedFrame next;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            queueCondition.wait(lock, [this] { return queueCount > 0 || stopping; });
+            if (stopping) break;
+            next = std::move(queue[queueHead]);
+            queue[queueHead] = QueuedFrame();
+            queueHead = (queueHead + 1) % QUEUE_DEPTH;
+            queueCount--;
+        }
+        
+        TraceScope trace("NdiOutputSender::submit");
+        
+        // Create sender if needed (only once). After a failure frames are
+        // dropped until the retry delay has passed, and only the first
+        // failure is reported.
+        if (!active) {
+            uint64_t now = ofGetElapsedTimeMicros();
+            if (createFailures > 0 && now - lastCreateMicros < CREATE_RETRY_SECONDS * 1000000) {
+                continue;
+            }
+            lastCreateMicros = now;
+            sender.SetFormat(format == OF_PIXELS_UYVY ? NDIlib_FourCC_video_type_UYVY : NDIlib_FourCC_video_type_RGBA);
+            sender.SetAsync(true);
+            if (!sender.CreateSender(name.c_str(), width, height)) {
+                if (createFailures++ == 0) {
+                    ofLogError("NdiOutputSender") << "Failed to create sender: " << name
+                                                  << ", retrying every " << CREATE_RETRY_SECONDS << " s";
+                }
+                continue;
+            }
+            active = true;
+            ofLogNotice("NdiOutputSender") << "Created sender: " << name
+                                           << (createFailures > 0 ? " after " + ofToString(createFailures) + " failed attempts" : "");
+            createFailures = 0;
+        }
+        
+        // Straight from the shared frame. NDI reads it until the next
+        // submit, so it's held until then.
+        sender.SendImage(next.frame->pixels.getData(), width, height, false, false);
+        inFlight = std::move(next.frame);
+        
+        float ms = (ofGetElapsedTimeMicros() - next.queuedMicros) / 1000.0f;
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.latencyMs = stats.sent == 0 ? ms : stats.latencyMs * 0.9f + ms * 0.1f;
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, ms);
+        stats.sent++;
+    }
+}
+
+void NdiOutputSender::stopSending() {
+    if (isThreadRunning()) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        waitForThread(true);
     }
     
-    // Copy texture to scaleFbo at output resolution
-    scaleFbo.begin();
-    ofViewport(0, 0, width, height);
-    ofSetupScreenOrtho(width, height);
-    ofClear(0, 0, 0, 255);
-    texture.draw(0, 0, width, height);
-    scaleFbo.end();
-    
-    // Use async PBO transfer for non-blocking readback
-    // This reads pixels from the PREVIOUS frame while rendering current frame
-    pboTransfer.beginTransfer(scaleFbo);
-    ofPixels& pixels = pboTransfer.endTransfer();
-    
-    if (pixels.isAllocated()) {
-        sender.SendImage(pixels, false, false);
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& slot : queue) {
+        slot = QueuedFrame();
     }
+    queueHead = 0;
+    queueCount = 0;
+    stopping = false;
+}
+
+NdiOutputSender::Stats NdiOutputSender::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    Stats result = stats;
+    result.queued = queueCount;
+    return result;
 }
 
 void NdiOutputSender::close() {
+    // Stop the sender thread first - no more submits after this
+    stopSending();
+    
     // Mark as inactive first - this stops any new send() calls
     bool wasActive = active;
     active = false;
     enabled = false;
     
-    // Clean up PBO first (safer operation)
-    if (!isShuttingDown) {
-        try {
-            pboTransfer.cleanup();
-        } catch (...) {
-            ofLogWarning("NdiOutputSender") << "Exception during PBO cleanup in close()";
-        }
-    }
-    
     // Try to release the NDI sender during normal close()
     // This is called from ofApp::exit(), not from destructor
     if (wasActive && !isShuttingDown) {
@@ -238,15 +222,30 @@ void NdiOutputSender::close() {
         ofLogNotice("NdiOutputSender") << "Skipping ReleaseSender (wasActive=" 
                                        << wasActive << ", isShuttingDown=" << isShuttingDown << ")";
     }
+    inFlight.reset();
 }
 
 void NdiOutputSender::setEnabled(bool e) {
-    std::lock_guard<std::mutex> lock(mtx);
+    if (e == enabled) return;
     enabled = e;
-    if (!enabled && active) {
+    if (enabled) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stats = Stats();
+        }
+        lastFrameNum = 0;
+        createFailures = 0;     // the thread isn't running: safe to reset
+        startThread();
+        return;
+    }
+    
+    stopSending();
+    if (active) {
         sender.ReleaseSender();
         active = false;
     }
+    // Released with the sender
+    inFlight.reset();
 }
 
 //==============================================================================
@@ -322,12 +321,14 @@ OutputManager::~OutputManager() {
 
 void OutputManager::setup(const DisplaySettings& settings) {
     displaySettings = settings;
+    frameBus.setRingDepth(settings.readbackRingDepth);
     
     // Create NDI senders
     ndiBlock1 = std::make_unique<NdiOutputSender>("GwBlock1");
     ndiBlock2 = std::make_unique<NdiOutputSender>("GwBlock2");
     ndiBlock3 = std::make_unique<NdiOutputSender>("GwBlock3");
     
+    applyNdiFormat(settings);
     ndiBlock1->setup(settings.ndiSendWidth, settings.ndiSendHeight);
     ndiBlock2->setup(settings.ndiSendWidth, settings.ndiSendHeight);
     ndiBlock3->setup(settings.ndiSendWidth, settings.ndiSendHeight);
@@ -352,11 +353,13 @@ void OutputManager::sendBlock1(ofTexture& texture) {
     if (!initialized) return;
     
     if (ndiBlock1 && ndiBlock1->isEnabled()) {
-        ndiBlock1->send(texture);
+        ndiBlock1->send(frameBus.latest(RenderGraph::BLOCK1, ndiBlock1->getWidth(), ndiBlock1->getHeight(),
+                                        ndiBlock1->getFormat()));
     }
 #if SPOUT_AVAILABLE
     if (spoutBlock1 && spoutBlock1->isEnabled()) {
-        spoutBlock1->send(texture);
+        spoutBlock1->send(frameBus.downscaled(RenderGraph::BLOCK1, texture,
+                                               spoutBlock1->getWidth(), spoutBlock1->getHeight()));
     }
 #endif
 }
@@ -365,11 +368,13 @@ void OutputManager::sendBlock2(ofTexture& texture) {
     if (!initialized) return;
     
     if (ndiBlock2 && ndiBlock2->isEnabled()) {
-        ndiBlock2->send(texture);
+        ndiBlock2->send(frameBus.latest(RenderGraph::BLOCK2, ndiBlock2->getWidth(), ndiBlock2->getHeight(),
+                                        ndiBlock2->getFormat()));
     }
 #if SPOUT_AVAILABLE
     if (spoutBlock2 && spoutBlock2->isEnabled()) {
-        spoutBlock2->send(texture);
+        spoutBlock2->send(frameBus.downscaled(RenderGraph::BLOCK2, texture,
+                                               spoutBlock2->getWidth(), spoutBlock2->getHeight()));
     }
 #endif
 }
@@ -378,15 +383,46 @@ void OutputManager::sendBlock3(ofTexture& texture) {
     if (!initialized) return;
     
     if (ndiBlock3 && ndiBlock3->isEnabled()) {
-        ndiBlock3->send(texture);
+        ndiBlock3->send(frameBus.latest(RenderGraph::BLOCK3, ndiBlock3->getWidth(), ndiBlock3->getHeight(),
+                                        ndiBlock3->getFormat()));
     }
 #if SPOUT_AVAILABLE
     if (spoutBlock3 && spoutBlock3->isEnabled()) {
-        spoutBlock3->send(texture);
+        spoutBlock3->send(frameBus.downscaled(RenderGraph::BLOCK3, texture,
+                                               spoutBlock3->getWidth(), spoutBlock3->getHeight()));
     }
 #endif
 }
 
+void OutputManager::requestFrames() {
+    if (!initialized) return;
+    
+    if (ndiBlock1 && ndiBlock1->isEnabled()) {
+        frameBus.request(RenderGraph::BLOCK1, ndiBlock1->getWidth(), ndiBlock1->getHeight(), ndiBlock1->getFormat(),
+                         false, NdiOutputSender::HELD_FRAMES);
+    }
+    if (ndiBlock2 && ndiBlock2->isEnabled()) {
+        frameBus.request(RenderGraph::BLOCK2, ndiBlock2->getWidth(), ndiBlock2->getHeight(), ndiBlock2->getFormat(),
+                         false, NdiOutputSender::HELD_FRAMES);
+    }
+    if (ndiBlock3 && ndiBlock3->isEnabled()) {
+        frameBus.request(RenderGraph::BLOCK3, ndiBlock3->getWidth(), ndiBlock3->getHeight(), ndiBlock3->getFormat(),
+                         false, NdiOutputSender::HELD_FRAMES);
+    }
+}
+
+void OutputManager::applyNdiFormat(const DisplaySettings& settings) {
+    bool uyvy = settings.ndiSendUyvy;
+    if (uyvy && !frameBus.isUyvySupported()) {
+        ofLogWarning("OutputManager") << "rgba2yuv shader unavailable, sending NDI as RGBA";
+        uyvy = false;
+    }
+    ofPixelFormat format = uyvy ? OF_PIXELS_UYVY : OF_PIXELS_RGBA;
+    if (ndiBlock1) ndiBlock1->setFormat(format);
+    if (ndiBlock2) ndiBlock2->setFormat(format);
+    if (ndiBlock3) ndiBlock3->setFormat(format);
+}
+
 void OutputManager::setNdiBlock1Enabled(bool enabled) {
     if (ndiBlock1) ndiBlock1->setEnabled(enabled);
 }
@@ -453,9 +489,19 @@ bool OutputManager::isSpoutBlock3Enabled() const {
 #endif
 }
 
+const NdiOutputSender* OutputManager::getNdiSender(RenderGraph::Node block) const {
+    switch (block) {
+        case RenderGraph::BLOCK1: return ndiBlock1.get();
+        case RenderGraph::BLOCK2: return ndiBlock2.get();
+        default: return ndiBlock3.get();
+    }
+}
+
 void OutputManager::reinitialize(const DisplaySettings& settings) {
     displaySettings = settings;
+    frameBus.setRingDepth(settings.readbackRingDepth);
     
+    applyNdiFormat(settings);
     if (ndiBlock1) ndiBlock1->setup(settings.ndiSendWidth, settings.ndiSendHeight);
     if (ndiBlock2) ndiBlock2->setup(settings.ndiSendWidth, settings.ndiSendHeight);
     if (ndiBlock3) ndiBlock3->setup(settings.ndiSendWidth, settings.ndiSendHeight);
@@ -538,6 +584,9 @@ void OutputManager::close() {
     // DO NOT reset the unique_ptrs here - let ofApp::exit() do that
     // after we're sure the NDI threads have settled
     
+    // Readback buffers (frames already handed out stay valid)
+    frameBus.release();
+    
     initialized = false;
     ofLogNotice("OutputManager") << "All output senders marked for cleanup (NDI resources will be cleaned up by OS)";
 }
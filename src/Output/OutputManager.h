@@ -3,6 +3,7 @@
 #include "ofMain.h"
 #include "ofxNDIsender.h"
 #include <mutex>
+#include <condition_variable>
 
 #if defined(TARGET_WIN32)
     #include "ofxSpout.h"
@@ -12,36 +13,10 @@
 #endif
 
 #include "../Core/SettingsManager.h"
+#include "FrameBus.h"
 
 namespace dragonwaves {
 
-//==============================================================================
-// Async PBO transfer for efficient NDI sending
-//==============================================================================
-class AsyncPixelTransfer {
-public:
-    void setup(int width, int height);
-    void cleanup();
-    
-    // Begin transfer - call after rendering to source FBO
-    void beginTransfer(ofFbo& sourceFbo);
-    
-    // End transfer and get pixels - call before sending
-    ofPixels& endTransfer();
-    
-    void resize(int width, int height);
-    
-private:
-    GLuint pbo[2] = {0, 0};
-    int pboIndex = 0;
-    int pboNextIndex = 1;
-    int frameCount = 0;
-    ofPixels pixels;
-    int width = 0;
-    int height = 0;
-    bool initialized = false;
-};
-
 //==============================================================================
 // Output sender base class
 //==============================================================================
@@ -51,7 +26,6 @@ public:
     virtual ~OutputSender() = default;
     
     virtual void setup(int width, int height) = 0;
-    virtual void send(ofTexture& texture) = 0;
     virtual void close() = 0;
     virtual bool isEnabled() const = 0;
     virtual void setEnabled(bool enabled) = 0;
@@ -64,27 +38,84 @@ protected:
 
 //==============================================================================
 // NDI Sender
+//
+// send() only queues the frame bus frame; a thread per sender submits it to
+// NDI. Submits are asynchronous: NDI reads the frame's pixels until the
+// next submit, so the thread holds the frame until then - no copy anywhere
+// between the readback and NDI.
 //==============================================================================
-class NdiOutputSender : public OutputSender {
+class NdiOutputSender : public OutputSender, public ofThread {
 public:
+    // Frames waiting for the sender thread; when full, the oldest is dropped
+    static constexpr int QUEUE_DEPTH = 2;
+    // Frame bus frames held at once: queued, being submitted and in flight
+    static constexpr int HELD_FRAMES = QUEUE_DEPTH + 2;
+    // Wait after a failed CreateSender before trying again
+    static constexpr float CREATE_RETRY_SECONDS = 2.0f;
+    
+    struct Stats {
+        int queued = 0;             // frames waiting now
+        uint64_t sent = 0;
+        uint64_t dropped = 0;       // replaced in the queue before being sent
+        float latencyMs = 0.0f;     // queued to submitted, smoothed
+        float maxLatencyMs = 0.0f;
+    };
+    
     NdiOutputSender(const std::string& name);
     ~NdiOutputSender();
     
     void setup(int width, int height) override;
-    void send(ofTexture& texture) override;
+    // Queue a frame bus readback at the send size and format; a frame
+    // already queued is skipped. Never waits for NDI.
+    void send(const BusFramePtr& frame);
     void close() override;
     bool isEnabled() const override { return enabled; }
     void setEnabled(bool enabled) override;
     
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    
+    // OF_PIXELS_RGBA or OF_PIXELS_UYVY (sent as NDI's native 4:2:2, no
+    // alpha). Set before setup(), which rounds the width to even for UYVY.
+    void setFormat(ofPixelFormat format);
+    ofPixelFormat getFormat() const { return format; }
+    
+    Stats getStats() const;
+    
 private:
+    struct QueuedFrame {
+        BusFramePtr frame;
+        uint64_t queuedMicros = 0;
+    };
+    
+    void threadedFunction() override;
+    // Stop the thread and empty the queue (the sender itself stays)
+    void stopSending();
+    
     ofxNDIsender sender;
-    ofFbo scaleFbo;
-    AsyncPixelTransfer pboTransfer;
+    ofPixelFormat format = OF_PIXELS_RGBA;
+    uint64_t lastFrameNum = 0;
     bool enabled = false;
-    bool active = false;
+    bool active = false;        // sender created (by the thread while it runs)
     int width = 0;
     int height = 0;
+    
+    // Queue ring and stats, shared with the thread
+    QueuedFrame queue[QUEUE_DEPTH];
+    int queueHead = 0;
+    int queueCount = 0;
+    bool stopping = false;
+    Stats stats;
     mutable std::mutex mtx;
+    std::condition_variable queueCondition;
+    
+    // Last frame submitted: NDI may still be reading it (sender thread only)
+    BusFramePtr inFlight;
+    
+    // Failed CreateSender attempts since enabled, and when the last one was
+    // (sender thread only)
+    int createFailures = 0;
+    uint64_t lastCreateMicros = 0;
     
 public:
     // Static flag to track if we're in the process of shutting down
@@ -101,11 +132,14 @@ public:
     ~SpoutOutputSender();
     
     void setup(int width, int height) override;
-    void send(ofTexture& texture) override;
+    void send(ofTexture& texture);
     void close() override;
     bool isEnabled() const override { return enabled; }
     void setEnabled(bool enabled) override;
     
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    
 private:
 #if SPOUT_AVAILABLE
     ofxSpout::Sender sender;
@@ -127,7 +161,15 @@ public:
     // Setup with display settings
     void setup(const DisplaySettings& settings);
     
-    // Send outputs
+    // GPU readback shared by the NDI senders, recorder and preview
+    FrameBus& getFrameBus() { return frameBus; }
+    
+    // Request the frames the enabled NDI senders need this frame. Call
+    // before FrameBus::update(), and send after it.
+    void requestFrames();
+    
+    // Send outputs (Spout shares the texture, from the frame bus's downscale
+    // chain when smaller; NDI sends the frame bus readback)
     void sendBlock1(ofTexture& texture);
     void sendBlock2(ofTexture& texture);
     void sendBlock3(ofTexture& texture);
@@ -148,6 +190,9 @@ public:
     bool isSpoutBlock2Enabled() const;
     bool isSpoutBlock3Enabled() const;
     
+    // NDI sender of a block (queue and latency stats), null before setup()
+    const NdiOutputSender* getNdiSender(RenderGraph::Node block) const;
+    
     // Reinitialize with new resolution
     void reinitialize(const DisplaySettings& settings);
     
@@ -155,6 +200,9 @@ public:
     void close();
     
 private:
+    // RGBA or UYVY for all NDI senders, per ndiSendUyvy
+    void applyNdiFormat(const DisplaySettings& settings);
+    
     std::unique_ptr<NdiOutputSender> ndiBlock1;
     std::unique_ptr<NdiOutputSender> ndiBlock2;
     std::unique_ptr<NdiOutputSender> ndiBlock3;
@@ -165,6 +213,8 @@ private:
     std::unique_ptr<SpoutOutputSender> spoutBlock3;
 #endif
     
+    FrameBus frameBus;
+    
     DisplaySettings displaySettings;
     bool initialized = false;
 };
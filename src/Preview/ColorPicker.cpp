@@ -6,8 +6,7 @@ namespace dragonwaves {
 ColorPicker::ColorPicker() {}
 
 void ColorPicker::setup() {
-    // Setup PBO for async readback
-    // Note: Actual PBO setup done on first use
+    // Pixels come from the frame bus (see setSourceFrame), no GPU resources here
 }
 
 void ColorPicker::onPreviewClick(int previewX, int previewY, int previewW, int previewH) {
@@ -19,30 +18,21 @@ void ColorPicker::onPreviewClick(int previewX, int previewY, int previewW, int p
     pickPosition.x = previewX / (float)previewW;
     pickPosition.y = previewY / (float)previewH;
     
-    // Schedule read
-    pendingRead = true;
+    // Sample the source frame at the same spot
+    if (sourceFrame) {
+        readColorAtPosition(pickPosition.x * sourceFrame->pixels.getWidth(),
+                            pickPosition.y * sourceFrame->pixels.getHeight());
+    }
 }
 
 void ColorPicker::readColorAtPosition(int x, int y) {
-    if (!sourceTexture || !sourceTexture->isAllocated()) return;
-    
-    // For now, use synchronous read (can optimize with PBO later)
-    // This is called from update() so it doesn't stall render
-    
-    ofFbo tempFbo;
-    tempFbo.allocate(1, 1, GL_RGBA);
-    
-    tempFbo.begin();
-    ofClear(0, 0, 0, 255);
-    ofSetColor(255);
-    sourceTexture->drawSubsection(0, 0, 1, 1, x, y, 1, 1);
-    tempFbo.end();
-    
-    ofPixels pixels;
-    tempFbo.readToPixels(pixels);
+    if (!sourceFrame || !sourceFrame->pixels.isAllocated()) return;
     
-    ofColor c = pixels.getColor(0, 0);
-    pickedColor = c;
+    // CPU copy already read back by the frame bus, so no GPU round trip
+    const ofPixels& pixels = sourceFrame->pixels;
+    x = ofClamp(x, 0, pixels.getWidth() - 1);
+    y = ofClamp(y, 0, pixels.getHeight() - 1);
+    pickedColor = pixels.getColor(x, y);
 }
 
 void ColorPicker::applyToKeyColor(float* keyColorArray) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ofMain.h"
+#include "../Output/FrameBus.h"
 
 namespace dragonwaves {
 
@@ -16,8 +17,8 @@ public:
     // Call when user clicks on preview
     void onPreviewClick(int previewX, int previewY, int previewW, int previewH);
     
-    // Set source texture for color picking
-    void setSourceTexture(ofTexture* tex) { sourceTexture = tex; }
+    // Set source frame for color picking (the preview's frame bus readback)
+    void setSourceFrame(const BusFramePtr& frame) { sourceFrame = frame; }
     
     // Get picked color
     ofColor getPickedColor() const { return pickedColor; }
@@ -47,8 +48,7 @@ public:
     void drawImGuiWidget();
     
 private:
-    ofTexture* sourceTexture = nullptr;
-    ofPixels pixelBuffer;
+    BusFramePtr sourceFrame;
     
     ofColor pickedColor = ofColor::white;
     ofColor hoveredColor = ofColor::white;
@@ -57,8 +57,6 @@ private:
     
     KeyTarget keyTarget = CH2_KEY;
     
-    bool pendingRead = false;
-    
     void readColorAtPosition(int x, int y);
 };
 
@@ -10,8 +10,9 @@ PreviewPanel::~PreviewPanel() {
     // Window will be cleaned up automatically
 }
 
-void PreviewPanel::setup(PipelineManager* pipe) {
+void PreviewPanel::setup(PipelineManager* pipe, FrameBus* bus) {
     pipeline = pipe;
+    frameBus = bus;
     
     renderer.setup(previewWidth, previewHeight);
     colorPicker.setup();
@@ -32,22 +33,31 @@ void PreviewPanel::setup(PipelineManager* pipe) {
 }
 
 void PreviewPanel::update() {
-    if (!enabled || !pipeline) return;
+    if (!pipeline || !frameBus) return;
     
-    // Skip update if preview window is not visible and panel is closed
+    // Declare the block we read, so the pipeline keeps rendering it
+    bool visible = enabled && (showPanel || isWindowVisible());
+    pipeline->setConsumer(RenderGraph::PREVIEW,
+        visible ? RenderGraph::drawModeOutputs(renderer.getPreviewDrawMode()) : 0);
+    
+    // Skip update if disabled, or preview window is not visible and panel is closed
     // This avoids expensive GPU->CPU pixel readback when not needed
-    if (!showPanel && !isWindowVisible()) return;
+    if (!visible) return;
+    
+    // Readback at the block's own size, shared with any other consumer of it.
+    // The renderer (and picker) and the preview window can each hold a frame.
+    RenderGraph::Node source = PreviewRenderer::getSourceNode(renderer.getPreviewDrawMode());
+    frameBus->request(source, 0, 0, OF_PIXELS_RGBA, false, 2);
     
     float now = ofGetElapsedTimef();
     if (now - lastUpdateTime < updateInterval) return;
     
-    // Get current draw mode from renderer
-    int drawMode = renderer.getPreviewDrawMode();
-    renderer.update(*pipeline, drawMode);
+    renderer.update(frameBus->latest(source));
+    colorPicker.setSourceFrame(renderer.getPreviewFrame());
     
-    // Update preview window with pixels (avoids cross-context texture issues)
+    // Update preview window with the frame (avoids cross-context texture issues)
     if (windowMode && isWindowVisible()) {
-        previewWindow.setPreviewPixels(renderer.getPreviewPixels());
+        previewWindow.setPreviewFrame(renderer.getPreviewFrame());
     }
     
     lastUpdateTime = now;
@@ -164,7 +174,7 @@ void PreviewPanel::drawColorPickerSection() {
     
     if (ImGui::Button("Reset", ImVec2(60, 0))) {
         lastPickedColor = ofColor::white;
-        colorPicker.setSourceTexture(nullptr);
+        colorPicker.setSourceFrame(nullptr);
     }
 }
 
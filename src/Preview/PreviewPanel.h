@@ -17,7 +17,8 @@ public:
     PreviewPanel();
     ~PreviewPanel();
     
-    void setup(PipelineManager* pipeline);
+    // Preview pixels come from the output manager's frame bus
+    void setup(PipelineManager* pipeline, FrameBus* frameBus);
     void update();
     void draw();
     
@@ -51,6 +52,7 @@ private:
     ColorPicker colorPicker;
     PreviewWindow previewWindow;
     PipelineManager* pipeline = nullptr;
+    FrameBus* frameBus = nullptr;
     
     bool showPanel = true;
     bool enabled = true;
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "ofMain.h"
-#include "../ShaderPipeline/PipelineManager.h"
+#include "../Output/FrameBus.h"
 
 namespace dragonwaves {
 
@@ -16,9 +16,11 @@ public:
     // Setup with desired preview size
     void setup(int width = 320, int height = 180);
     
-    // Update preview from pipeline output
-    // Copies FBO texture to shareable regular texture
-    void update(PipelineManager& pipeline, int drawMode);
+    // Update preview from a frame bus readback of the block output
+    void update(const BusFramePtr& frame);
+    
+    // Block output a draw mode previews
+    static RenderGraph::Node getSourceNode(int drawMode);
     
     // Draw the preview at specified position (for in-app display)
     void draw(int x, int y, int w = 0, int h = 0);
@@ -31,11 +33,11 @@ public:
     void setPreviewDrawMode(int mode) { previewDrawMode = mode; }
     int getPreviewDrawMode() const { return previewDrawMode; }
     
-    // Get current preview texture (shareable copy)
-    ofTexture& getPreviewTexture() { return previewTexture; }
+    // Get current preview texture (uploaded on first use after an update)
+    ofTexture& getPreviewTexture();
     
-    // Get current preview pixels (for cross-context drawing)
-    const ofPixels& getPreviewPixels() const { return previewPixels; }
+    // Get current preview frame (for cross-context drawing)
+    const BusFramePtr& getPreviewFrame() const { return previewFrame; }
     
     // Get texture dimensions
     int getWidth() const { return previewWidth; }
@@ -55,7 +57,7 @@ private:
     
     // We need a regular texture (not FBO) for cross-context sharing
     ofTexture previewTexture;
-    ofPixels previewPixels;  // For copying data
+    BusFramePtr previewFrame;  // Shared with the other frame bus consumers
     
     ofColor lastPickedColor = ofColor::black;
     bool colorPending = false;
@@ -65,12 +67,6 @@ private:
     bool textureNeedsUpdate = false;
     
     float lastUpdateTimeMs = 0.0f;
-    
-    // Get texture from appropriate block
-    ofTexture& getBlockTexture(PipelineManager& pipeline, int blockNum);
-    
-    // Copy FBO texture to shareable texture
-    void copyTextureData(ofTexture& sourceTexture);
 };
 
 } // namespace dragonwaves
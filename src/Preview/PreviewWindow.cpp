@@ -13,16 +13,12 @@ PreviewWindow::~PreviewWindow() {
     }
 }
 
-void PreviewWindow::setPreviewPixels(const ofPixels& pixels) {
+void PreviewWindow::setPreviewFrame(BusFramePtr frame) {
     ofScopedLock lock(pixelsMutex);
-    // Just copy the pixels, don't create the texture yet
+    // Just keep the frame, don't create the texture yet
     // Texture will be created in the preview window's context during draw()
-    if (!localPixels.isAllocated() || 
-        localPixels.getWidth() != pixels.getWidth() || 
-        localPixels.getHeight() != pixels.getHeight()) {
-        localPixels.allocate(pixels.getWidth(), pixels.getHeight(), pixels.getNumChannels());
-    }
-    localPixels = pixels;
+    if (frame == localFrame) return;
+    localFrame = frame;
     pixelsDirty = true;
 }
 
@@ -158,7 +154,8 @@ void PreviewWindow::draw() {
     
     // Update FBO if needed
     ofScopedLock lock(pixelsMutex);
-    if (pixelsDirty && localPixels.isAllocated()) {
+    if (pixelsDirty && localFrame && localFrame->pixels.isAllocated()) {
+        const ofPixels& localPixels = localFrame->pixels;
         int pixW = localPixels.getWidth();
         int pixH = localPixels.getHeight();
         
@@ -297,7 +294,8 @@ void PreviewWindow::performColorPick() {
     
     // Get pixel buffer dimensions (source resolution)
     ofScopedLock lock(pixelsMutex);
-    if (!localPixels.isAllocated()) return;
+    if (!localFrame || !localFrame->pixels.isAllocated()) return;
+    const ofPixels& localPixels = localFrame->pixels;
     
     int pixW = localPixels.getWidth();
     int pixH = localPixels.getHeight();
@@ -44,8 +44,8 @@ public:
     // Get GLFW window handle
     GLFWwindow* getGLFWWindow() const { return glfwWindow; }
     
-    // Set preview pixels (called from PreviewRenderer)
-    void setPreviewPixels(const ofPixels& pixels);
+    // Set the frame to show (shared, not copied)
+    void setPreviewFrame(BusFramePtr frame);
     
     // Callback for color picked
     std::function<void(ColorPicker::KeyTarget, ofColor)> onColorPicked;
@@ -64,8 +64,8 @@ private:
     bool visible = false;
     bool initialized = false;
     
-    // Local copy of pixels for drawing (avoids cross-context texture issues)
-    ofPixels localPixels;
+    // CPU frame for drawing (avoids cross-context texture issues)
+    BusFramePtr localFrame;
     ofFbo previewFbo;
     bool pixelsDirty = false;
     ofMutex pixelsMutex;
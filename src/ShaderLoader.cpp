@@ -6,6 +6,10 @@
 //
 
 #include "ShaderLoader.h"
+#include <filesystem>
+#include <iomanip>
+#include <regex>
+#include <sstream>
 
 //--------------------------------------------------------------
 std::string ShaderLoader::detectShaderDirectory() {
@@ -67,12 +71,15 @@ bool ShaderLoader::load(ofShader& shader, const std::string& shaderName) {
     std::string shaderDir = getShaderDirectory();
     std::string fullPath = shaderDir + shaderName;
     
-    bool success = shader.load(fullPath);
+    std::string vertSource = ofBufferFromFile(fullPath + ".vert").getText();
+    std::string fragSource = ofBufferFromFile(fullPath + ".frag").getText();
+    
+    bool success = !vertSource.empty() && !fragSource.empty() &&
+                   loadSources(shader, fullPath, vertSource, fragSource);
     
     if (success) {
-        // Bind default OF attributes (position, texcoord, color, normal)
-        shader.bindDefaults();
-        ofLogNotice("ShaderLoader") << "Successfully loaded shader: " << fullPath;
+        ofLogNotice("ShaderLoader") << "Successfully loaded shader: " << fullPath
+                                    << " (" << stats.lastMs << " ms)";
     } else {
         ofLogError("ShaderLoader") << "Failed to load shader: " << fullPath;
     }
@@ -94,3 +101,438 @@ bool ShaderLoader::loadFromPaths(ofShader& shader, const std::string& vertPath,
     
     return success;
 }
+
+//--------------------------------------------------------------
+bool ShaderLoader::loadVariant(ofShader& shader, const std::string& shaderName,
+                               const std::map<std::string, int>& defines) {
+    std::string fullPath = getShaderDirectory() + shaderName;
+    
+    std::string vertSource;
+    std::string fragSource;
+    if (!readVariantSources(shaderName, defines, vertSource, fragSource)) return false;
+    
+    bool success = loadSources(shader, fullPath, vertSource, fragSource);
+    
+    if (success) {
+        ofLogVerbose("ShaderLoader") << "Loaded variant of " << fullPath << " (" << defines.size() << " defines)";
+    } else {
+        ofLogError("ShaderLoader") << "Failed to load variant of: " << fullPath;
+    }
+    
+    return success;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::readVariantSources(const std::string& shaderName, const std::map<std::string, int>& defines,
+                                      std::string& vertSource, std::string& fragSource) {
+    std::string fullPath = getShaderDirectory() + shaderName;
+    
+    vertSource = ofBufferFromFile(fullPath + ".vert").getText();
+    fragSource = ofBufferFromFile(fullPath + ".frag").getText();
+    if (vertSource.empty() || fragSource.empty()) {
+        ofLogError("ShaderLoader") << "Failed to read shader source: " << fullPath;
+        return false;
+    }
+    
+    // Defines go straight after the first line (#version / OF_GLSL_SHADER_HEADER)
+    std::string defineBlock;
+    for (const auto& define : defines) {
+        defineBlock += "#define " + define.first + " " + ofToString(define.second) + "\n";
+    }
+    size_t lineEnd = fragSource.find('\n');
+    fragSource.insert(lineEnd == std::string::npos ? fragSource.size() : lineEnd + 1, defineBlock);
+    return true;
+}
+
+//==============================================================================
+// Program binary cache
+//==============================================================================
+bool ShaderLoader::binaryCacheEnabled = true;
+ShaderLoader::Stats ShaderLoader::stats;
+
+namespace {
+    // File layout: magic, binary format, key length, key, program binary
+    const uint32_t BINARY_CACHE_MAGIC = 0x44574232;  // "DWB2"
+    const std::string BINARY_CACHE_DIR = "shaderCache/";
+    const int BINARY_CACHE_MAX_FILES = 64;           // least recently used beyond this are deleted
+    
+    // FNV-1a: stable across builds and platforms, unlike std::hash
+    uint64_t hashKey(const std::string& key) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+}
+
+//--------------------------------------------------------------
+void ShaderLoader::setBinaryCacheEnabled(bool enabled) {
+    binaryCacheEnabled = enabled;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::isBinaryCacheSupported() {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) return false;
+    
+    // The context's own version (the renderer reports the 3.2 we asked for):
+    // explicit uniform locations are what keep ofShader's cached locations
+    // valid for a restored binary
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return major > 4 || (major == 4 && minor >= 3) || ofGLCheckExtension("GL_ARB_explicit_uniform_location");
+#endif
+}
+
+//--------------------------------------------------------------
+const ShaderLoader::Stats& ShaderLoader::getStats() {
+    return stats;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::canRestoreBinary(const std::string& vertSource, const std::string& fragSource) {
+    return isBinaryCacheSupported() && hasOnlyExplicitLocations(vertSource) && hasOnlyExplicitLocations(fragSource);
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::compileBinary(const std::string& vertSource, const std::string& fragSource,
+                                 const std::string& header, ProgramBinary& binary) {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    auto compileShader = [&](GLenum type, std::string source) -> GLuint {
+        ofStringReplace(source, "OF_GLSL_SHADER_HEADER", header);
+        GLuint id = glCreateShader(type);
+        const char* text = source.c_str();
+        glShaderSource(id, 1, &text, nullptr);
+        glCompileShader(id);
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(id, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            GLint length = 0;
+            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+            std::string info(std::max(length, 1), '\0');
+            glGetShaderInfoLog(id, length, nullptr, &info[0]);
+            ofLogError("ShaderLoader") << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment")
+                                       << " shader failed to compile: " << info;
+            glDeleteShader(id);
+            return 0;
+        }
+        return id;
+    };
+    
+    GLuint vert = compileShader(GL_VERTEX_SHADER, vertSource);
+    GLuint frag = vert ? compileShader(GL_FRAGMENT_SHADER, fragSource) : 0;
+    if (!frag) {
+        if (vert) glDeleteShader(vert);
+        return false;
+    }
+    
+    // Same attribute locations as ofShader::bindDefaults()
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vert);
+    glAttachShader(program, frag);
+    glBindAttribLocation(program, ofShader::POSITION_ATTRIBUTE, "position");
+    glBindAttribLocation(program, ofShader::COLOR_ATTRIBUTE, "color");
+    glBindAttribLocation(program, ofShader::NORMAL_ATTRIBUTE, "normal");
+    glBindAttribLocation(program, ofShader::TEXCOORD_ATTRIBUTE, "texcoord");
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    bool ok = linked && getProgramBinary(program, binary);
+    if (!linked) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string info(std::max(length, 1), '\0');
+        glGetProgramInfoLog(program, length, nullptr, &info[0]);
+        ofLogError("ShaderLoader") << "Program failed to link: " << info;
+    }
+    
+    glDetachShader(program, vert);
+    glDetachShader(program, frag);
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    glDeleteProgram(program);
+    return ok;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::loadFromBinary(ofShader& shader, const std::string& label, const std::string& vertSource,
+                                  const std::string& fragSource, const ProgramBinary& binary) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    bool success = applyBinary(shader, binary, vertSource, fragSource);
+    
+    stats.lastMs = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+    if (success) {
+        stats.programs++;
+        stats.totalMs += stats.lastMs;
+        if (binaryCacheEnabled) {
+            writeBinary(getCacheKey(vertSource, fragSource), binary);
+        }
+    }
+    ofLogVerbose("ShaderLoader") << label << (success ? " restored from compiled binary" : ": compiled binary rejected")
+                                 << " in " << stats.lastMs << " ms";
+    return success;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::loadSources(ofShader& shader, const std::string& label,
+                               const std::string& vertSource, const std::string& fragSource) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    
+    std::string cacheKey;
+    if (binaryCacheEnabled && isBinaryCacheSupported() &&
+        hasOnlyExplicitLocations(vertSource) && hasOnlyExplicitLocations(fragSource)) {
+        cacheKey = getCacheKey(vertSource, fragSource);
+    }
+    
+    bool fromCache = false;
+    ProgramBinary binary;
+    if (!cacheKey.empty() && readBinary(cacheKey, binary)) {
+        fromCache = applyBinary(shader, binary, vertSource, fragSource);
+        if (!fromCache) {
+            // Stale binary (driver update etc.) - recompile and overwrite
+            ofLogNotice("ShaderLoader") << "Discarding stale program binary: " << getCachePath(cacheKey);
+            ofFile::removeFile(getCachePath(cacheKey));
+        }
+    }
+    bool success = fromCache;
+    
+    if (!fromCache) {
+        success = shader.setupShaderFromSource(GL_VERTEX_SHADER, vertSource)
+               && shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragSource);
+        if (success) {
+            // Bind default OF attributes (position, texcoord, color, normal)
+            shader.bindDefaults();
+#ifndef TARGET_OPENGLES
+            if (!cacheKey.empty()) {
+                glProgramParameteri(shader.getProgram(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+#endif
+            success = shader.linkProgram();
+        }
+        if (success && !cacheKey.empty() && getProgramBinary(shader.getProgram(), binary)) {
+            writeBinary(cacheKey, binary);
+        }
+    }
+    
+    stats.lastMs = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+    if (success) {
+        stats.programs++;
+        stats.totalMs += stats.lastMs;
+        if (fromCache) stats.cacheHits++;
+    }
+    ofLogVerbose("ShaderLoader") << label << (fromCache ? " restored from binary cache" : " compiled")
+                                 << " in " << stats.lastMs << " ms";
+    
+    return success;
+}
+
+//--------------------------------------------------------------
+std::string ShaderLoader::getCacheKey(const std::string& vertSource, const std::string& fragSource) {
+    // Binaries are only valid for the exact driver that produced them
+    auto glString = [](GLenum name) {
+        const char* str = reinterpret_cast<const char*>(glGetString(name));
+        return str ? std::string(str) : std::string();
+    };
+    return glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION)
+         + "|" + vertSource + "|" + fragSource;
+}
+
+//--------------------------------------------------------------
+std::string ShaderLoader::getCachePath(const std::string& key) {
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hashKey(key);
+    return BINARY_CACHE_DIR + name.str() + ".bin";
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::hasOnlyExplicitLocations(const std::string& source) {
+    // Any top-level plain uniform without layout(location = N) (or
+    // UNIFORM_LOCATION(N), see shadersGL3) would get a different location in
+    // the stub program than in the cached binary
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line.compare(first, 8, "uniform ") == 0 &&
+            line.find('{') == std::string::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::buildStubFragment(const std::string& fragSource, std::string& stub) {
+    // Same first line (#version / OF_GLSL_SHADER_HEADER) and the same
+    // explicitly located uniforms as the real shader, each kept active, so
+    // ofShader caches the right names and locations
+    static const std::regex uniformDecl(
+        R"((?:layout\s*\(\s*location\s*=|UNIFORM_LOCATION\s*\()\s*(\d+)\s*\)\s*uniform\s+(\w+)\s+(\w+)\s*;)");
+    
+    std::string header = fragSource.substr(0, fragSource.find('\n'));
+    std::string declarations;
+    std::string uses;
+    for (std::sregex_iterator it(fragSource.begin(), fragSource.end(), uniformDecl), end; it != end; ++it) {
+        const std::string location = (*it)[1];
+        const std::string type = (*it)[2];
+        const std::string name = (*it)[3];
+        declarations += "layout(location = " + location + ") uniform " + type + " " + name + ";\n";
+        if (type == "sampler2D") {
+            uses += "    v += texture(" + name + ", vec2(0.0)).r;\n";
+        } else if (type == "sampler2DArray" || type == "sampler3D") {
+            uses += "    v += texture(" + name + ", vec3(0.0)).r;\n";
+        } else if (type == "int" || type == "float") {
+            uses += "    v += float(" + name + ");\n";
+        } else if (type == "vec2" || type == "vec3" || type == "vec4") {
+            uses += "    v += " + name + ".x;\n";
+        } else {
+            return false;
+        }
+    }
+    
+    stub = header + "\n#extension GL_ARB_explicit_uniform_location : enable\n" + declarations
+         + "out vec4 outputColor;\n"
+         + "void main() {\n    float v = 0.0;\n" + uses + "    outputColor = vec4(v);\n}\n";
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::applyBinary(ofShader& shader, const ProgramBinary& binary,
+                               const std::string& vertSource, const std::string& fragSource) {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    // ofShader needs attached shaders to create and track its program, so
+    // link the real vertex shader with a stub fragment shader, then replace
+    // the program's executable with the binary
+    std::string stub;
+    if (!buildStubFragment(fragSource, stub)) return false;
+    
+    bool ok = shader.setupShaderFromSource(GL_VERTEX_SHADER, vertSource)
+           && shader.setupShaderFromSource(GL_FRAGMENT_SHADER, stub);
+    if (ok) {
+        shader.bindDefaults();
+        ok = shader.linkProgram();
+    }
+    if (!ok) {
+        shader.unload();
+        return false;
+    }
+    
+    glProgramBinary(shader.getProgram(), binary.format, binary.data.data(), (GLsizei)binary.data.size());
+    
+    GLint linked = GL_FALSE;
+    glGetProgramiv(shader.getProgram(), GL_LINK_STATUS, &linked);
+    if (!linked) {
+        shader.unload();
+        return false;
+    }
+    
+    return true;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::getProgramBinary(GLuint program, ProgramBinary& binary) {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+    
+    binary.data.resize(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data.data());
+    if (written <= 0) return false;
+    
+    binary.format = format;
+    binary.data.resize(written);
+    return true;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ShaderLoader::readBinary(const std::string& key, ProgramBinary& binary) {
+    std::string path = getCachePath(key);
+    ofFile file(path, ofFile::ReadOnly, true);
+    if (!file.exists()) return false;
+    
+    ofBuffer buffer = file.readToBuffer();
+    file.close();
+    uint32_t header[3];
+    if (buffer.size() <= sizeof(header)) return false;
+    memcpy(header, buffer.getData(), sizeof(header));
+    
+    // The whole key is stored, so a hash collision or an older file layout
+    // is a miss rather than a wrong program
+    const char* stored = buffer.getData() + sizeof(header);
+    if (header[0] != BINARY_CACHE_MAGIC || header[2] != key.size() ||
+        buffer.size() <= sizeof(header) + key.size() ||
+        memcmp(stored, key.data(), key.size()) != 0) {
+        return false;
+    }
+    
+    binary.format = header[1];
+    binary.data.assign(stored + key.size(), buffer.getData() + buffer.size());
+    
+    // Recently used: pruning keeps it
+    std::error_code error;
+    std::filesystem::last_write_time(ofToDataPath(path, true),
+                                     std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+//--------------------------------------------------------------
+void ShaderLoader::writeBinary(const std::string& key, const ProgramBinary& binary) {
+    // Once per run, before the cache grows
+    static bool pruned = false;
+    if (!pruned) {
+        pruneBinaryCache();
+        pruned = true;
+    }
+    
+    uint32_t header[3] = { BINARY_CACHE_MAGIC, (uint32_t)binary.format, (uint32_t)key.size() };
+    ofBuffer buffer;
+    buffer.append(reinterpret_cast<const char*>(header), sizeof(header));
+    buffer.append(key.data(), key.size());
+    buffer.append(binary.data.data(), binary.data.size());
+    
+    ofDirectory::createDirectory(BINARY_CACHE_DIR, true, true);
+    std::string path = getCachePath(key);
+    if (!ofBufferToFile(path, buffer, true)) {
+        ofLogWarning("ShaderLoader") << "Could not write program binary: " << path;
+    }
+}
+
+//--------------------------------------------------------------
+void ShaderLoader::pruneBinaryCache() {
+    // Binaries of old sources and drivers are never asked for again; keep
+    // the most recently used
+    ofDirectory dir(BINARY_CACHE_DIR);
+    if (!dir.exists()) return;
+    dir.allowExt("bin");
+    dir.listDir();
+    if ((int)dir.size() <= BINARY_CACHE_MAX_FILES) return;
+    
+    dir.sortByDate();  // oldest first
+    int excess = (int)dir.size() - BINARY_CACHE_MAX_FILES;
+    for (int i = 0; i < excess; i++) {
+        dir.getFile(i).remove();
+    }
+    ofLogNotice("ShaderLoader") << "Pruned " << excess << " old program binaries";
+}
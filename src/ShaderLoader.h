@@ -39,6 +39,88 @@ public:
      */
     static bool loadFromPaths(ofShader& shader, const std::string& vertPath, const std::string& fragPath);
     
+    /**
+     * Load a specialized variant of a shader with extra preprocessor defines
+     *
+     * Each define is injected as "#define NAME value" after the first line
+     * of the fragment shader, so it can test for it with #ifdef.
+     *
+     * @param shader The shader object to load into
+     * @param shaderName Base name of the shader (without extension or directory)
+     * @param defines Integer defines to inject
+     * @return True if loading was successful, false otherwise
+     */
+    static bool loadVariant(ofShader& shader, const std::string& shaderName,
+                            const std::map<std::string, int>& defines);
+    
+    /**
+     * A linked program's executable (glGetProgramBinary)
+     */
+    struct ProgramBinary {
+        GLenum format = 0;
+        std::vector<char> data;
+    };
+    
+    /**
+     * Read the sources loadVariant() would compile
+     */
+    static bool readVariantSources(const std::string& shaderName, const std::map<std::string, int>& defines,
+                                   std::string& vertSource, std::string& fragSource);
+    
+    /**
+     * Whether a binary of these sources can be restored into an ofShader
+     * (see setBinaryCacheEnabled)
+     */
+    static bool canRestoreBinary(const std::string& vertSource, const std::string& fragSource);
+    
+    /**
+     * Compile and link with plain GL calls into a program binary, leaving
+     * no GL objects behind. Touches no ofShader state, so it can run on a
+     * worker thread with its own context; `header` replaces
+     * OF_GLSL_SHADER_HEADER (ofGLSLGetDefaultHeader(), fetched beforehand).
+     */
+    static bool compileBinary(const std::string& vertSource, const std::string& fragSource,
+                              const std::string& header, ProgramBinary& binary);
+    
+    /**
+     * Load a program compileBinary() built from these sources (and save it
+     * to the binary cache if enabled)
+     */
+    static bool loadFromBinary(ofShader& shader, const std::string& label, const std::string& vertSource,
+                               const std::string& fragSource, const ProgramBinary& binary);
+    
+    /**
+     * Enable or disable the on-disk program binary cache
+     *
+     * Linked programs are saved with glGetProgramBinary under
+     * data/shaderCache/, keyed by the sources (including defines) and the GL
+     * vendor/renderer/version strings, and restored with glProgramBinary on
+     * the next load. The file is named by a hash of the key and holds the
+     * whole key, checked on load; the least recently used files beyond 64
+     * are deleted. Only used for shaders whose plain (non-block) uniforms
+     * all have explicit locations, since ofShader's uniform location cache
+     * is filled before the binary is swapped in.
+     */
+    static void setBinaryCacheEnabled(bool enabled);
+    
+    /**
+     * Whether the context can use the binary cache: it has program binary
+     * formats and honours explicit uniform locations (GL 4.3, or
+     * GL_ARB_explicit_uniform_location for shadersGL3)
+     */
+    static bool isBinaryCacheSupported();
+    
+    /**
+     * Load statistics since startup (for the startup-time metric)
+     */
+    struct Stats {
+        int programs = 0;        // programs loaded
+        int cacheHits = 0;       // of which restored from the binary cache
+        float totalMs = 0.0f;    // total time spent in load/loadVariant
+        float lastMs = 0.0f;     // time of the most recent load
+    };
+    static const Stats& getStats();
+    
     /**
      * Get recommended shader directory based on platform and OpenGL version
      * @return Path to the recommended shader directory
@@ -50,6 +132,23 @@ public:
      * @return Path to shader directory (e.g., "shadersGL4/", "shadersGL32/", "shadersGLES2/")
      */
     static std::string detectShaderDirectory();
+    
+private:
+    static bool loadSources(ofShader& shader, const std::string& label,
+                            const std::string& vertSource, const std::string& fragSource);
+    static bool applyBinary(ofShader& shader, const ProgramBinary& binary,
+                            const std::string& vertSource, const std::string& fragSource);
+    static bool getProgramBinary(GLuint program, ProgramBinary& binary);
+    static bool readBinary(const std::string& key, ProgramBinary& binary);
+    static void writeBinary(const std::string& key, const ProgramBinary& binary);
+    static void pruneBinaryCache();
+    static bool buildStubFragment(const std::string& fragSource, std::string& stub);
+    static bool hasOnlyExplicitLocations(const std::string& source);
+    static std::string getCacheKey(const std::string& vertSource, const std::string& fragSource);
+    static std::string getCachePath(const std::string& key);
+    
+    static bool binaryCacheEnabled;
+    static Stats stats;
 };
 
 #endif /* ShaderLoader_h */
@@ -5,6 +5,7 @@ namespace dragonwaves {
 
 Block1Shader::Block1Shader()
     : ShaderBlock("Block1", "shader1") {
+    colorLuts = { &ch1ColorLut, &ch2ColorLut, &fb1ColorLut };
     initializeModulations();
 }
 
@@ -28,178 +29,217 @@ void Block1Shader::process() {
     
     // Bind textures
     if (ch1Tex && ch1Tex->isAllocated()) {
-        shader.setUniformTexture("ch1Tex", *ch1Tex, 2);
+        setParamTexture("ch1Tex", *ch1Tex, 2);
     } else {
-        shader.setUniformTexture("ch1Tex", dummyTex, 2);
+        setParamTexture("ch1Tex", dummyTex, 2);
     }
     
     if (ch2Tex && ch2Tex->isAllocated()) {
-        shader.setUniformTexture("ch2Tex", *ch2Tex, 3);
+        setParamTexture("ch2Tex", *ch2Tex, 3);
     } else {
-        shader.setUniformTexture("ch2Tex", dummyTex, 3);
+        setParamTexture("ch2Tex", dummyTex, 3);
     }
     
-    if (fbTex && fbTex->isAllocated()) {
-        shader.setUniformTexture("fb1Tex", *fbTex, 0);
-    } else {
-        shader.setUniformTexture("fb1Tex", dummyTex, 0);
-    }
-    
-    if (temporalTex && temporalTex->isAllocated()) {
-        shader.setUniformTexture("fb1TemporalFilter", *temporalTex, 1);
-    } else {
-        shader.setUniformTexture("fb1TemporalFilter", dummyTex, 1);
-    }
+    // Delayed and temporal filter frames come from the feedback history arrays
+    setParamTexture("fb1History", GL_TEXTURE_2D_ARRAY, historyTex, 0);
+    setParamTexture("fb1HistoryOlder", GL_TEXTURE_2D_ARRAY, historyOlderTex, 1);
+    setParam1i("fb1DelayTier", historyDelayed.tier);
+    setParam1i("fb1DelayLayer", historyDelayed.layer);
+    setParam1i("fb1TemporalLayer", historyTemporalLayer);
+    
+    // Blur/sharpen pre-pass results (units 4-6)
+    setPrepassParams("ch1Prepass", "ch1BlurPrepass", ch1PrepassTex, dummyTex, 4);
+    setPrepassParams("ch2Prepass", "ch2BlurPrepass", ch2PrepassTex, dummyTex, 5);
+    setPrepassParams("fb1Prepass", "fb1BlurPrepass", fb1PrepassTex, dummyTex, 6);
+    
+    // Layers culled by PipelineManager
+    setParam1i("ch1LayerOn", ch1Used ? 1 : 0);
+    setParam1i("ch2LayerOn", ch2Used ? 1 : 0);
+    
+    // Channel results of an earlier pass (units 10-11)
+    setParamTexture("ch1Cache", ch1CacheTex ? *ch1CacheTex : dummyTex, 10);
+    setParamTexture("ch2Cache", ch2CacheTex ? *ch2CacheTex : dummyTex, 11);
+    setParam1i("block1Stage", stage);
+    
+    // A stage only evaluates (and updates the LUTs of) its own layers
+    const bool channelStage = stage == SINGLE_PASS || stage == CHANNELS;
+    const bool mixStage = stage == SINGLE_PASS || stage == MIX;
+    
+    // Baked layer coordinates (units 12-14)
+    ofTexture* ch1Warp = channelStage ? warpTex[WARP_CH1] : nullptr;
+    ofTexture* ch2Warp = channelStage ? warpTex[WARP_CH2] : nullptr;
+    ofTexture* fb1Warp = mixStage ? warpTex[WARP_FB1] : nullptr;
+    setParamTexture("ch1WarpMap", ch1Warp ? *ch1Warp : dummyTex, 12);
+    setParamTexture("ch2WarpMap", ch2Warp ? *ch2Warp : dummyTex, 13);
+    setParamTexture("fb1WarpMap", fb1Warp ? *fb1Warp : dummyTex, 14);
+    setParam1i("ch1WarpOn", ch1Warp ? 1 : 0);
+    setParam1i("ch2WarpOn", ch2Warp ? 1 : 0);
+    setParam1i("fb1WarpOn", fb1Warp ? 1 : 0);
+    
+    // Colour chains baked into 3D LUTs once their parameters settle (units 7-9)
+    setColorLutParams("ch1ColorLut", "ch1ColorLutOn", ch1ColorLut,
+        channelStage && ch1ColorLut.updateInputChain(
+            glm::vec3(params.ch1HueAttenuate, params.ch1SaturationAttenuate, params.ch1BrightAttenuate),
+            params.ch1HueInvert == 1, params.ch1SaturationInvert == 1, params.ch1BrightInvert == 1,
+            params.ch1Solarize == 1, params.ch1RGBInvert == 1, params.ch1SharpenAmount), 7);
+    setColorLutParams("ch2ColorLut", "ch2ColorLutOn", ch2ColorLut,
+        channelStage && ch2ColorLut.updateInputChain(
+            glm::vec3(params.ch2HueAttenuate, params.ch2SaturationAttenuate, params.ch2BrightAttenuate),
+            params.ch2HueInvert == 1, params.ch2SaturationInvert == 1, params.ch2BrightInvert == 1,
+            params.ch2Solarize == 1, params.ch2RGBInvert == 1, params.ch2SharpenAmount), 8);
+    setColorLutParams("fb1ColorLut", "fb1ColorLutOn", fb1ColorLut,
+        mixStage && fb1ColorLut.updateFeedbackChain(params.fb1HueShaper,
+            glm::vec3(params.fb1HueOffset, params.fb1SaturationOffset, params.fb1BrightOffset),
+            glm::vec3(params.fb1HueAttenuate, params.fb1SaturationAttenuate, params.fb1BrightAttenuate),
+            glm::vec3(params.fb1HuePowmap, params.fb1SaturationPowmap, params.fb1BrightPowmap),
+            params.fb1HueInvert == 1, params.fb1SaturationInvert == 1, params.fb1BrightInvert == 1,
+            params.fb1SharpenAmount), 9);
     
     // Set resolution uniforms
-    shader.setUniform1f("width", width);
-    shader.setUniform1f("height", height);
-    shader.setUniform1f("inverseWidth", 1.0f / width);
-    shader.setUniform1f("inverseHeight", 1.0f / height);
+    setParam1f("width", width);
+    setParam1f("height", height);
+    setParam1f("inverseWidth", 1.0f / width);
+    setParam1f("inverseHeight", 1.0f / height);
     
     // Legacy resolution uniforms (for compatibility)
-    shader.setUniform1f("inverseWidth1", 1.0f / width);
-    shader.setUniform1f("inverseHeight1", 1.0f / height);
-    shader.setUniform1f("input1Width", width);
-    shader.setUniform1f("input1Height", height);
-    shader.setUniform1f("hdFixX", 0.0f);
-    shader.setUniform1f("hdFixY", 0.0f);
-    shader.setUniform1f("ratio", 1.0f);
+    setParam1f("inverseWidth1", 1.0f / width);
+    setParam1f("inverseHeight1", 1.0f / height);
+    setParam1f("input1Width", width);
+    setParam1f("input1Height", height);
+    setParam1f("hdFixX", 0.0f);
+    setParam1f("hdFixY", 0.0f);
+    setParam1f("ratio", 1.0f);
     
     // Channel 1 parameters
-    shader.setUniform2f("ch1XYDisplace", params.ch1XDisplace, params.ch1YDisplace);
-    shader.setUniform1f("ch1ZDisplace", params.ch1ZDisplace);
-    shader.setUniform1f("ch1Rotate", params.ch1Rotate);
-    shader.setUniform3f("ch1HSBAttenuate", params.ch1HueAttenuate, params.ch1SaturationAttenuate, params.ch1BrightAttenuate);
-    shader.setUniform1f("ch1Posterize", params.ch1Posterize);
-    shader.setUniform1f("ch1PosterizeInvert", 1.0f / params.ch1Posterize);
-    shader.setUniform1i("ch1PosterizeSwitch", params.ch1PosterizeSwitch);
-    shader.setUniform1f("ch1KaleidoscopeAmount", params.ch1KaleidoscopeAmount);
-    shader.setUniform1f("ch1KaleidoscopeSlice", params.ch1KaleidoscopeSlice);
-    shader.setUniform1f("ch1BlurAmount", params.ch1BlurAmount);
-    shader.setUniform1f("ch1BlurRadius", params.ch1BlurRadius);
-    shader.setUniform1f("ch1SharpenAmount", params.ch1SharpenAmount);
-    shader.setUniform1f("ch1SharpenRadius", params.ch1SharpenRadius);
-    shader.setUniform1f("ch1FiltersBoost", params.ch1FiltersBoost);
-    
-    shader.setUniform1i("ch1GeoOverflow", params.ch1GeoOverflow);
-    shader.setUniform1i("ch1HMirror", params.ch1HMirror);
-    shader.setUniform1i("ch1VMirror", params.ch1VMirror);
-    shader.setUniform1i("ch1HFlip", params.ch1HFlip);
-    shader.setUniform1i("ch1VFlip", params.ch1VFlip);
-    shader.setUniform1i("ch1HueInvert", params.ch1HueInvert);
-    shader.setUniform1i("ch1SaturationInvert", params.ch1SaturationInvert);
-    shader.setUniform1i("ch1BrightInvert", params.ch1BrightInvert);
-    shader.setUniform1i("ch1RGBInvert", params.ch1RGBInvert);
-    shader.setUniform1i("ch1Solarize", params.ch1Solarize);
+    setParam3f("ch1HSBAttenuate", params.ch1HueAttenuate, params.ch1SaturationAttenuate, params.ch1BrightAttenuate);
+    setParam1f("ch1Posterize", params.ch1Posterize);
+    setParam1f("ch1PosterizeInvert", 1.0f / params.ch1Posterize);
+    setParam1i("ch1PosterizeSwitch", params.ch1PosterizeSwitch);
+    setParam1f("ch1KaleidoscopeAmount", params.ch1KaleidoscopeAmount);
+    setParam1f("ch1KaleidoscopeSlice", params.ch1KaleidoscopeSlice);
+    setParam1f("ch1BlurAmount", params.ch1BlurAmount);
+    setParam1f("ch1BlurRadius", params.ch1BlurRadius);
+    setParam1f("ch1SharpenAmount", params.ch1SharpenAmount);
+    setParam1f("ch1SharpenRadius", params.ch1SharpenRadius);
+    setParam1f("ch1FiltersBoost", params.ch1FiltersBoost);
+    
+    setParam1i("ch1GeoOverflow", params.ch1GeoOverflow);
+    setParam1i("ch1HMirror", params.ch1HMirror);
+    setParam1i("ch1VMirror", params.ch1VMirror);
+    setParam1i("ch1HueInvert", params.ch1HueInvert);
+    setParam1i("ch1SaturationInvert", params.ch1SaturationInvert);
+    setParam1i("ch1BrightInvert", params.ch1BrightInvert);
+    setParam1i("ch1RGBInvert", params.ch1RGBInvert);
+    setParam1i("ch1Solarize", params.ch1Solarize);
     
     // Channel 2 mix and key
-    shader.setUniform1f("ch2MixAmount", params.ch2MixAmount);
-    shader.setUniform3f("ch2KeyValue", params.ch2KeyValueRed, params.ch2KeyValueGreen, params.ch2KeyValueBlue);
-    shader.setUniform1f("ch2KeyThreshold", params.ch2KeyThreshold);
-    shader.setUniform1f("ch2KeySoft", params.ch2KeySoft);
-    shader.setUniform1i("ch2KeyOrder", params.ch2KeyOrder);
-    shader.setUniform1i("ch2MixType", params.ch2MixType);
-    shader.setUniform1i("ch2MixOverflow", params.ch2MixOverflow);
+    setParam1f("ch2MixAmount", params.ch2MixAmount);
+    setParam3f("ch2KeyValue", params.ch2KeyValueRed, params.ch2KeyValueGreen, params.ch2KeyValueBlue);
+    setParam1f("ch2KeyThreshold", params.ch2KeyThreshold);
+    setParam1f("ch2KeySoft", params.ch2KeySoft);
+    setParam1i("ch2KeyOrder", params.ch2KeyOrder);
+    setParam1i("ch2MixType", params.ch2MixType);
+    setParam1i("ch2MixOverflow", params.ch2MixOverflow);
     
     // Channel 2 parameters
-    shader.setUniform2f("ch2XYDisplace", params.ch2XDisplace, params.ch2YDisplace);
-    shader.setUniform1f("ch2ZDisplace", params.ch2ZDisplace);
-    shader.setUniform1f("ch2Rotate", params.ch2Rotate);
-    shader.setUniform3f("ch2HSBAttenuate", params.ch2HueAttenuate, params.ch2SaturationAttenuate, params.ch2BrightAttenuate);
-    shader.setUniform1f("ch2Posterize", params.ch2Posterize);
-    shader.setUniform1f("ch2PosterizeInvert", 1.0f / params.ch2Posterize);
-    shader.setUniform1i("ch2PosterizeSwitch", params.ch2PosterizeSwitch);
-    shader.setUniform1f("ch2KaleidoscopeAmount", params.ch2KaleidoscopeAmount);
-    shader.setUniform1f("ch2KaleidoscopeSlice", params.ch2KaleidoscopeSlice);
-    shader.setUniform1f("ch2BlurAmount", params.ch2BlurAmount);
-    shader.setUniform1f("ch2BlurRadius", params.ch2BlurRadius);
-    shader.setUniform1f("ch2SharpenAmount", params.ch2SharpenAmount);
-    shader.setUniform1f("ch2SharpenRadius", params.ch2SharpenRadius);
-    shader.setUniform1f("ch2FiltersBoost", params.ch2FiltersBoost);
-    
-    shader.setUniform1i("ch2GeoOverflow", params.ch2GeoOverflow);
-    shader.setUniform1i("ch2HMirror", params.ch2HMirror);
-    shader.setUniform1i("ch2VMirror", params.ch2VMirror);
-    shader.setUniform1i("ch2HFlip", params.ch2HFlip);
-    shader.setUniform1i("ch2VFlip", params.ch2VFlip);
-    shader.setUniform1i("ch2HueInvert", params.ch2HueInvert);
-    shader.setUniform1i("ch2SaturationInvert", params.ch2SaturationInvert);
-    shader.setUniform1i("ch2BrightInvert", params.ch2BrightInvert);
-    shader.setUniform1i("ch2RGBInvert", params.ch2RGBInvert);
-    shader.setUniform1i("ch2Solarize", params.ch2Solarize);
+    setParam3f("ch2HSBAttenuate", params.ch2HueAttenuate, params.ch2SaturationAttenuate, params.ch2BrightAttenuate);
+    setParam1f("ch2Posterize", params.ch2Posterize);
+    setParam1f("ch2PosterizeInvert", 1.0f / params.ch2Posterize);
+    setParam1i("ch2PosterizeSwitch", params.ch2PosterizeSwitch);
+    setParam1f("ch2KaleidoscopeAmount", params.ch2KaleidoscopeAmount);
+    setParam1f("ch2KaleidoscopeSlice", params.ch2KaleidoscopeSlice);
+    setParam1f("ch2BlurAmount", params.ch2BlurAmount);
+    setParam1f("ch2BlurRadius", params.ch2BlurRadius);
+    setParam1f("ch2SharpenAmount", params.ch2SharpenAmount);
+    setParam1f("ch2SharpenRadius", params.ch2SharpenRadius);
+    setParam1f("ch2FiltersBoost", params.ch2FiltersBoost);
+    
+    setParam1i("ch2GeoOverflow", params.ch2GeoOverflow);
+    setParam1i("ch2HMirror", params.ch2HMirror);
+    setParam1i("ch2VMirror", params.ch2VMirror);
+    setParam1i("ch2HueInvert", params.ch2HueInvert);
+    setParam1i("ch2SaturationInvert", params.ch2SaturationInvert);
+    setParam1i("ch2BrightInvert", params.ch2BrightInvert);
+    setParam1i("ch2RGBInvert", params.ch2RGBInvert);
+    setParam1i("ch2Solarize", params.ch2Solarize);
     
     // FB1 parameters
-    shader.setUniform1f("fb1MixAmount", params.fb1MixAmount);
-    shader.setUniform3f("fb1KeyValue", params.fb1KeyValueRed, params.fb1KeyValueGreen, params.fb1KeyValueBlue);
-    shader.setUniform1f("fb1KeyThreshold", params.fb1KeyThreshold);
-    shader.setUniform1f("fb1KeySoft", params.fb1KeySoft);
-    shader.setUniform1i("fb1KeyOrder", params.fb1KeyOrder);
-    shader.setUniform1i("fb1MixType", params.fb1MixType);
-    shader.setUniform1i("fb1MixOverflow", params.fb1MixOverflow);
-    
-    shader.setUniform2f("fb1XYDisplace", params.fb1XDisplace, params.fb1YDisplace);
-    shader.setUniform1f("fb1ZDisplace", params.fb1ZDisplace);
-    shader.setUniform1f("fb1Rotate", params.fb1Rotate);
-    shader.setUniform4f("fb1ShearMatrix", params.fb1ShearMatrix1, params.fb1ShearMatrix2, 
-                        params.fb1ShearMatrix3, params.fb1ShearMatrix4);
-    shader.setUniform1f("fb1KaleidoscopeAmount", params.fb1KaleidoscopeAmount);
-    shader.setUniform1f("fb1KaleidoscopeSlice", params.fb1KaleidoscopeSlice);
-    
-    shader.setUniform1i("fb1HMirror", params.fb1HMirror);
-    shader.setUniform1i("fb1VMirror", params.fb1VMirror);
-    shader.setUniform1i("fb1HFlip", params.fb1HFlip);
-    shader.setUniform1i("fb1VFlip", params.fb1VFlip);
-    shader.setUniform1i("fb1RotateMode", params.fb1RotateMode);
-    shader.setUniform1i("fb1GeoOverflow", params.fb1GeoOverflow);
-    
-    shader.setUniform3f("fb1HSBOffset", params.fb1HueOffset, params.fb1SaturationOffset, params.fb1BrightOffset);
-    shader.setUniform3f("fb1HSBAttenuate", params.fb1HueAttenuate, params.fb1SaturationAttenuate, params.fb1BrightAttenuate);
-    shader.setUniform3f("fb1HSBPowmap", params.fb1HuePowmap, params.fb1SaturationPowmap, params.fb1BrightPowmap);
-    shader.setUniform1f("fb1HueShaper", params.fb1HueShaper);
-    shader.setUniform1f("fb1Posterize", params.fb1Posterize);
-    shader.setUniform1f("fb1PosterizeInvert", 1.0f / params.fb1Posterize);
-    shader.setUniform1i("fb1PosterizeSwitch", params.fb1PosterizeSwitch);
-    
-    shader.setUniform1i("fb1HueInvert", params.fb1HueInvert);
-    shader.setUniform1i("fb1SaturationInvert", params.fb1SaturationInvert);
-    shader.setUniform1i("fb1BrightInvert", params.fb1BrightInvert);
-    
-    shader.setUniform1f("fb1BlurAmount", params.fb1BlurAmount);
-    shader.setUniform1f("fb1BlurRadius", params.fb1BlurRadius);
-    shader.setUniform1f("fb1SharpenAmount", params.fb1SharpenAmount);
-    shader.setUniform1f("fb1SharpenRadius", params.fb1SharpenRadius);
-    shader.setUniform1f("fb1TemporalFilter1Amount", params.fb1TemporalFilter1Amount);
-    shader.setUniform1f("fb1TemporalFilter1Resonance", params.fb1TemporalFilter1Resonance);
-    shader.setUniform1f("fb1TemporalFilter2Amount", params.fb1TemporalFilter2Amount);
-    shader.setUniform1f("fb1TemporalFilter2Resonance", params.fb1TemporalFilter2Resonance);
-    shader.setUniform1f("fb1FiltersBoost", params.fb1FiltersBoost);
+    setParam1f("fb1MixAmount", params.fb1MixAmount);
+    setParam3f("fb1KeyValue", params.fb1KeyValueRed, params.fb1KeyValueGreen, params.fb1KeyValueBlue);
+    setParam1f("fb1KeyThreshold", params.fb1KeyThreshold);
+    setParam1f("fb1KeySoft", params.fb1KeySoft);
+    setParam1i("fb1KeyOrder", params.fb1KeyOrder);
+    setParam1i("fb1MixType", params.fb1MixType);
+    setParam1i("fb1MixOverflow", params.fb1MixOverflow);
+    
+    setParam1f("fb1KaleidoscopeAmount", params.fb1KaleidoscopeAmount);
+    setParam1f("fb1KaleidoscopeSlice", params.fb1KaleidoscopeSlice);
+    
+    setParam1i("fb1HMirror", params.fb1HMirror);
+    setParam1i("fb1VMirror", params.fb1VMirror);
+    setParam1i("fb1GeoOverflow", params.fb1GeoOverflow);
+    
+    setParam3f("fb1HSBOffset", params.fb1HueOffset, params.fb1SaturationOffset, params.fb1BrightOffset);
+    setParam3f("fb1HSBAttenuate", params.fb1HueAttenuate, params.fb1SaturationAttenuate, params.fb1BrightAttenuate);
+    setParam3f("fb1HSBPowmap", params.fb1HuePowmap, params.fb1SaturationPowmap, params.fb1BrightPowmap);
+    setParam1f("fb1HueShaper", params.fb1HueShaper);
+    setParam1f("fb1Posterize", params.fb1Posterize);
+    setParam1f("fb1PosterizeInvert", 1.0f / params.fb1Posterize);
+    setParam1i("fb1PosterizeSwitch", params.fb1PosterizeSwitch);
+    
+    setParam1i("fb1HueInvert", params.fb1HueInvert);
+    setParam1i("fb1SaturationInvert", params.fb1SaturationInvert);
+    setParam1i("fb1BrightInvert", params.fb1BrightInvert);
+    
+    setParam1f("fb1BlurAmount", params.fb1BlurAmount);
+    setParam1f("fb1BlurRadius", params.fb1BlurRadius);
+    setParam1f("fb1SharpenAmount", params.fb1SharpenAmount);
+    setParam1f("fb1SharpenRadius", params.fb1SharpenRadius);
+    setParam1f("fb1TemporalFilter1Amount", params.fb1TemporalFilter1Amount);
+    setParam1f("fb1TemporalFilter1Resonance", params.fb1TemporalFilter1Resonance);
+    setParam1f("fb1TemporalFilter2Amount", params.fb1TemporalFilter2Amount);
+    setParam1f("fb1TemporalFilter2Resonance", params.fb1TemporalFilter2Resonance);
+    setParam1f("fb1FiltersBoost", params.fb1FiltersBoost);
     
     // Aspect ratio fixes
-    shader.setUniform1i("ch1HdAspectOn", params.ch1HdAspectOn);
-    shader.setUniform2f("ch1HdAspectXYFix", ch1HdAspectXFix, ch1HdAspectYFix);
-    shader.setUniform2f("input1XYFix", input1XYFix[0], input1XYFix[1]);
-    
-    shader.setUniform1i("ch2HdAspectOn", params.ch2HdAspectOn);
-    shader.setUniform2f("ch2HdAspectXYFix", ch2HdAspectXFix, ch2HdAspectYFix);
-    shader.setUniform2f("input2XYFix", input2XYFix[0], input2XYFix[1]);
-    
-    // Channel 1 aspect ratio and scaling (inputs are pre-scaled to internal resolution)
-    shader.setUniform1f("ch1ScaleFix", 1.0f);
-    shader.setUniform1f("ch1AspectRatio", 1.0f);
-    shader.setUniform1f("ch1CribX", 0.0f);
-    shader.setUniform1f("ch1HdZCrib", 0.0f);
-    
-    // Channel 2 aspect ratio and scaling
-    shader.setUniform1f("ch2ScaleFix", 1.0f);
-    shader.setUniform1f("ch2AspectRatio", 1.0f);
-    shader.setUniform1f("ch2CribX", 0.0f);
-    shader.setUniform1f("ch2HdZCrib", 0.0f);
-    shader.setUniform1f("cribY", 0.0f);
+    setParam2f("input1XYFix", input1XYFix[0], input1XYFix[1]);
+    setParam2f("input2XYFix", input2XYFix[0], input2XYFix[1]);
+    
+    // Layer coordinate transforms (see LayerTransform). Inputs are pre-scaled
+    // to internal resolution, so the input mapping is aspect 1, no crib,
+    // scale 1 unless the HD aspect fix is on.
+    glm::vec2 size(width, height);
+    const glm::vec4 noShear(1.0f, 0.0f, 0.0f, 1.0f);
+    
+    setParamMatrix3f("ch1PreTransform",
+        LayerTransform::flip(params.ch1HFlip == 1, params.ch1VFlip == 1, size) *
+        LayerTransform::inputMapping(1.0f, 0.0f, 1.0f, params.ch1HdAspectOn == 1,
+                                     glm::vec2(ch1HdAspectXFix, ch1HdAspectYFix), size));
+    setParamMatrix3f("ch1Transform",
+        LayerTransform::geometry(glm::vec2(params.ch1XDisplace, params.ch1YDisplace), params.ch1ZDisplace,
+                                 params.ch1Rotate, 0, noShear, size));
+    
+    // Channel 2's HD aspect fix has always used channel 1's factors
+    setParamMatrix3f("ch2PreTransform",
+        LayerTransform::flip(params.ch2HFlip == 1, params.ch2VFlip == 1, size) *
+        LayerTransform::inputMapping(1.0f, 0.0f, 1.0f, params.ch2HdAspectOn == 1,
+                                     glm::vec2(ch1HdAspectXFix, ch1HdAspectYFix), size));
+    setParamMatrix3f("ch2Transform",
+        LayerTransform::geometry(glm::vec2(params.ch2XDisplace, params.ch2YDisplace), params.ch2ZDisplace,
+                                 params.ch2Rotate, 0, noShear, size));
+    
+    setParamMatrix3f("fb1PreTransform", LayerTransform::flip(params.fb1HFlip == 1, params.fb1VFlip == 1, size));
+    setParamMatrix3f("fb1Transform",
+        LayerTransform::geometry(glm::vec2(params.fb1XDisplace, params.fb1YDisplace), params.fb1ZDisplace,
+                                 params.fb1Rotate, params.fb1RotateMode,
+                                 glm::vec4(params.fb1ShearMatrix1, params.fb1ShearMatrix2,
+                                           params.fb1ShearMatrix3, params.fb1ShearMatrix4), size));
     
     // Input select
-    shader.setUniform1i("ch1InputSelect", params.ch1InputSelect);
-    shader.setUniform1i("ch2InputSelect", params.ch2InputSelect);
+    setParam1i("ch1InputSelect", params.ch1InputSelect);
+    setParam1i("ch2InputSelect", params.ch2InputSelect);
+    
+    flushParams();
 }
 
 void Block1Shader::setChannel1Texture(ofTexture& tex) {
@@ -210,12 +250,34 @@ void Block1Shader::setChannel2Texture(ofTexture& tex) {
     ch2Tex = &tex;
 }
 
-void Block1Shader::setFeedbackTexture(ofTexture& tex) {
-    fbTex = &tex;
+void Block1Shader::setFeedbackHistory(GLuint textureArray, GLuint olderTextureArray,
+                                      HistoryTap delayed, int temporalLayer) {
+    historyTex = textureArray;
+    historyOlderTex = olderTextureArray;
+    historyDelayed = delayed;
+    historyTemporalLayer = temporalLayer;
+}
+
+void Block1Shader::setBlurPrepass(ofTexture* ch1, ofTexture* ch2, ofTexture* fb1) {
+    ch1PrepassTex = ch1;
+    ch2PrepassTex = ch2;
+    fb1PrepassTex = fb1;
+}
+
+void Block1Shader::setLayersUsed(bool ch1, bool ch2) {
+    ch1Used = ch1;
+    ch2Used = ch2;
+}
+
+void Block1Shader::setChannelCache(ofTexture* ch1, ofTexture* ch2) {
+    ch1CacheTex = ch1;
+    ch2CacheTex = ch2;
 }
 
-void Block1Shader::setTemporalFilterTexture(ofTexture& tex) {
-    temporalTex = &tex;
+void Block1Shader::setWarpMaps(ofTexture* ch1, ofTexture* ch2, ofTexture* fb1) {
+    warpTex[WARP_CH1] = ch1;
+    warpTex[WARP_CH2] = ch2;
+    warpTex[WARP_FB1] = fb1;
 }
 
 //==============================================================================
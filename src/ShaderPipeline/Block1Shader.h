@@ -18,8 +18,40 @@ public:
     // Input textures
     void setChannel1Texture(ofTexture& tex);
     void setChannel2Texture(ofTexture& tex);
-    void setFeedbackTexture(ofTexture& tex);
-    void setTemporalFilterTexture(ofTexture& tex);
+    
+    // Feedback history: full quality and older tier texture arrays, the
+    // delayed frame's location and the most recent frame's layer
+    // (-1 = empty, reads as black)
+    void setFeedbackHistory(GLuint textureArray, GLuint olderTextureArray,
+                            HistoryTap delayed, int temporalLayer);
+    
+    // BlurPrepass results per layer (nullptr = blur/sharpen per pixel)
+    void setBlurPrepass(ofTexture* ch1, ofTexture* ch2, ofTexture* fb1);
+    
+    // Layers that can reach the output (see PipelineManager::RenderPaths);
+    // the shader skips the fetches of the others
+    void setLayersUsed(bool ch1, bool ch2);
+    
+    // Channel caching (see ChannelCache): CHANNELS renders ch1/ch2 only, to
+    // draw buffers 0/1; MIX runs feedback and mix on the cached results.
+    // WARP bakes the ch1/ch2/fb1 warp maps to draw buffers 0-2.
+    enum Stage {
+        SINGLE_PASS = 0,
+        CHANNELS,
+        MIX,
+        WARP
+    };
+    void setStage(Stage stage) { this->stage = stage; }
+    void setChannelCache(ofTexture* ch1, ofTexture* ch2);
+    
+    // Baked per-layer coordinates (see WarpMapCache), nullptr = live math
+    enum WarpLayer {
+        WARP_CH1 = 0,
+        WARP_CH2,
+        WARP_FB1,
+        WARP_LAYER_COUNT
+    };
+    void setWarpMaps(ofTexture* ch1, ofTexture* ch2, ofTexture* fb1);
     
     // Parameters - these are references that can be bound to ParameterManager
     struct Params {
@@ -190,8 +222,22 @@ public:
 private:
     ofTexture* ch1Tex = nullptr;
     ofTexture* ch2Tex = nullptr;
-    ofTexture* fbTex = nullptr;
-    ofTexture* temporalTex = nullptr;
+    GLuint historyTex = 0;
+    GLuint historyOlderTex = 0;
+    HistoryTap historyDelayed;
+    int historyTemporalLayer = -1;
+    ofTexture* ch1PrepassTex = nullptr;
+    ofTexture* ch2PrepassTex = nullptr;
+    ofTexture* fb1PrepassTex = nullptr;
+    ColorLut ch1ColorLut;
+    ColorLut ch2ColorLut;
+    ColorLut fb1ColorLut;
+    bool ch1Used = true;
+    bool ch2Used = true;
+    Stage stage = SINGLE_PASS;
+    ofTexture* ch1CacheTex = nullptr;
+    ofTexture* ch2CacheTex = nullptr;
+    ofTexture* warpTex[WARP_LAYER_COUNT] = {};
     ofTexture dummyTex;
     
     // Store last computed modulated values for GUI feedback
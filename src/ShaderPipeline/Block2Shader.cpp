@@ -5,6 +5,7 @@ namespace dragonwaves {
 
 Block2Shader::Block2Shader()
     : ShaderBlock("Block2", "shader2") {
+    colorLuts = { &block2InputColorLut, &fb2ColorLut };
     initializeModulations();
 }
 
@@ -23,137 +24,167 @@ void Block2Shader::setup(int width, int height) {
 void Block2Shader::process() {
     ShaderBlock::process();
     
+    // Block2 input layer (units 6, 7 and 9)
+    setInputLayerParams(paramBuffer, 6, 7, 9);
+    
+    // Delayed and temporal filter frames come from the feedback history arrays
+    setParamTexture("fb2History", GL_TEXTURE_2D_ARRAY, historyTex, 4);
+    setParamTexture("fb2HistoryOlder", GL_TEXTURE_2D_ARRAY, historyOlderTex, 5);
+    setParam1i("fb2DelayTier", historyDelayed.tier);
+    setParam1i("fb2DelayLayer", historyDelayed.layer);
+    setParam1i("fb2TemporalLayer", historyTemporalLayer);
+    
+    // fb2 blur/sharpen pre-pass result (unit 8)
+    setPrepassParams("fb2Prepass", "fb2BlurPrepass", fb2PrepassTex, dummyTex, 8);
+    
+    // Layers culled by PipelineManager
+    setParam1i("block2InputLayerOn", block2InputUsed ? 1 : 0);
+    
+    // Baked fb2 coordinates (unit 11)
+    setParam1i("block2Stage", stage);
+    ofTexture* fb2Warp = (stage == RENDER) ? fb2WarpTex : nullptr;
+    setParamTexture("fb2WarpMap", fb2Warp ? *fb2Warp : dummyTex, 11);
+    setParam1i("fb2WarpOn", fb2Warp ? 1 : 0);
+    
+    // fb2 colour chain baked into a 3D LUT once its parameters settle (unit 10)
+    setColorLutParams("fb2ColorLut", "fb2ColorLutOn", fb2ColorLut,
+        stage == RENDER && fb2ColorLut.updateFeedbackChain(params.fb2HueShaper,
+            glm::vec3(params.fb2HueOffset, params.fb2SaturationOffset, params.fb2BrightOffset),
+            glm::vec3(params.fb2HueAttenuate, params.fb2SaturationAttenuate, params.fb2BrightAttenuate),
+            glm::vec3(params.fb2HuePowmap, params.fb2SaturationPowmap, params.fb2BrightPowmap),
+            params.fb2HueInvert == 1, params.fb2SaturationInvert == 1, params.fb2BrightInvert == 1,
+            params.fb2SharpenAmount), 10);
+    
+    // Resolution uniforms
+    setParam1f("width", width);
+    setParam1f("height", height);
+    setParam1f("inverseWidth", 1.0f / width);
+    setParam1f("inverseHeight", 1.0f / height);
+    
+    setParam1f("inverseWidth1", 1.0f / width);
+    setParam1f("inverseHeight1", 1.0f / height);
+    glm::vec2 size(width, height);
+    
+    // FB2 parameters
+    setParam1f("fb2MixAmount", params.fb2MixAmount);
+    setParam3f("fb2KeyValue", params.fb2KeyValueRed, params.fb2KeyValueGreen, params.fb2KeyValueBlue);
+    setParam1f("fb2KeyThreshold", params.fb2KeyThreshold);
+    setParam1f("fb2KeySoft", params.fb2KeySoft);
+    setParam1i("fb2KeyOrder", params.fb2KeyOrder);
+    setParam1i("fb2MixType", params.fb2MixType);
+    setParam1i("fb2MixOverflow", params.fb2MixOverflow);
+    
+    setParamMatrix3f("fb2PreTransform", LayerTransform::flip(params.fb2HFlip == 1, params.fb2VFlip == 1, size));
+    setParamMatrix3f("fb2Transform",
+        LayerTransform::geometry(glm::vec2(params.fb2XDisplace, params.fb2YDisplace), params.fb2ZDisplace,
+                                 params.fb2Rotate, params.fb2RotateMode,
+                                 glm::vec4(params.fb2ShearMatrix1, params.fb2ShearMatrix2,
+                                           params.fb2ShearMatrix3, params.fb2ShearMatrix4), size));
+    setParam1f("fb2KaleidoscopeAmount", params.fb2KaleidoscopeAmount);
+    setParam1f("fb2KaleidoscopeSlice", params.fb2KaleidoscopeSlice);
+    
+    setParam1i("fb2HMirror", params.fb2HMirror);
+    setParam1i("fb2VMirror", params.fb2VMirror);
+    setParam1i("fb2GeoOverflow", params.fb2GeoOverflow);
+    
+    setParam3f("fb2HSBOffset", params.fb2HueOffset, params.fb2SaturationOffset, params.fb2BrightOffset);
+    setParam3f("fb2HSBAttenuate", params.fb2HueAttenuate, params.fb2SaturationAttenuate, params.fb2BrightAttenuate);
+    setParam3f("fb2HSBPowmap", params.fb2HuePowmap, params.fb2SaturationPowmap, params.fb2BrightPowmap);
+    setParam1f("fb2HueShaper", params.fb2HueShaper);
+    setParam1f("fb2Posterize", params.fb2Posterize);
+    setParam1f("fb2PosterizeInvert", 1.0f / params.fb2Posterize);
+    setParam1i("fb2PosterizeSwitch", params.fb2PosterizeSwitch);
+    
+    setParam1i("fb2HueInvert", params.fb2HueInvert);
+    setParam1i("fb2SaturationInvert", params.fb2SaturationInvert);
+    setParam1i("fb2BrightInvert", params.fb2BrightInvert);
+    
+    setParam1f("fb2BlurAmount", params.fb2BlurAmount);
+    setParam1f("fb2BlurRadius", params.fb2BlurRadius);
+    setParam1f("fb2SharpenAmount", params.fb2SharpenAmount);
+    setParam1f("fb2SharpenRadius", params.fb2SharpenRadius);
+    setParam1f("fb2TemporalFilter1Amount", params.fb2TemporalFilter1Amount);
+    setParam1f("fb2TemporalFilter1Resonance", params.fb2TemporalFilter1Resonance);
+    setParam1f("fb2TemporalFilter2Amount", params.fb2TemporalFilter2Amount);
+    setParam1f("fb2TemporalFilter2Resonance", params.fb2TemporalFilter2Resonance);
+    setParam1f("fb2FiltersBoost", params.fb2FiltersBoost);
+    
+    // Input select
+    setParam1i("block2InputSelect", params.block2InputSelect);
+    
+    flushParams();
+}
+
+void Block2Shader::setInputLayerParams(ParamBuffer& target, int textureUnit, int prepassUnit, int lutUnit) {
     // Bind textures based on block2InputSelect
     // 0 = use block1 output (fb texture), 1 = input1, 2 = input2
-    if (params.block2InputSelect == 0) {
-        // Use block1 output
-        if (block1Tex && block1Tex->isAllocated()) {
-            shader.setUniformTexture("block2InputTex", *block1Tex, 6);
-        } else {
-            shader.setUniformTexture("block2InputTex", dummyTex, 6);
-        }
+    ofTexture* source = (params.block2InputSelect == 0) ? block1Tex : inputTex;
+    if (source && source->isAllocated()) {
+        target.setTexture("block2InputTex", *source, textureUnit);
     } else {
-        // Use external input (input1 or input2)
-        if (inputTex && inputTex->isAllocated()) {
-            shader.setUniformTexture("block2InputTex", *inputTex, 6);
-        } else {
-            shader.setUniformTexture("block2InputTex", dummyTex, 6);
-        }
+        target.setTexture("block2InputTex", dummyTex, textureUnit);
     }
     
-    if (fbTex && fbTex->isAllocated()) {
-        shader.setUniformTexture("tex0", *fbTex, 4);
-    } else {
-        shader.setUniformTexture("tex0", dummyTex, 4);
-    }
+    // Blur/sharpen pre-pass result (the dummy keeps the sampler valid without one)
+    target.setTexture("block2InputPrepass", block2InputPrepassTex ? *block2InputPrepassTex : dummyTex, prepassUnit);
+    target.set1i("block2InputBlurPrepass", block2InputPrepassTex ? 1 : 0);
     
-    if (temporalTex && temporalTex->isAllocated()) {
-        shader.setUniformTexture("fb2TemporalFilter", *temporalTex, 5);
-    } else {
-        shader.setUniformTexture("fb2TemporalFilter", dummyTex, 5);
-    }
+    // Colour chain baked into a 3D LUT once its parameters settle
+    bool lutActive = block2InputColorLut.updateInputChain(
+        glm::vec3(params.block2InputHueAttenuate, params.block2InputSaturationAttenuate,
+                  params.block2InputBrightAttenuate),
+        params.block2InputHueInvert == 1, params.block2InputSaturationInvert == 1,
+        params.block2InputBrightInvert == 1, params.block2InputSolarize == 1,
+        params.block2InputRGBInvert == 1, params.block2InputSharpenAmount);
+    target.setTexture("block2InputColorLut", GL_TEXTURE_3D, block2InputColorLut.getTextureId(), lutUnit);
+    target.set1i("block2InputColorLutOn", lutActive ? 1 : 0);
     
-    // Resolution uniforms
-    shader.setUniform1f("width", width);
-    shader.setUniform1f("height", height);
-    shader.setUniform1f("inverseWidth", 1.0f / width);
-    shader.setUniform1f("inverseHeight", 1.0f / height);
-    
-    // Block2 input parameters
-    // Master switch is 1 when using external input (input1 or input2), 0 when using block1 output
-    int masterSwitch = (params.block2InputSelect > 0) ? 1 : 0;
-    shader.setUniform1i("block2InputMasterSwitch", masterSwitch);
-    shader.setUniform1f("block2InputWidth", width);
-    shader.setUniform1f("block2InputHeight", height);
-    shader.setUniform1f("block2InputWidthHalf", width * 0.5f);
-    shader.setUniform1f("block2InputHeightHalf", height * 0.5f);
-    
-    // Coordinate transformation defaults (for external input scaling)
-    shader.setUniform1f("block2InputAspectRatio", 1.0f);
-    shader.setUniform1f("block2InputHdZCrib", 0.0f);
-    shader.setUniform1f("block2InputScaleFix", 1.0f);
-    shader.setUniform1f("block2InputCribX", 0.0f);
-    shader.setUniform1f("inverseWidth1", 1.0f / width);
-    shader.setUniform1f("inverseHeight1", 1.0f / height);
-    
-    shader.setUniform2f("block2InputXYDisplace", params.block2InputXDisplace, params.block2InputYDisplace);
-    shader.setUniform1f("block2InputZDisplace", params.block2InputZDisplace);
-    shader.setUniform1f("block2InputRotate", params.block2InputRotate);
-    shader.setUniform3f("block2InputHSBAttenuate", params.block2InputHueAttenuate, 
-                        params.block2InputSaturationAttenuate, params.block2InputBrightAttenuate);
-    shader.setUniform1f("block2InputPosterize", params.block2InputPosterize);
-    shader.setUniform1f("block2InputPosterizeInvert", 1.0f / params.block2InputPosterize);
-    shader.setUniform1i("block2InputPosterizeSwitch", params.block2InputPosterizeSwitch);
-    shader.setUniform1f("block2InputKaleidoscopeAmount", params.block2InputKaleidoscopeAmount);
-    shader.setUniform1f("block2InputKaleidoscopeSlice", params.block2InputKaleidoscopeSlice);
-    shader.setUniform1f("block2InputBlurAmount", params.block2InputBlurAmount);
-    shader.setUniform1f("block2InputBlurRadius", params.block2InputBlurRadius);
-    shader.setUniform1f("block2InputSharpenAmount", params.block2InputSharpenAmount);
-    shader.setUniform1f("block2InputSharpenRadius", params.block2InputSharpenRadius);
-    shader.setUniform1f("block2InputFiltersBoost", params.block2InputFiltersBoost);
-    
-    shader.setUniform1i("block2InputGeoOverflow", params.block2InputGeoOverflow);
-    shader.setUniform1i("block2InputHMirror", params.block2InputHMirror);
-    shader.setUniform1i("block2InputVMirror", params.block2InputVMirror);
-    shader.setUniform1i("block2InputHFlip", params.block2InputHFlip);
-    shader.setUniform1i("block2InputVFlip", params.block2InputVFlip);
-    shader.setUniform1i("block2InputHueInvert", params.block2InputHueInvert);
-    shader.setUniform1i("block2InputSaturationInvert", params.block2InputSaturationInvert);
-    shader.setUniform1i("block2InputBrightInvert", params.block2InputBrightInvert);
-    shader.setUniform1i("block2InputRGBInvert", params.block2InputRGBInvert);
-    shader.setUniform1i("block2InputSolarize", params.block2InputSolarize);
-    
-    shader.setUniform1i("block2InputHdAspectOn", params.block2InputHdAspectOn);
-    shader.setUniform2f("block2InputHdAspectXYFix", block2InputHdAspectXFix, block2InputHdAspectYFix);
+    target.set1f("block2InputWidth", width);
+    target.set1f("block2InputHeight", height);
+    target.set1f("block2InputWidthHalf", width * 0.5f);
+    target.set1f("block2InputHeightHalf", height * 0.5f);
     
-    // FB2 parameters
-    shader.setUniform1f("fb2MixAmount", params.fb2MixAmount);
-    shader.setUniform3f("fb2KeyValue", params.fb2KeyValueRed, params.fb2KeyValueGreen, params.fb2KeyValueBlue);
-    shader.setUniform1f("fb2KeyThreshold", params.fb2KeyThreshold);
-    shader.setUniform1f("fb2KeySoft", params.fb2KeySoft);
-    shader.setUniform1i("fb2KeyOrder", params.fb2KeyOrder);
-    shader.setUniform1i("fb2MixType", params.fb2MixType);
-    shader.setUniform1i("fb2MixOverflow", params.fb2MixOverflow);
-    
-    shader.setUniform2f("fb2XYDisplace", params.fb2XDisplace, params.fb2YDisplace);
-    shader.setUniform1f("fb2ZDisplace", params.fb2ZDisplace);
-    shader.setUniform1f("fb2Rotate", params.fb2Rotate);
-    shader.setUniform4f("fb2ShearMatrix", params.fb2ShearMatrix1, params.fb2ShearMatrix2,
-                        params.fb2ShearMatrix3, params.fb2ShearMatrix4);
-    shader.setUniform1f("fb2KaleidoscopeAmount", params.fb2KaleidoscopeAmount);
-    shader.setUniform1f("fb2KaleidoscopeSlice", params.fb2KaleidoscopeSlice);
-    
-    shader.setUniform1i("fb2HMirror", params.fb2HMirror);
-    shader.setUniform1i("fb2VMirror", params.fb2VMirror);
-    shader.setUniform1i("fb2HFlip", params.fb2HFlip);
-    shader.setUniform1i("fb2VFlip", params.fb2VFlip);
-    shader.setUniform1i("fb2RotateMode", params.fb2RotateMode);
-    shader.setUniform1i("fb2GeoOverflow", params.fb2GeoOverflow);
-    
-    shader.setUniform3f("fb2HSBOffset", params.fb2HueOffset, params.fb2SaturationOffset, params.fb2BrightOffset);
-    shader.setUniform3f("fb2HSBAttenuate", params.fb2HueAttenuate, params.fb2SaturationAttenuate, params.fb2BrightAttenuate);
-    shader.setUniform3f("fb2HSBPowmap", params.fb2HuePowmap, params.fb2SaturationPowmap, params.fb2BrightPowmap);
-    shader.setUniform1f("fb2HueShaper", params.fb2HueShaper);
-    shader.setUniform1f("fb2Posterize", params.fb2Posterize);
-    shader.setUniform1f("fb2PosterizeInvert", 1.0f / params.fb2Posterize);
-    shader.setUniform1i("fb2PosterizeSwitch", params.fb2PosterizeSwitch);
-    
-    shader.setUniform1i("fb2HueInvert", params.fb2HueInvert);
-    shader.setUniform1i("fb2SaturationInvert", params.fb2SaturationInvert);
-    shader.setUniform1i("fb2BrightInvert", params.fb2BrightInvert);
-    
-    shader.setUniform1f("fb2BlurAmount", params.fb2BlurAmount);
-    shader.setUniform1f("fb2BlurRadius", params.fb2BlurRadius);
-    shader.setUniform1f("fb2SharpenAmount", params.fb2SharpenAmount);
-    shader.setUniform1f("fb2SharpenRadius", params.fb2SharpenRadius);
-    shader.setUniform1f("fb2TemporalFilter1Amount", params.fb2TemporalFilter1Amount);
-    shader.setUniform1f("fb2TemporalFilter1Resonance", params.fb2TemporalFilter1Resonance);
-    shader.setUniform1f("fb2TemporalFilter2Amount", params.fb2TemporalFilter2Amount);
-    shader.setUniform1f("fb2TemporalFilter2Resonance", params.fb2TemporalFilter2Resonance);
-    shader.setUniform1f("fb2FiltersBoost", params.fb2FiltersBoost);
+    target.set3f("block2InputHSBAttenuate", params.block2InputHueAttenuate,
+                 params.block2InputSaturationAttenuate, params.block2InputBrightAttenuate);
+    target.set1f("block2InputPosterize", params.block2InputPosterize);
+    target.set1f("block2InputPosterizeInvert", 1.0f / params.block2InputPosterize);
+    target.set1i("block2InputPosterizeSwitch", params.block2InputPosterizeSwitch);
+    target.set1f("block2InputKaleidoscopeAmount", params.block2InputKaleidoscopeAmount);
+    target.set1f("block2InputKaleidoscopeSlice", params.block2InputKaleidoscopeSlice);
+    target.set1f("block2InputBlurAmount", params.block2InputBlurAmount);
+    target.set1f("block2InputBlurRadius", params.block2InputBlurRadius);
+    target.set1f("block2InputSharpenAmount", params.block2InputSharpenAmount);
+    target.set1f("block2InputSharpenRadius", params.block2InputSharpenRadius);
+    target.set1f("block2InputFiltersBoost", params.block2InputFiltersBoost);
     
-    // Input select
-    shader.setUniform1i("block2InputSelect", params.block2InputSelect);
+    target.set1i("block2InputGeoOverflow", params.block2InputGeoOverflow);
+    target.set1i("block2InputHMirror", params.block2InputHMirror);
+    target.set1i("block2InputVMirror", params.block2InputVMirror);
+    target.set1i("block2InputHueInvert", params.block2InputHueInvert);
+    target.set1i("block2InputSaturationInvert", params.block2InputSaturationInvert);
+    target.set1i("block2InputBrightInvert", params.block2InputBrightInvert);
+    target.set1i("block2InputRGBInvert", params.block2InputRGBInvert);
+    target.set1i("block2InputSolarize", params.block2InputSolarize);
+    
+    // Layer coordinate transforms (see LayerTransform). External inputs get
+    // the input mapping (pre-scaled: aspect 1, no crib, scale 1, or the HD
+    // aspect fix); block1's output is used as is.
+    glm::vec2 size(width, height);
+    const glm::vec4 noShear(1.0f, 0.0f, 0.0f, 1.0f);
+    
+    glm::mat3 inputMapping(1.0f);
+    if (params.block2InputSelect > 0) {
+        inputMapping = LayerTransform::inputMapping(1.0f, 0.0f, 1.0f, params.block2InputHdAspectOn == 1,
+                                                    glm::vec2(block2InputHdAspectXFix, block2InputHdAspectYFix), size);
+    }
+    target.setMatrix3f("block2InputPreTransform",
+        LayerTransform::flip(params.block2InputHFlip == 1, params.block2InputVFlip == 1, size) * inputMapping);
+    
+    // The shader has always rotated this layer twice (rotate() then rotate1())
+    target.setMatrix3f("block2InputTransform",
+        LayerTransform::rotate(params.block2InputRotate, 0, size) *
+        LayerTransform::geometry(glm::vec2(params.block2InputXDisplace, params.block2InputYDisplace),
+                                 params.block2InputZDisplace, params.block2InputRotate, 0, noShear, size));
 }
 
 void Block2Shader::setBlock1Texture(ofTexture& tex) {
@@ -164,12 +195,21 @@ void Block2Shader::setInputTexture(ofTexture& tex) {
     inputTex = &tex;
 }
 
-void Block2Shader::setFeedbackTexture(ofTexture& tex) {
-    fbTex = &tex;
+void Block2Shader::setFeedbackHistory(GLuint textureArray, GLuint olderTextureArray,
+                                      HistoryTap delayed, int temporalLayer) {
+    historyTex = textureArray;
+    historyOlderTex = olderTextureArray;
+    historyDelayed = delayed;
+    historyTemporalLayer = temporalLayer;
+}
+
+void Block2Shader::setBlurPrepass(ofTexture* block2Input, ofTexture* fb2) {
+    block2InputPrepassTex = block2Input;
+    fb2PrepassTex = fb2;
 }
 
-void Block2Shader::setTemporalFilterTexture(ofTexture& tex) {
-    temporalTex = &tex;
+void Block2Shader::setLayersUsed(bool block2Input) {
+    block2InputUsed = block2Input;
 }
 
 //==============================================================================
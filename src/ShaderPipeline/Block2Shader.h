@@ -18,8 +18,33 @@ public:
     // Input textures
     void setBlock1Texture(ofTexture& tex);
     void setInputTexture(ofTexture& tex);
-    void setFeedbackTexture(ofTexture& tex);
-    void setTemporalFilterTexture(ofTexture& tex);
+    
+    // Feedback history: full quality and older tier texture arrays, the
+    // delayed frame's location and the most recent frame's layer
+    // (-1 = empty, reads as black)
+    void setFeedbackHistory(GLuint textureArray, GLuint olderTextureArray,
+                            HistoryTap delayed, int temporalLayer);
+    
+    // BlurPrepass results per layer (nullptr = blur/sharpen per pixel)
+    void setBlurPrepass(ofTexture* block2Input, ofTexture* fb2);
+    
+    // Layers that can reach the output (see PipelineManager::RenderPaths);
+    // the shader skips the fetches of the others
+    void setLayersUsed(bool block2Input);
+    
+    // WARP bakes the fb2 warp map instead of rendering (see WarpMapCache)
+    enum Stage {
+        RENDER = 0,
+        WARP
+    };
+    void setStage(Stage stage) { this->stage = stage; }
+    // Baked fb2 coordinates, nullptr = live math
+    void setWarpMap(ofTexture* fb2) { fb2WarpTex = fb2; }
+    
+    // Write the block2 input layer's parameters and textures into `target`.
+    // process() uses it for its own draw, Block3 when Block2 is fused into
+    // it (see PipelineManager::updateBlock2Fusion).
+    void setInputLayerParams(ParamBuffer& target, int textureUnit, int prepassUnit, int lutUnit);
     
     // Parameters
     struct Params {
@@ -143,8 +168,17 @@ public:
 private:
     ofTexture* block1Tex = nullptr;
     ofTexture* inputTex = nullptr;
-    ofTexture* fbTex = nullptr;
-    ofTexture* temporalTex = nullptr;
+    GLuint historyTex = 0;
+    GLuint historyOlderTex = 0;
+    HistoryTap historyDelayed;
+    int historyTemporalLayer = -1;
+    ofTexture* block2InputPrepassTex = nullptr;
+    ofTexture* fb2PrepassTex = nullptr;
+    ColorLut block2InputColorLut;
+    ColorLut fb2ColorLut;
+    bool block2InputUsed = true;
+    Stage stage = RENDER;
+    ofTexture* fb2WarpTex = nullptr;
     ofTexture dummyTex;
     
     // Store last computed modulated values for GUI feedback
@@ -1,4 +1,5 @@
 #include "Block3Shader.h"
+#include "Block2Shader.h"
 
 namespace dragonwaves {
 
@@ -40,6 +41,7 @@ void ParamModulation::saveToJson(ofJson& json) const {
 //==============================================================================
 Block3Shader::Block3Shader()
     : ShaderBlock("Block3", "shader3") {
+    colorLuts = { &block1ColorLut, &block2ColorLut };
     initializeModulations();
 }
 
@@ -58,131 +60,174 @@ void Block3Shader::process() {
     
     // Bind textures - use units 0 and 1 for maximum compatibility
     if (block1Tex && block1Tex->isAllocated()) {
-        shader.setUniformTexture("block1Output", *block1Tex, 0);
+        setParamTexture("block1Output", *block1Tex, 0);
     } else {
-        shader.setUniformTexture("block1Output", dummyTex, 0);
+        setParamTexture("block1Output", dummyTex, 0);
     }
     
     if (block2Tex && block2Tex->isAllocated()) {
-        shader.setUniformTexture("block2Output", *block2Tex, 1);
+        setParamTexture("block2Output", *block2Tex, 1);
     } else {
-        shader.setUniformTexture("block2Output", dummyTex, 1);
+        setParamTexture("block2Output", dummyTex, 1);
     }
     
+    // Blur/sharpen pre-pass results (units 2-3)
+    setPrepassParams("block1Prepass", "block1BlurPrepass", block1PrepassTex, dummyTex, 2);
+    setPrepassParams("block2Prepass", "block2BlurPrepass", block2PrepassTex, dummyTex, 3);
+    
+    // Layers culled by PipelineManager
+    setParam1i("block1LayerOn", block1Used ? 1 : 0);
+    setParam1i("block2LayerOn", block2Used ? 1 : 0);
+    
+    // Block2 fused into this pass (units 6-8); with fusion off the samplers
+    // still get textures of the right type
+    if (fusedBlock2) {
+        fusedBlock2->setInputLayerParams(paramBuffer, 6, 7, 8);
+    } else {
+        setParamTexture("block2InputTex", dummyTex, 6);
+        setParamTexture("block2InputPrepass", dummyTex, 7);
+        setParamTexture("block2InputColorLut", GL_TEXTURE_3D, block2ColorLut.getTextureId(), 8);
+    }
+    setParam1i("block2Fused", fusedBlock2 ? 1 : 0);
+    
+    // Colorize baked into 3D LUTs once its bands settle (units 4-5), only
+    // with colorize on (off, it leaves the colour unchanged)
+    const glm::vec3 block1Bands[5] = {
+        glm::vec3(params.block1ColorizeHueBand1, params.block1ColorizeSaturationBand1, params.block1ColorizeBrightBand1),
+        glm::vec3(params.block1ColorizeHueBand2, params.block1ColorizeSaturationBand2, params.block1ColorizeBrightBand2),
+        glm::vec3(params.block1ColorizeHueBand3, params.block1ColorizeSaturationBand3, params.block1ColorizeBrightBand3),
+        glm::vec3(params.block1ColorizeHueBand4, params.block1ColorizeSaturationBand4, params.block1ColorizeBrightBand4),
+        glm::vec3(params.block1ColorizeHueBand5, params.block1ColorizeSaturationBand5, params.block1ColorizeBrightBand5)
+    };
+    const glm::vec3 block2Bands[5] = {
+        glm::vec3(params.block2ColorizeHueBand1, params.block2ColorizeSaturationBand1, params.block2ColorizeBrightBand1),
+        glm::vec3(params.block2ColorizeHueBand2, params.block2ColorizeSaturationBand2, params.block2ColorizeBrightBand2),
+        glm::vec3(params.block2ColorizeHueBand3, params.block2ColorizeSaturationBand3, params.block2ColorizeBrightBand3),
+        glm::vec3(params.block2ColorizeHueBand4, params.block2ColorizeSaturationBand4, params.block2ColorizeBrightBand4),
+        glm::vec3(params.block2ColorizeHueBand5, params.block2ColorizeSaturationBand5, params.block2ColorizeBrightBand5)
+    };
+    setColorLutParams("block1ColorLut", "block1ColorLutOn", block1ColorLut,
+        params.block1ColorizeSwitch == 1 &&
+        block1ColorLut.updateColorize(block1Bands, params.block1ColorizeHSB_RGB == 1, params.block1SharpenAmount), 4);
+    setColorLutParams("block2ColorLut", "block2ColorLutOn", block2ColorLut,
+        params.block2ColorizeSwitch == 1 &&
+        block2ColorLut.updateColorize(block2Bands, params.block2ColorizeHSB_RGB == 1, params.block2SharpenAmount), 5);
+    
     // Resolution uniforms
-    shader.setUniform1f("width", width);
-    shader.setUniform1f("height", height);
-    shader.setUniform1f("inverseWidth", 1.0f / width);
-    shader.setUniform1f("inverseHeight", 1.0f / height);
+    setParam1f("width", width);
+    setParam1f("height", height);
+    setParam1f("inverseWidth", 1.0f / width);
+    setParam1f("inverseHeight", 1.0f / height);
+    
+    // Layer coordinate transforms (see LayerTransform)
+    glm::vec2 size(width, height);
     
     // Block1 geo (final stage)
-    shader.setUniform2f("block1XYDisplace", params.block1XDisplace, params.block1YDisplace);
     float z1 = params.block1ZDisplace;
     if (z1 > 1.0f) {
         z1 = pow(2.0f, (z1 - 1.0f) * 8.0f);
         if (params.block1ZDisplace >= 2.0f) z1 = 1000.0f;
     }
-    shader.setUniform1f("block1ZDisplace", z1);
-    shader.setUniform1f("block1Rotate", params.block1Rotate);
-    shader.setUniform4f("block1ShearMatrix", params.block1ShearMatrix1, params.block1ShearMatrix2,
-                        params.block1ShearMatrix3, params.block1ShearMatrix4);
-    shader.setUniform1f("block1KaleidoscopeAmount", params.block1KaleidoscopeAmount);
-    shader.setUniform1f("block1KaleidoscopeSlice", params.block1KaleidoscopeSlice);
+    setParamMatrix3f("block1PreTransform", LayerTransform::flip(params.block1HFlip == 1, params.block1VFlip == 1, size));
+    setParamMatrix3f("block1Transform",
+        LayerTransform::geometry(glm::vec2(params.block1XDisplace, params.block1YDisplace), z1,
+                                 params.block1Rotate, params.block1RotateMode,
+                                 glm::vec4(params.block1ShearMatrix1, params.block1ShearMatrix2,
+                                           params.block1ShearMatrix3, params.block1ShearMatrix4), size));
+    setParam1f("block1KaleidoscopeAmount", params.block1KaleidoscopeAmount);
+    setParam1f("block1KaleidoscopeSlice", params.block1KaleidoscopeSlice);
     
-    shader.setUniform1i("block1HMirror", params.block1HMirror);
-    shader.setUniform1i("block1VMirror", params.block1VMirror);
-    shader.setUniform1i("block1HFlip", params.block1HFlip);
-    shader.setUniform1i("block1VFlip", params.block1VFlip);
-    shader.setUniform1i("block1RotateMode", params.block1RotateMode);
-    shader.setUniform1i("block1GeoOverflow", params.block1GeoOverflow);
+    setParam1i("block1HMirror", params.block1HMirror);
+    setParam1i("block1VMirror", params.block1VMirror);
+    setParam1i("block1GeoOverflow", params.block1GeoOverflow);
     
     // Block1 colorize
-    shader.setUniform1i("block1ColorizeSwitch", params.block1ColorizeSwitch);
-    shader.setUniform1i("block1ColorizeHSB_RGB", params.block1ColorizeHSB_RGB);
-    shader.setUniform3f("block1ColorizeBand1", params.block1ColorizeHueBand1,
+    setParam1i("block1ColorizeSwitch", params.block1ColorizeSwitch);
+    setParam1i("block1ColorizeHSB_RGB", params.block1ColorizeHSB_RGB);
+    setParam3f("block1ColorizeBand1", params.block1ColorizeHueBand1,
                         params.block1ColorizeSaturationBand1, params.block1ColorizeBrightBand1);
-    shader.setUniform3f("block1ColorizeBand2", params.block1ColorizeHueBand2,
+    setParam3f("block1ColorizeBand2", params.block1ColorizeHueBand2,
                         params.block1ColorizeSaturationBand2, params.block1ColorizeBrightBand2);
-    shader.setUniform3f("block1ColorizeBand3", params.block1ColorizeHueBand3,
+    setParam3f("block1ColorizeBand3", params.block1ColorizeHueBand3,
                         params.block1ColorizeSaturationBand3, params.block1ColorizeBrightBand3);
-    shader.setUniform3f("block1ColorizeBand4", params.block1ColorizeHueBand4,
+    setParam3f("block1ColorizeBand4", params.block1ColorizeHueBand4,
                         params.block1ColorizeSaturationBand4, params.block1ColorizeBrightBand4);
-    shader.setUniform3f("block1ColorizeBand5", params.block1ColorizeHueBand5,
+    setParam3f("block1ColorizeBand5", params.block1ColorizeHueBand5,
                         params.block1ColorizeSaturationBand5, params.block1ColorizeBrightBand5);
     
     // Block1 filters
-    shader.setUniform1f("block1BlurAmount", params.block1BlurAmount);
-    shader.setUniform1f("block1BlurRadius", params.block1BlurRadius);
-    shader.setUniform1f("block1SharpenAmount", params.block1SharpenAmount);
-    shader.setUniform1f("block1SharpenRadius", params.block1SharpenRadius);
-    shader.setUniform1f("block1FiltersBoost", params.block1FiltersBoost);
-    shader.setUniform1f("block1Dither", params.block1Dither);
-    shader.setUniform1i("block1DitherSwitch", params.block1DitherSwitch);
-    shader.setUniform1i("block1DitherType", params.block1DitherType);
+    setParam1f("block1BlurAmount", params.block1BlurAmount);
+    setParam1f("block1BlurRadius", params.block1BlurRadius);
+    setParam1f("block1SharpenAmount", params.block1SharpenAmount);
+    setParam1f("block1SharpenRadius", params.block1SharpenRadius);
+    setParam1f("block1FiltersBoost", params.block1FiltersBoost);
+    setParam1f("block1Dither", params.block1Dither);
+    setParam1i("block1DitherSwitch", params.block1DitherSwitch);
+    setParam1i("block1DitherType", params.block1DitherType);
     
     // Block2 geo (final stage)
-    shader.setUniform2f("block2XYDisplace", params.block2XDisplace, params.block2YDisplace);
     float z2 = params.block2ZDisplace;
     if (z2 > 1.0f) {
         z2 = pow(2.0f, (z2 - 1.0f) * 8.0f);
         if (params.block2ZDisplace >= 2.0f) z2 = 1000.0f;
     }
-    shader.setUniform1f("block2ZDisplace", z2);
-    shader.setUniform1f("block2Rotate", params.block2Rotate);
-    shader.setUniform4f("block2ShearMatrix", params.block2ShearMatrix1, params.block2ShearMatrix2,
-                        params.block2ShearMatrix3, params.block2ShearMatrix4);
-    shader.setUniform1f("block2KaleidoscopeAmount", params.block2KaleidoscopeAmount);
-    shader.setUniform1f("block2KaleidoscopeSlice", params.block2KaleidoscopeSlice);
+    setParamMatrix3f("block2PreTransform", LayerTransform::flip(params.block2HFlip == 1, params.block2VFlip == 1, size));
+    setParamMatrix3f("block2Transform",
+        LayerTransform::geometry(glm::vec2(params.block2XDisplace, params.block2YDisplace), z2,
+                                 params.block2Rotate, params.block2RotateMode,
+                                 glm::vec4(params.block2ShearMatrix1, params.block2ShearMatrix2,
+                                           params.block2ShearMatrix3, params.block2ShearMatrix4), size));
+    setParam1f("block2KaleidoscopeAmount", params.block2KaleidoscopeAmount);
+    setParam1f("block2KaleidoscopeSlice", params.block2KaleidoscopeSlice);
     
-    shader.setUniform1i("block2HMirror", params.block2HMirror);
-    shader.setUniform1i("block2VMirror", params.block2VMirror);
-    shader.setUniform1i("block2HFlip", params.block2HFlip);
-    shader.setUniform1i("block2VFlip", params.block2VFlip);
-    shader.setUniform1i("block2RotateMode", params.block2RotateMode);
-    shader.setUniform1i("block2GeoOverflow", params.block2GeoOverflow);
+    setParam1i("block2HMirror", params.block2HMirror);
+    setParam1i("block2VMirror", params.block2VMirror);
+    setParam1i("block2GeoOverflow", params.block2GeoOverflow);
     
     // Block2 colorize
-    shader.setUniform1i("block2ColorizeSwitch", params.block2ColorizeSwitch);
-    shader.setUniform1i("block2ColorizeHSB_RGB", params.block2ColorizeHSB_RGB);
-    shader.setUniform3f("block2ColorizeBand1", params.block2ColorizeHueBand1,
+    setParam1i("block2ColorizeSwitch", params.block2ColorizeSwitch);
+    setParam1i("block2ColorizeHSB_RGB", params.block2ColorizeHSB_RGB);
+    setParam3f("block2ColorizeBand1", params.block2ColorizeHueBand1,
                         params.block2ColorizeSaturationBand1, params.block2ColorizeBrightBand1);
-    shader.setUniform3f("block2ColorizeBand2", params.block2ColorizeHueBand2,
+    setParam3f("block2ColorizeBand2", params.block2ColorizeHueBand2,
                         params.block2ColorizeSaturationBand2, params.block2ColorizeBrightBand2);
-    shader.setUniform3f("block2ColorizeBand3", params.block2ColorizeHueBand3,
+    setParam3f("block2ColorizeBand3", params.block2ColorizeHueBand3,
                         params.block2ColorizeSaturationBand3, params.block2ColorizeBrightBand3);
-    shader.setUniform3f("block2ColorizeBand4", params.block2ColorizeHueBand4,
+    setParam3f("block2ColorizeBand4", params.block2ColorizeHueBand4,
                         params.block2ColorizeSaturationBand4, params.block2ColorizeBrightBand4);
-    shader.setUniform3f("block2ColorizeBand5", params.block2ColorizeHueBand5,
+    setParam3f("block2ColorizeBand5", params.block2ColorizeHueBand5,
                         params.block2ColorizeSaturationBand5, params.block2ColorizeBrightBand5);
     
     // Block2 filters
-    shader.setUniform1f("block2BlurAmount", params.block2BlurAmount);
-    shader.setUniform1f("block2BlurRadius", params.block2BlurRadius);
-    shader.setUniform1f("block2SharpenAmount", params.block2SharpenAmount);
-    shader.setUniform1f("block2SharpenRadius", params.block2SharpenRadius);
-    shader.setUniform1f("block2FiltersBoost", params.block2FiltersBoost);
-    shader.setUniform1f("block2Dither", params.block2Dither);
-    shader.setUniform1i("block2DitherSwitch", params.block2DitherSwitch);
-    shader.setUniform1i("block2DitherType", params.block2DitherType);
+    setParam1f("block2BlurAmount", params.block2BlurAmount);
+    setParam1f("block2BlurRadius", params.block2BlurRadius);
+    setParam1f("block2SharpenAmount", params.block2SharpenAmount);
+    setParam1f("block2SharpenRadius", params.block2SharpenRadius);
+    setParam1f("block2FiltersBoost", params.block2FiltersBoost);
+    setParam1f("block2Dither", params.block2Dither);
+    setParam1i("block2DitherSwitch", params.block2DitherSwitch);
+    setParam1i("block2DitherType", params.block2DitherType);
     
     // Matrix mixer
-    shader.setUniform1i("matrixMixType", params.matrixMixType);
-    shader.setUniform1i("matrixMixOverflow", params.matrixMixOverflow);
-    shader.setUniform3f("bgRGBIntoFgRed", params.matrixMixBgRedIntoFgRed,
+    setParam1i("matrixMixType", params.matrixMixType);
+    setParam1i("matrixMixOverflow", params.matrixMixOverflow);
+    setParam3f("bgRGBIntoFgRed", params.matrixMixBgRedIntoFgRed,
                         params.matrixMixBgGreenIntoFgRed, params.matrixMixBgBlueIntoFgRed);
-    shader.setUniform3f("bgRGBIntoFgGreen", params.matrixMixBgRedIntoFgGreen,
+    setParam3f("bgRGBIntoFgGreen", params.matrixMixBgRedIntoFgGreen,
                         params.matrixMixBgGreenIntoFgGreen, params.matrixMixBgBlueIntoFgGreen);
-    shader.setUniform3f("bgRGBIntoFgBlue", params.matrixMixBgRedIntoFgBlue,
+    setParam3f("bgRGBIntoFgBlue", params.matrixMixBgRedIntoFgBlue,
                         params.matrixMixBgGreenIntoFgBlue, params.matrixMixBgBlueIntoFgBlue);
     
     // Final mix and key
-    shader.setUniform1f("finalMixAmount", params.finalMixAmount);
-    shader.setUniform3f("finalKeyValue", params.finalKeyValueRed, params.finalKeyValueGreen, params.finalKeyValueBlue);
-    shader.setUniform1f("finalKeyThreshold", params.finalKeyThreshold);
-    shader.setUniform1f("finalKeySoft", params.finalKeySoft);
-    shader.setUniform1i("finalKeyOrder", params.finalKeyOrder);
-    shader.setUniform1i("finalMixType", params.finalMixType);
-    shader.setUniform1i("finalMixOverflow", params.finalMixOverflow);
+    setParam1f("finalMixAmount", params.finalMixAmount);
+    setParam3f("finalKeyValue", params.finalKeyValueRed, params.finalKeyValueGreen, params.finalKeyValueBlue);
+    setParam1f("finalKeyThreshold", params.finalKeyThreshold);
+    setParam1f("finalKeySoft", params.finalKeySoft);
+    setParam1i("finalKeyOrder", params.finalKeyOrder);
+    setParam1i("finalMixType", params.finalMixType);
+    setParam1i("finalMixOverflow", params.finalMixOverflow);
+    
+    flushParams();
 }
 
 void Block3Shader::setBlock1Texture(ofTexture& tex) {
@@ -193,6 +238,16 @@ void Block3Shader::setBlock2Texture(ofTexture& tex) {
     block2Tex = &tex;
 }
 
+void Block3Shader::setBlurPrepass(ofTexture* block1, ofTexture* block2) {
+    block1PrepassTex = block1;
+    block2PrepassTex = block2;
+}
+
+void Block3Shader::setLayersUsed(bool block1, bool block2) {
+    block1Used = block1;
+    block2Used = block2;
+}
+
 void Block3Shader::initializeModulations() {
     // Block1 geo
     modulations["block1XDisplace"] = ParamModulation();
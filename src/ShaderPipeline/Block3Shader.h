@@ -6,6 +6,8 @@
 
 namespace dragonwaves {
 
+class Block2Shader;
+
 //==============================================================================
 // Parameter modulation info - links a parameter to audio/BPM modulation
 //==============================================================================
@@ -34,6 +36,17 @@ public:
     void setBlock1Texture(ofTexture& tex);
     void setBlock2Texture(ofTexture& tex);
     
+    // BlurPrepass results per layer (nullptr = blur/sharpen per pixel)
+    void setBlurPrepass(ofTexture* block1, ofTexture* block2);
+    
+    // Layers that can reach the output (see PipelineManager::RenderPaths);
+    // the shader skips the fetches of the others
+    void setLayersUsed(bool block1, bool block2);
+    
+    // Evaluate `block2`'s input layer in place of sampling its output
+    // (nullptr = sample block2Output, see PipelineManager::updateBlock2Fusion)
+    void setFusedBlock2(Block2Shader* block2) { fusedBlock2 = block2; }
+    
     // Parameters
     struct Params {
         // Block1 geo (final stage)
@@ -188,6 +201,13 @@ public:
 private:
     ofTexture* block1Tex = nullptr;
     ofTexture* block2Tex = nullptr;
+    ofTexture* block1PrepassTex = nullptr;
+    ofTexture* block2PrepassTex = nullptr;
+    ColorLut block1ColorLut;
+    ColorLut block2ColorLut;
+    bool block1Used = true;
+    bool block2Used = true;
+    Block2Shader* fusedBlock2 = nullptr;
     ofTexture dummyTex;
     
     // Store last computed modulated values for GUI feedback
@@ -0,0 +1,115 @@
+#include "BlurPrepass.h"
+#include "../ShaderLoader.h"
+
+namespace dragonwaves {
+
+// Texture units used by the pre-pass shader
+static const int UNIT_SOURCE = 0;
+static const int UNIT_SOURCE_ARRAY = 1;
+static const int UNIT_HORIZONTAL = 2;
+
+void BlurPrepass::setup() {
+    loaded = ShaderLoader::load(shader, "blurPrepass");
+    if (!loaded) {
+        ofLogError("BlurPrepass") << "Failed to load blurPrepass shader, using per-pixel blur/sharpen";
+    }
+
+    quad.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    quad.addVertex(ofVec3f(0, 0, 0));
+    quad.addTexCoord(ofVec2f(0, 0));
+    quad.addVertex(ofVec3f(1, 0, 0));
+    quad.addTexCoord(ofVec2f(1, 0));
+    quad.addVertex(ofVec3f(1, 1, 0));
+    quad.addTexCoord(ofVec2f(1, 1));
+    quad.addVertex(ofVec3f(0, 1, 0));
+    quad.addTexCoord(ofVec2f(0, 1));
+}
+
+void BlurPrepass::setScale(float s) {
+    scale = ofClamp(s, 0.25f, 1.0f);
+}
+
+ofTexture* BlurPrepass::render(Layer layer, ofTexture& source, const Filter& filter) {
+    if (!source.isAllocated()) return nullptr;
+    return renderPasses(layer, &source, 0, -1, source.getWidth(), source.getHeight(), filter);
+}
+
+ofTexture* BlurPrepass::render(Layer layer, GLuint arrayTexture, int arrayLayer,
+                               int sourceWidth, int sourceHeight, const Filter& filter) {
+    if (arrayTexture == 0 || arrayLayer < 0) return nullptr;
+    return renderPasses(layer, nullptr, arrayTexture, arrayLayer, sourceWidth, sourceHeight, filter);
+}
+
+ofTexture* BlurPrepass::renderPasses(Layer layer, ofTexture* source, GLuint arrayTexture, int arrayLayer,
+                                     int sourceWidth, int sourceHeight, const Filter& filter) {
+    if (!enabled || !loaded || !filter.isActive()) return nullptr;
+    if (sourceWidth < 2 || sourceHeight < 2) return nullptr;
+
+    Target& target = targets[layer];
+    int w = std::max(1, (int)(sourceWidth * scale));
+    int h = std::max(1, (int)(sourceHeight * scale));
+    if (!target.result.isAllocated() || target.result.getWidth() != w || target.result.getHeight() != h) {
+        allocateTarget(target, w, h);
+    }
+
+    // Tap spacing matches blurAndSharpen(): radius in source texels
+    ofVec2f texelScale(1.0f / (sourceWidth - 1), 1.0f / (sourceHeight - 1));
+    ofVec2f blurStep = texelScale * filter.blurRadius;
+    ofVec2f sharpenStep = texelScale * filter.sharpenRadius;
+
+    for (int pass = 0; pass < 2; pass++) {
+        ofFbo& fbo = (pass == 0) ? target.horizontal : target.result;
+
+        fbo.begin();
+        ofViewport(0, 0, w, h);
+        ofSetupScreenOrtho(w, h);
+        shader.begin();
+
+        // Every sampler gets its own unit even when unused, so the 2D and
+        // array samplers never alias unit 0
+        if (source) {
+            shader.setUniformTexture("srcTex", *source, UNIT_SOURCE);
+        } else {
+            shader.setUniform1i("srcTex", UNIT_SOURCE);
+        }
+        shader.setUniformTexture("srcArray", GL_TEXTURE_2D_ARRAY, arrayTexture, UNIT_SOURCE_ARRAY);
+        shader.setUniform1i("srcLayer", source ? -1 : arrayLayer);
+        if (pass == 1) {
+            shader.setUniformTexture("horizontalTex", target.horizontal.getTexture(), UNIT_HORIZONTAL);
+        } else {
+            shader.setUniform1i("horizontalTex", UNIT_HORIZONTAL);
+        }
+        shader.setUniform1i("pass", pass);
+        shader.setUniform2f("blurStep", blurStep.x, blurStep.y);
+        shader.setUniform2f("sharpenStep", sharpenStep.x, sharpenStep.y);
+
+        drawQuad(w, h);
+
+        shader.end();
+        fbo.end();
+        passesThisFrame++;
+    }
+
+    return &target.result.getTexture();
+}
+
+void BlurPrepass::allocateTarget(Target& target, int width, int height) {
+    // Sums of up to 3 taps in the horizontal pass need more than 8 bits
+    ofFboSettings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.internalformat = GL_RGBA16F;
+    settings.useDepth = false;
+    settings.useStencil = false;
+    target.horizontal.allocate(settings);
+    target.result.allocate(settings);
+}
+
+void BlurPrepass::drawQuad(int width, int height) {
+    ofPushMatrix();
+    ofScale(width, height);
+    quad.draw();
+    ofPopMatrix();
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Separable blur/sharpen neighbourhood pre-pass
+//
+// blurAndSharpen() in the block shaders takes 8 blur taps plus 8 sharpen
+// taps (each through rgb2hsb) per pixel, for every layer. This stage
+// computes the same two neighbourhood averages once per layer in two
+// separable passes at reduced resolution:
+//   rgb = average colour of the blur ring, a = average sharpen brightness
+// and the block shader then does a single extra fetch (blurAndSharpenPrepass).
+//
+// Layers whose blur and sharpen amounts are both zero are skipped entirely.
+//==============================================================================
+class BlurPrepass {
+public:
+    enum Layer {
+        CH1 = 0,
+        CH2,
+        FB1,
+        BLOCK2_INPUT,
+        FB2,
+        BLOCK1_OUTPUT,    // Block3's block1 layer
+        BLOCK2_OUTPUT,    // Block3's block2 layer
+        NUM_LAYERS
+    };
+
+    struct Filter {
+        float blurAmount = 0.0f;
+        float blurRadius = 0.0f;
+        float sharpenAmount = 0.0f;
+        float sharpenRadius = 0.0f;
+
+        // Same threshold as the early exit in blurAndSharpen()
+        bool isActive() const { return blurAmount >= 0.001f || sharpenAmount >= 0.001f; }
+    };
+
+    void setup();
+
+    // Pre-pass resolution relative to the source texture (0.25 - 1)
+    void setScale(float scale);
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+
+    // Reset per-frame counters
+    void beginFrame() { passesThisFrame = 0; }
+
+    // Render the pre-pass for a layer from a 2D texture or one layer of a
+    // texture array. Returns the result, or nullptr if the layer was skipped
+    // (disabled, filter inactive, or empty history layer).
+    ofTexture* render(Layer layer, ofTexture& source, const Filter& filter);
+    ofTexture* render(Layer layer, GLuint arrayTexture, int arrayLayer,
+                      int sourceWidth, int sourceHeight, const Filter& filter);
+
+    // Full-screen passes run this frame (2 per active layer)
+    int getPassCount() const { return passesThisFrame; }
+
+private:
+    struct Target {
+        ofFbo horizontal;
+        ofFbo result;
+    };
+
+    ofShader shader;
+    Target targets[NUM_LAYERS];
+    ofMesh quad;
+    float scale = 0.5f;
+    bool enabled = true;
+    bool loaded = false;
+    int passesThisFrame = 0;
+
+    // Source is srcTex when arrayTexture is 0
+    ofTexture* renderPasses(Layer layer, ofTexture* source, GLuint arrayTexture, int arrayLayer,
+                            int sourceWidth, int sourceHeight, const Filter& filter);
+    void allocateTarget(Target& target, int width, int height);
+    void drawQuad(int width, int height);
+};
+
+} // namespace dragonwaves
@@ -0,0 +1,76 @@
+#include "ChannelCache.h"
+
+namespace dragonwaves {
+
+void ChannelCache::setEnabled(bool e) {
+    if (e == enabled) return;
+    enabled = e;
+    invalidate();
+    if (!enabled) fbo.clear();
+    ofLogNotice("ChannelCache") << (enabled ? "Enabled" : "Disabled");
+}
+
+void ChannelCache::allocate(int width, int height) {
+    if (!enabled) return;
+    if (fbo.isAllocated() && fbo.getWidth() == width && fbo.getHeight() == height) return;
+
+    ofFboSettings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.numColorbuffers = CHANNEL_COUNT;
+    // Half float: sharpened colours above 1 survive for the mix overflow modes
+    settings.internalformat = GL_RGBA16F;
+    settings.useDepth = false;
+    settings.useStencil = false;
+    // The mix stage samples texel centres at the same size
+    settings.minFilter = GL_NEAREST;
+    settings.maxFilter = GL_NEAREST;
+    fbo.allocate(settings);
+    invalidate();
+
+    ofLogVerbose("ChannelCache") << "Allocated " << width << "x" << height;
+}
+
+void ChannelCache::invalidate() {
+    for (Slot& slot : slots) {
+        slot.valid = false;
+    }
+}
+
+void ChannelCache::update(Channel channel, bool used, bool frameNew, const std::vector<float>& key) {
+    Slot& slot = slots[channel];
+    bool changed = frameNew || key != slot.key;
+    slot.key = key;
+    slot.used = used;
+    if (changed) slot.valid = false;
+    if (used && !changed) reusable = true;
+}
+
+bool ChannelCache::resolve() {
+    rendersSinceReuse = reusable ? 0 : std::min(rendersSinceReuse + 1, REUSE_WINDOW);
+    reusable = false;
+
+    bool anyUsed = slots[CH1].used || slots[CH2].used;
+    bool wasSplit = split;
+    split = enabled && fbo.isAllocated() && anyUsed && rendersSinceReuse < REUSE_WINDOW;
+    if (split != wasSplit) {
+        ofLogVerbose("ChannelCache") << (split ? "Block1 rendering in two stages" : "Block1 rendering in one pass");
+    }
+
+    // The single pass doesn't write the cache, so nothing in it survives
+    if (!split) invalidate();
+
+    reusedThisFrame = 0;
+    for (const Slot& slot : slots) {
+        if (split && slot.used && slot.valid) reusedThisFrame++;
+    }
+    return split;
+}
+
+void ChannelCache::commit() {
+    for (Slot& slot : slots) {
+        if (slot.used) slot.valid = true;
+    }
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Block1 channel results kept across frames
+//
+// Inputs usually deliver new frames at 25-30 fps while the pipeline renders
+// at 60, yet Block1 re-ran the ch1/ch2 geometry, blur/sharpen and colour
+// chain on the same input every frame. With the cache Block1 renders in two
+// stages: a channel pass writes ch1/ch2 into the textures here, and the
+// feedback/mix pass reads them back. The channel pass only runs for a
+// channel whose source delivered a new frame or whose parameters moved.
+//
+// The textures are half float at Block1's output size, so the mix stage
+// reads exactly what the single pass computed (sharpen can push colours
+// above 1). A cache that isn't reused for REUSE_WINDOW renders in a row
+// (inputs as fast as the pipeline, or animated channel parameters) drops
+// back to the single pass, which is cheaper then.
+//==============================================================================
+class ChannelCache {
+public:
+    enum Channel {
+        CH1 = 0,
+        CH2,
+        CHANNEL_COUNT
+    };
+
+    static constexpr int REUSE_WINDOW = 30;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Match Block1's output FBO (drops the cached results on a change)
+    void allocate(int width, int height);
+    void invalidate();
+
+    // Per Block1 render: describe each channel, then resolve(). `frameNew`
+    // is set if its source delivered a frame since the last render, `key`
+    // holds everything else the channel's result depends on.
+    void update(Channel channel, bool used, bool frameNew, const std::vector<float>& key);
+    // Whether Block1 renders in two stages this frame
+    bool resolve();
+
+    // Channel must be re-rendered into the cache this frame
+    bool isStale(Channel channel) const { return split && slots[channel].used && !slots[channel].valid; }
+    // Call after the channel pass drew the stale channels
+    void commit();
+
+    ofFbo& getFbo() { return fbo; }
+    ofTexture& getTexture(Channel channel) { return fbo.getTexture(channel); }
+
+    bool isSplit() const { return split; }
+    // Used channels read from the cache without being re-rendered this frame
+    int getReusedCount() const { return reusedThisFrame; }
+
+private:
+    struct Slot {
+        std::vector<float> key;
+        bool used = false;
+        bool valid = false;
+    };
+
+    ofFbo fbo;
+    Slot slots[CHANNEL_COUNT];
+    bool enabled = true;
+    bool split = false;
+    bool reusable = false;
+    int rendersSinceReuse = 0;
+    int reusedThisFrame = 0;
+};
+
+} // namespace dragonwaves
@@ -0,0 +1,258 @@
+#include "ColorLut.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+
+namespace dragonwaves {
+
+ColorLut::~ColorLut() {
+    release();
+}
+
+bool ColorLut::isSupported() {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    return true;
+#endif
+}
+
+void ColorLut::setEnabled(bool e) {
+    enabled = e;
+    if (!enabled) active = false;
+}
+
+void ColorLut::release() {
+#ifndef TARGET_OPENGLES
+    // Skip GL calls if the context is already gone (application shutdown)
+    if (textureId != 0 && glfwGetCurrentContext() != nullptr) {
+        glDeleteTextures(1, &textureId);
+    }
+#endif
+    textureId = 0;
+    active = false;
+    bakedValid = false;
+    settledFrames = 0;
+    pendingKey.clear();
+}
+
+bool ColorLut::update(const std::vector<float>& key, const Chain& chain, bool inputInRange) {
+    if (!enabled || textureId == 0) return false;
+
+    if (key != pendingKey) {
+        pendingKey = key;
+        settledFrames = 0;
+    } else if (settledFrames < SETTLE_FRAMES) {
+        settledFrames++;
+    }
+
+    if (bakedValid && key == bakedKey) return active && inputInRange;
+
+    // Parameters moved: analytic until they settle and the LUT catches up
+    active = false;
+    if (settledFrames >= SETTLE_FRAMES) {
+        bake(key, chain);
+    }
+    return active && inputInRange;
+}
+
+bool ColorLut::updateInputChain(const glm::vec3& hsbAttenuate, bool hueInvert, bool saturationInvert,
+                                bool brightInvert, bool solarize, bool rgbInvert, float sharpenAmount) {
+    std::vector<float> key = {
+        hsbAttenuate.x, hsbAttenuate.y, hsbAttenuate.z,
+        (float)hueInvert, (float)saturationInvert, (float)brightInvert, (float)solarize, (float)rgbInvert
+    };
+    return update(key, [=](const glm::vec3& rgb) {
+        glm::vec3 hsb = glm::pow(rgb2hsb(rgb), hsbAttenuate);
+        if (hueInvert) hsb.x = 1.0f - hsb.x;
+        if (saturationInvert) hsb.y = 1.0f - hsb.y;
+        if (brightInvert) hsb.z = 1.0f - hsb.z;
+        hsb.x = fract(hsb.x);
+        if (solarize) hsb.z = ColorLut::solarize(hsb.z);
+        glm::vec3 out = hsb2rgb(hsb);
+        return rgbInvert ? 1.0f - out : out;
+    }, isInputInRange(sharpenAmount));
+}
+
+bool ColorLut::updateFeedbackChain(float hueShaper, const glm::vec3& hsbOffset, const glm::vec3& hsbAttenuate,
+                                   const glm::vec3& hsbPowmap, bool hueInvert, bool saturationInvert,
+                                   bool brightInvert, float sharpenAmount) {
+    std::vector<float> key = {
+        hueShaper,
+        hsbOffset.x, hsbOffset.y, hsbOffset.z,
+        hsbAttenuate.x, hsbAttenuate.y, hsbAttenuate.z,
+        hsbPowmap.x, hsbPowmap.y, hsbPowmap.z,
+        (float)hueInvert, (float)saturationInvert, (float)brightInvert
+    };
+    return update(key, [=](const glm::vec3& rgb) {
+        glm::vec3 hsb = rgb2hsb(rgb);
+        hsb.x = ColorLut::hueShaper(hsb.x, hueShaper);
+        hsb = glm::pow((hsb + hsbOffset) * hsbAttenuate, hsbPowmap);
+        if (hueInvert) hsb.x = 1.0f - hsb.x;
+        if (saturationInvert) hsb.y = 1.0f - hsb.y;
+        if (brightInvert) hsb.z = 1.0f - hsb.z;
+        hsb.x = fract(hsb.x);
+        hsb.y = ofClamp(hsb.y, 0.0f, 1.0f);
+        hsb.z = ofClamp(hsb.z, 0.0f, 1.0f);
+        return hsb2rgb(hsb);
+    }, isInputInRange(sharpenAmount));
+}
+
+bool ColorLut::updateColorize(const glm::vec3 bands[5], bool rgbMode, float sharpenAmount) {
+    std::vector<float> key = { (float)rgbMode };
+    for (int i = 0; i < 5; i++) {
+        key.push_back(bands[i].x);
+        key.push_back(bands[i].y);
+        key.push_back(bands[i].z);
+    }
+    glm::vec3 b[5] = { bands[0], bands[1], bands[2], bands[3], bands[4] };
+    return update(key, [=](const glm::vec3& rgb) {
+        float brightness = rgb2hsb(rgb).z;
+        glm::vec3 colorized[5];
+        for (int i = 0; i < 5; i++) {
+            colorized[i] = rgbMode ? b[i] + rgb : hsb2rgb(b[i] + glm::vec3(0.0f, 0.0f, brightness));
+        }
+        // Blend between the two bands around the brightness
+        int band = std::min(3, (int)(brightness * 4.0f));
+        float t = ofClamp((brightness - band * 0.25f) * 4.0f, 0.0f, 1.0f);
+        return glm::mix(colorized[band], colorized[band + 1], t);
+    }, isInputInRange(sharpenAmount));
+}
+
+void ColorLut::setup() {
+#ifndef TARGET_OPENGLES
+    if (textureId != 0) return;
+
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_3D, textureId);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Half float: outputs above 1 survive for the mix overflow modes
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, SIZE, SIZE, SIZE, 0, GL_RGB, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    upload(std::vector<float>());
+#endif
+}
+
+void ColorLut::bake(const std::vector<float>& key, const Chain& chain) {
+    std::vector<float> nodes(SIZE * SIZE * SIZE * 3);
+    float step = 1.0f / (SIZE - 1);
+    size_t i = 0;
+    for (int b = 0; b < SIZE; b++) {
+        for (int g = 0; g < SIZE; g++) {
+            for (int r = 0; r < SIZE; r++) {
+                glm::vec3 out = chain(glm::vec3(r * step, g * step, b * step));
+                nodes[i++] = out.r;
+                nodes[i++] = out.g;
+                nodes[i++] = out.b;
+            }
+        }
+    }
+
+    upload(nodes);
+    measureError(nodes, chain);
+
+    bakedKey = key;
+    bakedValid = true;
+    bakeCount++;
+
+    // NaN errors (undefined pow() and the like) also fail this test
+    active = maxError <= MAX_ERROR_LEVELS && meanError <= MAX_MEAN_ERROR_LEVELS;
+    ofLogVerbose("ColorLut") << "Baked LUT: max error " << maxError << ", mean " << meanError
+                             << " (8-bit levels)" << (active ? "" : ", using the analytic chain");
+}
+
+void ColorLut::upload(const std::vector<float>& nodes) {
+#ifndef TARGET_OPENGLES
+    std::vector<float> identity;
+    const float* data = nodes.data();
+    if (nodes.empty()) {
+        identity.resize(SIZE * SIZE * SIZE * 3);
+        float step = 1.0f / (SIZE - 1);
+        size_t i = 0;
+        for (int b = 0; b < SIZE; b++) {
+            for (int g = 0; g < SIZE; g++) {
+                for (int r = 0; r < SIZE; r++) {
+                    identity[i++] = r * step;
+                    identity[i++] = g * step;
+                    identity[i++] = b * step;
+                }
+            }
+        }
+        data = identity.data();
+    }
+
+    glBindTexture(GL_TEXTURE_3D, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, SIZE, SIZE, SIZE, GL_RGB, GL_FLOAT, data);
+    glBindTexture(GL_TEXTURE_3D, 0);
+#endif
+}
+
+void ColorLut::measureError(const std::vector<float>& nodes, const Chain& chain) {
+    // Fixed pseudo-random sample colours, so reports are comparable between bakes
+    uint32_t seed = 0x9e3779b9u;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) * (1.0f / 16777216.0f);
+    };
+
+    float maxDiff = 0.0f;
+    double sum = 0.0;
+    for (int i = 0; i < ERROR_SAMPLES; i++) {
+        glm::vec3 c(next(), next(), next());
+        glm::vec3 d = glm::abs(lookup(nodes, c) - chain(c));
+        float diff = std::max(d.x, std::max(d.y, d.z));
+        if (glm::any(glm::isnan(d))) diff = std::numeric_limits<float>::infinity();
+        maxDiff = std::max(maxDiff, diff);
+        sum += diff;
+    }
+
+    maxError = maxDiff * 255.0f;
+    meanError = (float)(sum / ERROR_SAMPLES) * 255.0f;
+}
+
+glm::vec3 ColorLut::lookup(const std::vector<float>& nodes, const glm::vec3& c) {
+    glm::vec3 p = glm::clamp(c, 0.0f, 1.0f) * float(SIZE - 1);
+    glm::ivec3 base = glm::min(glm::ivec3(p), glm::ivec3(SIZE - 2));
+    glm::vec3 f = p - glm::vec3(base);
+
+    glm::vec3 result(0.0f);
+    for (int corner = 0; corner < 8; corner++) {
+        int dx = corner & 1;
+        int dy = (corner >> 1) & 1;
+        int dz = (corner >> 2) & 1;
+        float w = (dx ? f.x : 1.0f - f.x) * (dy ? f.y : 1.0f - f.y) * (dz ? f.z : 1.0f - f.z);
+        const float* node = &nodes[(((base.z + dz) * SIZE + base.y + dy) * SIZE + base.x + dx) * 3];
+        result += w * glm::vec3(node[0], node[1], node[2]);
+    }
+    return result;
+}
+
+//==============================================================================
+// Colour helpers, matching the block shaders
+//==============================================================================
+glm::vec3 ColorLut::rgb2hsb(const glm::vec3& c) {
+    const glm::vec4 K(0.0f, -1.0f / 3.0f, 2.0f / 3.0f, -1.0f);
+    glm::vec4 p = (c.g >= c.b) ? glm::vec4(c.g, c.b, K.x, K.y) : glm::vec4(c.b, c.g, K.w, K.z);
+    glm::vec4 q = (c.r >= p.x) ? glm::vec4(c.r, p.y, p.z, p.x) : glm::vec4(p.x, p.y, p.w, c.r);
+
+    float d = q.x - std::min(q.w, q.y);
+    float e = 1.0e-10f;
+    return glm::vec3(std::abs(q.z + (q.w - q.y) / (6.0f * d + e)), d / (q.x + e), q.x);
+}
+
+glm::vec3 ColorLut::hsb2rgb(const glm::vec3& c) {
+    glm::vec3 p(std::abs(fract(c.x + 1.0f) * 6.0f - 3.0f),
+                std::abs(fract(c.x + 2.0f / 3.0f) * 6.0f - 3.0f),
+                std::abs(fract(c.x + 1.0f / 3.0f) * 6.0f - 3.0f));
+    return c.z * glm::mix(glm::vec3(1.0f), glm::clamp(p - 1.0f, 0.0f, 1.0f), c.y);
+}
+
+float ColorLut::hueShaper(float hue, float shaper) {
+    return fract(std::abs(hue + shaper * std::sin(hue * 0.3184713f)));
+}
+
+} // namespace dragonwaves
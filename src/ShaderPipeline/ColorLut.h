@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ofMain.h"
+#include <functional>
+
+namespace dragonwaves {
+
+//==============================================================================
+// A layer's pointwise colour chain baked into a 3D LUT
+//
+// The HSB attenuate/powmap/hue shaper/invert/solarize chains and Block3's
+// colorize only depend on the input colour, so once their parameters settle
+// the chain is evaluated on the CPU at every node of a SIZE^3 grid and the
+// shader replaces rgb2hsb -> math -> hsb2rgb with one trilinear lookup
+// (colorLut() in the block shaders).
+//
+// After each bake the LUT is checked against the analytic chain on a fixed
+// set of sample colours. Chains a LUT can't represent (discontinuities such
+// as hueShaper wrapping, undefined pow() of negative values) show up as a
+// large error, and the layer stays on the analytic path instead.
+//
+// Posterize is a step function and stays in the shader after the lookup.
+// The LUT only covers inputs in 0-1: the layer's sharpen (and its boost)
+// can push brightness past 1, so while it is on the layer stays analytic
+// rather than clipping the overshoot.
+//==============================================================================
+class ColorLut {
+public:
+    // Input colour -> output colour (unclamped; outputs above 1 are kept)
+    typedef std::function<glm::vec3(const glm::vec3&)> Chain;
+
+    static const int SIZE = 32;
+
+    ColorLut() = default;
+    ~ColorLut();
+
+    ColorLut(const ColorLut&) = delete;
+    ColorLut& operator=(const ColorLut&) = delete;
+
+    static bool isSupported();
+
+    // Create the texture (identity until the first bake)
+    void setup();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Call once per frame with every parameter the chain depends on. Bakes
+    // once the key has held still for SETTLE_FRAMES frames (animated
+    // parameters stay analytic rather than re-baking every frame). Returns
+    // true if the shader should sample the LUT this frame; never while
+    // `inputInRange` is false (inputs can leave 0-1, see above).
+    bool update(const std::vector<float>& key, const Chain& chain, bool inputInRange);
+
+    // update() for the block shaders' chains (mirroring the GLSL, so keep
+    // them in sync with it):
+    //   input: ch1/ch2/block2Input - attenuate (as a power), inverts,
+    //          solarize, RGB invert
+    //   feedback: fb1/fb2 - hue shaper, offset, attenuate, powmap, inverts
+    //   colorize: Block3's 5-band colorize (HSB or RGB bands)
+    // `sharpenAmount` is the layer's, which decides whether inputs stay in 0-1.
+    bool updateInputChain(const glm::vec3& hsbAttenuate, bool hueInvert, bool saturationInvert,
+                          bool brightInvert, bool solarize, bool rgbInvert, float sharpenAmount);
+    bool updateFeedbackChain(float hueShaper, const glm::vec3& hsbOffset, const glm::vec3& hsbAttenuate,
+                             const glm::vec3& hsbPowmap, bool hueInvert, bool saturationInvert,
+                             bool brightInvert, float sharpenAmount);
+    bool updateColorize(const glm::vec3 bands[5], bool rgbMode, float sharpenAmount);
+
+    // blurAndSharpen() in the shaders leaves colours in 0-1 unless sharpen is on
+    static bool isInputInRange(float sharpenAmount) { return sharpenAmount < 0.001f; }
+
+    // 3D texture for the layer's sampler (0 if unsupported)
+    GLuint getTextureId() const { return textureId; }
+
+    bool isActive() const { return active; }
+
+    // Error of the last bake against the analytic chain, in 8-bit levels
+    float getMaxError() const { return maxError; }
+    float getMeanError() const { return meanError; }
+    int getBakeCount() const { return bakeCount; }
+
+    void release();
+
+    // CPU versions of the block shaders' colour helpers
+    static glm::vec3 rgb2hsb(const glm::vec3& c);
+    static glm::vec3 hsb2rgb(const glm::vec3& c);
+    static float hueShaper(float hue, float shaper);
+    static float solarize(float bright) { return bright > 0.5f ? 1.0f - bright : bright; }
+    static float fract(float x) { return x - std::floor(x); }
+
+private:
+    static const int SETTLE_FRAMES = 8;
+    static const int ERROR_SAMPLES = 4096;
+
+    // Largest error (8-bit levels) accepted before falling back
+    static constexpr float MAX_ERROR_LEVELS = 3.0f;
+    static constexpr float MAX_MEAN_ERROR_LEVELS = 0.25f;
+
+    GLuint textureId = 0;
+    bool enabled = true;
+    bool active = false;
+
+    std::vector<float> pendingKey;
+    int settledFrames = 0;
+    std::vector<float> bakedKey;
+    bool bakedValid = false;
+
+    float maxError = 0.0f;
+    float meanError = 0.0f;
+    int bakeCount = 0;
+
+    void bake(const std::vector<float>& key, const Chain& chain);
+    void upload(const std::vector<float>& nodes);
+    void measureError(const std::vector<float>& nodes, const Chain& chain);
+
+    // Trilinear lookup matching the GPU's (nodes at texel centres)
+    static glm::vec3 lookup(const std::vector<float>& nodes, const glm::vec3& c);
+};
+
+} // namespace dragonwaves
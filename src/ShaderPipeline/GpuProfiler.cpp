@@ -0,0 +1,164 @@
+#include "GpuProfiler.h"
+#include "GpuTimer.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+
+namespace dragonwaves {
+
+GpuProfiler::~GpuProfiler() {
+    release();
+}
+
+const char* GpuProfiler::getStageName(Stage stage) {
+    switch (stage) {
+        case INPUT: return "input";
+        case BLOCK1: return "block1";
+        case BLOCK2: return "block2";
+        case BLOCK3: return "block3";
+        case HISTORY: return "history";
+        case READBACK: return "readback";
+        default: return "unknown";
+    }
+}
+
+void GpuProfiler::setEnabled(bool e) {
+    if (e == enabled) return;
+    enabled = e;
+    if (!enabled) release();
+    ofLogNotice("GpuProfiler") << (enabled ? "Enabled" : "Disabled");
+}
+
+void GpuProfiler::release() {
+#ifndef TARGET_OPENGLES
+    // Skip GL calls if the context is already gone (application shutdown)
+    bool hasContext = glfwGetCurrentContext() != nullptr;
+    for (Frame& frame : frames) {
+        if (hasContext && !frame.queries.empty()) {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+        frame.queries.clear();
+        frame.intervals.clear();
+        frame.used = 0;
+        frame.pending = false;
+    }
+#endif
+    writeFrame = readFrame = 0;
+    recording = false;
+}
+
+void GpuProfiler::beginFrame() {
+    recording = false;
+    if (!enabled) return;
+    if (!checked) {
+        supported = GpuTimer::isSupported();
+        checked = true;
+        if (!supported) ofLogNotice("GpuProfiler") << "Timer queries not available, stage timings disabled";
+    }
+    if (!supported) return;
+
+    poll();
+
+    // Ring full: leave this frame unmeasured rather than wait for the GPU
+    Frame& frame = frames[writeFrame];
+    if (frame.pending) return;
+
+    frame.used = 0;
+    frame.intervals.clear();
+    for (int s = 0; s < STAGE_COUNT; s++) openQuery[s] = -1;
+    recording = true;
+}
+
+void GpuProfiler::endFrame() {
+    if (!recording) return;
+    recording = false;
+
+    Frame& frame = frames[writeFrame];
+    if (frame.intervals.empty()) return;
+    frame.pending = true;
+    writeFrame = (writeFrame + 1) % RING_SIZE;
+}
+
+void GpuProfiler::begin(Stage stage) {
+    if (!recording || openQuery[stage] >= 0) return;
+    openQuery[stage] = stamp();
+}
+
+void GpuProfiler::end(Stage stage) {
+    if (!recording || openQuery[stage] < 0) return;
+    Interval interval;
+    interval.stage = stage;
+    interval.beginQuery = openQuery[stage];
+    interval.endQuery = stamp();
+    frames[writeFrame].intervals.push_back(interval);
+    openQuery[stage] = -1;
+}
+
+int GpuProfiler::stamp() {
+    Frame& frame = frames[writeFrame];
+#ifndef TARGET_OPENGLES
+    if (frame.used == (int)frame.queries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+#endif
+    return frame.used++;
+}
+
+void GpuProfiler::poll() {
+#ifndef TARGET_OPENGLES
+    while (frames[readFrame].pending) {
+        Frame& frame = frames[readFrame];
+
+        for (int i = 0; i < frame.used; i++) {
+            GLint available = 0;
+            glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+        }
+
+        std::vector<GLuint64> times(frame.used);
+        for (int i = 0; i < frame.used; i++) {
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+        }
+
+        double totalMs[STAGE_COUNT] = {};
+        bool measured[STAGE_COUNT] = {};
+        for (const Interval& interval : frame.intervals) {
+            GLuint64 b = times[interval.beginQuery];
+            GLuint64 e = times[interval.endQuery];
+            totalMs[interval.stage] += (e > b ? e - b : 0) / 1.0e6;
+            measured[interval.stage] = true;
+        }
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            if (measured[s]) addSample(s, (float)totalMs[s]);
+        }
+
+        frame.pending = false;
+        readFrame = (readFrame + 1) % RING_SIZE;
+    }
+#endif
+}
+
+void GpuProfiler::addSample(int stage, float ms) {
+    std::vector<float>& window = samples[stage];
+    if ((int)window.size() < WINDOW) {
+        window.push_back(ms);
+    } else {
+        window[sampleIndex[stage]] = ms;
+        sampleIndex[stage] = (sampleIndex[stage] + 1) % WINDOW;
+    }
+
+    std::vector<float> sorted = window;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (float v : sorted) sum += v;
+
+    Stats& s = stats[stage];
+    s.lastMs = ms;
+    s.minMs = sorted.front();
+    s.avgMs = (float)(sum / sorted.size());
+    s.p99Ms = sorted[std::min(sorted.size() - 1, (size_t)std::ceil(sorted.size() * 0.99) - 1)];
+    s.samples = (int)sorted.size();
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// GPU time per pipeline stage
+//
+// Every stage section is bracketed by a pair of GL_TIMESTAMP queries.
+// Timestamps (unlike GL_TIME_ELAPSED) may enclose other timer queries, so a
+// stage can wrap a block including its own GpuTimer. A stage entered several
+// times in a frame (e.g. both feedback histories) counts the sum.
+//
+// Queries are grouped per frame in a small ring and read back only once the
+// driver has them, so profiling never stalls the render loop; if the GPU
+// falls RING_SIZE frames behind, the frame goes unmeasured. Each stage keeps
+// the last WINDOW results for min/avg/p99. No-op where timer queries aren't
+// available.
+//==============================================================================
+class GpuProfiler {
+public:
+    enum Stage {
+        INPUT = 0,      // InputSlot scaling into the input FBOs
+        BLOCK1,         // Block1 including its pre-passes, channel pass and warp bakes
+        BLOCK2,
+        BLOCK3,
+        HISTORY,        // DelayBuffer tier demotion and history copies
+        READBACK,       // FrameBus scale draws and readback starts
+        STAGE_COUNT
+    };
+
+    struct Stats {
+        float lastMs = 0.0f;
+        float minMs = 0.0f;
+        float avgMs = 0.0f;
+        float p99Ms = 0.0f;
+        int samples = 0;    // frames in the window
+    };
+
+    static constexpr int RING_SIZE = 4;
+    static constexpr int WINDOW = 240;
+
+    static GpuProfiler& getInstance() {
+        static GpuProfiler instance;
+        return instance;
+    }
+
+    // Lower-case name, also the OSC address segment (/gravity/stats/gpu/<name>/...)
+    static const char* getStageName(Stage stage);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Bracket each frame's GPU work; beginFrame() also collects finished frames
+    void beginFrame();
+    void endFrame();
+
+    // Stage sections, only recorded between beginFrame() and endFrame()
+    void begin(Stage stage);
+    void end(Stage stage);
+
+    const Stats& getStats(Stage stage) const { return stats[stage]; }
+
+    void release();
+
+private:
+    struct Interval {
+        int stage;
+        int beginQuery;
+        int endQuery;
+    };
+
+    struct Frame {
+        std::vector<GLuint> queries;    // grows to the most any frame used
+        int used = 0;
+        std::vector<Interval> intervals;
+        bool pending = false;
+    };
+
+    GpuProfiler() = default;
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    bool enabled = true;
+    bool supported = false;
+    bool checked = false;
+    bool recording = false;
+
+    Frame frames[RING_SIZE];
+    int writeFrame = 0;
+    int readFrame = 0;
+    int openQuery[STAGE_COUNT] = {};
+
+    // Per stage: ring of the last WINDOW results
+    std::vector<float> samples[STAGE_COUNT];
+    int sampleIndex[STAGE_COUNT] = {};
+    Stats stats[STAGE_COUNT];
+
+    int stamp();
+    void poll();
+    void addSample(int stage, float ms);
+};
+
+} // namespace dragonwaves
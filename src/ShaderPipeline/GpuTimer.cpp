@@ -0,0 +1,94 @@
+#include "GpuTimer.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+
+namespace dragonwaves {
+
+GpuTimer::~GpuTimer() {
+    release();
+}
+
+bool GpuTimer::isSupported() {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    if (!ofGetGLRenderer()) return false;
+    int major = ofGetGLRenderer()->getGLVersionMajor();
+    int minor = ofGetGLRenderer()->getGLVersionMinor();
+    return major > 3 || (major == 3 && minor >= 3) || ofGLCheckExtension("GL_ARB_timer_query");
+#endif
+}
+
+void GpuTimer::release() {
+#ifndef TARGET_OPENGLES
+    // Skip GL calls if the context is already gone (application shutdown)
+    if (allocated && glfwGetCurrentContext() != nullptr) {
+        glDeleteQueries(RING_SIZE, queries);
+    }
+#endif
+    allocated = false;
+    running = false;
+    writeIndex = readIndex = 0;
+    for (int i = 0; i < RING_SIZE; i++) inFlight[i] = false;
+}
+
+void GpuTimer::begin(int tag) {
+#ifndef TARGET_OPENGLES
+    if (!allocated) {
+        if (!isSupported()) return;
+        glGenQueries(RING_SIZE, queries);
+        allocated = true;
+    }
+
+    // Ring full: drop this sample rather than wait for the GPU
+    if (inFlight[writeIndex]) return;
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[writeIndex]);
+    tags[writeIndex] = tag;
+    running = true;
+#endif
+}
+
+void GpuTimer::end() {
+#ifndef TARGET_OPENGLES
+    if (!running) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    inFlight[writeIndex] = true;
+    writeIndex = (writeIndex + 1) % RING_SIZE;
+    running = false;
+#endif
+}
+
+bool GpuTimer::poll() {
+    bool updated = false;
+#ifndef TARGET_OPENGLES
+    while (allocated && inFlight[readIndex]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[readIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[readIndex], GL_QUERY_RESULT, &elapsed);
+        inFlight[readIndex] = false;
+
+        lastMs = elapsed / 1.0e6f;
+        lastTag = ofClamp(tags[readIndex], 0, MAX_TAGS - 1);
+        if (hasAverage[lastTag]) {
+            averageMs[lastTag] += (lastMs - averageMs[lastTag]) * SMOOTHING;
+        } else {
+            averageMs[lastTag] = lastMs;
+            hasAverage[lastTag] = true;
+        }
+
+        readIndex = (readIndex + 1) % RING_SIZE;
+        updated = true;
+    }
+#endif
+    return updated;
+}
+
+float GpuTimer::getAverageMs(int tag) const {
+    if (tag < 0 || tag >= MAX_TAGS || !hasAverage[tag]) return 0.0f;
+    return averageMs[tag];
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// GL_TIME_ELAPSED query around a GPU pass
+//
+// Queries live in a small ring and are only read back once the driver says
+// the result is available, so timing never stalls the render loop. Results
+// arrive a few frames late. No-op where timer queries aren't available.
+//==============================================================================
+class GpuTimer {
+public:
+    static constexpr int RING_SIZE = 4;
+
+    GpuTimer() = default;
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // `tag` is carried through to the result so callers can split timings
+    // (e.g. generic vs specialized program)
+    void begin(int tag = 0);
+    void end();
+
+    // Collect finished queries; returns true if a new result arrived
+    bool poll();
+
+    // Last result and exponential moving average per tag, in milliseconds
+    float getLastMs() const { return lastMs; }
+    int getLastTag() const { return lastTag; }
+    float getAverageMs(int tag = 0) const;
+
+    void release();
+
+    // Timer queries (elapsed and timestamp) are core since GL 3.3
+    static bool isSupported();
+
+private:
+    static constexpr int MAX_TAGS = 2;
+    static constexpr float SMOOTHING = 0.05f;
+
+    GLuint queries[RING_SIZE] = {};
+    int tags[RING_SIZE] = {};
+    bool inFlight[RING_SIZE] = {};
+    int writeIndex = 0;
+    int readIndex = 0;
+    bool running = false;
+    bool allocated = false;
+
+    float lastMs = 0.0f;
+    int lastTag = 0;
+    float averageMs[MAX_TAGS] = {};
+    bool hasAverage[MAX_TAGS] = {};
+};
+
+} // namespace dragonwaves
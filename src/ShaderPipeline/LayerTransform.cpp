@@ -0,0 +1,64 @@
+#include "LayerTransform.h"
+
+namespace dragonwaves {
+
+glm::mat3 LayerTransform::about(const glm::mat2& linear, const glm::vec2& center) {
+    glm::mat3 m(1.0f);
+    m[0] = glm::vec3(linear[0], 0.0f);
+    m[1] = glm::vec3(linear[1], 0.0f);
+    m[2] = glm::vec3(center - linear * center, 1.0f);
+    return m;
+}
+
+glm::mat3 LayerTransform::translate(const glm::vec2& offset) {
+    glm::mat3 m(1.0f);
+    m[2] = glm::vec3(offset, 1.0f);
+    return m;
+}
+
+glm::mat3 LayerTransform::flip(bool horizontal, bool vertical, const glm::vec2& size) {
+    glm::mat2 linear(horizontal ? -1.0f : 1.0f, 0.0f,
+                     0.0f, vertical ? -1.0f : 1.0f);
+    return about(linear, size * 0.5f);
+}
+
+glm::mat3 LayerTransform::inputMapping(float aspectRatio, float cribX, float scale,
+                                       bool hdAspectOn, const glm::vec2& hdAspectFix,
+                                       const glm::vec2& size) {
+    if (hdAspectOn) {
+        return glm::mat3(glm::vec3(hdAspectFix.x, 0.0f, 0.0f),
+                         glm::vec3(0.0f, hdAspectFix.y, 0.0f),
+                         glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    glm::mat3 aspect(1.0f);
+    aspect[0][0] = aspectRatio;
+    return about(glm::mat2(scale), size * 0.5f) * translate(glm::vec2(-cribX, 0.0f)) * aspect;
+}
+
+glm::mat3 LayerTransform::rotate(float theta, int mode, const glm::vec2& size) {
+    float c = cos(theta);
+    float s = sin(theta);
+    glm::mat2 rotation(c, s, -s, c);
+
+    if (mode == 1) {
+        glm::mat2 stretch(size.x, 0.0f, 0.0f, size.y);
+        rotation = stretch * rotation * glm::inverse(stretch);
+    }
+    return about(rotation, size * 0.5f);
+}
+
+glm::mat3 LayerTransform::shear(const glm::vec4& m, const glm::vec2& size) {
+    // Columns: x' = a*x + b*y, y' = c*x' + d*y
+    glm::mat2 linear(m.x, m.z * m.x,
+                     m.y, m.z * m.y + m.w);
+    return about(linear, size * 0.5f);
+}
+
+glm::mat3 LayerTransform::geometry(const glm::vec2& displace, float zoom, float theta, int rotateMode,
+                                   const glm::vec4& shearMatrix, const glm::vec2& size) {
+    glm::mat3 zoomed = about(glm::mat2(zoom), size * 0.5f);
+    return shear(shearMatrix, size) * rotate(theta, rotateMode, size) * zoomed * translate(displace);
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Affine coordinate transforms for a layer, composed on the CPU
+//
+// Each layer maps an output pixel to a source coordinate (in pixels):
+//   input mapping, flips -> mirror -> kaleidoscope -> displace, zoom, rotate, shear
+// Mirror and kaleidoscope are not affine and stay in the shader. Everything
+// before them is composed into the layer's pre transform and everything
+// after into its transform, so the shader does one mat3 multiply for each
+// instead of rebuilding them (including sin/cos of the rotation) per pixel.
+//
+// Shaders apply a transform as (m * vec3(coord, 1.0)).xy. The functions
+// reproduce the shaders' original math, including its quirks.
+//==============================================================================
+class LayerTransform {
+public:
+    // x -> size.x - x and/or y -> size.y - y
+    static glm::mat3 flip(bool horizontal, bool vertical, const glm::vec2& size);
+
+    // Input aspect/crib/scale correction, or the HD aspect fix when
+    // hdAspectOn (which replaces it)
+    static glm::mat3 inputMapping(float aspectRatio, float cribX, float scale,
+                                  bool hdAspectOn, const glm::vec2& hdAspectFix,
+                                  const glm::vec2& size);
+
+    // rotate() in the shaders: mode 0 rotates in pixel space, mode 1 in
+    // normalized space (stretched to the frame's aspect)
+    static glm::mat3 rotate(float theta, int mode, const glm::vec2& size);
+
+    // shear() in the shaders. It updates x before computing y from it, so the
+    // effective matrix is [a b; c*a c*b+d] rather than [a b; c d].
+    static glm::mat3 shear(const glm::vec4& shearMatrix, const glm::vec2& size);
+
+    // Displace, zoom about the centre, rotate, then shear
+    static glm::mat3 geometry(const glm::vec2& displace, float zoom, float theta, int rotateMode,
+                              const glm::vec4& shearMatrix, const glm::vec2& size);
+
+    static glm::mat3 translate(const glm::vec2& offset);
+
+private:
+    // p -> linear * (p - center) + center
+    static glm::mat3 about(const glm::mat2& linear, const glm::vec2& center);
+};
+
+} // namespace dragonwaves
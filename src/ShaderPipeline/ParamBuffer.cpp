@@ -0,0 +1,270 @@
+#include "ParamBuffer.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
+
+namespace dragonwaves {
+
+// Binding point 0 is left to anything else that uses uniform buffers
+GLuint ParamBuffer::nextBindingPoint = 1;
+
+ParamBuffer::ParamBuffer()
+    : bindingPoint(nextBindingPoint++) {
+}
+
+ParamBuffer::~ParamBuffer() {
+    release();
+}
+
+void ParamBuffer::release() {
+    // Skip GL calls if the context is already gone (application shutdown)
+    if (bufferId != 0 && glfwGetCurrentContext() != nullptr) {
+        glDeleteBuffers(1, &bufferId);
+    }
+    bufferId = 0;
+    staging.clear();
+    uploaded.clear();
+    uploadedValid = false;
+    offsets.clear();
+    intMembers.clear();
+    switchKey.clear();
+    pending.clear();
+}
+
+bool ParamBuffer::setup(ofShader& s, const std::string& name) {
+    release();
+    shader = &s;
+    blockName = name;
+
+#ifdef TARGET_OPENGLES
+    ofLogNotice("ParamBuffer") << blockName << ": no uniform buffers on GLES, using plain uniforms";
+    return false;
+#else
+    if (ofGetGLRenderer()) {
+        int major = ofGetGLRenderer()->getGLVersionMajor();
+        int minor = ofGetGLRenderer()->getGLVersionMinor();
+        bool core = major > 3 || (major == 3 && minor >= 1);
+        if (!core && !ofGLCheckExtension("GL_ARB_uniform_buffer_object")) {
+            ofLogNotice("ParamBuffer") << blockName << ": GL < 3.1 without GL_ARB_uniform_buffer_object, using plain uniforms";
+            return false;
+        }
+    }
+
+    GLuint program = shader->getProgram();
+    GLuint blockIndex = glGetUniformBlockIndex(program, blockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX) {
+        ofLogNotice("ParamBuffer") << blockName << " not found in shader, using plain uniforms";
+        return false;
+    }
+
+    GLint blockSize = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    glUniformBlockBinding(program, blockIndex, bindingPoint);
+
+    staging.assign(blockSize, 0);
+    findIntMembers(program, blockIndex);
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferData(GL_UNIFORM_BUFFER, blockSize, staging.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    ofLogNotice("ParamBuffer") << blockName << ": " << blockSize << " byte uniform buffer on binding " << bindingPoint
+                               << ", " << intMembers.size() << " switches";
+    return true;
+#endif
+}
+
+void ParamBuffer::findIntMembers(GLuint program, GLuint blockIndex) {
+#ifndef TARGET_OPENGLES
+    GLint count = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+    if (count <= 0) return;
+
+    std::vector<GLint> indices(count);
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+    std::vector<GLuint> uindices(indices.begin(), indices.end());
+    std::vector<GLint> types(count), memberOffsets(count);
+    glGetActiveUniformsiv(program, count, uindices.data(), GL_UNIFORM_TYPE, types.data());
+    glGetActiveUniformsiv(program, count, uindices.data(), GL_UNIFORM_OFFSET, memberOffsets.data());
+
+    char nameBuffer[256];
+    for (int i = 0; i < count; i++) {
+        if (types[i] != GL_INT) continue;
+        GLsizei length = 0;
+        glGetActiveUniformName(program, uindices[i], sizeof(nameBuffer), &length, nameBuffer);
+        intMembers.push_back({ std::string(nameBuffer, length), memberOffsets[i] });
+    }
+
+    // Declaration order, so keys don't depend on the driver's index order
+    std::sort(intMembers.begin(), intMembers.end(),
+              [](const IntMember& a, const IntMember& b) { return a.offset < b.offset; });
+#endif
+}
+
+void ParamBuffer::attach(ofShader& program) {
+#ifndef TARGET_OPENGLES
+    if (!isActive()) return;
+    GLuint blockIndex = glGetUniformBlockIndex(program.getProgram(), blockName.c_str());
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program.getProgram(), blockIndex, bindingPoint);
+    }
+#endif
+}
+
+int ParamBuffer::resolve(const char* name) {
+    auto it = offsets.find(name);
+    if (it != offsets.end()) return it->second;
+
+    int offset = -1;
+#ifndef TARGET_OPENGLES
+    GLuint program = shader->getProgram();
+    GLuint index = GL_INVALID_INDEX;
+    glGetUniformIndices(program, 1, &name, &index);
+    if (index != GL_INVALID_INDEX) {
+        // Uniforms outside any block report an offset of -1
+        GLint queried = -1;
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &queried);
+        offset = queried;
+    }
+#endif
+    offsets[name] = offset;
+    return offset;
+}
+
+void ParamBuffer::write(int offset, const float* values, int count) {
+    if (offset + count * (int)sizeof(float) > (int)staging.size()) return;
+    memcpy(staging.data() + offset, values, count * sizeof(float));
+}
+
+ParamBuffer::Pending& ParamBuffer::queue(Pending::Type type, const char* name) {
+    pending.emplace_back();
+    Pending& p = pending.back();
+    p.type = type;
+    p.name = name;
+    return p;
+}
+
+void ParamBuffer::set1f(const char* name, float v) {
+    int offset = isActive() ? resolve(name) : -1;
+    if (offset < 0) {
+        queue(Pending::F1, name).f[0] = v;
+        return;
+    }
+    write(offset, &v, 1);
+}
+
+void ParamBuffer::set1i(const char* name, int v) {
+    int offset = isActive() ? resolve(name) : -1;
+    if (offset < 0) {
+        queue(Pending::I1, name).i = v;
+        return;
+    }
+    if (offset + (int)sizeof(int) > (int)staging.size()) return;
+    memcpy(staging.data() + offset, &v, sizeof(int));
+}
+
+void ParamBuffer::set2f(const char* name, float x, float y) {
+    int offset = isActive() ? resolve(name) : -1;
+    const float v[2] = { x, y };
+    if (offset < 0) {
+        memcpy(queue(Pending::F2, name).f, v, sizeof(v));
+        return;
+    }
+    write(offset, v, 2);
+}
+
+void ParamBuffer::set3f(const char* name, float x, float y, float z) {
+    int offset = isActive() ? resolve(name) : -1;
+    const float v[3] = { x, y, z };
+    if (offset < 0) {
+        memcpy(queue(Pending::F3, name).f, v, sizeof(v));
+        return;
+    }
+    write(offset, v, 3);
+}
+
+void ParamBuffer::set4f(const char* name, float x, float y, float z, float w) {
+    int offset = isActive() ? resolve(name) : -1;
+    const float v[4] = { x, y, z, w };
+    if (offset < 0) {
+        memcpy(queue(Pending::F4, name).f, v, sizeof(v));
+        return;
+    }
+    write(offset, v, 4);
+}
+
+void ParamBuffer::setMatrix3f(const char* name, const glm::mat3& m) {
+    int offset = isActive() ? resolve(name) : -1;
+    if (offset < 0) {
+        queue(Pending::MAT3, name).m = m;
+        return;
+    }
+    // std140 stores each mat3 column padded to a vec4
+    for (int column = 0; column < 3; column++) {
+        write(offset + column * 4 * sizeof(float), &m[column][0], 3);
+    }
+}
+
+void ParamBuffer::setTexture(const char* name, ofTexture& tex, int unit) {
+    Pending& p = queue(Pending::TEX, name);
+    p.tex = &tex;
+    p.i = unit;
+}
+
+void ParamBuffer::setTexture(const char* name, GLenum target, GLuint textureId, int unit) {
+    Pending& p = queue(Pending::TEX_ID, name);
+    p.target = target;
+    p.textureId = textureId;
+    p.i = unit;
+}
+
+const std::string& ParamBuffer::getSwitchKey() {
+    switchKey.resize(intMembers.size() * sizeof(int));
+    char* out = &switchKey[0];
+    for (const auto& m : intMembers) {
+        memcpy(out, staging.data() + m.offset, sizeof(int));
+        out += sizeof(int);
+    }
+    return switchKey;
+}
+
+std::map<std::string, int> ParamBuffer::getSwitchValues() const {
+    std::map<std::string, int> values;
+    for (const auto& m : intMembers) {
+        int v = 0;
+        memcpy(&v, staging.data() + m.offset, sizeof(int));
+        values[m.name] = v;
+    }
+    return values;
+}
+
+void ParamBuffer::upload(ofShader& program) {
+    for (const auto& p : pending) {
+        switch (p.type) {
+            case Pending::F1:     program.setUniform1f(p.name, p.f[0]); break;
+            case Pending::I1:     program.setUniform1i(p.name, p.i); break;
+            case Pending::F2:     program.setUniform2f(p.name, p.f[0], p.f[1]); break;
+            case Pending::F3:     program.setUniform3f(p.name, p.f[0], p.f[1], p.f[2]); break;
+            case Pending::F4:     program.setUniform4f(p.name, p.f[0], p.f[1], p.f[2], p.f[3]); break;
+            case Pending::MAT3:   program.setUniformMatrix3f(p.name, p.m); break;
+            case Pending::TEX:    program.setUniformTexture(p.name, *p.tex, p.i); break;
+            case Pending::TEX_ID: program.setUniformTexture(p.name, p.target, p.textureId, p.i); break;
+        }
+    }
+    pending.clear();
+
+    if (!isActive()) return;
+
+    if (!uploadedValid || memcmp(staging.data(), uploaded.data(), staging.size()) != 0) {
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        uploaded = staging;
+        uploadedValid = true;
+        uploadCount++;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, bufferId);
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// std140 uniform buffer mirroring a shader block's parameters
+//
+// Parameter writes land in a CPU staging copy laid out exactly as the
+// shader's uniform block (offsets are queried from GL, so the GLSL block is
+// the single source of truth). upload() sends the whole block with one
+// glBufferSubData, and only when something actually changed.
+//
+// Names that are not members of the block (samplers, per-frame values) and
+// contexts without uniform buffers (GLES2) fall back to plain uniforms.
+// Those are queued and applied in upload(), so the program that draws can
+// still be chosen after the parameters are written (see ShaderVariantCache).
+//==============================================================================
+class ParamBuffer {
+public:
+    ParamBuffer();
+    ~ParamBuffer();
+
+    ParamBuffer(const ParamBuffer&) = delete;
+    ParamBuffer& operator=(const ParamBuffer&) = delete;
+
+    // Look up `blockName` in the linked shader and create the buffer.
+    // Returns false if uniform buffers are unavailable or the shader has no
+    // such block, in which case all writes go to plain uniforms.
+    bool setup(ofShader& shader, const std::string& blockName);
+
+    bool isActive() const { return bufferId != 0; }
+
+    // Parameter writes. `name` should be a string literal: lookups are
+    // cached by pointer, so the name is only resolved the first time.
+    void set1f(const char* name, float v);
+    void set1i(const char* name, int v);
+    void set2f(const char* name, float x, float y);
+    void set3f(const char* name, float x, float y, float z);
+    void set4f(const char* name, float x, float y, float z, float w);
+    void setMatrix3f(const char* name, const glm::mat3& m);
+    void setTexture(const char* name, ofTexture& tex, int unit);
+    void setTexture(const char* name, GLenum target, GLuint textureId, int unit);
+
+    // Point another linked program with the same block (e.g. a specialized
+    // variant) at this buffer
+    void attach(ofShader& program);
+
+    // Apply queued plain uniforms to `program` (which must be bound), upload
+    // the staging copy if it differs from what the GPU has, and bind the
+    // buffer to this block's binding point. Call after the writes, before
+    // drawing.
+    void upload(ofShader& program);
+
+    // Current values of the int members of the block (the shader's switches)
+    // as a compact key, and as name/value pairs for #defines
+    const std::string& getSwitchKey();
+    std::map<std::string, int> getSwitchValues() const;
+
+    // Number of uploads actually issued (for profiling)
+    uint64_t getUploadCount() const { return uploadCount; }
+
+    void release();
+
+private:
+    ofShader* shader = nullptr;
+    std::string blockName;
+    GLuint bufferId = 0;
+    GLuint bindingPoint = 0;
+
+    std::vector<uint8_t> staging;
+    std::vector<uint8_t> uploaded;
+    bool uploadedValid = false;
+    uint64_t uploadCount = 0;
+
+    // Member offset by name pointer (-1 = not in the block)
+    std::unordered_map<const char*, int> offsets;
+
+    // Int members of the block, in declaration order
+    struct IntMember {
+        std::string name;
+        int offset;
+    };
+    std::vector<IntMember> intMembers;
+    std::string switchKey;
+
+    // Plain uniforms waiting for upload()
+    struct Pending {
+        enum Type { F1, I1, F2, F3, F4, MAT3, TEX, TEX_ID } type;
+        const char* name;
+        float f[4];
+        glm::mat3 m;
+        int i;
+        ofTexture* tex;
+        GLenum target;
+        GLuint textureId;
+    };
+    std::vector<Pending> pending;
+
+    int resolve(const char* name);
+    Pending& queue(Pending::Type type, const char* name);
+    void findIntMembers(GLuint program, GLuint blockIndex);
+    void write(int offset, const float* values, int count);
+
+    static GLuint nextBindingPoint;
+};
+
+} // namespace dragonwaves
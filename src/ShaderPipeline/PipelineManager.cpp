@@ -1,31 +1,62 @@
 #include "PipelineManager.h"
+#include "GpuProfiler.h"
+#include "ShaderCompiler.h"
+#include "../Core/FrameTracer.h"
+#include <GLFW/glfw3.h>  // For glfwGetCurrentContext()
 
 namespace dragonwaves {
 
 //==============================================================================
 // DelayBuffer
 //==============================================================================
+DelayBuffer::~DelayBuffer() {
+    release();
+}
+
+void DelayBuffer::releaseTier(Tier& tier) {
+    if (tier.textureId != 0 && glfwGetCurrentContext() != nullptr) {
+        glDeleteTextures(1, &tier.textureId);
+    }
+    tier.textureId = 0;
+    tier.layerGeneration.clear();
+    tier.writeIndex = 0;
+}
+
+void DelayBuffer::release() {
+    releaseTier(full);
+    releaseTier(older);
+    
+    // Skip GL calls if the context is already gone (application shutdown)
+    if (glfwGetCurrentContext() != nullptr) {
+        if (readFbo != 0) glDeleteFramebuffers(1, &readFbo);
+        if (drawFbo != 0) glDeleteFramebuffers(1, &drawFbo);
+    }
+    readFbo = 0;
+    drawFbo = 0;
+    initialized = false;
+}
+
 void DelayBuffer::setup(int w, int h) {
+    release();
+    
     width = w;
     height = h;
     
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        ofFboSettings settings;
-        settings.width = w;
-        settings.height = h;
-        settings.internalformat = GL_RGBA8;
-        settings.useDepth = false;
-        settings.useStencil = false;
-        frames[i].allocate(settings);
-        frames[i].begin();
-        ofClear(0, 0, 0, 255);
-        frames[i].end();
-    }
+    glGenFramebuffers(1, &readFbo);
+    glGenFramebuffers(1, &drawFbo);
     
-    writeIndex = 0;
+    generation = 1;
+    seeding = false;
+    cooldownFrames = 0;
+    cooldownPeak = 0;
+    configureTiers();
+    updateCapacityLimit();
     initialized = true;
     
-    ofLogNotice("DelayBuffer") << "Setup with " << MAX_FRAMES << " frames at " << w << "x" << h;
+    setTotalFrames(MIN_FRAMES);
+    
+    ofLogNotice("DelayBuffer") << "Setup with " << getSize() << " layers at " << w << "x" << h
+                               << " (limit " << maxFrames << ")";
 }
 
 void DelayBuffer::resize(int w, int h) {
@@ -34,55 +65,367 @@ void DelayBuffer::resize(int w, int h) {
         return;
     }
     
+    if (w == width && h == height) return;
+    
+    // Resample the history to the new size (one filtered blit per live
+    // frame), so a resolution change doesn't restart the feedback
+    int fullWidth = full.width, fullHeight = full.height;
+    int olderWidth = older.width, olderHeight = older.height;
     width = w;
     height = h;
+    configureTiers();
+    resampleTier(full, fullWidth, fullHeight);
+    resampleTier(older, olderWidth, olderHeight);
+    
+    // A larger frame may no longer fit the memory budget
+    updateCapacityLimit();
+    if (getSize() > maxFrames) {
+        setTotalFrames(maxFrames);
+    }
+    
+    ofLogNotice("DelayBuffer") << "Resized to " << w << "x" << h << ", history resampled";
+}
+
+void DelayBuffer::setTiering(int fullFrames, OlderTierFormat format) {
+    if (fullFrames >= MAX_FRAMES) fullFrames = 0;
+    if (fullFrames > 0) fullFrames = std::max(fullFrames, MIN_FRAMES - 1);
+    if (fullFrames == fullQualityFrames && format == olderFormat) return;
+    
+    fullQualityFrames = fullFrames;
+    olderFormat = format;
+    if (!initialized) return;
+    
+    // Layer layout changes, start with empty history
+    int frames = getSize();
+    releaseTier(full);
+    releaseTier(older);
+    seeding = false;
+    configureTiers();
+    updateCapacityLimit();
+    setTotalFrames(std::min(frames, maxFrames));
+    
+    if (isTiered()) {
+        ofLogNotice("DelayBuffer") << "Tiered history: newest " << fullQualityFrames << " frames full quality, older frames "
+                                   << (olderFormat == OLDER_RGB565 ? "16-bit" : "half resolution");
+    } else {
+        ofLogNotice("DelayBuffer") << "Flat history: all frames full quality";
+    }
+}
+
+void DelayBuffer::configureTiers() {
+    full.internalFormat = GL_RGBA8;
+    full.bytesPerPixel = 4;
+    full.width = width;
+    full.height = height;
+    
+    if (olderFormat == OLDER_RGB565) {
+        older.internalFormat = GL_RGB565;
+        older.bytesPerPixel = 2;
+        older.width = width;
+        older.height = height;
+    } else {
+        older.internalFormat = GL_RGBA8;
+        older.bytesPerPixel = 4;
+        older.width = std::max(width / 2, 1);
+        older.height = std::max(height / 2, 1);
+    }
+}
+
+void DelayBuffer::copyLayer(GLuint srcTexture, int srcLayer, int srcW, int srcH,
+                            GLuint dstTexture, int dstLayer, int dstW, int dstH) {
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, srcTexture, 0, srcLayer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dstTexture, 0, dstLayer);
+    glBlitFramebuffer(0, 0, srcW, srcH, 0, 0, dstW, dstH, GL_COLOR_BUFFER_BIT,
+                      (srcW == dstW && srcH == dstH) ? GL_NEAREST : GL_LINEAR);
+}
+
+void DelayBuffer::reallocate(Tier& tier, int layers, const std::vector<int>& sourceLayers,
+                             int sourceWidth, int sourceHeight) {
+    if (layers <= 0) {
+        releaseTier(tier);
+        return;
+    }
+    
+    GLuint newTexture = 0;
+    glGenTextures(1, &newTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, newTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, tier.internalFormat, tier.width, tier.height, layers, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    
+    std::vector<uint32_t> newGeneration(layers, 0);
+    
+    if (tier.textureId != 0) {
+        // Carry over live frames with one blit per layer; cleared layers are skipped
+        GLint prevRead = 0, prevDraw = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevDraw);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo);
+        
+        for (int i = 0; i < layers; i++) {
+            int src = sourceLayers[i];
+            if (src < 0 || tier.layerGeneration[src] != generation) continue;
+            
+            copyLayer(tier.textureId, src, sourceWidth, sourceHeight,
+                      newTexture, i, tier.width, tier.height);
+            newGeneration[i] = generation;
+        }
+        
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevDraw);
+        
+        glDeleteTextures(1, &tier.textureId);
+    }
+    
+    tier.textureId = newTexture;
+    tier.layerGeneration.swap(newGeneration);
+}
+
+void DelayBuffer::updateCapacityLimit() {
+    int fullLimit = isTiered() ? fullQualityFrames + 1 : MAX_FRAMES;
+    maxFrames = MAX_FRAMES;
+    
+    if (memoryBudget > 0 && full.getFrameBytes() > 0) {
+        int fullCap = (int)std::min<size_t>(fullLimit, memoryBudget / full.getFrameBytes());
+        maxFrames = fullCap;
+        if (isTiered() && fullCap == fullLimit && older.getFrameBytes() > 0) {
+            maxFrames += (int)((memoryBudget - fullCap * full.getFrameBytes()) / older.getFrameBytes());
+        }
+        maxFrames = std::min(maxFrames, MAX_FRAMES);
+    }
+    maxFrames = std::max(maxFrames, MIN_FRAMES);
+}
+
+void DelayBuffer::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+    updateCapacityLimit();
+    if (initialized && getSize() > maxFrames) {
+        setTotalFrames(maxFrames);
+    }
+}
+
+void DelayBuffer::growTier(Tier& tier, int frames) {
+    int count = frames - tier.size();
+    if (count <= 0) return;
+    
+    // New layers go in front of the oldest frame, so existing history keeps its delay
+    std::vector<int> sources(frames);
+    for (int i = 0; i < frames; i++) {
+        if (i < tier.writeIndex) sources[i] = i;
+        else if (i < tier.writeIndex + count) sources[i] = -1;
+        else sources[i] = i - count;
+    }
+    reallocate(tier, frames, sources, tier.width, tier.height);
+}
+
+void DelayBuffer::shrinkTier(Tier& tier, int frames) {
+    int size = tier.size();
+    int count = size - frames;
+    if (count <= 0) return;
+    
+    // Drop the oldest frames; the survivors are laid out oldest first
+    std::vector<int> sources(frames);
+    for (int i = 0; i < frames; i++) {
+        sources[i] = (tier.writeIndex + count + i) % size;
+    }
+    reallocate(tier, frames, sources, tier.width, tier.height);
+    tier.writeIndex = 0;
+}
+
+void DelayBuffer::resampleTier(Tier& tier, int sourceWidth, int sourceHeight) {
+    // Same layers in the same order, only the size changes
+    std::vector<int> sources(tier.size());
+    for (int i = 0; i < tier.size(); i++) {
+        sources[i] = i;
+    }
+    reallocate(tier, tier.size(), sources, sourceWidth, sourceHeight);
+}
+
+void DelayBuffer::setTotalFrames(int frames) {
+    frames = ofClamp(frames, MIN_FRAMES, maxFrames);
+    
+    // Fill the full quality tier first, the rest goes to the older tier
+    int fullFrames = isTiered() ? std::min(frames, fullQualityFrames + 1) : frames;
+    int olderFrames = frames - fullFrames;
+    
+    if (olderFrames < older.size()) shrinkTier(older, olderFrames);
+    if (fullFrames < full.size()) shrinkTier(full, fullFrames);
+    if (fullFrames > full.size()) growTier(full, fullFrames);
+    if (olderFrames > older.size()) growTier(older, olderFrames);
+}
+
+void DelayBuffer::requestDelay(int delay) {
+    if (!initialized) return;
     
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        ofFboSettings settings;
-        settings.width = w;
-        settings.height = h;
-        settings.internalformat = GL_RGBA8;
-        settings.useDepth = false;
-        settings.useStencil = false;
-        frames[i].allocate(settings);
-        frames[i].begin();
-        ofClear(0, 0, 0, 255);
-        frames[i].end();
+    int needed = ofClamp(delay + 2, MIN_FRAMES, maxFrames);
+    int size = getSize();
+    
+    if (needed > size) {
+        int target = std::min(((needed + GROW_STEP - 1) / GROW_STEP) * GROW_STEP, maxFrames);
+        setTotalFrames(target);
+        cooldownFrames = 0;
+        cooldownPeak = 0;
+        ofLogNotice("DelayBuffer") << "Grew to " << getSize() << " frames ("
+                                   << getMemoryBytes() / (1024 * 1024) << " MB, flat storage would be "
+                                   << getFlatMemoryBytes() / (1024 * 1024) << " MB)";
+    } else if (needed < size) {
+        cooldownPeak = std::max(cooldownPeak, needed);
+        if (++cooldownFrames >= SHRINK_COOLDOWN_FRAMES) {
+            setTotalFrames(cooldownPeak);
+            cooldownFrames = 0;
+            cooldownPeak = 0;
+            ofLogNotice("DelayBuffer") << "Shrank to " << getSize() << " frames ("
+                                       << getMemoryBytes() / (1024 * 1024) << " MB, flat storage would be "
+                                       << getFlatMemoryBytes() / (1024 * 1024) << " MB)";
+        }
+    } else {
+        cooldownFrames = 0;
+        cooldownPeak = 0;
     }
+}
+
+void DelayBuffer::beginFrame() {
+    if (!initialized || older.size() == 0) return;
     
-    ofLogNotice("DelayBuffer") << "Resized to " << w << "x" << h;
+    // The full tier write layer holds the oldest full quality frame; move it
+    // down a tier before it gets overwritten. Empty frames stay empty, but the
+    // older ring advances regardless so both tiers stay in step.
+    uint32_t frameGeneration = full.layerGeneration[full.writeIndex];
+    if (frameGeneration == generation) {
+        GLint prevRead = 0, prevDraw = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevDraw);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo);
+        
+        copyLayer(full.textureId, full.writeIndex, full.width, full.height,
+                  older.textureId, older.writeIndex, older.width, older.height);
+        
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevDraw);
+    }
+    older.layerGeneration[older.writeIndex] = frameGeneration;
+    older.writeIndex = (older.writeIndex + 1) % older.size();
 }
 
 void DelayBuffer::pushFrame(ofFbo& frame) {
     if (!initialized) return;
     
-    frames[writeIndex].begin();
-    ofViewport(0, 0, width, height);
-    ofSetupScreenOrtho(width, height);
-    ofClear(0, 0, 0, 255);
-    frame.getTexture().draw(0, 0, width, height);
-    frames[writeIndex].end();
+    GLint prevRead = 0, prevDraw = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevDraw);
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, frame.getId());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, full.textureId, 0, full.writeIndex);
+    glBlitFramebuffer(0, 0, frame.getWidth(), frame.getHeight(), 0, 0, width, height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevDraw);
+    
+    commitFrame();
+}
+
+bool DelayBuffer::isZeroCopySupported() {
+#ifdef TARGET_OPENGLES
+    return false;
+#else
+    if (!ofGetGLRenderer()) return false;
+    int major = ofGetGLRenderer()->getGLVersionMajor();
+    int minor = ofGetGLRenderer()->getGLVersionMinor();
+    return major > 4 || (major == 4 && minor >= 5) || ofGLCheckExtension("GL_ARB_texture_barrier");
+#endif
+}
+
+void DelayBuffer::attachWriteLayer(ofFbo& fbo) {
+    if (!initialized) return;
     
-    writeIndex = (writeIndex + 1) % MAX_FRAMES;
+    // Sampling other layers of the array while this one is attached is only
+    // defined with GL 4.5 / GL_ARB_texture_barrier (isZeroCopySupported());
+    // before that the feedback loop rule covers the whole texture level.
+    // getMaxDelay() guarantees the write layer itself is never read, and the
+    // barrier makes layers written by earlier draws safe to sample.
+#ifndef TARGET_OPENGLES
+    glTextureBarrier();
+#endif
+    GLint prev = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo.getId());
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, full.textureId, 0, full.writeIndex);
+    const GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, prev);
+}
+
+void DelayBuffer::detachWriteLayer(ofFbo& fbo) {
+    GLint prev = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo.getId());
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, 0, 0, 0);
+    const GLenum buffers[] = { GL_COLOR_ATTACHMENT0 };
+    glDrawBuffers(1, buffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, prev);
 }
 
-ofTexture& DelayBuffer::getFrame(int delay) {
-    if (!initialized || delay < 0 || delay >= MAX_FRAMES) {
-        return frames[0].getTexture();
+void DelayBuffer::commitFrame() {
+    if (!initialized) return;
+    full.layerGeneration[full.writeIndex] = generation;
+    full.writeIndex = (full.writeIndex + 1) % full.size();
+    if (seeding && ++seededFrames > getMaxDelay()) seeding = false;
+}
+
+HistoryTap DelayBuffer::getTap(int delay) const {
+    HistoryTap tap;
+    if (!initialized || delay < 0) {
+        return tap;
     }
     
-    // Calculate read index based on delay
-    int readIndex = (writeIndex - delay - 1 + MAX_FRAMES) % MAX_FRAMES;
-    return frames[readIndex].getTexture();
+    // Delays beyond the current capacity (or, after a reseed, beyond what
+    // has been written since) read the oldest available frame
+    if (seeding) delay = std::min(delay, std::max(seededFrames - 1, 0));
+    delay = std::min(delay, getMaxDelay());
+    
+    // The full tier's write layer is excluded, so it covers delays 0..size-2;
+    // the newest older-tier frame continues at delay size-1
+    const Tier* tier = &full;
+    if (delay > full.size() - 2) {
+        tier = &older;
+        delay -= full.size() - 1;
+        tap.tier = 1;
+    }
+    
+    int size = tier->size();
+    int readIndex = (tier->writeIndex - delay - 1 + size) % size;
+    if (tier->layerGeneration[readIndex] == generation) {
+        tap.layer = readIndex;
+    }
+    return tap;
 }
 
 void DelayBuffer::clear() {
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        frames[i].begin();
-        ofClear(0, 0, 0, 255);
-        frames[i].end();
-    }
-    writeIndex = 0;
+    // Invalidate every layer at once instead of redrawing them
+    generation++;
+    seeding = false;
+}
+
+void DelayBuffer::reseed(ofFbo* frame) {
+    if (!initialized) return;
+    clear();
+    seeding = true;
+    seededFrames = 0;
+    if (frame) pushFrame(*frame);
 }
 
 //==============================================================================
@@ -92,22 +435,45 @@ PipelineManager::PipelineManager() {
 }
 
 PipelineManager::~PipelineManager() {
+    // Stop the variant compiler while its shared context can still be destroyed
+    ShaderCompiler::getInstance().shutdown();
 }
 
-void PipelineManager::setup(const DisplaySettings& settings) {
+void PipelineManager::setup(const DisplaySettings& settings, bool backgroundCompile) {
     displaySettings = settings;
     
-    // Setup shader blocks
+    // Setup shader blocks (timed: shader compile dominates startup)
+    ShaderLoader::setBinaryCacheEnabled(settings.shaderBinaryCache);
+    if (settings.shaderBinaryCache && !ShaderLoader::isBinaryCacheSupported()) {
+        ofLogNotice("PipelineManager") << "Program binary cache unavailable (no binary formats or explicit uniform locations)";
+    }
+    if (backgroundCompile) ShaderCompiler::getInstance().setup();
+    uint64_t shaderStart = ofGetElapsedTimeMicros();
+    applyBlockRates();
     block1.setup(settings.internalWidth, settings.internalHeight);
     block2.setup(settings.internalWidth, settings.internalHeight);
     block3.setup(settings.outputWidth, settings.outputHeight);
+    applyVariantSettings();
+    blurPrepass.setup();
+    shaderSetupMs = (ofGetElapsedTimeMicros() - shaderStart) / 1000.0f;
     
-    // Setup delay buffers
-    fb1Delay.setup(settings.internalWidth, settings.internalHeight);
-    fb2Delay.setup(settings.internalWidth, settings.internalHeight);
+    const auto& shaderStats = ShaderLoader::getStats();
+    ofLogNotice("PipelineManager") << "Shader blocks ready in " << shaderSetupMs << " ms ("
+                                   << shaderStats.cacheHits << "/" << shaderStats.programs
+                                   << " programs from binary cache)";
+    
+    // Setup delay buffers (at the blocks' scaled size, history is a copy of their output)
+    fb1Delay.setup(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    fb2Delay.setup(block2.getOutput().getWidth(), block2.getOutput().getHeight());
+    applyFeedbackSettings();
+    zeroCopySupported = DelayBuffer::isZeroCopySupported();
+    if (settings.zeroCopyFeedback && !zeroCopySupported) {
+        ofLogNotice("PipelineManager") << "Zero-copy feedback needs GL 4.5 or GL_ARB_texture_barrier, copying history instead";
+    }
     
-    // Initialize cached mesh for Block3
-    updateBlock3Mesh(settings.outputWidth, settings.outputHeight);
+    // Initialize cached full-screen quads
+    updateQuadMesh(internalMesh, settings.internalWidth, settings.internalHeight);
+    updateQuadMesh(block3Mesh, settings.outputWidth, settings.outputHeight);
     
     allocateDummyTexture();
     
@@ -116,17 +482,17 @@ void PipelineManager::setup(const DisplaySettings& settings) {
     ofLogNotice("PipelineManager") << "Setup complete";
 }
 
-void PipelineManager::updateBlock3Mesh(int width, int height) {
-    block3Mesh.clear();
-    block3Mesh.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
-    block3Mesh.addVertex(ofVec3f(0, 0, 0));
-    block3Mesh.addTexCoord(ofVec2f(0, 0));
-    block3Mesh.addVertex(ofVec3f(width, 0, 0));
-    block3Mesh.addTexCoord(ofVec2f(1, 0));
-    block3Mesh.addVertex(ofVec3f(width, height, 0));
-    block3Mesh.addTexCoord(ofVec2f(1, 1));
-    block3Mesh.addVertex(ofVec3f(0, height, 0));
-    block3Mesh.addTexCoord(ofVec2f(0, 1));
+void PipelineManager::updateQuadMesh(ofMesh& mesh, int width, int height) {
+    mesh.clear();
+    mesh.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    mesh.addVertex(ofVec3f(0, 0, 0));
+    mesh.addTexCoord(ofVec2f(0, 0));
+    mesh.addVertex(ofVec3f(width, 0, 0));
+    mesh.addTexCoord(ofVec2f(1, 0));
+    mesh.addVertex(ofVec3f(width, height, 0));
+    mesh.addTexCoord(ofVec2f(1, 1));
+    mesh.addVertex(ofVec3f(0, height, 0));
+    mesh.addTexCoord(ofVec2f(0, 1));
 }
 
 void PipelineManager::allocateDummyTexture() {
@@ -137,16 +503,305 @@ void PipelineManager::allocateDummyTexture() {
     dummyTexture.loadData(pixels);
 }
 
+void PipelineManager::applyVariantSettings() {
+    block1.setVariantsEnabled(displaySettings.shaderVariants);
+    block2.setVariantsEnabled(displaySettings.shaderVariants);
+    block3.setVariantsEnabled(displaySettings.shaderVariants);
+    
+    blurPrepass.setEnabled(displaySettings.blurPrepass);
+    blurPrepass.setScale(displaySettings.blurPrepassScale);
+    
+    // Pre-pass settings change the channel results
+    channelCache.setEnabled(displaySettings.channelCache);
+    channelCache.invalidate();
+    block1WarpMaps.setEnabled(displaySettings.warpMaps);
+    block2WarpMaps.setEnabled(displaySettings.warpMaps);
+    
+    block1.setColorLutsEnabled(displaySettings.colorLut);
+    block2.setColorLutsEnabled(displaySettings.colorLut);
+    block3.setColorLutsEnabled(displaySettings.colorLut);
+}
+
+void PipelineManager::applyBlockRates() {
+    governor.setEnabled(displaySettings.resolutionGovernor);
+    governor.setMinScale(displaySettings.resolutionGovernorMinScale);
+    block1.setRenderScale(displaySettings.block1Scale * governor.getScale());
+    block2.setRenderScale(displaySettings.block2Scale * governor.getScale());
+    renderGraph.setUpdateInterval(RenderGraph::BLOCK1, displaySettings.block1UpdateInterval);
+    renderGraph.setUpdateInterval(RenderGraph::BLOCK2, displaySettings.block2UpdateInterval);
+}
+
+void PipelineManager::updateGovernor() {
+    // GPU time of the blocks that actually drew (a skipped block's timer holds a stale value)
+    float gpuMs = block3.getGpuTimer().getLastMs();
+    if (renderGraph.getState(RenderGraph::BLOCK1) != RenderGraph::SKIPPED) gpuMs += block1.getGpuTimer().getLastMs();
+    if (channelPassRendered) gpuMs += channelGpuTimer.getLastMs();
+    if (renderGraph.getState(RenderGraph::BLOCK2) != RenderGraph::SKIPPED && !block2Fused) {
+        gpuMs += block2.getGpuTimer().getLastMs();
+    }
+    float budgetMs = 1000.0f / std::max(displaySettings.targetFPS, 1);
+    
+    if (!governor.update(frameCpuMs, gpuMs, budgetMs)) return;
+    
+    applyBlockRates();
+    fb1Delay.resize(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    fb2Delay.resize(block2.getOutput().getWidth(), block2.getOutput().getHeight());
+}
+
+// Delay times are set in frames of the output; a block rendering every
+// `interval` frames only advances its history on the frames it renders
+static int historyDelay(int frames, int interval) {
+    return std::max(1, (frames + interval / 2) / interval);
+}
+
+ofTexture* PipelineManager::renderHistoryPrepass(BlurPrepass::Layer layer, DelayBuffer& buffer, int delay,
+                                                 const BlurPrepass::Filter& filter) {
+    HistoryTap tap = buffer.getTap(delay);
+    GLuint texture = (tap.tier == 0) ? buffer.getTextureId() : buffer.getOlderTextureId();
+    ofVec2f size = buffer.getTierSize(tap.tier);
+    return blurPrepass.render(layer, texture, tap.layer, size.x, size.y, filter);
+}
+
+void PipelineManager::applyFeedbackSettings() {
+    auto olderFormat = (displaySettings.feedbackOlderTierFormat == 1) ?
+        DelayBuffer::OLDER_RGB565 : DelayBuffer::OLDER_HALF_RES;
+    fb1Delay.setTiering(displaySettings.feedbackFullQualityFrames, olderFormat);
+    fb2Delay.setTiering(displaySettings.feedbackFullQualityFrames, olderFormat);
+    
+    // Budget is shared evenly between the two feedback loops
+    size_t budget = (size_t)std::max(displaySettings.feedbackMemoryBudgetMB, 0) * 1024 * 1024 / 2;
+    fb1Delay.setMemoryBudget(budget);
+    fb2Delay.setMemoryBudget(budget);
+    
+    ofLogNotice("PipelineManager") << "Feedback history limit: " << fb1Delay.getCapacityLimit()
+                                   << " frames per loop (" << displaySettings.feedbackMemoryBudgetMB << " MB budget)";
+}
+
+size_t PipelineManager::getFeedbackMemoryBytes() const {
+    return fb1Delay.getMemoryBytes() + fb2Delay.getMemoryBytes();
+}
+
+size_t PipelineManager::getFeedbackFlatMemoryBytes() const {
+    return fb1Delay.getFlatMemoryBytes() + fb2Delay.getFlatMemoryBytes();
+}
+
+// Which inputs of a mixnKeyVideo() call reach its output. With no mix
+// amount and a key that can't trigger (threshold <= 0) the result is the
+// foreground alone, which keyOrder 1 swaps with the background.
+static void mixInputsUsed(float amount, float keyThreshold, int keyOrder, bool& fgUsed, bool& bgUsed) {
+    bool blends = amount != 0.0f || keyThreshold > 0.0f;
+    fgUsed = keyOrder == 0 || blends;
+    bgUsed = keyOrder != 0 || blends;
+}
+
+void PipelineManager::updateRenderPaths() {
+    RenderPaths paths;
+    const bool elide = displaySettings.deadPathElision;
+    renderGraph.setCullingEnabled(elide);
+    renderGraph.beginFrame();
+    
+    if (elide) {
+        // Block3: the matrix mix always reads its foreground, and its background
+        // only with a non-zero bg-into-fg weight; the final mix then keys the
+        // matrix output over the background
+        const auto& p3 = block3.params;
+        bool matrixUsed, bgUsed;
+        mixInputsUsed(p3.finalMixAmount, p3.finalKeyThreshold, p3.finalKeyOrder, matrixUsed, bgUsed);
+        bool matrixReadsBg = p3.matrixMixBgRedIntoFgRed != 0.0f || p3.matrixMixBgGreenIntoFgRed != 0.0f ||
+            p3.matrixMixBgBlueIntoFgRed != 0.0f || p3.matrixMixBgRedIntoFgGreen != 0.0f ||
+            p3.matrixMixBgGreenIntoFgGreen != 0.0f || p3.matrixMixBgBlueIntoFgGreen != 0.0f ||
+            p3.matrixMixBgRedIntoFgBlue != 0.0f || p3.matrixMixBgGreenIntoFgBlue != 0.0f ||
+            p3.matrixMixBgBlueIntoFgBlue != 0.0f;
+        bool fgUsed = matrixUsed;
+        bgUsed = bgUsed || (matrixUsed && matrixReadsBg);
+        // finalKeyOrder 1 makes Block2 the foreground
+        paths.block1Layer = (p3.finalKeyOrder == 0) ? fgUsed : bgUsed;
+        paths.block2Layer = (p3.finalKeyOrder == 0) ? bgUsed : fgUsed;
+        
+        // Block2: input keyed over its feedback
+        const auto& p2 = block2.params;
+        mixInputsUsed(p2.fb2MixAmount, p2.fb2KeyThreshold, p2.fb2KeyOrder, paths.block2Input, paths.fb2);
+        paths.fb2Temporal = p2.fb2TemporalFilter1Amount != 0.0f || p2.fb2TemporalFilter2Amount != 0.0f;
+        
+        // Block1: ch1 keyed with ch2, the result keyed over its feedback
+        const auto& p1 = block1.params;
+        bool channelsUsed;
+        mixInputsUsed(p1.fb1MixAmount, p1.fb1KeyThreshold, p1.fb1KeyOrder, channelsUsed, paths.fb1);
+        mixInputsUsed(p1.ch2MixAmount, p1.ch2KeyThreshold, p1.ch2KeyOrder, paths.ch1, paths.ch2);
+        paths.ch1 = paths.ch1 && channelsUsed;
+        paths.ch2 = paths.ch2 && channelsUsed;
+        paths.fb1Temporal = p1.fb1TemporalFilter1Amount != 0.0f || p1.fb1TemporalFilter2Amount != 0.0f;
+    }
+    
+    // A loop coming back from elision last wrote its history before it was
+    // cut; restart it from the block's current output so delayed taps don't
+    // replay that stale stretch. The graph still holds last frame's states: a
+    // block that was culled (or fused, for Block2) has no current output, so
+    // its history starts empty and fills from the next frame it renders.
+    if (paths.fb1Live() && !renderPaths.fb1Live()) {
+        bool current = renderGraph.getState(RenderGraph::BLOCK1) != RenderGraph::SKIPPED;
+        fb1Delay.reseed(current ? &block1.getOutput() : nullptr);
+    }
+    if (paths.fb2Live() && !renderPaths.fb2Live()) {
+        bool current = renderGraph.getState(RenderGraph::BLOCK2) != RenderGraph::SKIPPED && !block2Fused;
+        fb2Delay.reseed(current ? &block2.getOutput() : nullptr);
+    }
+    renderPaths = paths;
+    
+    // Which blocks read which, for the consumers to pull on
+    if (paths.block1Layer) renderGraph.addEdge(RenderGraph::BLOCK1, RenderGraph::BLOCK3);
+    if (paths.block2Layer) renderGraph.addEdge(RenderGraph::BLOCK2, RenderGraph::BLOCK3);
+    if (paths.block2Input && block2.params.block2InputSelect == 0) {
+        renderGraph.addEdge(RenderGraph::BLOCK1, RenderGraph::BLOCK2);
+    }
+    renderGraph.setFeedback(RenderGraph::BLOCK1, paths.fb1Live());
+    renderGraph.setFeedback(RenderGraph::BLOCK2, paths.fb2Live());
+    renderGraph.resolve();
+}
+
+void PipelineManager::updateBlock2Fusion() {
+    // With its feedback out of the mix Block2's output is just its input
+    // layer, which Block3 can evaluate wherever it samples Block2, provided
+    // it samples one pixel at a time (no blur/sharpen on that layer), nothing
+    // else reads Block2's output and Block2 isn't holding frames
+    const auto& p3 = block3.params;
+    bool fuse = displaySettings.passFusion && renderPaths.block2Layer && !renderPaths.fb2Live() &&
+        renderGraph.getUpdateInterval(RenderGraph::BLOCK2) == 1 &&
+        !BlurPrepass::Filter{ p3.block2BlurAmount, p3.block2BlurRadius,
+                              p3.block2SharpenAmount, p3.block2SharpenRadius }.isActive();
+    for (int c = 0; c < RenderGraph::CONSUMER_COUNT && fuse; c++) {
+        if (renderGraph.getConsumer((RenderGraph::Consumer)c) & RenderGraph::mask(RenderGraph::BLOCK2)) fuse = false;
+    }
+    
+    if (fuse != block2Fused) {
+        ofLogVerbose("PipelineManager") << (fuse ? "Block2 fused into Block3" : "Block2 rendering its own pass");
+    }
+    block2Fused = fuse;
+}
+
 void PipelineManager::processFrame() {
+    TraceScope trace("PipelineManager::processFrame");
     if (!initialized) return;
     
-    // ===== BLOCK 1 =====
-    // Draw feedback texture first (delayed frame)
-    ofTexture& fb1Tex = fb1Delay.getFrame(fb1DelayTime);
-    ofTexture& fb1Temporal = fb1Delay.getFrame(0);  // Most recent for temporal filter
+    const bool zeroCopy = displaySettings.zeroCopyFeedback && zeroCopySupported;
+    
+    updateGovernor();
+    updateRenderPaths();
+    updateBlock2Fusion();
+    passesExecuted = 0;
+    channelPassRendered = false;
+    const bool render1 = renderGraph.shouldRender(RenderGraph::BLOCK1);
+    const bool render2 = renderGraph.shouldRender(RenderGraph::BLOCK2) && !block2Fused;
+    const bool render3 = renderGraph.shouldRender(RenderGraph::BLOCK3);
+    
+    // Grow/shrink delay history to what is actually requested, then move
+    // frames that are about to be overwritten down to the older tier. A
+    // loop that isn't written this frame (culled, or its block is holding
+    // between updates) leaves its history as it is.
+    fb1HistoryDelay = historyDelay(fb1DelayTime, renderGraph.getEffectiveInterval(RenderGraph::BLOCK1));
+    fb2HistoryDelay = historyDelay(fb2DelayTime, renderGraph.getEffectiveInterval(RenderGraph::BLOCK2));
+    fb1Delay.requestDelay(fb1HistoryDelay);
+    fb2Delay.requestDelay(fb2HistoryDelay);
+    auto& profiler = GpuProfiler::getInstance();
+    profiler.begin(GpuProfiler::HISTORY);
+    if (render1 && renderPaths.fb1Live()) fb1Delay.beginFrame();
+    if (render2 && renderPaths.fb2Live()) fb2Delay.beginFrame();
+    profiler.end(GpuProfiler::HISTORY);
+    
+    blurPrepass.beginFrame();
+    
+    // Install at most one compiled shader variant per frame (the attach and
+    // first use of a new program still cost a little)
+    if (!block1.updateVariants() && !block2.updateVariants()) {
+        block3.updateVariants();
+    }
+    
+    // Blocks no consumer reads are skipped (or idle, see RenderGraph)
+    if (render1) renderBlock1(zeroCopy);
+    if (render2) renderBlock2(zeroCopy);
+    if (render3) {
+        profiler.begin(GpuProfiler::BLOCK3);
+        renderBlock3();
+        profiler.end(GpuProfiler::BLOCK3);
+    }
+    
+    passesExecuted += blurPrepass.getPassCount();
+}
+
+// Everything a Block1 channel's result depends on apart from its source's
+// frames: the source texture and the channel's parameters
+static std::vector<float> channelCacheKey(const Block1Shader& block, ChannelCache::Channel channel,
+                                          const ofTexture& source) {
+    const auto& p = block.params;
+    // Channel 2's HD aspect fix uses channel 1's factors
+    std::vector<float> key = {
+        (float)source.getTextureData().textureID, block.ch1HdAspectXFix, block.ch1HdAspectYFix
+    };
+    if (channel == ChannelCache::CH1) {
+        key.insert(key.end(), {
+            p.ch1XDisplace, p.ch1YDisplace, p.ch1ZDisplace, p.ch1Rotate,
+            p.ch1HueAttenuate, p.ch1SaturationAttenuate, p.ch1BrightAttenuate, p.ch1Posterize,
+            p.ch1KaleidoscopeAmount, p.ch1KaleidoscopeSlice,
+            p.ch1BlurAmount, p.ch1BlurRadius, p.ch1SharpenAmount, p.ch1SharpenRadius, p.ch1FiltersBoost,
+            (float)p.ch1GeoOverflow, (float)p.ch1HMirror, (float)p.ch1VMirror, (float)p.ch1HFlip, (float)p.ch1VFlip,
+            (float)p.ch1HueInvert, (float)p.ch1SaturationInvert, (float)p.ch1BrightInvert, (float)p.ch1RGBInvert,
+            (float)p.ch1Solarize, (float)p.ch1PosterizeSwitch, (float)p.ch1HdAspectOn
+        });
+    } else {
+        key.insert(key.end(), {
+            p.ch2XDisplace, p.ch2YDisplace, p.ch2ZDisplace, p.ch2Rotate,
+            p.ch2HueAttenuate, p.ch2SaturationAttenuate, p.ch2BrightAttenuate, p.ch2Posterize,
+            p.ch2KaleidoscopeAmount, p.ch2KaleidoscopeSlice,
+            p.ch2BlurAmount, p.ch2BlurRadius, p.ch2SharpenAmount, p.ch2SharpenRadius, p.ch2FiltersBoost,
+            (float)p.ch2GeoOverflow, (float)p.ch2HMirror, (float)p.ch2VMirror, (float)p.ch2HFlip, (float)p.ch2VFlip,
+            (float)p.ch2HueInvert, (float)p.ch2SaturationInvert, (float)p.ch2BrightInvert, (float)p.ch2RGBInvert,
+            (float)p.ch2Solarize, (float)p.ch2PosterizeSwitch, (float)p.ch2HdAspectOn
+        });
+    }
+    return key;
+}
+
+// Everything a channel's coordinates depend on (see WarpMapCache)
+static std::vector<float> channelWarpKey(const Block1Shader& block, Block1Shader::WarpLayer layer) {
+    const auto& p = block.params;
+    std::vector<float> key = {
+        (float)block.getWidth(), (float)block.getHeight(), block.ch1HdAspectXFix, block.ch1HdAspectYFix
+    };
+    if (layer == Block1Shader::WARP_CH1) {
+        key.insert(key.end(), {
+            p.ch1XDisplace, p.ch1YDisplace, p.ch1ZDisplace, p.ch1Rotate,
+            p.ch1KaleidoscopeAmount, p.ch1KaleidoscopeSlice,
+            (float)p.ch1HMirror, (float)p.ch1VMirror, (float)p.ch1HFlip, (float)p.ch1VFlip,
+            (float)p.ch1GeoOverflow, (float)p.ch1HdAspectOn
+        });
+    } else {
+        key.insert(key.end(), {
+            p.ch2XDisplace, p.ch2YDisplace, p.ch2ZDisplace, p.ch2Rotate,
+            p.ch2KaleidoscopeAmount, p.ch2KaleidoscopeSlice,
+            (float)p.ch2HMirror, (float)p.ch2VMirror, (float)p.ch2HFlip, (float)p.ch2VFlip,
+            (float)p.ch2GeoOverflow, (float)p.ch2HdAspectOn
+        });
+    }
+    return key;
+}
+
+// Same for a feedback layer, from its geometry parameters in block order
+static std::vector<float> feedbackWarpKey(const ShaderBlock& block, std::initializer_list<float> params) {
+    std::vector<float> key = { (float)block.getWidth(), (float)block.getHeight() };
+    key.insert(key.end(), params);
+    return key;
+}
+
+void PipelineManager::renderBlock1(bool zeroCopy) {
+    const RenderPaths& paths = renderPaths;
+    auto& profiler = GpuProfiler::getInstance();
+    profiler.begin(GpuProfiler::BLOCK1);
     
-    block1.setFeedbackTexture(fb1Tex);
-    block1.setTemporalFilterTexture(fb1Temporal);
+    // Delayed frame (either tier) and most recent frame (temporal filter, always full quality);
+    // taps of unused layers read as empty, so the shader skips them
+    block1.setFeedbackHistory(fb1Delay.getTextureId(), fb1Delay.getOlderTextureId(),
+                              paths.fb1 ? fb1Delay.getTap(fb1HistoryDelay) : HistoryTap(),
+                              paths.fb1Temporal ? fb1Delay.getTap(0).layer : -1);
     
     // Set input textures based on ch1InputSelect and ch2InputSelect
     // ch1InputSelect: 0=input1, 1=input2
@@ -166,15 +821,97 @@ void PipelineManager::processFrame() {
         block1.setChannel2Texture(dummyTexture);
     }
     
+    // Channels whose source has no new frame and whose parameters haven't
+    // moved are read back from the cache instead of being processed again
+    channelCache.allocate(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    channelCache.update(ChannelCache::CH1, paths.ch1,
+        (block1.params.ch1InputSelect == 0) ? input1FrameNew : input2FrameNew,
+        channelCacheKey(block1, ChannelCache::CH1, (ch1Tex && ch1Tex->isAllocated()) ? *ch1Tex : dummyTexture));
+    channelCache.update(ChannelCache::CH2, paths.ch2,
+        (block1.params.ch2InputSelect == 0) ? input1FrameNew : input2FrameNew,
+        channelCacheKey(block1, ChannelCache::CH2, (ch2Tex && ch2Tex->isAllocated()) ? *ch2Tex : dummyTexture));
+    input1FrameNew = false;
+    input2FrameNew = false;
+    const bool split = channelCache.resolve();
+    const bool renderCh1 = paths.ch1 && (!split || channelCache.isStale(ChannelCache::CH1));
+    const bool renderCh2 = paths.ch2 && (!split || channelCache.isStale(ChannelCache::CH2));
+    
+    // Coordinates of layers whose geometry is still come from their warp maps
+    {
+        const auto& p = block1.params;
+        block1WarpMaps.allocate(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+        block1WarpMaps.update(Block1Shader::WARP_CH1, renderCh1, channelWarpKey(block1, Block1Shader::WARP_CH1));
+        block1WarpMaps.update(Block1Shader::WARP_CH2, renderCh2, channelWarpKey(block1, Block1Shader::WARP_CH2));
+        block1WarpMaps.update(Block1Shader::WARP_FB1, paths.fb1, feedbackWarpKey(block1, {
+            p.fb1XDisplace, p.fb1YDisplace, p.fb1ZDisplace, p.fb1Rotate, (float)p.fb1RotateMode,
+            p.fb1ShearMatrix1, p.fb1ShearMatrix2, p.fb1ShearMatrix3, p.fb1ShearMatrix4,
+            p.fb1KaleidoscopeAmount, p.fb1KaleidoscopeSlice,
+            (float)p.fb1HMirror, (float)p.fb1VMirror, (float)p.fb1HFlip, (float)p.fb1VFlip, (float)p.fb1GeoOverflow
+        }));
+        if (block1WarpMaps.needsBake()) {
+            block1.setStage(Block1Shader::WARP);
+            block1.setWarpMaps(nullptr, nullptr, nullptr);
+            bakeWarpMaps(block1, block1WarpMaps);
+        }
+        block1.setWarpMaps(block1WarpMaps.getMap(Block1Shader::WARP_CH1),
+                           block1WarpMaps.getMap(Block1Shader::WARP_CH2),
+                           block1WarpMaps.getMap(Block1Shader::WARP_FB1));
+    }
+    
+    // Blur/sharpen pre-passes (skipped for layers with both amounts at zero,
+    // culled, or read from the channel cache)
+    {
+        const auto& p = block1.params;
+        ofTexture* ch1Prepass = nullptr;
+        ofTexture* ch2Prepass = nullptr;
+        ofTexture* fb1Prepass = nullptr;
+        if (renderCh1) {
+            ch1Prepass = blurPrepass.render(BlurPrepass::CH1,
+                (ch1Tex && ch1Tex->isAllocated()) ? *ch1Tex : dummyTexture,
+                { p.ch1BlurAmount, p.ch1BlurRadius, p.ch1SharpenAmount, p.ch1SharpenRadius });
+        }
+        if (renderCh2) {
+            ch2Prepass = blurPrepass.render(BlurPrepass::CH2,
+                (ch2Tex && ch2Tex->isAllocated()) ? *ch2Tex : dummyTexture,
+                { p.ch2BlurAmount, p.ch2BlurRadius, p.ch2SharpenAmount, p.ch2SharpenRadius });
+        }
+        if (paths.fb1) {
+            fb1Prepass = renderHistoryPrepass(BlurPrepass::FB1, fb1Delay, fb1HistoryDelay,
+                { p.fb1BlurAmount, p.fb1BlurRadius, p.fb1SharpenAmount, p.fb1SharpenRadius });
+        }
+        
+        // Split: the channel pass reads the channel pre-passes, the mix stage only fb1's
+        channelPassRendered = split && (renderCh1 || renderCh2);
+        if (channelPassRendered) {
+            block1.setBlurPrepass(ch1Prepass, ch2Prepass, nullptr);
+            renderBlock1Channels();
+        }
+        block1.setBlurPrepass(split ? nullptr : ch1Prepass, split ? nullptr : ch2Prepass, fb1Prepass);
+    }
+    
+    block1.setStage(split ? Block1Shader::MIX : Block1Shader::SINGLE_PASS);
+    block1.setChannelCache(split ? &channelCache.getTexture(ChannelCache::CH1) : nullptr,
+                           split ? &channelCache.getTexture(ChannelCache::CH2) : nullptr);
+    block1.setLayersUsed(paths.ch1, paths.ch2);
+    
+    // In zero-copy mode the shader's second output lands directly in the history layer
+    const bool writeHistory = paths.fb1Live();
+    if (zeroCopy && writeHistory) {
+        fb1Delay.attachWriteLayer(block1.getOutput());
+    }
+    
     // Process block 1
     block1.getOutput().begin();
     ofViewport(0, 0, block1.getOutput().getWidth(), block1.getOutput().getHeight());
-    ofSetupScreenOrtho(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    // Full size projection: a scaled FBO renders the same picture at lower resolution
+    ofSetupScreenOrtho(block1.getWidth(), block1.getHeight());
     ofClear(0, 0, 0, 255);
     
-    // Unbind only texture units used by Block1 (0-3) to prevent FBO self-binding issues
-    // Unit 0: fb1Tex (bound by draw), Units 1-3: ch1Tex, ch2Tex, temporal (bound by uniforms)
-    for (int i = 0; i < 4; i++) {
+    // Unbind only texture units used by Block1 (0-6, 10-11) to prevent FBO self-binding issues
+    // Units 0-1: fb1 history arrays, Units 2-3: ch1Tex, ch2Tex, Units 4-6: pre-passes,
+    // Units 10-11: channel cache
+    for (int i = 0; i < 12; i++) {
+        if (i >= 7 && i < 10) continue;
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -184,23 +921,98 @@ void PipelineManager::processFrame() {
     block1.getShader().begin();
     block1.process();
     
-    // Draw feedback texture - this binds it to texture unit 0
-    // The shader samples from tex0 uniform which is also bound to unit 0
-    fb1Tex.draw(0, 0, block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    block1.beginGpuTimer();
+    internalMesh.draw();
+    block1.endGpuTimer();
+    passesExecuted++;
     
     block1.getShader().end();
     block1.getOutput().end();
+    profiler.end(GpuProfiler::BLOCK1);
     
     // Store frame for feedback
-    fb1Delay.pushFrame(block1.getOutput());
+    if (!writeHistory) return;
+    if (zeroCopy) {
+        fb1Delay.detachWriteLayer(block1.getOutput());
+        fb1Delay.commitFrame();
+    } else {
+        profiler.begin(GpuProfiler::HISTORY);
+        fb1Delay.pushFrame(block1.getOutput());
+        profiler.end(GpuProfiler::HISTORY);
+        passesExecuted++;
+    }
+}
+
+void PipelineManager::renderBlock1Channels() {
+    const bool ch1 = channelCache.isStale(ChannelCache::CH1);
+    const bool ch2 = channelCache.isStale(ChannelCache::CH2);
+    block1.setStage(Block1Shader::CHANNELS);
+    block1.setChannelCache(nullptr, nullptr);
+    block1.setLayersUsed(ch1, ch2);
+    
+    ofFbo& fbo = channelCache.getFbo();
+    fbo.begin();
+    // Only the stale channels are written, the other attachment keeps its cached result
+    const GLenum buffers[] = { ch1 ? GL_COLOR_ATTACHMENT0 : GL_NONE, ch2 ? GL_COLOR_ATTACHMENT1 : GL_NONE };
+    glDrawBuffers(2, buffers);
+    ofViewport(0, 0, fbo.getWidth(), fbo.getHeight());
+    ofSetupScreenOrtho(block1.getWidth(), block1.getHeight());
     
-    // ===== BLOCK 2 =====
-    ofTexture& fb2Tex = fb2Delay.getFrame(fb2DelayTime);
-    ofTexture& fb2Temporal = fb2Delay.getFrame(0);
+    // Units 10-11 may still hold the cache from the last mix stage
+    for (int i = 10; i < 12; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    
+    block1.getShader().begin();
+    block1.process();
     
+    channelGpuTimer.begin();
+    internalMesh.draw();
+    channelGpuTimer.end();
+    channelGpuTimer.poll();
+    passesExecuted++;
+    
+    block1.getShader().end();
+    fbo.end();
+    
+    channelCache.commit();
+}
+
+void PipelineManager::bakeWarpMaps(ShaderBlock& block, WarpMapCache& maps) {
+    ofFbo& fbo = maps.getFbo();
+    fbo.begin();
+    // Only the layers being baked are written, the others keep their maps
+    std::vector<GLenum> buffers(fbo.getNumTextures());
+    for (int i = 0; i < (int)buffers.size(); i++) {
+        buffers[i] = maps.isBaking(i) ? GL_COLOR_ATTACHMENT0 + i : GL_NONE;
+    }
+    glDrawBuffers((GLsizei)buffers.size(), buffers.data());
+    ofViewport(0, 0, fbo.getWidth(), fbo.getHeight());
+    ofSetupScreenOrtho(block.getWidth(), block.getHeight());
+    
+    block.getShader().begin();
+    block.process();
+    internalMesh.draw();
+    passesExecuted++;
+    block.getShader().end();
+    fbo.end();
+    
+    maps.commit();
+}
+
+WarpMapCache::Stats PipelineManager::getWarpMapStats() const {
+    WarpMapCache::Stats total = block1WarpMaps.getStats();
+    const WarpMapCache::Stats& block2Stats = block2WarpMaps.getStats();
+    total.hits += block2Stats.hits;
+    total.misses += block2Stats.misses;
+    total.bakes += block2Stats.bakes;
+    return total;
+}
+
+ofTexture* PipelineManager::prepareBlock2Input() {
     block2.setBlock1Texture(block1.getOutputTexture());
-    block2.setFeedbackTexture(fb2Tex);
-    block2.setTemporalFilterTexture(fb2Temporal);
     
     // Set input texture based on block2InputSelect
     if (block2.params.block2InputSelect == 0) {
@@ -213,13 +1025,70 @@ void PipelineManager::processFrame() {
         block2.setInputTexture(dummyTexture);
     }
     
+    // Blur/sharpen pre-pass (skipped with both amounts at zero, or culled)
+    if (!renderPaths.block2Input) return nullptr;
+    const auto& p = block2.params;
+    ofTexture* inputSource = &dummyTexture;
+    if (p.block2InputSelect == 0) {
+        inputSource = &block1.getOutputTexture();
+    } else if (p.block2InputSelect == 1 && input1Tex && input1Tex->isAllocated()) {
+        inputSource = input1Tex;
+    } else if (p.block2InputSelect == 2 && input2Tex && input2Tex->isAllocated()) {
+        inputSource = input2Tex;
+    }
+    return blurPrepass.render(BlurPrepass::BLOCK2_INPUT, *inputSource,
+        { p.block2InputBlurAmount, p.block2InputBlurRadius, p.block2InputSharpenAmount, p.block2InputSharpenRadius });
+}
+
+void PipelineManager::renderBlock2(bool zeroCopy) {
+    const RenderPaths& paths = renderPaths;
+    auto& profiler = GpuProfiler::getInstance();
+    profiler.begin(GpuProfiler::BLOCK2);
+    
+    ofTexture* inputPrepass = prepareBlock2Input();
+    block2.setFeedbackHistory(fb2Delay.getTextureId(), fb2Delay.getOlderTextureId(),
+                              paths.fb2 ? fb2Delay.getTap(fb2HistoryDelay) : HistoryTap(),
+                              paths.fb2Temporal ? fb2Delay.getTap(0).layer : -1);
+    block2.setLayersUsed(paths.block2Input);
+    
+    {
+        const auto& p = block2.params;
+        ofTexture* fb2Prepass = nullptr;
+        if (paths.fb2) {
+            fb2Prepass = renderHistoryPrepass(BlurPrepass::FB2, fb2Delay, fb2HistoryDelay,
+                { p.fb2BlurAmount, p.fb2BlurRadius, p.fb2SharpenAmount, p.fb2SharpenRadius });
+        }
+        block2.setBlurPrepass(inputPrepass, fb2Prepass);
+        
+        block2WarpMaps.allocate(block2.getOutput().getWidth(), block2.getOutput().getHeight());
+        block2WarpMaps.update(0, paths.fb2, feedbackWarpKey(block2, {
+            p.fb2XDisplace, p.fb2YDisplace, p.fb2ZDisplace, p.fb2Rotate, (float)p.fb2RotateMode,
+            p.fb2ShearMatrix1, p.fb2ShearMatrix2, p.fb2ShearMatrix3, p.fb2ShearMatrix4,
+            p.fb2KaleidoscopeAmount, p.fb2KaleidoscopeSlice,
+            (float)p.fb2HMirror, (float)p.fb2VMirror, (float)p.fb2HFlip, (float)p.fb2VFlip, (float)p.fb2GeoOverflow
+        }));
+        if (block2WarpMaps.needsBake()) {
+            block2.setStage(Block2Shader::WARP);
+            block2.setWarpMap(nullptr);
+            bakeWarpMaps(block2, block2WarpMaps);
+        }
+        block2.setStage(Block2Shader::RENDER);
+        block2.setWarpMap(block2WarpMaps.getMap(0));
+    }
+    
+    const bool writeHistory = paths.fb2Live();
+    if (zeroCopy && writeHistory) {
+        fb2Delay.attachWriteLayer(block2.getOutput());
+    }
+    
     block2.getOutput().begin();
     ofViewport(0, 0, block2.getOutput().getWidth(), block2.getOutput().getHeight());
-    ofSetupScreenOrtho(block2.getOutput().getWidth(), block2.getOutput().getHeight());
+    // Full size projection: a scaled FBO renders the same picture at lower resolution
+    ofSetupScreenOrtho(block2.getWidth(), block2.getHeight());
     ofClear(0, 0, 0, 255);
     
-    // Unbind only texture units used by Block2 (4-6) to prevent FBO self-binding issues
-    for (int i = 4; i < 7; i++) {
+    // Unbind only texture units used by Block2 (4-8) to prevent FBO self-binding issues
+    for (int i = 4; i < 9; i++) {
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -229,26 +1098,61 @@ void PipelineManager::processFrame() {
     block2.getShader().begin();
     block2.process();
     
-    // Draw feedback texture - this binds it to texture unit 0
-    // The shader samples from tex0 uniform which is also bound to unit 0
-    fb2Tex.draw(0, 0, block2.getOutput().getWidth(), block2.getOutput().getHeight());
+    block2.beginGpuTimer();
+    internalMesh.draw();
+    block2.endGpuTimer();
+    passesExecuted++;
     
     block2.getShader().end();
     block2.getOutput().end();
+    profiler.end(GpuProfiler::BLOCK2);
     
-    fb2Delay.pushFrame(block2.getOutput());
+    if (!writeHistory) return;
+    if (zeroCopy) {
+        fb2Delay.detachWriteLayer(block2.getOutput());
+        fb2Delay.commitFrame();
+    } else {
+        profiler.begin(GpuProfiler::HISTORY);
+        fb2Delay.pushFrame(block2.getOutput());
+        profiler.end(GpuProfiler::HISTORY);
+        passesExecuted++;
+    }
+}
+
+void PipelineManager::renderBlock3() {
+    const RenderPaths& paths = renderPaths;
     
-    // ===== BLOCK 3 =====
     block3.setBlock1Texture(block1.getOutputTexture());
     block3.setBlock2Texture(block2.getOutputTexture());
+    block3.setLayersUsed(paths.block1Layer, paths.block2Layer);
+    
+    // Fused: Block3 evaluates Block2's input layer instead of sampling its output
+    if (block2Fused) {
+        block2.setBlurPrepass(prepareBlock2Input(), nullptr);
+    }
+    block3.setFusedBlock2(block2Fused ? &block2 : nullptr);
+    {
+        const auto& p = block3.params;
+        ofTexture* block1Prepass = nullptr;
+        ofTexture* block2Prepass = nullptr;
+        if (paths.block1Layer) {
+            block1Prepass = blurPrepass.render(BlurPrepass::BLOCK1_OUTPUT, block1.getOutputTexture(),
+                { p.block1BlurAmount, p.block1BlurRadius, p.block1SharpenAmount, p.block1SharpenRadius });
+        }
+        if (paths.block2Layer) {
+            block2Prepass = blurPrepass.render(BlurPrepass::BLOCK2_OUTPUT, block2.getOutputTexture(),
+                { p.block2BlurAmount, p.block2BlurRadius, p.block2SharpenAmount, p.block2SharpenRadius });
+        }
+        block3.setBlurPrepass(block1Prepass, block2Prepass);
+    }
     
     block3.getOutput().begin();
     ofViewport(0, 0, block3.getOutput().getWidth(), block3.getOutput().getHeight());
     ofSetupScreenOrtho(block3.getOutput().getWidth(), block3.getOutput().getHeight());
     ofClear(0, 0, 0, 255);
     
-    // Unbind only texture units used by Block3 (0-1) to prevent FBO self-binding issues
-    for (int i = 0; i < 2; i++) {
+    // Unbind only texture units used by Block3 (0-3) to prevent FBO self-binding issues
+    for (int i = 0; i < 4; i++) {
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -259,7 +1163,10 @@ void PipelineManager::processFrame() {
     block3.process();
     
     // Draw cached mesh (avoid recreation every frame)
+    block3.beginGpuTimer();
     block3Mesh.draw();
+    block3.endGpuTimer();
+    passesExecuted++;
     
     block3.getShader().end();
     block3.getOutput().end();
@@ -273,6 +1180,11 @@ void PipelineManager::setInput2Texture(ofTexture& tex) {
     input2Tex = &tex;
 }
 
+void PipelineManager::setInputFramesNew(bool input1, bool input2) {
+    input1FrameNew = input1FrameNew || input1;
+    input2FrameNew = input2FrameNew || input2;
+}
+
 ofTexture& PipelineManager::getBlock1Output() {
     return block1.getOutputTexture();
 }
@@ -300,15 +1212,19 @@ ofFbo& PipelineManager::getBlock3Fbo() {
 void PipelineManager::reinitialize(const DisplaySettings& settings) {
     displaySettings = settings;
     
+    applyBlockRates();
     block1.resize(settings.internalWidth, settings.internalHeight);
     block2.resize(settings.internalWidth, settings.internalHeight);
     block3.resize(settings.outputWidth, settings.outputHeight);
+    applyVariantSettings();
     
-    fb1Delay.resize(settings.internalWidth, settings.internalHeight);
-    fb2Delay.resize(settings.internalWidth, settings.internalHeight);
+    fb1Delay.resize(block1.getOutput().getWidth(), block1.getOutput().getHeight());
+    fb2Delay.resize(block2.getOutput().getWidth(), block2.getOutput().getHeight());
+    applyFeedbackSettings();
     
-    // Update cached mesh for new dimensions
-    updateBlock3Mesh(settings.outputWidth, settings.outputHeight);
+    // Update cached meshes for new dimensions
+    updateQuadMesh(internalMesh, settings.internalWidth, settings.internalHeight);
+    updateQuadMesh(block3Mesh, settings.outputWidth, settings.outputHeight);
     
     allocateDummyTexture();
     
@@ -340,6 +1256,7 @@ void PipelineManager::setFB2DelayTime(int frames) {
 }
 
 void PipelineManager::updateModulations(float deltaTime) {
+    TraceScope trace("PipelineManager::updateModulations");
     if (!audioAnalyzer && !tempoManager) return;
     
     // Update audio analyzer
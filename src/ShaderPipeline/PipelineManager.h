@@ -3,6 +3,11 @@
 #include "Block1Shader.h"
 #include "Block2Shader.h"
 #include "Block3Shader.h"
+#include "BlurPrepass.h"
+#include "ChannelCache.h"
+#include "WarpMapCache.h"
+#include "RenderGraph.h"
+#include "ResolutionGovernor.h"
 #include "../Core/SettingsManager.h"
 #include "../Audio/AudioAnalyzer.h"
 #include "../Tempo/TempoManager.h"
@@ -11,31 +16,188 @@ namespace dragonwaves {
 
 //==============================================================================
 // Frame buffer for delay/feedback
+//
+// History is stored in GL_TEXTURE_2D_ARRAYs, one layer per frame. Blocks
+// sample it through sampler2DArray bindings plus layer-index uniforms
+// (see getTap()), so any number of past frames can be read in one pass.
+//
+// Storage is tiered: the newest frames live in a full quality array and are
+// demoted into a cheaper "older" array (half resolution, or 16-bit RGB565)
+// once they age past the full tier. Reads from the older tier are upsampled
+// by the sampler.
+//
+// Layers are allocated lazily: the ring grows to the largest delay actually
+// requested (within a memory budget) and shrinks again after a cooldown.
+// Clearing bumps a generation counter; layers written before the clear
+// report as empty (layer -1) until they are overwritten.
 //==============================================================================
 class DelayBuffer {
 public:
     static constexpr int MAX_FRAMES = 120;
+    static constexpr int MIN_FRAMES = 3;                  // delay 1 + write layer + spare
+    static constexpr int GROW_STEP = 8;                   // round growth to avoid per-frame allocs
+    static constexpr int SHRINK_COOLDOWN_FRAMES = 300;    // ~10 sec at 30 FPS
+    
+    // Storage used for frames older than the full quality tier
+    enum OlderTierFormat {
+        OLDER_HALF_RES = 0,    // RGBA8 at half width/height (1/4 the memory)
+        OLDER_RGB565           // 16-bit at full resolution (1/2 the memory)
+    };
+    
+    ~DelayBuffer();
     
     void setup(int width, int height);
+    // Change the frame size, resampling the stored history
     void resize(int width, int height);
     
-    // Push new frame to buffer
+    // Keep the newest `fullQualityFrames` at full quality and store older
+    // ones in `olderFormat`. 0 (or >= MAX_FRAMES) disables tiering.
+    // Changing the split discards the current history.
+    void setTiering(int fullQualityFrames, OlderTierFormat olderFormat);
+    
+    // Make sure `delay` frames of history are available, growing the ring
+    // (or shrinking it after the cooldown). Call once per frame.
+    void requestDelay(int delay);
+    
+    // Demote the oldest full quality frame into the older tier before its
+    // layer is overwritten. Call once per frame, before the block renders.
+    void beginFrame();
+    
+    // Upper bound on video memory used by this buffer (0 = unlimited)
+    void setMemoryBudget(size_t bytes);
+    
+    // Push new frame to buffer (copies frame into the write layer)
     void pushFrame(ofFbo& frame);
     
-    // Get frame at specified delay (0 = most recent)
-    ofTexture& getFrame(int delay);
+    // Zero-copy mode: attach the write layer as GL_COLOR_ATTACHMENT1 of the
+    // block FBO so the block shader writes its history output straight into
+    // it, then call commitFrame() after rendering. detachWriteLayer() restores
+    // the FBO to a single draw buffer.
+    void attachWriteLayer(ofFbo& fbo);
+    void detachWriteLayer(ofFbo& fbo);
+    void commitFrame();
+    
+    // Zero-copy mode samples the array while a layer of it is attached,
+    // which is only defined per layer from GL 4.5 / GL_ARB_texture_barrier
+    static bool isZeroCopySupported();
+    
+    // Where the frame at the given delay (0 = most recent) lives
+    HistoryTap getTap(int delay) const;
     
-    // Clear all frames
+    // Texture arrays for binding as sampler2DArray (tier 0 / tier 1)
+    GLuint getTextureId() const { return full.textureId; }
+    GLuint getOlderTextureId() const { return older.textureId; }
+    ofVec2f getTierSize(int tier) const {
+        const Tier& t = (tier == 0) ? full : older;
+        return ofVec2f(t.width, t.height);
+    }
+    
+    // Clear all frames (no GPU work, see generation counter above)
     void clear();
     
-    int getSize() const { return MAX_FRAMES; }
+    // Restart the history from `frame` (nullptr = empty): every delay reads
+    // the newest frame written since, until the ring has refilled
+    void reseed(ofFbo* frame);
+    
+    int getSize() const { return full.size() + older.size(); }
+    int getFullQualitySize() const { return full.size(); }
+    int getCapacityLimit() const { return maxFrames; }
+    bool isTiered() const { return fullQualityFrames > 0; }
+    
+    // Largest delay that can be read; the write layer itself must never be sampled
+    int getMaxDelay() const { return getSize() - 2; }
+    
+    // Current video memory footprint in bytes, and what the same history
+    // would cost stored flat at full quality
+    size_t getMemoryBytes() const { return full.getBytes() + older.getBytes(); }
+    size_t getFlatMemoryBytes() const { return (size_t)getSize() * full.getFrameBytes(); }
     
 private:
-    std::array<ofFbo, MAX_FRAMES> frames;
-    int writeIndex = 0;
+    struct Tier {
+        GLuint textureId = 0;
+        GLenum internalFormat = GL_RGBA8;
+        int bytesPerPixel = 4;
+        int width = 0;
+        int height = 0;
+        
+        // Generation each layer was last written in; layer writeIndex is the
+        // oldest frame and the next to be written
+        std::vector<uint32_t> layerGeneration;
+        int writeIndex = 0;
+        
+        int size() const { return (int)layerGeneration.size(); }
+        size_t getFrameBytes() const { return (size_t)width * height * bytesPerPixel; }
+        size_t getBytes() const { return layerGeneration.size() * getFrameBytes(); }
+    };
+    
+    Tier full;
+    Tier older;
+    GLuint readFbo = 0;     // scratch framebuffers for layer copies
+    GLuint drawFbo = 0;
+    uint32_t generation = 1;
+    bool seeding = false;   // set by reseed() until the ring has refilled
+    int seededFrames = 0;   // frames written since reseed()
+    
+    int fullQualityFrames = 0;
+    OlderTierFormat olderFormat = OLDER_HALF_RES;
+    
+    int maxFrames = MAX_FRAMES;
+    size_t memoryBudget = 0;
+    int cooldownFrames = 0;
+    int cooldownPeak = 0;
+    
     int width = 0;
     int height = 0;
     bool initialized = false;
+    
+    // Reallocate a tier with `layers` layers at the tier's current size.
+    // sourceLayers[i] names the old layer (sourceWidth x sourceHeight)
+    // copied into new layer i, or -1 to leave it empty.
+    void reallocate(Tier& tier, int layers, const std::vector<int>& sourceLayers,
+                    int sourceWidth, int sourceHeight);
+    void growTier(Tier& tier, int layers);
+    void shrinkTier(Tier& tier, int layers);
+    void resampleTier(Tier& tier, int sourceWidth, int sourceHeight);
+    void releaseTier(Tier& tier);
+    
+    // Split `frames` between the tiers and grow/shrink both to match
+    void setTotalFrames(int frames);
+    void configureTiers();
+    void copyLayer(GLuint srcTexture, int srcLayer, int srcW, int srcH,
+                   GLuint dstTexture, int dstLayer, int dstW, int dstH);
+    void updateCapacityLimit();
+    void release();
+};
+
+//==============================================================================
+// Layers that can reach their block's output this frame
+//
+// Worked out from the mix/key parameters each frame (see
+// PipelineManager::updateRenderPaths()): a layer mixed in at amount 0 with
+// a key that can't trigger contributes nothing, so its fetches, blur
+// pre-pass and (for feedback) history writes are skipped. The Block3 layers
+// also decide which blocks RenderGraph keeps. Everything defaults to used,
+// which is also what the pipeline runs with deadPathElision off.
+//==============================================================================
+struct RenderPaths {
+    // Block1 layers
+    bool ch1 = true;
+    bool ch2 = true;
+    bool fb1 = true;            // delayed feedback frame
+    bool fb1Temporal = true;    // temporal filters (most recent frame)
+    
+    // Block2 layers
+    bool block2Input = true;
+    bool fb2 = true;
+    bool fb2Temporal = true;
+    
+    // Block3 layers
+    bool block1Layer = true;
+    bool block2Layer = true;
+    
+    // Feedback history is read, so rendered frames have to be written to it
+    bool fb1Live() const { return fb1 || fb1Temporal; }
+    bool fb2Live() const { return fb2 || fb2Temporal; }
 };
 
 //==============================================================================
@@ -46,8 +208,10 @@ public:
     PipelineManager();
     ~PipelineManager();
     
-    // Initialize with settings
-    void setup(const DisplaySettings& settings);
+    // Initialize with settings. Without backgroundCompile shader variants
+    // compile on the main thread, on a frame fixed by the request count
+    // (offline renders, which have to come out the same every run).
+    void setup(const DisplaySettings& settings, bool backgroundCompile = true);
     
     // Process one frame through the pipeline
     void processFrame();
@@ -55,6 +219,9 @@ public:
     // Input textures
     void setInput1Texture(ofTexture& tex);
     void setInput2Texture(ofTexture& tex);
+    // Whether each input delivered a new frame since the last call; Block1
+    // only re-processes its channels on new frames (see ChannelCache)
+    void setInputFramesNew(bool input1, bool input2);
     
     // Get outputs
     ofTexture& getBlock1Output();
@@ -73,9 +240,43 @@ public:
     DelayBuffer& getFB1DelayBuffer() { return fb1Delay; }
     DelayBuffer& getFB2DelayBuffer() { return fb2Delay; }
     
+    // Longest feedback delay (frames) both buffers can hold within their
+    // memory budget
+    int getMaxDelayFrames() const {
+        return std::min(fb1Delay.getCapacityLimit(), fb2Delay.getCapacityLimit()) - 2;
+    }
+    
+    // Video memory currently held by both feedback delay buffers, and what
+    // the same history would take without tiering
+    size_t getFeedbackMemoryBytes() const;
+    size_t getFeedbackFlatMemoryBytes() const;
+    
+    // Time spent loading the block shaders in setup() (startup metric)
+    float getShaderSetupMs() const { return shaderSetupMs; }
+    
+    // Blur/sharpen pre-pass passes run in the last frame (0 when all filters are off)
+    int getBlurPrepassCount() const { return blurPrepass.getPassCount(); }
+    
+    // What the last frame rendered (see RenderPaths, RenderGraph) and how many
+    // GPU passes it ran: block draws, blur pre-passes and feedback history copies
+    const RenderPaths& getRenderPaths() const { return renderPaths; }
+    const RenderGraph& getRenderGraph() const { return renderGraph; }
+    int getPassesExecuted() const { return passesExecuted; }
+    // Block2 folded into Block3's pass this frame (see updateBlock2Fusion())
+    bool isBlock2Fused() const { return block2Fused; }
+    // Block1's cached channels as of the last frame Block1 rendered
+    const ChannelCache& getChannelCache() const { return channelCache; }
+    // Warp map hits/misses/bakes of all layers since startup (see WarpMapCache)
+    WarpMapCache::Stats getWarpMapStats() const;
+    
     // Reinitialize with new resolution
     void reinitialize(const DisplaySettings& settings);
     
+    // Dynamic resolution: CPU time of the last frame's work (update + draw,
+    // excluding frame rate sleep), fed to the governor with the block GPU times
+    void setFrameCpuTime(float ms) { frameCpuMs = ms; }
+    ResolutionGovernor& getResolutionGovernor() { return governor; }
+    
     // Clear feedback buffers
     void clearFB1();
     void clearFB2();
@@ -89,9 +290,19 @@ public:
         DRAW_ALL_BLOCKS
     };
     
-    void setDrawMode(DrawMode mode) { drawMode = mode; }
+    // The draw mode is the screen's consumer declaration
+    void setDrawMode(DrawMode mode) {
+        drawMode = mode;
+        renderGraph.setConsumer(RenderGraph::SCREEN, RenderGraph::drawModeOutputs(mode));
+    }
     DrawMode getDrawMode() const { return drawMode; }
     
+    // Block outputs read by the other consumers (RenderGraph::mask() bits);
+    // blocks nobody reads aren't rendered
+    void setConsumer(RenderGraph::Consumer consumer, unsigned outputs) {
+        renderGraph.setConsumer(consumer, outputs);
+    }
+    
     // Feedback delay times
     void setFB1DelayTime(int frames);
     void setFB2DelayTime(int frames);
@@ -128,12 +339,74 @@ private:
     
     int fb1DelayTime = 1;
     int fb2DelayTime = 1;
+    bool zeroCopySupported = false;     // see DelayBuffer::isZeroCopySupported()
+    // Delays in the blocks' own frames (see RenderGraph update intervals)
+    int fb1HistoryDelay = 1;
+    int fb2HistoryDelay = 1;
     
     bool initialized = false;
     
-    // Cached mesh for Block3 rendering (avoid recreation every frame)
+    // Apply DisplaySettings feedback tiering and memory budget to the delay buffers
+    void applyFeedbackSettings();
+    
+    // Apply DisplaySettings shader variant switch to the blocks
+    void applyVariantSettings();
+    
+    // Apply DisplaySettings per-block resolution scale (times the governor's)
+    // and update rate
+    void applyBlockRates();
+    
+    // Step the governor and resize Block1/Block2 (and their history) on a change
+    ResolutionGovernor governor;
+    float frameCpuMs = 0.0f;
+    void updateGovernor();
+    
+    // Blur/sharpen neighbourhood pre-pass shared by all blocks
+    BlurPrepass blurPrepass;
+    ofTexture* renderHistoryPrepass(BlurPrepass::Layer layer, DelayBuffer& buffer, int delay,
+                                    const BlurPrepass::Filter& filter);
+    float shaderSetupMs = 0.0f;
+    
+    // Dead-path elision and output-driven culling (see RenderPaths, RenderGraph)
+    RenderPaths renderPaths;
+    RenderGraph renderGraph;
+    int passesExecuted = 0;
+    void updateRenderPaths();
+    
+    // Pass fusion: when Block2 only passes its input layer through and
+    // Block3 is its only reader, Block3 evaluates that layer itself and
+    // Block2's pass (and its FBO write) is skipped
+    bool block2Fused = false;
+    void updateBlock2Fusion();
+    
+    // Channel caching: Block1's ch1/ch2 results are kept across frames and
+    // only re-rendered (by a separate channel pass) on a new input frame or
+    // a parameter change. New frames accumulate until Block1 next renders.
+    ChannelCache channelCache;
+    GpuTimer channelGpuTimer;
+    bool input1FrameNew = true;
+    bool input2FrameNew = true;
+    bool channelPassRendered = false;
+    void renderBlock1Channels();
+    
+    // Warp maps: baked coordinates of Block1's ch1/ch2/fb1 and Block2's fb2
+    WarpMapCache block1WarpMaps{ Block1Shader::WARP_LAYER_COUNT };
+    WarpMapCache block2WarpMaps{ 1 };
+    // Draw `block` (set to its warp stage) into the maps' stale layers
+    void bakeWarpMaps(ShaderBlock& block, WarpMapCache& maps);
+    
+    // processFrame() stages, run for the blocks RenderGraph keeps
+    void renderBlock1(bool zeroCopy);
+    // Block2 input textures and blur pre-pass (returned), for its own pass or Block3's
+    ofTexture* prepareBlock2Input();
+    void renderBlock2(bool zeroCopy);
+    void renderBlock3();
+    
+    // Cached full-screen quads (avoid recreation every frame):
+    // Block1/Block2 at internal resolution, Block3 at output resolution
+    ofMesh internalMesh;
     ofMesh block3Mesh;
-    void updateBlock3Mesh(int width, int height);
+    void updateQuadMesh(ofMesh& mesh, int width, int height);
     
     void allocateDummyTexture();
     
@@ -0,0 +1,86 @@
+#include "RenderGraph.h"
+
+namespace dragonwaves {
+
+unsigned RenderGraph::drawModeOutputs(int drawMode) {
+    switch (drawMode) {
+        case 0: return mask(BLOCK1);
+        case 1: return mask(BLOCK2);
+        case 2: return mask(BLOCK3);
+        case 3: return mask(BLOCK1) | mask(BLOCK2) | mask(BLOCK3);
+        default: return 0;
+    }
+}
+
+const char* RenderGraph::getStateName(State state) {
+    switch (state) {
+        case RENDERED: return "rendered";
+        case IDLE: return "idle";
+        case SKIPPED: default: return "skipped";
+    }
+}
+
+void RenderGraph::setConsumer(Consumer consumer, unsigned outputs) {
+    if (consumers[consumer] != outputs) {
+        ofLogVerbose("RenderGraph") << "Consumer " << consumer << " now reads outputs 0x" << std::hex << outputs;
+    }
+    consumers[consumer] = outputs;
+}
+
+void RenderGraph::beginFrame() {
+    for (int n = 0; n < NODE_COUNT; n++) {
+        readers[n] = 0;
+        feedback[n] = false;
+    }
+    frame++;
+}
+
+void RenderGraph::addEdge(Node input, Node reader) {
+    readers[input] |= mask(reader);
+}
+
+void RenderGraph::resolve() {
+    // Blocks only read earlier blocks, so walking back from the last one
+    // settles every reader before the blocks it reads
+    for (int n = NODE_COUNT - 1; n >= 0; n--) {
+        if (!cullingEnabled) {
+            states[n] = RENDERED;
+            continue;
+        }
+
+        bool read = false;
+        bool readWhileIdle = false;
+        for (int c = 0; c < CONSUMER_COUNT; c++) {
+            if (consumers[c] & mask((Node)n)) read = true;
+        }
+        for (int r = n + 1; r < NODE_COUNT; r++) {
+            if (!(readers[n] & mask((Node)r))) continue;
+            if (states[r] == RENDERED) read = true;
+            if (states[r] == IDLE) readWhileIdle = true;
+        }
+
+        if (read) {
+            states[n] = RENDERED;
+        } else if (feedback[n] || readWhileIdle) {
+            states[n] = IDLE;
+        } else {
+            states[n] = SKIPPED;
+        }
+    }
+}
+
+void RenderGraph::setUpdateInterval(Node node, int frames) {
+    intervals[node] = ofClamp(frames, 1, 8);
+}
+
+int RenderGraph::getEffectiveInterval(Node node) const {
+    if (states[node] == IDLE) return std::max(intervals[node], IDLE_INTERVAL);
+    return intervals[node];
+}
+
+bool RenderGraph::shouldRender(Node node) const {
+    if (states[node] == SKIPPED) return false;
+    return (frame + node) % getEffectiveInterval(node) == 0;
+}
+
+} // namespace dragonwaves
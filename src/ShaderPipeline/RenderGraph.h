@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Consumer-driven culling of the block renders
+//
+// Each consumer of the pipeline (screen, NDI/Spout senders, video recorder,
+// preview panel) declares which block outputs it reads, and every frame
+// PipelineManager adds the block-to-block edges the current parameters
+// actually use (see RenderPaths). A block renders if a consumer reads it or
+// a rendered block reads it; everything else is skipped.
+//
+// A block nobody reads but whose feedback loop is live doesn't stop: it
+// idles, rendering every IDLE_INTERVAL frames, so the loop keeps evolving
+// and its history is recent when a consumer comes back. Blocks it reads
+// idle along with it.
+//
+// Blocks can also run at a reduced update rate, holding their last output
+// in between. Ticks are staggered per block so blocks at the same rate
+// don't all land on one frame.
+//==============================================================================
+class RenderGraph {
+public:
+    enum Node {
+        BLOCK1 = 0,
+        BLOCK2,
+        BLOCK3,
+        NODE_COUNT
+    };
+
+    enum Consumer {
+        SCREEN = 0,     // main window (draw mode)
+        OUTPUTS,        // NDI/Spout senders
+        RECORDER,       // VideoRecorder
+        PREVIEW,        // preview panel/window
+        CONSUMER_COUNT
+    };
+
+    enum State {
+        SKIPPED = 0,
+        IDLE,           // feedback kept running at reduced rate
+        RENDERED
+    };
+
+    static constexpr int IDLE_INTERVAL = 4;
+
+    // Output bit for a node, as used by setConsumer()
+    static unsigned mask(Node node) { return 1u << node; }
+
+    // Outputs shown by a PipelineManager::DrawMode value (-1 = none)
+    static unsigned drawModeOutputs(int drawMode);
+
+    static const char* getStateName(State state);
+
+    // Block outputs `consumer` reads (mask() bits, 0 = none). Holds until
+    // changed, so consumers only need to call it when their needs change.
+    void setConsumer(Consumer consumer, unsigned outputs);
+    unsigned getConsumer(Consumer consumer) const { return consumers[consumer]; }
+
+    // With culling off every block renders every frame
+    void setCullingEnabled(bool enabled) { cullingEnabled = enabled; }
+
+    // Per frame: beginFrame(), describe the blocks, then resolve()
+    void beginFrame();
+    // `reader` samples `input`'s output (input must come before reader)
+    void addEdge(Node input, Node reader);
+    void setFeedback(Node node, bool live) { feedback[node] = live; }
+    void resolve();
+
+    // Render `node` every `frames` frames (1 - 8, 1 = every frame)
+    void setUpdateInterval(Node node, int frames);
+    int getUpdateInterval(Node node) const { return intervals[node]; }
+    // Interval the node actually renders at this frame (idle blocks slow to IDLE_INTERVAL)
+    int getEffectiveInterval(Node node) const;
+
+    State getState(Node node) const { return states[node]; }
+
+    // Rendered or idle, and due this frame
+    bool shouldRender(Node node) const;
+
+private:
+    unsigned consumers[CONSUMER_COUNT] = { 1u << BLOCK3, 0, 0, 0 };
+    unsigned readers[NODE_COUNT] = {};   // per node: mask of nodes reading it
+    bool feedback[NODE_COUNT] = {};
+    int intervals[NODE_COUNT] = { 1, 1, 1 };
+    State states[NODE_COUNT] = { RENDERED, RENDERED, RENDERED };
+    bool cullingEnabled = true;
+    uint64_t frame = 0;
+};
+
+} // namespace dragonwaves
@@ -0,0 +1,100 @@
+#include "ResolutionGovernor.h"
+
+namespace dragonwaves {
+
+// Eighths, so the block sizes stay on a small set of round fractions
+const float ResolutionGovernor::LEVELS[] = { 1.0f, 0.875f, 0.75f, 0.625f, 0.5f, 0.375f, 0.25f };
+const int ResolutionGovernor::LEVEL_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+void ResolutionGovernor::setEnabled(bool e) {
+    if (e == enabled) return;
+    enabled = e;
+    overBudgetFrames = 0;
+    headroomFrames = 0;
+    ofLogNotice("ResolutionGovernor") << (enabled ? "Enabled" : "Disabled");
+}
+
+void ResolutionGovernor::setLocked(bool l) {
+    if (l == locked) return;
+    locked = l;
+    overBudgetFrames = 0;
+    headroomFrames = 0;
+    ofLogNotice("ResolutionGovernor") << (locked ? "Locked" : "Unlocked") << " at scale " << getScale();
+}
+
+void ResolutionGovernor::setMinScale(float scale) {
+    maxLevel = 0;
+    while (maxLevel + 1 < LEVEL_COUNT && LEVELS[maxLevel + 1] >= scale - 0.001f) {
+        maxLevel++;
+    }
+    // Takes effect on the next update()
+}
+
+float ResolutionGovernor::getScale() const {
+    return LEVELS[level];
+}
+
+bool ResolutionGovernor::update(float cpuMs, float gpuMs, float budgetMs) {
+    // Disabled (or the minimum raised above the current level): back to the allowed range
+    int target = enabled ? std::min(level, maxLevel) : 0;
+    if (target != level) {
+        setLevel(target, budgetMs);
+        return true;
+    }
+    if (!enabled || budgetMs <= 0.0f) return false;
+
+    float sample = std::max(cpuMs, gpuMs);
+    frameMs = hasSample ? ofLerp(frameMs, sample, 0.1f) : sample;
+    hasSample = true;
+
+    if (locked) return false;
+    if (cooldownFrames > 0) {
+        cooldownFrames--;
+        return false;
+    }
+
+    if (frameMs > budgetMs) {
+        overBudgetFrames++;
+        headroomFrames = 0;
+    } else if (frameMs < budgetMs * HEADROOM) {
+        headroomFrames++;
+        overBudgetFrames = 0;
+    } else {
+        overBudgetFrames = 0;
+        headroomFrames = 0;
+    }
+
+    if (overBudgetFrames >= OVER_BUDGET_FRAMES && level < maxLevel) {
+        setLevel(level + 1, budgetMs);
+        return true;
+    }
+    if (headroomFrames >= HEADROOM_FRAMES && level > 0) {
+        setLevel(level - 1, budgetMs);
+        return true;
+    }
+    return false;
+}
+
+void ResolutionGovernor::setLevel(int newLevel, float budgetMs) {
+    Change change;
+    change.time = ofGetElapsedTimef();
+    change.fromScale = LEVELS[level];
+    change.toScale = LEVELS[newLevel];
+    change.frameMs = frameMs;
+    change.budgetMs = budgetMs;
+
+    log.push_back(change);
+    while ((int)log.size() > MAX_LOG) {
+        log.pop_front();
+    }
+
+    ofLogNotice("ResolutionGovernor") << "Render scale " << change.fromScale << " -> " << change.toScale
+                                      << " (frame " << change.frameMs << " ms, budget " << budgetMs << " ms)";
+
+    level = newLevel;
+    overBudgetFrames = 0;
+    headroomFrames = 0;
+    cooldownFrames = COOLDOWN_FRAMES;
+}
+
+} // namespace dragonwaves
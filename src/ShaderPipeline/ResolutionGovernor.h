@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ofMain.h"
+#include <deque>
+
+namespace dragonwaves {
+
+//==============================================================================
+// Dynamic resolution governor
+//
+// Watches frame time against the targetFPS budget and steps the render scale
+// of Block1/Block2 through a few fixed levels: down after a sustained
+// overrun, back up only after a longer stretch with clear headroom. Every
+// change is followed by a cooldown so the new level's timing settles before
+// it is judged again.
+//
+// Frame time is the larger of the CPU time of the frame's work and the GPU
+// time of the block draws, whichever is the bottleneck. Scales are
+// quantized to the levels below, so changes reallocate at a small set of
+// sizes (DelayBuffer resamples its history on each one).
+//
+// Locking holds the current scale (OSC /gravity/pipeline/governorLock).
+//==============================================================================
+class ResolutionGovernor {
+public:
+    // One entry per scale change, oldest first
+    struct Change {
+        float time = 0.0f;          // seconds since startup
+        float fromScale = 1.0f;
+        float toScale = 1.0f;
+        float frameMs = 0.0f;       // smoothed frame time that triggered it
+        float budgetMs = 0.0f;
+    };
+
+    static constexpr int OVER_BUDGET_FRAMES = 30;   // sustained overrun before stepping down
+    static constexpr int HEADROOM_FRAMES = 180;     // sustained headroom before stepping up
+    static constexpr int COOLDOWN_FRAMES = 60;      // after every change
+    static constexpr float HEADROOM = 0.7f;         // step up below this fraction of the budget
+    static constexpr int MAX_LOG = 32;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    void setLocked(bool locked);
+    bool isLocked() const { return locked; }
+
+    // Lowest level the governor may use (0.25 - 1)
+    void setMinScale(float scale);
+
+    // Feed one frame's timings; returns true if the scale changed
+    bool update(float cpuMs, float gpuMs, float budgetMs);
+
+    float getScale() const;
+    float getFrameMs() const { return frameMs; }
+    const std::deque<Change>& getLog() const { return log; }
+
+private:
+    static const float LEVELS[];
+    static const int LEVEL_COUNT;
+
+    bool enabled = false;
+    bool locked = false;
+    int level = 0;
+    int maxLevel = 0;
+
+    float frameMs = 0.0f;
+    bool hasSample = false;
+    int overBudgetFrames = 0;
+    int headroomFrames = 0;
+    int cooldownFrames = 0;
+
+    std::deque<Change> log;
+
+    void setLevel(int newLevel, float budgetMs);
+};
+
+} // namespace dragonwaves
@@ -3,7 +3,7 @@
 namespace dragonwaves {
 
 ShaderBlock::ShaderBlock(const std::string& name, const std::string& shaderName)
-    : name(name), shaderName(shaderName) {
+    : name(name), shaderName(shaderName), variants(shaderName) {
 }
 
 void ShaderBlock::setup(int w, int h) {
@@ -15,30 +15,118 @@ void ShaderBlock::setup(int w, int h) {
         ofLogError("ShaderBlock") << "Failed to load shader: " << shaderName;
     }
     
+    // Parameter uniform buffer (plain uniforms if unavailable)
+    paramBuffer.setup(shader, name + "Params");
+    variants.clear();
+    activeShader = &shader;
+    
+    for (ColorLut* lut : colorLuts) {
+        lut->setup();
+    }
+    
     // Allocate output FBO
-    allocateFbo(outputFbo, width, height);
+    allocateOutput();
     
     initialized = true;
     
-    ofLogNotice("ShaderBlock") << name << " initialized at " << width << "x" << height;
+    ofLogNotice("ShaderBlock") << name << " initialized at " << outputFbo.getWidth() << "x" << outputFbo.getHeight();
 }
 
 void ShaderBlock::process() {
     if (!initialized) return;
     
     // Viewport and projection are already set by PipelineManager
-    // which calls outputFbo.begin() before shader.begin()
-    ofViewport(0, 0, width, height);
+    // which calls outputFbo.begin() before shader.begin(). The projection
+    // stays at full size, so a scaled FBO gets the same picture.
+    ofViewport(0, 0, outputFbo.getWidth(), outputFbo.getHeight());
     ofSetupScreenOrtho(width, height);
     // Note: FBO begin/clear is handled by PipelineManager
 }
 
+void ShaderBlock::setVariantsEnabled(bool enabled) {
+    variantsEnabled = enabled;
+    if (!enabled) {
+        activeShader = &shader;
+        variants.clear();
+    }
+}
+
+void ShaderBlock::setColorLutsEnabled(bool enabled) {
+    for (ColorLut* lut : colorLuts) {
+        lut->setEnabled(enabled);
+    }
+}
+
+int ShaderBlock::getActiveColorLutCount() const {
+    int count = 0;
+    for (const ColorLut* lut : colorLuts) {
+        if (lut->isActive()) count++;
+    }
+    return count;
+}
+
+float ShaderBlock::getColorLutMaxError() const {
+    float worst = 0.0f;
+    for (const ColorLut* lut : colorLuts) {
+        if (lut->isActive()) worst = std::max(worst, lut->getMaxError());
+    }
+    return worst;
+}
+
+bool ShaderBlock::updateVariants() {
+    if (!variantsEnabled) return false;
+    
+    ofShader* program = variants.compilePending();
+    if (!program) return false;
+    
+    paramBuffer.attach(*program);
+    
+    // The compile may have evicted the program we were drawing with;
+    // flushParams() picks again this frame
+    activeShader = &shader;
+    return true;
+}
+
+void ShaderBlock::flushParams() {
+    ofShader* program = &shader;
+    if (variantsEnabled && paramBuffer.isActive()) {
+        ofShader* variant = variants.get(paramBuffer.getSwitchKey(),
+                                         [this]() { return paramBuffer.getSwitchValues(); });
+        if (variant) program = variant;
+    }
+    
+    // Swap programs if the switches moved to (or away from) a built variant
+    if (program != activeShader) {
+        activeShader->end();
+        program->begin();
+        activeShader = program;
+    }
+    
+    paramBuffer.upload(*activeShader);
+}
+
 void ShaderBlock::resize(int w, int h) {
     width = w;
     height = h;
-    allocateFbo(outputFbo, width, height);
+    allocateOutput();
     
-    ofLogNotice("ShaderBlock") << name << " resized to " << width << "x" << height;
+    ofLogNotice("ShaderBlock") << name << " resized to " << outputFbo.getWidth() << "x" << outputFbo.getHeight();
+}
+
+void ShaderBlock::setRenderScale(float scale) {
+    scale = ofClamp(scale, 0.25f, 1.0f);
+    if (scale == renderScale) return;
+    renderScale = scale;
+    if (initialized) {
+        allocateOutput();
+        ofLogNotice("ShaderBlock") << name << " rendering at " << outputFbo.getWidth() << "x" << outputFbo.getHeight()
+                                   << " (scale " << renderScale << ")";
+    }
+}
+
+void ShaderBlock::allocateOutput() {
+    allocateFbo(outputFbo, std::max(1, (int)std::round(width * renderScale)),
+                std::max(1, (int)std::round(height * renderScale)));
 }
 
 void ShaderBlock::clear() {
@@ -54,6 +142,9 @@ void ShaderBlock::allocateFbo(ofFbo& fbo, int w, int h) {
     settings.internalformat = GL_RGBA8;
     settings.useDepth = false;
     settings.useStencil = false;
+    // Linear, so readers upsample scaled blocks smoothly
+    settings.minFilter = GL_LINEAR;
+    settings.maxFilter = GL_LINEAR;
     fbo.allocate(settings);
     fbo.begin();
     ofClear(0, 0, 0, 255);
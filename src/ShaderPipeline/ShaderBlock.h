@@ -2,9 +2,22 @@
 
 #include "ofMain.h"
 #include "../ShaderLoader.h"
+#include "ParamBuffer.h"
+#include "ShaderVariantCache.h"
+#include "GpuTimer.h"
+#include "LayerTransform.h"
+#include "ColorLut.h"
 
 namespace dragonwaves {
 
+//==============================================================================
+// Location of one frame in a feedback history (see DelayBuffer)
+//==============================================================================
+struct HistoryTap {
+    int tier = 0;      // 0 = full quality array, 1 = older (compressed) array
+    int layer = -1;    // texture array layer, -1 = empty (reads as black)
+};
+
 //==============================================================================
 // Base class for shader blocks
 //==============================================================================
@@ -26,13 +39,47 @@ public:
     // Resize
     virtual void resize(int width, int height);
     
+    // Render at a fraction of the block's resolution. The shader keeps
+    // working in full size pixel coordinates (so geometry parameters mean
+    // the same), only the output FBO shrinks; readers sample it filtered.
+    void setRenderScale(float scale);
+    float getRenderScale() const { return renderScale; }
+    
+    // Full size the shader works in (the FBO may be smaller, see above)
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    
     // Clear
     virtual void clear();
     
     const std::string& getName() const { return name; }
     
-    // Shader access for PipelineManager
-    ofShader& getShader() { return shader; }
+    // Shader access for PipelineManager. This is the program that will draw:
+    // the specialized variant for the current switches if one is ready,
+    // otherwise the generic program. It can change inside process().
+    ofShader& getShader() { return *activeShader; }
+    
+    // Specialized program variants (see ShaderVariantCache)
+    void setVariantsEnabled(bool enabled);
+    bool isSpecialized() const { return activeShader != &shader; }
+    const ShaderVariantCache& getVariantCache() const { return variants; }
+    
+    // Install a variant once its background compile has finished (and start
+    // one that has settled). Returns true if it installed one (callers limit
+    // this to one block per frame).
+    bool updateVariants();
+    
+    // GPU time of the block's draw, split by generic (0) / specialized (1)
+    void beginGpuTimer() { gpuTimer.begin(isSpecialized() ? 1 : 0); }
+    void endGpuTimer() { gpuTimer.end(); gpuTimer.poll(); }
+    const GpuTimer& getGpuTimer() const { return gpuTimer; }
+    
+    // Colour chains baked into 3D LUTs (see ColorLut)
+    void setColorLutsEnabled(bool enabled);
+    int getColorLutCount() const { return (int)colorLuts.size(); }
+    int getActiveColorLutCount() const;
+    // Worst error of the LUTs in use, in 8-bit levels
+    float getColorLutMaxError() const;
     
 protected:
     std::string name;
@@ -41,10 +88,54 @@ protected:
     ofFbo outputFbo;
     int width = 0;
     int height = 0;
+    float renderScale = 1.0f;
     bool initialized = false;
     
+    // Parameters mirrored into the shader's "<name>Params" uniform block
+    // (see ParamBuffer). The setParam* helpers fall back to plain uniforms
+    // for anything not in the block.
+    ParamBuffer paramBuffer;
+    
+    void setParam1f(const char* n, float v) { paramBuffer.set1f(n, v); }
+    void setParam1i(const char* n, int v) { paramBuffer.set1i(n, v); }
+    void setParam2f(const char* n, float x, float y) { paramBuffer.set2f(n, x, y); }
+    void setParam3f(const char* n, float x, float y, float z) { paramBuffer.set3f(n, x, y, z); }
+    void setParam4f(const char* n, float x, float y, float z, float w) { paramBuffer.set4f(n, x, y, z, w); }
+    void setParamMatrix3f(const char* n, const glm::mat3& m) { paramBuffer.setMatrix3f(n, m); }
+    void setParamTexture(const char* n, ofTexture& tex, int unit) { paramBuffer.setTexture(n, tex, unit); }
+    void setParamTexture(const char* n, GLenum target, GLuint id, int unit) { paramBuffer.setTexture(n, target, id, unit); }
+    
+    // Bind a BlurPrepass result (or `fallback` with the switch off, so the
+    // sampler still has a valid 2D texture on its unit)
+    void setPrepassParams(const char* samplerName, const char* switchName,
+                          ofTexture* prepass, ofTexture& fallback, int unit) {
+        setParamTexture(samplerName, prepass ? *prepass : fallback, unit);
+        setParam1i(switchName, prepass ? 1 : 0);
+    }
+    
+    // Bind a layer's ColorLut texture and set its switch (the texture stays
+    // bound with the switch off, so the sampler always has a 3D texture)
+    void setColorLutParams(const char* samplerName, const char* switchName,
+                           ColorLut& lut, bool use, int unit) {
+        setParamTexture(samplerName, GL_TEXTURE_3D, lut.getTextureId(), unit);
+        setParam1i(switchName, use ? 1 : 0);
+    }
+    
+    // Pick the program for the current switches and upload changed
+    // parameters - call at the end of process()
+    void flushParams();
+    
+    ShaderVariantCache variants;
+    ofShader* activeShader = &shader;
+    bool variantsEnabled = true;
+    GpuTimer gpuTimer;
+    
+    // Per-layer LUTs owned by the subclass, registered in its constructor
+    std::vector<ColorLut*> colorLuts;
+    
     // Helper to allocate GPU-only FBO
     void allocateFbo(ofFbo& fbo, int w, int h);
+    void allocateOutput();
 };
 
 } // namespace dragonwaves
@@ -0,0 +1,124 @@
+#include "ShaderCompiler.h"
+#include "../Core/FrameTracer.h"
+#include <GLFW/glfw3.h>
+
+namespace dragonwaves {
+
+ShaderCompiler::~ShaderCompiler() {
+    // Normally shut down already; past glfwTerminate() the context can only leak
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        worker.join();
+    }
+}
+
+bool ShaderCompiler::setup() {
+    if (worker.joinable()) return true;
+
+#ifdef TARGET_OPENGLES
+    ofLogNotice("ShaderCompiler") << "No worker context on GLES, compiling variants synchronously";
+    return false;
+#else
+    GLFWwindow* shared = glfwGetCurrentContext();
+    if (!shared || !ofGetGLRenderer()) {
+        ofLogWarning("ShaderCompiler") << "No current GL context, compiling variants synchronously";
+        return false;
+    }
+    if (!ShaderLoader::isBinaryCacheSupported()) {
+        ofLogNotice("ShaderCompiler") << "Program binaries can't be restored, compiling variants synchronously";
+        return false;
+    }
+
+    // A hidden 1x1 window whose context shares objects with the render context
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (ofIsGLProgrammableRenderer()) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, ofGetGLRenderer()->getGLVersionMajor());
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ofGetGLRenderer()->getGLVersionMinor());
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    }
+    context = glfwCreateWindow(1, 1, "shader compiler", nullptr, shared);
+    glfwDefaultWindowHints();
+    glfwMakeContextCurrent(shared);
+
+    if (!context) {
+        ofLogWarning("ShaderCompiler") << "Could not create a worker context, compiling variants synchronously";
+        return false;
+    }
+
+    stopping = false;
+    worker = std::thread(&ShaderCompiler::threadedFunction, this);
+    ofLogNotice("ShaderCompiler") << "Compiling shader variants in the background";
+    return true;
+#endif
+}
+
+void ShaderCompiler::shutdown() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        worker.join();
+    }
+    queue.clear();
+
+    if (context) {
+        glfwDestroyWindow(context);
+        context = nullptr;
+    }
+}
+
+ShaderCompiler::JobPtr ShaderCompiler::submit(const std::string& shaderName, const std::map<std::string, int>& defines) {
+    if (!worker.joinable()) return nullptr;
+
+    auto job = std::make_shared<Job>();
+    job->shaderName = shaderName;
+    job->defines = defines;
+    if (!ShaderLoader::readVariantSources(shaderName, defines, job->vertSource, job->fragSource) ||
+        !ShaderLoader::canRestoreBinary(job->vertSource, job->fragSource)) {
+        return nullptr;
+    }
+    job->header = ofGLSLGetDefaultHeader();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(job);
+    }
+    condition.notify_one();
+    return job;
+}
+
+void ShaderCompiler::threadedFunction() {
+    FrameTracer::getInstance().setThreadName("shader compiler");
+    glfwMakeContextCurrent(context);
+
+    while (true) {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return !queue.empty() || stopping; });
+            if (stopping) break;
+            job = queue.front();
+            queue.pop_front();
+        }
+
+        {
+            TraceScope trace("ShaderCompiler::compile");
+            uint64_t start = ofGetElapsedTimeMicros();
+            job->linked = ShaderLoader::compileBinary(job->vertSource, job->fragSource, job->header, job->binary);
+            job->compileMs = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+        }
+        job->done.store(true, std::memory_order_release);
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+} // namespace dragonwaves
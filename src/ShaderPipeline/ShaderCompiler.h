@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../ShaderLoader.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct GLFWwindow;
+
+namespace dragonwaves {
+
+//==============================================================================
+// Background shader compiler
+//
+// Compiles and links shader variants on a worker thread with its own hidden
+// GL context (shared with the render context, so binaries are for the same
+// driver), so a compile never stalls a frame. The worker only makes plain GL
+// calls and hands back a program binary: ofShader keeps global state that
+// isn't thread safe, so the caller builds the ofShader from the binary on
+// the main thread once the job isDone() (ShaderLoader::loadFromBinary).
+//
+// Only available where a binary can be restored into an ofShader (see
+// ShaderLoader::canRestoreBinary); submit() returns null otherwise, and the
+// caller compiles synchronously.
+//==============================================================================
+class ShaderCompiler {
+public:
+    struct Job {
+        std::string shaderName;
+        std::map<std::string, int> defines;
+        std::string vertSource;
+        std::string fragSource;
+        std::string header;                     // OF_GLSL_SHADER_HEADER replacement
+        ShaderLoader::ProgramBinary binary;
+        bool linked = false;
+        float compileMs = 0.0f;
+
+        bool isDone() const { return done.load(std::memory_order_acquire); }
+
+    private:
+        friend class ShaderCompiler;
+        std::atomic<bool> done{false};
+    };
+    typedef std::shared_ptr<Job> JobPtr;
+
+    static ShaderCompiler& getInstance() {
+        static ShaderCompiler instance;
+        return instance;
+    }
+
+    // Create the worker context and thread. Call on the main thread with
+    // the render context current.
+    bool setup();
+
+    // Finish the job in progress, stop the worker and destroy its context
+    // (main thread, before the window goes)
+    void shutdown();
+
+    // Queue a variant of shaderName with `defines` (see ShaderLoader::loadVariant).
+    // Null if there's no worker or its binary couldn't be restored.
+    JobPtr submit(const std::string& shaderName, const std::map<std::string, int>& defines);
+
+    bool isAsync() const { return worker.joinable(); }
+
+private:
+    ShaderCompiler() = default;
+    ~ShaderCompiler();
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    void threadedFunction();
+
+    GLFWwindow* context = nullptr;
+    std::thread worker;
+    std::deque<JobPtr> queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+} // namespace dragonwaves
@@ -0,0 +1,128 @@
+#include "ShaderVariantCache.h"
+#include "../ShaderLoader.h"
+
+namespace dragonwaves {
+
+ShaderVariantCache::ShaderVariantCache(const std::string& shaderName)
+    : shaderName(shaderName) {
+}
+
+void ShaderVariantCache::setCapacity(int variants) {
+    capacity = std::max(variants, 1);
+    while ((int)entries.size() > capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+}
+
+ofShader* ShaderVariantCache::get(const std::string& key, const std::function<std::map<std::string, int>()>& defines) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        // Move to front (most recently used)
+        entries.splice(entries.begin(), entries, it->second);
+        hits++;
+        return it->second->program.get();
+    }
+
+    misses++;
+    if (key == jobKey) return nullptr;  // already compiling
+
+    uint64_t now = ofGetFrameNum();
+    auto queued = pending.emplace(key, Pending());
+    Pending& p = queued.first->second;
+    if (queued.second) {
+        p.defines = defines();
+    } else if (p.lastFrame == now) {
+        return nullptr;  // requested twice this frame
+    }
+    p.frames++;
+    p.lastFrame = now;
+    return nullptr;
+}
+
+ofShader* ShaderVariantCache::compilePending() {
+    if (!job) {
+        // Drop keys no longer requested, and pick the most recently
+        // requested of those that have settled
+        uint64_t now = ofGetFrameNum();
+        auto settled = pending.end();
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (now - it->second.lastFrame > STALE_FRAMES) {
+                it = pending.erase(it);
+                continue;
+            }
+            if (it->second.frames >= SETTLE_FRAMES &&
+                (settled == pending.end() || it->second.lastFrame > settled->second.lastFrame)) {
+                settled = it;
+            }
+            ++it;
+        }
+        if (settled == pending.end()) return nullptr;
+
+        std::string key = settled->first;
+        std::map<std::string, int> defines = std::move(settled->second.defines);
+        pending.erase(settled);
+
+        job = ShaderCompiler::getInstance().submit(shaderName, defines);
+        if (!job) {
+            // No worker (or no way back from a binary): compile here
+            auto program = std::make_unique<ofShader>();
+            uint64_t start = ofGetElapsedTimeMicros();
+            if (!ShaderLoader::loadVariant(*program, shaderName, defines)) program.reset();
+            return install(key, std::move(program), (ofGetElapsedTimeMicros() - start) / 1000.0f);
+        }
+        jobKey = key;
+    }
+
+    // Keep drawing with the generic program until the worker has linked it
+    if (!job->isDone()) return nullptr;
+
+    // The ofShader itself is only ever built on this thread
+    auto program = std::make_unique<ofShader>();
+    bool ok = job->linked &&
+              ShaderLoader::loadFromBinary(*program, shaderName, job->vertSource, job->fragSource, job->binary);
+    if (!ok && job->linked) {
+        // The driver rejected its own binary: compile here after all
+        ok = ShaderLoader::loadVariant(*program, shaderName, job->defines);
+    }
+    if (!ok) program.reset();
+
+    std::string key = std::move(jobKey);
+    float compileMs = job->compileMs;
+    jobKey.clear();
+    job.reset();
+    return install(key, std::move(program), compileMs);
+}
+
+ofShader* ShaderVariantCache::install(const std::string& key, std::unique_ptr<ofShader> program, float compileMs) {
+    lastCompileMs = compileMs;
+    compiles++;
+
+    if (program) {
+        ofLogNotice("ShaderVariantCache") << shaderName << ": compiled variant " << compiles
+                                          << " in " << lastCompileMs << " ms";
+    } else {
+        // Keep the failed entry so the same key isn't retried every frame
+        ofLogWarning("ShaderVariantCache") << shaderName << ": variant failed, using generic program";
+    }
+
+    entries.push_front({ key, std::move(program) });
+    index[key] = entries.begin();
+
+    setCapacity(capacity);  // evict least recently used
+
+    return entries.front().program.get();
+}
+
+void ShaderVariantCache::clear() {
+    entries.clear();
+    index.clear();
+    pending.clear();
+
+    // A compile in flight would install a stale program (the worker still
+    // finishes it; the job only holds its binary)
+    job.reset();
+    jobKey.clear();
+}
+
+} // namespace dragonwaves
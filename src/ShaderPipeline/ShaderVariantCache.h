@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ShaderCompiler.h"
+#include <list>
+
+namespace dragonwaves {
+
+//==============================================================================
+// LRU cache of specialized shader programs
+//
+// The block shaders branch per pixel on int switches (mirrors, mix types,
+// key order...) that only change when the operator flips a toggle. A
+// variant is the same shader compiled with each switch #defined to its
+// current value, so the compiler can drop the untaken branches.
+//
+// get() never compiles: a miss queues the key and returns nullptr, and the
+// caller keeps drawing with the generic program. Each queued key counts the
+// distinct frames it was requested on, so keys that alternate (Block1's
+// CHANNELS and MIX stages on new-input frames) settle side by side; keys not
+// seen for a while are dropped, so sweeping through switch values doesn't
+// compile every combination. compilePending() hands a settled key to the
+// ShaderCompiler and, once the worker has linked it, builds the variant's
+// ofShader from the binary (or compiles right away where there's no worker).
+//==============================================================================
+class ShaderVariantCache {
+public:
+    static constexpr int DEFAULT_CAPACITY = 8;
+    static constexpr int SETTLE_FRAMES = 15;  // frames a key must be requested on before compiling
+    static constexpr int STALE_FRAMES = 60;   // queued keys not requested this long are dropped
+
+    ShaderVariantCache(const std::string& shaderName);
+
+    void setCapacity(int variants);
+
+    // Variant for `key`, or nullptr if it isn't built yet (then it is queued,
+    // with `defines` describing it)
+    ofShader* get(const std::string& key, const std::function<std::map<std::string, int>()>& defines);
+
+    // Install the variant whose compile has finished, or start compiling the
+    // queued one if it has settled. Returns a newly installed program (so the
+    // caller can attach its uniform buffer), or nullptr.
+    ofShader* compilePending();
+
+    void clear();
+
+    int getSize() const { return (int)entries.size(); }
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    uint64_t getCompileCount() const { return compiles; }
+    float getLastCompileMs() const { return lastCompileMs; }
+
+private:
+    struct Entry {
+        std::string key;
+        std::unique_ptr<ofShader> program;   // null if compilation failed
+    };
+
+    ofShader* install(const std::string& key, std::unique_ptr<ofShader> program, float compileMs);
+
+    std::string shaderName;
+    int capacity = DEFAULT_CAPACITY;
+
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+    // Queued keys waiting to settle
+    struct Pending {
+        std::map<std::string, int> defines;
+        int frames = 0;           // distinct frames the key was requested on
+        uint64_t lastFrame = 0;
+    };
+    std::unordered_map<std::string, Pending> pending;
+
+    // Compile in flight, and the key it was submitted for
+    ShaderCompiler::JobPtr job;
+    std::string jobKey;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t compiles = 0;
+    float lastCompileMs = 0.0f;
+};
+
+} // namespace dragonwaves
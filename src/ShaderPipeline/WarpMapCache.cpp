@@ -0,0 +1,90 @@
+#include "WarpMapCache.h"
+
+namespace dragonwaves {
+
+WarpMapCache::WarpMapCache(int layerCount)
+    : slots(layerCount) {
+}
+
+void WarpMapCache::setEnabled(bool e) {
+    if (e == enabled) return;
+    enabled = e;
+    invalidate();
+    if (!enabled) fbo.clear();
+    ofLogNotice("WarpMapCache") << (enabled ? "Enabled" : "Disabled");
+}
+
+void WarpMapCache::allocate(int width, int height) {
+    if (!enabled) return;
+    if (fbo.isAllocated() && fbo.getWidth() == width && fbo.getHeight() == height) return;
+
+    ofFboSettings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.numColorbuffers = (int)slots.size();
+    settings.internalformat = GL_RG32F;
+    settings.useDepth = false;
+    settings.useStencil = false;
+    // The block samples texel centres at the same size
+    settings.minFilter = GL_NEAREST;
+    settings.maxFilter = GL_NEAREST;
+    fbo.allocate(settings);
+    invalidate();
+
+    ofLogVerbose("WarpMapCache") << "Allocated " << slots.size() << " maps at " << width << "x" << height;
+}
+
+void WarpMapCache::invalidate() {
+    for (Slot& slot : slots) {
+        slot.valid = false;
+        slot.baking = false;
+    }
+}
+
+void WarpMapCache::update(int layer, bool used, const std::vector<float>& key) {
+    Slot& slot = slots[layer];
+    slot.used = used;
+    slot.baking = false;
+
+    if (key != slot.key) {
+        slot.key = key;
+        slot.settledFrames = 0;
+        slot.valid = false;
+    } else if (slot.settledFrames < SETTLE_FRAMES) {
+        slot.settledFrames++;
+    }
+
+    if (!enabled || !used) return;
+
+    if (slot.valid) {
+        stats.hits++;
+        return;
+    }
+    stats.misses++;
+    // Parameters moving: live math until they settle
+    slot.baking = fbo.isAllocated() && slot.settledFrames >= SETTLE_FRAMES;
+}
+
+bool WarpMapCache::needsBake() const {
+    for (const Slot& slot : slots) {
+        if (slot.baking) return true;
+    }
+    return false;
+}
+
+void WarpMapCache::commit() {
+    for (Slot& slot : slots) {
+        if (!slot.baking) continue;
+        slot.valid = true;
+        slot.baking = false;
+        stats.bakes++;
+    }
+}
+
+ofTexture* WarpMapCache::getMap(int layer) {
+    const Slot& slot = slots[layer];
+    if (!enabled || !slot.used || !slot.valid) return nullptr;
+    return &fbo.getTexture(layer);
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace dragonwaves {
+
+//==============================================================================
+// Baked per-layer geometry
+//
+// Mirrors, kaleidoscope, displace/zoom/rotate/shear and the overflow wrap
+// map every pixel of a layer to a sampling coordinate that depends only on
+// the layer's geometry parameters, yet the block shaders worked it out per
+// pixel every frame. Once a layer's geometry has been still for
+// SETTLE_FRAMES renders the block draws a bake pass that writes the final
+// coordinates into a texture, and its layer does a single fetch from it
+// until the parameters move again.
+//
+// Moving parameters (LFOs, audio/BPM modulation, a knob being turned) keep
+// the layer on the live math until they settle, so an animated layer never
+// re-bakes every frame. The maps are RG32F at the block's output size:
+// coordinates are in pixels, and half float can't hold sub-pixel offsets at
+// HD sizes.
+//==============================================================================
+class WarpMapCache {
+public:
+    static constexpr int SETTLE_FRAMES = 8;
+
+    // Layer-frames read from a baked map (hits) or worked out live (misses),
+    // and bake passes, since startup
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t bakes = 0;
+    };
+
+    explicit WarpMapCache(int layerCount);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Match the block's output FBO (drops the baked maps on a change)
+    void allocate(int width, int height);
+    void invalidate();
+
+    // Per block render, per layer: whether it is used and everything its
+    // coordinates depend on
+    void update(int layer, bool used, const std::vector<float>& key);
+
+    // Layers to bake this frame: draw the bake pass to the FBO (only their
+    // draw buffers), then commit()
+    bool needsBake() const;
+    bool isBaking(int layer) const { return slots[layer].baking; }
+    void commit();
+    ofFbo& getFbo() { return fbo; }
+
+    // The layer's map if it reads one this frame, nullptr for live math
+    ofTexture* getMap(int layer);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Slot {
+        std::vector<float> key;
+        int settledFrames = 0;
+        bool used = false;
+        bool valid = false;
+        bool baking = false;
+    };
+
+    ofFbo fbo;
+    std::vector<Slot> slots;
+    bool enabled = true;
+    Stats stats;
+};
+
+} // namespace dragonwaves
@@ -1,5 +1,6 @@
 #include "TempoManager.h"
 #include "../Core/SettingsManager.h"
+#include "../Core/FrameClock.h"
 
 namespace dragonwaves {
 
@@ -91,7 +92,7 @@ TempoManager::TempoManager() {
 void TempoManager::setup(const TempoSettings& newSettings) {
     settings = newSettings;
     settings.bpm = ofClamp(settings.bpm, settings.minBpm, settings.maxBpm);
-    lastUpdateTime = ofGetElapsedTimef();
+    lastUpdateTime = FrameClock::getInstance().getElapsedTime();
 }
 
 void TempoManager::update(float deltaTime) {
@@ -101,7 +102,7 @@ void TempoManager::update(float deltaTime) {
     
     // Check for tap timeout
     if (settings.autoResetTap && tapTimes.size() > 0) {
-        float timeSinceLastTap = ofGetElapsedTimef() - lastTapTime;
+        float timeSinceLastTap = FrameClock::getInstance().getElapsedTime() - lastTapTime;
         if (timeSinceLastTap > settings.tapTimeout) {
             resetTap();
         }
@@ -136,7 +137,7 @@ void TempoManager::advancePhase(float deltaTime) {
 }
 
 void TempoManager::tap() {
-    float currentTime = ofGetElapsedTimef();
+    float currentTime = FrameClock::getInstance().getElapsedTime();
     
     // First tap always resets phase to 0 (beat starts now)
     if (tapTimes.empty()) {
@@ -241,7 +242,7 @@ float TempoManager::getCalculatedBpm() const {
 
 bool TempoManager::isTapPending() const {
     if (tapTimes.empty()) return false;
-    float timeSinceLastTap = ofGetElapsedTimef() - lastTapTime;
+    float timeSinceLastTap = FrameClock::getInstance().getElapsedTime() - lastTapTime;
     return timeSinceLastTap < settings.tapTimeout;
 }
 
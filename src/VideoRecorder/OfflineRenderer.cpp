@@ -0,0 +1,116 @@
+#include "OfflineRenderer.h"
+
+namespace dragonwaves {
+
+OfflineRenderSettings OfflineRenderSettings::fromArgs(int argc, char* argv[]) {
+    OfflineRenderSettings settings;
+    std::vector<std::string> ignored;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--render") {
+            settings.enabled = true;
+        } else if (arg == "--preset" && hasValue) {
+            settings.preset = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            settings.frames = std::max(1, ofToInt(argv[++i]));
+        } else if (arg == "--fps" && hasValue) {
+            settings.fps = std::max(1.0f, ofToFloat(argv[++i]));
+        } else if (arg == "--output" && hasValue) {
+            settings.output = argv[++i];
+        } else if (arg == "--format" && hasValue) {
+            settings.format = ofToLower(argv[++i]);
+        } else if (arg == "--input1" && hasValue) {
+            settings.input1 = argv[++i];
+        } else if (arg == "--input2" && hasValue) {
+            settings.input2 = argv[++i];
+        } else if (arg == "--size" && hasValue) {
+            auto size = ofSplitString(ofToLower(argv[++i]), "x");
+            if (size.size() == 2 && ofToInt(size[0]) > 0 && ofToInt(size[1]) > 0) {
+                settings.width = ofToInt(size[0]);
+                settings.height = ofToInt(size[1]);
+            } else {
+                ofLogWarning("OfflineRenderSettings") << "Ignoring --size " << argv[i] << " (expected WxH)";
+            }
+        } else if (arg == "--zero-copy" && hasValue) {
+            settings.zeroCopyFeedback = ofToInt(argv[++i]) != 0 ? 1 : 0;
+        } else if (arg == "--variants" && hasValue) {
+            settings.shaderVariants = ofToInt(argv[++i]) != 0 ? 1 : 0;
+        } else {
+            ignored.push_back(arg);
+        }
+    }
+    // Only worth mentioning when rendering (the OS may pass its own arguments)
+    if (settings.enabled) {
+        for (const auto& arg : ignored) {
+            ofLogWarning("OfflineRenderSettings") << "Ignoring argument " << arg;
+        }
+    }
+    return settings;
+}
+
+bool OfflineRenderer::setup(const OfflineRenderSettings& s) {
+    settings = s;
+    frameCount = 0;
+    closed = false;
+
+    if (settings.format == "raw") {
+        std::string path = ofToDataPath(settings.output, true);
+        ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(path), false, true);
+        raw.open(path, std::ios::binary | std::ios::trunc);
+        if (!raw) {
+            ofLogError("OfflineRenderer") << "Could not open " << path;
+            return false;
+        }
+    } else if (settings.format == "png" || settings.format == "jpg" || settings.format == "tif") {
+        ofDirectory::createDirectory(settings.output, true, true);
+    } else {
+        ofLogError("OfflineRenderer") << "Unknown format " << settings.format << " (png, jpg, tif or raw)";
+        return false;
+    }
+
+    ofLogNotice("OfflineRenderer") << "Rendering " << settings.frames << " frames at " << settings.fps
+                                   << " fps to " << settings.output << " (" << settings.format << ")";
+    startMicros = ofGetElapsedTimeMicros();
+    return true;
+}
+
+bool OfflineRenderer::writeFrame(ofFbo& source) {
+    if (isDone()) return true;
+
+    source.readToPixels(pixels);
+    if (pixels.getNumChannels() != 4) {
+        pixels.setNumChannels(4);
+    }
+
+    if (raw.is_open()) {
+        raw.write(reinterpret_cast<const char*>(pixels.getData()), pixels.size());
+        if (!raw) {
+            ofLogError("OfflineRenderer") << "Write failed at frame " << frameCount;
+            return false;
+        }
+    } else {
+        std::string path = settings.output + "/frame_" + ofToString(frameCount, 5, '0') + "." + settings.format;
+        if (!ofSaveImage(pixels, path)) {
+            ofLogError("OfflineRenderer") << "Could not save " << path;
+            return false;
+        }
+    }
+
+    frameCount++;
+    return true;
+}
+
+void OfflineRenderer::close() {
+    if (closed) return;
+    closed = true;
+    if (raw.is_open()) raw.close();
+
+    float seconds = (ofGetElapsedTimeMicros() - startMicros) / 1.0e6f;
+    ofLogNotice("OfflineRenderer") << "Wrote " << frameCount << " frames ("
+                                   << pixels.getWidth() << "x" << pixels.getHeight() << ") in "
+                                   << seconds << " s, " << (seconds > 0.0f ? frameCount / seconds : 0.0f)
+                                   << " frames/s";
+}
+
+} // namespace dragonwaves
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ofMain.h"
+#include <fstream>
+
+namespace dragonwaves {
+
+//==============================================================================
+// Offline render settings, from the command line:
+//
+//   --render [--preset file.json] [--frames N] [--fps F] [--output path]
+//            [--format png|jpg|tif|raw] [--input1 video] [--input2 video]
+//            [--size WxH] [--zero-copy 0|1] [--variants 0|1]
+//
+// --size, --zero-copy and --variants override the display settings for
+// this run, so A/B benchmarks don't need config.json edits.
+// Relative paths are inside data/. Without --inputN that input stays empty.
+// The GL context is a hidden GLFW window, so Linux still needs an X server
+// (xvfb-run on headless machines).
+//==============================================================================
+struct OfflineRenderSettings {
+    bool enabled = false;
+    std::string preset;
+    int frames = 300;
+    float fps = 30.0f;              // fixed clock step, not a frame cap
+    std::string output = "render";  // image sequence folder, or the raw file
+    std::string format = "png";     // raw: RGBA8 frames back to back
+    std::string input1;
+    std::string input2;
+    int width = 0;                  // internal and output resolution (0 = from settings)
+    int height = 0;
+    int zeroCopyFeedback = -1;      // 0/1 (-1 = from settings)
+    int shaderVariants = -1;
+
+    static OfflineRenderSettings fromArgs(int argc, char* argv[]);
+};
+
+//==============================================================================
+// Writes the final output of each frame of an offline render
+//
+// Readback is synchronous: offline there is no frame deadline to protect,
+// and each frame on disk has to be the frame just rendered.
+//==============================================================================
+class OfflineRenderer {
+public:
+    bool setup(const OfflineRenderSettings& settings);
+
+    // Returns false on a write error
+    bool writeFrame(ofFbo& source);
+    bool isDone() const { return frameCount >= settings.frames; }
+    int getFrameCount() const { return frameCount; }
+
+    // Logs the totals
+    void close();
+
+private:
+    OfflineRenderSettings settings;
+    ofPixels pixels;
+    std::ofstream raw;
+    int frameCount = 0;
+    uint64_t startMicros = 0;
+    bool closed = false;
+};
+
+} // namespace dragonwaves
@@ -1,4 +1,5 @@
 #include "VideoRecorder.h"
+#include "../Core/FrameTracer.h"
 #include "ofUtils.h"
 
 #if !defined(TARGET_WIN32)
@@ -14,11 +15,6 @@ VideoRecorder::VideoRecorder() {
 //==============================================================================
 VideoRecorder::~VideoRecorder() {
     stopRecording();
-    
-    // Clean up PBOs
-    if (pbosInitialized_) {
-        glDeleteBuffers(NUM_PBOS, pboIds_);
-    }
 }
 
 //==============================================================================
@@ -33,33 +29,11 @@ void VideoRecorder::setup(int width, int height, const VideoRecorderSettings& se
         dir.create(true);
     }
     
-    // Setup PBOs for async readback
-    setupPBOs();
-    
     ofLogNotice("VideoRecorder") << "Setup: " << width_ << "x" << height_ 
                                  << " @ " << settings_.fps << "fps"
                                  << " codec: " << settings_.codec;
 }
 
-//==============================================================================
-void VideoRecorder::setupPBOs() {
-    if (pbosInitialized_ || width_ == 0 || height_ == 0) return;
-    
-    glGenBuffers(NUM_PBOS, pboIds_);
-    
-    int dataSize = width_ * height_ * 4;  // RGBA
-    
-    for (int i = 0; i < NUM_PBOS; i++) {
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds_[i]);
-        glBufferData(GL_PIXEL_PACK_BUFFER, dataSize, nullptr, GL_STREAM_READ);
-    }
-    
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    pbosInitialized_ = true;
-    
-    ofLogNotice("VideoRecorder") << "PBOs initialized";
-}
-
 //==============================================================================
 void VideoRecorder::setSettings(const VideoRecorderSettings& settings) {
     settings_ = settings;
@@ -87,6 +61,7 @@ bool VideoRecorder::startRecording(const std::string& filename) {
     // Reset counters
     droppedFrames_ = 0;
     frameCount_ = 0;
+    hasLastFrame_ = false;
     startTime_ = ofGetElapsedTimeMillis();
     shouldStop_ = false;
     
@@ -136,58 +111,34 @@ void VideoRecorder::stopRecording() {
 }
 
 //==============================================================================
-void VideoRecorder::captureFrame(ofFbo& source) {
-    if (!isRecording_.load() || !pbosInitialized_) return;
-    
-    // Async PBO readback
-    readbackPBO(source);
-}
-
-//==============================================================================
-void VideoRecorder::readbackPBO(ofFbo& source) {
-    // Use next PBO
-    int nextPboIndex = (pboIndex_ + 1) % NUM_PBOS;
-    int readPboIndex = (pboIndex_ + 2) % NUM_PBOS;
-    
-    // Read from oldest PBO (3 frames ago) - ensures GPU is done
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds_[readPboIndex]);
-    
-    GLubyte* ptr = (GLubyte*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
-    if (ptr) {
-        // Try to add to queue (non-blocking)
-        RecordFrame frame;
-        frame.pixels.allocate(width_, height_, 4);  // RGBA
-        frame.pixels.setFromPixels(ptr, width_, height_, 4);
-        frame.timestamp = ofGetElapsedTimeMillis();
-        
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            
-            if (frameQueue_.size() < MAX_QUEUE_SIZE) {
-                frameQueue_.push(std::move(frame));
-                queueCondition_.notify_one();
-            } else {
-                droppedFrames_++;
-            }
-        }
-        
-        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+void VideoRecorder::captureFrame(const BusFramePtr& frame) {
+    TraceScope trace("VideoRecorder::captureFrame");
+    if (!isRecording_.load() || !frame) return;
+    if (hasLastFrame_ && frame->frameNum == lastFrameNum_) return;
+    
+    // FFmpeg was started at this size
+    if (frame->pixels.getWidth() != width_ || frame->pixels.getHeight() != height_) return;
+    
+    lastFrameNum_ = frame->frameNum;
+    hasLastFrame_ = true;
+    
+    // Queue the shared frame itself (non-blocking, no copy)
+    RecordFrame record;
+    record.frame = frame;
+    record.timestamp = ofGetElapsedTimeMillis();
+    
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    if (frameQueue_.size() < MAX_QUEUE_SIZE) {
+        frameQueue_.push(std::move(record));
+        queueCondition_.notify_one();
+    } else {
+        droppedFrames_++;
     }
-    
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds_[nextPboIndex]);
-    
-    // Initiate async read from FBO to PBO
-    source.bind();
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-    source.unbind();
-    
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-    
-    pboIndex_ = nextPboIndex;
 }
 
 //==============================================================================
 void VideoRecorder::threadedFunction() {
+    FrameTracer::getInstance().setThreadName("recorder");
     while (isThreadRunning()) {
         RecordFrame frame;
         
@@ -209,8 +160,9 @@ void VideoRecorder::threadedFunction() {
         }
         
         // Write to FFmpeg
-        if (frame.pixels.isAllocated()) {
-            writeFrameToFFmpeg(frame.pixels);
+        if (frame.frame) {
+            TraceScope trace("VideoRecorder::writeFrame");
+            writeFrameToFFmpeg(frame.frame->pixels);
             frameCount_++;
         }
     }
@@ -2,6 +2,7 @@
 
 #include "ofMain.h"
 #include "ofThread.h"
+#include "../Output/FrameBus.h"
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -21,23 +22,28 @@ struct VideoRecorderSettings {
 };
 
 //==============================================================================
-// Frame buffer for async capture
+// Frame queued for the encoder (shared with the other frame bus consumers)
 //==============================================================================
 struct RecordFrame {
-    ofPixels pixels;
+    BusFramePtr frame;
     int64_t timestamp;
     
     RecordFrame() : timestamp(0) {}
-    RecordFrame(int w, int h, int channels) : timestamp(0) {
-        pixels.allocate(w, h, channels);
-    }
 };
 
 //==============================================================================
-// Async Video Recorder using PBO and FFmpeg
+// Async Video Recorder using FFmpeg
+//
+// Frames come from the output manager's frame bus: request() Block3 at the
+// recording size in order each frame, then captureFrame() every frame the
+// bus published, oldest first.
 //==============================================================================
 class VideoRecorder : public ofThread {
 public:
+    static constexpr int MAX_QUEUE_SIZE = 10;  // Drop frames if encoder can't keep up
+    // Frame bus frames held at once: queued and being encoded
+    static constexpr int HELD_FRAMES = MAX_QUEUE_SIZE + 1;
+    
     VideoRecorder();
     ~VideoRecorder();
     
@@ -49,8 +55,13 @@ public:
     void stopRecording();
     bool isRecording() const { return isRecording_.load(); }
     
-    // Capture frame (call from main thread, non-blocking)
-    void captureFrame(ofFbo& source);
+    // Capture frame (call from main thread, non-blocking). A frame already
+    // captured is skipped.
+    void captureFrame(const BusFramePtr& frame);
+    
+    // Recording size (what to request from the frame bus)
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
     
     // Settings
     void setSettings(const VideoRecorderSettings& settings);
@@ -68,10 +79,6 @@ private:
     // Background encoding thread
     void threadedFunction() override;
     
-    // PBO setup for async readback
-    void setupPBOs();
-    void readbackPBO(ofFbo& source);
-    
     // FFmpeg process
     bool startFFmpeg(const std::string& filename);
     void stopFFmpeg();
@@ -82,17 +89,14 @@ private:
     int width_ = 0;
     int height_ = 0;
     
-    // PBOs for async GPU readback (triple buffering)
-    static constexpr int NUM_PBOS = 3;
-    GLuint pboIds_[NUM_PBOS] = {0};
-    int pboIndex_ = 0;
-    bool pbosInitialized_ = false;
+    // Frame bus frame last queued
+    uint64_t lastFrameNum_ = 0;
+    bool hasLastFrame_ = false;
     
     // Frame queue (main thread writes, encoder thread reads)
     std::queue<RecordFrame> frameQueue_;
     mutable std::mutex queueMutex_;
     std::condition_variable queueCondition_;
-    static constexpr int MAX_QUEUE_SIZE = 10;  // Drop frames if encoder can't keep up
     
     // FFmpeg pipe
     FILE* ffmpegPipe_ = nullptr;
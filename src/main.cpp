@@ -4,7 +4,33 @@
 #include "ofAppGLFWWindow.h"
 
 //========================================================================
-int main() {
+// Headless offline render: one hidden window for the GL context, no GUI
+// window. Linux boxes without a display can run it under Xvfb.
+static int runOffline(const dragonwaves::OfflineRenderSettings& offline) {
+    ofGLFWWindowSettings settings;
+    settings.setGLVersion(3, 2);
+    settings.setSize(640, 360);
+    settings.visible = false;
+    shared_ptr<ofAppBaseWindow> window = ofCreateWindow(settings);
+    
+    // The GUI app is never run: it only holds the parameter state
+    shared_ptr<ofApp> mainApp(new ofApp);
+    shared_ptr<GuiApp> guiApp(new GuiApp);
+    mainApp->gui = guiApp;
+    guiApp->mainApp = mainApp.get();
+    mainApp->offline = offline;
+    
+    ofRunApp(window, mainApp);
+    return ofRunMainLoop();
+}
+
+//========================================================================
+int main(int argc, char* argv[]) {
+    dragonwaves::OfflineRenderSettings offline = dragonwaves::OfflineRenderSettings::fromArgs(argc, argv);
+    if (offline.enabled) {
+        return runOffline(offline);
+    }
+    
 #if defined(__APPLE__) && (defined(__arm64__) || defined(__aarch64__))
     // Apple Silicon - can use desktop OpenGL
     ofGLWindowSettings settings;
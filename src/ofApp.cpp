@@ -10,6 +10,9 @@
 #include "Output/OutputManager.h"
 #include "Geometry/GeometryRenderer.h"
 #include "Parameters/ParameterManager.h"
+#include "Core/FrameTracer.h"
+#include "Core/FrameClock.h"
+#include "ShaderPipeline/GpuProfiler.h"
 
 using namespace dragonwaves;
 
@@ -42,6 +45,12 @@ void ofApp::setup(){
     SettingsManager::getInstance().load();
     auto& settings = SettingsManager::getInstance();
     
+    // Headless: no GUI, OSC, audio or live inputs (see setupOffline)
+    if (offline.enabled) {
+        setupOffline();
+        return;
+    }
+    
     // Apply display settings
     ofSetFrameRate(settings.getDisplay().targetFPS);
     
@@ -114,6 +123,12 @@ void ofApp::setup(){
     // Initialize shader pipeline
     pipeline = std::make_unique<PipelineManager>();
     pipeline->setup(settings.getDisplay());
+    GpuProfiler::getInstance().setEnabled(settings.getDisplay().gpuProfiler);
+    
+    // CPU frame-phase tracing (see FrameTracer)
+    traceEnabled = settings.getDisplay().frameTracing;
+    FrameTracer::getInstance().setThreadName("main");
+    FrameTracer::getInstance().setEnabled(traceEnabled);
     
     // Initialize output manager
     outputManager = std::make_unique<OutputManager>();
@@ -142,6 +157,7 @@ void ofApp::setup(){
         gui->setAudioAnalyzer(audioAnalyzer.get());
         gui->setTempoManager(tempoManager.get());
         gui->syncAudioSettingsFromAnalyzer();  // Sync GUI with loaded settings
+        gui->gpuStatsOverlay = settings.getDisplay().gpuStatsOverlay;
     }
     
     // Initialize preset manager
@@ -149,7 +165,7 @@ void ofApp::setup(){
     
     // Initialize preview panel (AFTER pipeline is created)
     previewPanel = std::make_unique<dragonwaves::PreviewPanel>();
-    previewPanel->setup(pipeline.get());
+    previewPanel->setup(pipeline.get(), &outputManager->getFrameBus());
     
     // Set up color applied callback
     previewPanel->onColorApplied = [this](dragonwaves::ColorPicker::KeyTarget target, ofColor color) {
@@ -209,6 +225,7 @@ void ofApp::setup(){
     
     // Register Audio and Tempo parameters with OSC
     registerAudioTempoOscParams();
+    registerPipelineOscParams();
     
     // Initialize LFO thetas
     resetLfoThetas();
@@ -227,8 +244,81 @@ void ofApp::setup(){
     ofLogNotice("ofApp") << "Setup complete";
 }
 
+//--------------------------------------------------------------
+void ofApp::setupOffline() {
+    auto& settings = SettingsManager::getInstance();
+    
+    // Fixed clock and no frame cap: frames come out as fast as the hardware
+    // allows, and are the same however fast that is
+    FrameClock::getInstance().setFixedFps(offline.fps);
+    ofSetFrameRate(0);
+    
+    // The governor's scale would depend on the machine's speed
+    DisplaySettings display = settings.getDisplay();
+    display.resolutionGovernor = false;
+    
+    // Command line overrides, for A/B runs
+    if (offline.width > 0) {
+        display.internalWidth = display.outputWidth = offline.width;
+        display.internalHeight = display.outputHeight = offline.height;
+    }
+    if (offline.zeroCopyFeedback >= 0) display.zeroCopyFeedback = offline.zeroCopyFeedback == 1;
+    if (offline.shaderVariants >= 0) display.shaderVariants = offline.shaderVariants == 1;
+    
+    // Video files advance one frame per rendered frame; other inputs stay empty
+    inputManager = std::make_unique<InputManager>();
+    inputManager->setup(display);
+    inputManager->getVideoInput1()->setFrameStepping(true);
+    inputManager->getVideoInput2()->setFrameStepping(true);
+    inputManager->configureInput1(offline.input1.empty() ? InputType::NONE : InputType::VIDEO_FILE, 0, offline.input1);
+    inputManager->configureInput2(offline.input2.empty() ? InputType::NONE : InputType::VIDEO_FILE, 0, offline.input2);
+    
+    // Variants compile synchronously: with the background compiler the frame
+    // a variant takes over would depend on how long the worker took
+    pipeline = std::make_unique<PipelineManager>();
+    pipeline->setup(display, false);
+    GpuProfiler::getInstance().setEnabled(display.gpuProfiler);
+    
+    geometryManager = std::make_unique<GeometryManager>();
+    geometryManager->setup();
+    
+    // No audio input: audio modulation stays at rest, BPM modulation follows the clock
+    tempoManager = std::make_unique<TempoManager>();
+    tempoManager->setup(settings.getTempo());
+    pipeline->setTempoManager(tempoManager.get());
+    
+    // The (windowless) GUI holds the parameter state synced to the pipeline
+    gui->setupHeadless();
+    gui->setTempoManager(tempoManager.get());
+    if (!offline.preset.empty()) {
+        if (!ofFile::doesFileExist(offline.preset)) {
+            ofLogError("ofApp") << "Preset not found: " << offline.preset;
+            ofExit(1);
+            return;
+        }
+        gui->resetAll();
+        gui->loadPresetFile(offline.preset);
+    }
+    gui->drawMode = PipelineManager::DRAW_BLOCK3;
+    resetLfoThetas();
+    
+    offlineRenderer = std::make_unique<OfflineRenderer>();
+    if (!offlineRenderer->setup(offline)) {
+        offlineRenderer.reset();
+        ofExit(1);
+        return;
+    }
+    
+    ofLogNotice("ofApp") << "Offline setup complete";
+}
+
 //--------------------------------------------------------------
 void ofApp::update(){
+    TraceScope trace("ofApp::update");
+    frameWorkStartMicros = ofGetElapsedTimeMicros();
+    FrameClock::getInstance().tick();
+    GpuProfiler::getInstance().beginFrame();
+    
     // Update settings manager (file watching for runtime reload)
     SettingsManager::getInstance().update();
     
@@ -302,6 +392,7 @@ void ofApp::update(){
 
 //--------------------------------------------------------------
 void ofApp::draw(){
+    TraceScope trace("ofApp::draw");
     if (!pipeline) return;
     
     // Sync parameters from GUI to pipeline
@@ -309,33 +400,91 @@ void ofApp::draw(){
     
     // Apply audio/BPM modulations (after GUI sync, before shader processing)
     if (pipeline && (audioAnalyzer || tempoManager)) {
-        pipeline->updateModulations(ofGetLastFrameTime());
+        pipeline->updateModulations(FrameClock::getInstance().getDeltaTime());
     }
     
     // Set input textures
     pipeline->setInput1Texture(inputManager->getInput1Texture());
     pipeline->setInput2Texture(inputManager->getInput2Texture());
+    pipeline->setInputFramesNew(inputManager->isInput1FrameNew(), inputManager->isInput2FrameNew());
     
     // Draw geometry patterns FIRST (before shader processing)
     // This ensures geometry is rendered into the FBOs before they're used as textures
     drawGeometryPatterns();
     
+    // Declare the outputs the senders and recorder read this frame, so the
+    // pipeline can skip blocks nobody consumes (see RenderGraph)
+    unsigned block3Output = dragonwaves::RenderGraph::mask(dragonwaves::RenderGraph::BLOCK3);
+    unsigned sent = 0;
+    if (outputManager) {
+        if (outputManager->isNdiBlock1Enabled() || outputManager->isSpoutBlock1Enabled()) {
+            sent |= dragonwaves::RenderGraph::mask(dragonwaves::RenderGraph::BLOCK1);
+        }
+        if (outputManager->isNdiBlock2Enabled() || outputManager->isSpoutBlock2Enabled()) {
+            sent |= dragonwaves::RenderGraph::mask(dragonwaves::RenderGraph::BLOCK2);
+        }
+        if (outputManager->isNdiBlock3Enabled() || outputManager->isSpoutBlock3Enabled()) {
+            sent |= block3Output;
+        }
+    }
+    pipeline->setConsumer(dragonwaves::RenderGraph::OUTPUTS, sent);
+    pipeline->setConsumer(dragonwaves::RenderGraph::RECORDER,
+        ((videoRecorder && videoRecorder->isRecording()) || offlineRenderer) ? block3Output : 0);
+    
     // Process shader pipeline
     pipeline->processFrame();
     
-    // Capture frame for video recording (non-blocking PBO readback)
-    if (videoRecorder && videoRecorder->isRecording()) {
-        videoRecorder->captureFrame(pipeline->getBlock3Fbo());
+    // Offline: every frame goes to disk, then quit after the last one
+    if (offlineRenderer && !offlineRenderer->isDone()) {
+        bool written = offlineRenderer->writeFrame(pipeline->getBlock3Fbo());
+        if (!written || offlineRenderer->isDone()) {
+            offlineRenderer->close();
+            // Stage timings over the last GpuProfiler::WINDOW frames, for benchmark runs
+            if (GpuProfiler::getInstance().isEnabled()) {
+                ofLogNotice("ofApp") << "\n" << getGpuStatsText();
+            }
+            ofExit(written ? 0 : 1);
+        }
+    }
+    
+    // Read back what the NDI senders, recorder and preview need, once per
+    // block output (see FrameBus)
+    if (outputManager) {
+        auto& frameBus = outputManager->getFrameBus();
+        outputManager->requestFrames();
+        bool recording = videoRecorder && videoRecorder->isRecording();
+        if (recording) {
+            // In order: FFmpeg encodes at a fixed rate, so every frame counts
+            frameBus.request(dragonwaves::RenderGraph::BLOCK3, videoRecorder->getWidth(), videoRecorder->getHeight(),
+                             OF_PIXELS_RGBA, true, dragonwaves::VideoRecorder::HELD_FRAMES);
+        }
+        frameBus.update(*pipeline);
+        
+        // Capture frames for video recording (non-blocking)
+        if (recording) {
+            for (auto& frame : frameBus.published(dragonwaves::RenderGraph::BLOCK3,
+                                                  videoRecorder->getWidth(), videoRecorder->getHeight())) {
+                videoRecorder->captureFrame(frame);
+            }
+        }
     }
     
     // Send outputs
     sendOutputs();
     
-    // Draw to screen based on draw mode
-    drawOutput();
+    // Draw to screen based on draw mode (the offline window is hidden)
+    if (!offlineRenderer) {
+        drawOutput();
+    }
     
     // Clear framebuffers for next frame (only if requested)
     clearFramebuffers();
+    
+    GpuProfiler::getInstance().endFrame();
+    sendGpuStats();
+    
+    // CPU time of update + draw, read by the resolution governor next frame
+    pipeline->setFrameCpuTime((ofGetElapsedTimeMicros() - frameWorkStartMicros) / 1000.0f);
 }
 
 //--------------------------------------------------------------
@@ -394,7 +543,7 @@ float ofApp::getEffectiveLfoRate(bool* syncEnabled, int* divisionIndex, float ra
     float cyclesPerSecond = cyclesPerBeat * beatsPerSecond;
     
     // Get actual delta time for frame-rate independent calculation
-    float deltaTime = ofGetLastFrameTime();
+    float deltaTime = FrameClock::getInstance().getDeltaTime();
     
     // Calculate what rate would give us the desired cycles per second
     // lfoRateC * rate * (TWO_PI / (lfoRateC * deltaTime)) = cycles per second
@@ -427,6 +576,7 @@ void ofApp::syncGuiToSettingsManager() {
     displaySettings.ndiSendWidth = gui->ndiSendWidth;
     displaySettings.ndiSendHeight = gui->ndiSendHeight;
     displaySettings.targetFPS = gui->targetFPS;
+    displaySettings.gpuStatsOverlay = gui->gpuStatsOverlay;
     
     // Sync input source settings
     inputSettings.input1SourceType = gui->input1SourceType;
@@ -481,6 +631,7 @@ void ofApp::syncSettingsManagerToGui() {
     gui->ndiSendWidth = displaySettings.ndiSendWidth;
     gui->ndiSendHeight = displaySettings.ndiSendHeight;
     gui->targetFPS = displaySettings.targetFPS;
+    gui->gpuStatsOverlay = displaySettings.gpuStatsOverlay;
     
     // Sync input source settings to GUI
     gui->input1SourceType = inputSettings.input1SourceType;
@@ -535,6 +686,7 @@ void ofApp::syncSettingsManagerToGui() {
 
 //--------------------------------------------------------------
 void ofApp::syncGuiToPipeline() {
+    TraceScope trace("ofApp::syncGuiToPipeline");
     if (!gui) return;
     
     auto& block1 = pipeline->getBlock1();
@@ -1272,10 +1424,16 @@ void ofApp::syncGuiToPipeline() {
     pipeline->setDrawMode((PipelineManager::DrawMode)gui->drawMode);
     
     // NDI/Spout enable
-    outputManager->setNdiBlock3Enabled(gui->ndiSendBlock3);
+    if (outputManager) {
+        outputManager->setNdiBlock1Enabled(gui->ndiSendBlock1);
+        outputManager->setNdiBlock2Enabled(gui->ndiSendBlock2);
+        outputManager->setNdiBlock3Enabled(gui->ndiSendBlock3);
 #if OFAPP_HAS_SPOUT
-    outputManager->setSpoutBlock3Enabled(gui->spoutSendBlock3);
+        outputManager->setSpoutBlock1Enabled(gui->spoutSendBlock1);
+        outputManager->setSpoutBlock2Enabled(gui->spoutSendBlock2);
+        outputManager->setSpoutBlock3Enabled(gui->spoutSendBlock3);
 #endif
+    }
 }
 
 //--------------------------------------------------------------
@@ -1368,6 +1526,8 @@ void ofApp::drawGeometryPatterns() {
 void ofApp::sendOutputs() {
     if (!outputManager) return;
     
+    outputManager->sendBlock1(pipeline->getBlock1Fbo().getTexture());
+    outputManager->sendBlock2(pipeline->getBlock2Fbo().getTexture());
     outputManager->sendBlock3(pipeline->getFinalOutput());
 }
 
@@ -1393,6 +1553,52 @@ void ofApp::drawOutput() {
             pipeline->getFinalOutput().draw(0, ofGetHeight()/2, ofGetWidth()/2, ofGetHeight()/2);
             break;
     }
+    
+    if (gui->gpuStatsOverlay) {
+        drawGpuStatsOverlay();
+    }
+}
+
+//--------------------------------------------------------------
+std::string ofApp::getGpuStatsText() const {
+    auto& profiler = GpuProfiler::getInstance();
+    std::string text = "GPU ms      last    min    avg    p99";
+    for (int s = 0; s < GpuProfiler::STAGE_COUNT; s++) {
+        const auto& stats = profiler.getStats((GpuProfiler::Stage)s);
+        if (stats.samples == 0) continue;
+        char line[96];
+        snprintf(line, sizeof(line), "\n%-9s %6.2f %6.2f %6.2f %6.2f",
+                 GpuProfiler::getStageName((GpuProfiler::Stage)s),
+                 stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms);
+        text += line;
+    }
+    return text;
+}
+
+//--------------------------------------------------------------
+void ofApp::drawGpuStatsOverlay() {
+    if (!GpuProfiler::getInstance().isEnabled()) return;
+    ofDrawBitmapStringHighlight(getGpuStatsText(), 20, 30);
+}
+
+//--------------------------------------------------------------
+void ofApp::sendGpuStats() {
+    float now = ofGetElapsedTimef();
+    if (now - lastGpuStatsSendTime < 0.5f) return;
+    lastGpuStatsSendTime = now;
+    
+    auto& profiler = GpuProfiler::getInstance();
+    if (!profiler.isEnabled()) return;
+    
+    auto& pm = ParameterManager::getInstance();
+    for (int s = 0; s < GpuProfiler::STAGE_COUNT; s++) {
+        const auto& stats = profiler.getStats((GpuProfiler::Stage)s);
+        if (stats.samples == 0) continue;
+        std::string address = std::string("/gravity/stats/gpu/") + GpuProfiler::getStageName((GpuProfiler::Stage)s);
+        pm.sendParameter(address + "/min", stats.minMs);
+        pm.sendParameter(address + "/avg", stats.avgMs);
+        pm.sendParameter(address + "/p99", stats.p99Ms);
+    }
 }
 
 //--------------------------------------------------------------
@@ -1530,6 +1736,7 @@ void ofApp::applyResolutionChange() {
 
 //--------------------------------------------------------------
 void ofApp::updateLfos() {
+    TraceScope trace("ofApp::updateLfos");
     if (!gui) return;
     
     // Get beat division values for tempo sync
@@ -1883,6 +2090,15 @@ void ofApp::keyPressed(int key){
         }
     }
     
+    // 't' key to dump the recent frame trace (see FrameTracer)
+    if (key == 't' || key == 'T') {
+        if (FrameTracer::getInstance().isEnabled()) {
+            FrameTracer::getInstance().dump(SettingsManager::getInstance().getDisplay().traceSeconds);
+        } else {
+            ofLogNotice("ofApp") << "Frame tracing is off (frameTracing setting or /gravity/trace/enabled)";
+        }
+    }
+    
     // F10 to toggle window decoration
     if (key == OF_KEY_F10) {
         auto glfwWindow = dynamic_cast<ofAppGLFWWindow*>(mainWindow.get());
@@ -1915,24 +2131,29 @@ void ofApp::exit(){
         ofLogNotice("ofApp") << "PreviewPanel cleaned up";
     }
     
-    // 2. Save settings on exit (after closing OSC to prevent race conditions)
-    ofLogNotice("ofApp") << "Saving settings on exit...";
-    
-    // Sync current GUI values to SettingsManager
-    if (gui) {
-        syncGuiToSettingsManager();
-    }
-    
-    // Save to config.json
-    SettingsManager::getInstance().save();
-    
-    // Also save to settings.json for backward compatibility
-    if (gui) {
-        gui->saveVideoOscSettings();
+    // 2. Save settings on exit (after closing OSC to prevent race conditions).
+    // An offline render never set up the GUI's settings, so it leaves them alone.
+    if (offline.enabled) {
+        if (offlineRenderer) offlineRenderer->close();
+    } else {
+        ofLogNotice("ofApp") << "Saving settings on exit...";
+        
+        // Sync current GUI values to SettingsManager
+        if (gui) {
+            syncGuiToSettingsManager();
+        }
+        
+        // Save to config.json
+        SettingsManager::getInstance().save();
+        
+        // Also save to settings.json for backward compatibility
+        if (gui) {
+            gui->saveVideoOscSettings();
+        }
+        
+        ofLogNotice("ofApp") << "Settings saved successfully";
     }
     
-    ofLogNotice("ofApp") << "Settings saved successfully";
-    
     // 3. Clean up modular components in reverse order of creation
     // This ensures proper cleanup of GPU resources and NDI/Spout
     ofLogNotice("ofApp") << "Cleaning up modular components...";
@@ -2096,6 +2317,42 @@ void ofApp::registerAudioTempoOscParams() {
     ofLogNotice("ofApp") << "Audio and Tempo OSC parameters registered";
 }
 
+void ofApp::registerPipelineOscParams() {
+    using namespace dragonwaves;
+    auto& pm = ParameterManager::getInstance();
+    
+    auto pipelineGroup = std::make_shared<ParameterGroup>("Pipeline", "/gravity/pipeline");
+    
+    // Hold the resolution governor's current scale (live shows: set the scale, then lock)
+    auto lock = std::make_shared<Parameter<bool>>(
+        "governorLock", "/gravity/pipeline/governorLock", &governorLocked);
+    lock->setCallback([this]() {
+        if (pipeline) pipeline->getResolutionGovernor().setLocked(governorLocked);
+    });
+    pipelineGroup->addParameter(lock);
+    
+    pm.registerGroup(pipelineGroup);
+    
+    // Frame tracing: record, and dump the last traceSeconds to data/traces
+    auto traceGroup = std::make_shared<ParameterGroup>("Trace", "/gravity/trace");
+    auto traceOn = std::make_shared<Parameter<bool>>(
+        "enabled", "/gravity/trace/enabled", &traceEnabled);
+    traceOn->setCallback([this]() {
+        FrameTracer::getInstance().setEnabled(traceEnabled);
+    });
+    traceGroup->addParameter(traceOn);
+    auto dump = std::make_shared<Parameter<bool>>(
+        "dump", "/gravity/trace/dump", &traceDumpRequested);
+    dump->setCallback([this]() {
+        if (!traceDumpRequested) return;
+        traceDumpRequested = false;
+        FrameTracer::getInstance().dump(SettingsManager::getInstance().getDisplay().traceSeconds);
+    });
+    traceGroup->addParameter(dump);
+    
+    pm.registerGroup(traceGroup);
+}
+
 bool ofApp::processOscAudioParams(const string& address, float value) {
     if (!audioAnalyzer) return false;
     
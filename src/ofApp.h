@@ -25,6 +25,7 @@
 #include "Tempo/TempoManager.h"
 #include "Preview/PreviewPanel.h"
 #include "VideoRecorder/VideoRecorder.h"
+#include "VideoRecorder/OfflineRenderer.h"
 
 class ofApp : public ofBaseApp{
 
@@ -40,6 +41,9 @@ class ofApp : public ofBaseApp{
 		void keyReleased(int key);
 		void exit();
 
+		// Headless render from the command line (set by main() before setup)
+		dragonwaves::OfflineRenderSettings offline;
+
 
 		shared_ptr<GuiApp> gui;
 		shared_ptr<ofAppBaseWindow> mainWindow;  // Reference to output window
@@ -84,6 +88,23 @@ class ofApp : public ofBaseApp{
 		// Register Audio and Tempo OSC parameters
 		void registerAudioTempoOscParams();
 		
+		// Register pipeline OSC parameters (resolution governor lock, frame tracing)
+		void registerPipelineOscParams();
+		bool governorLocked = false;
+		bool traceEnabled = false;
+		bool traceDumpRequested = false;
+		
+		// Start of this frame's work, for the resolution governor's CPU time
+		uint64_t frameWorkStartMicros = 0;
+		
+		// GPU stage timings (see GpuProfiler): output window overlay (and
+		// the log at the end of an offline render), and
+		// OSC /gravity/stats/gpu/<stage>/{min,avg,p99} twice a second
+		std::string getGpuStatsText() const;
+		void drawGpuStatsOverlay();
+		void sendGpuStats();
+		float lastGpuStatsSendTime = 0.0f;
+		
 		// Apply audio/BPM modulations from GUI to Block3Shader
 		void applyAudioModulationToParam(int blockNum, const std::string& paramName, bool enabled, int fftBand, float amount, float rangeScale = 1.0f);
 		void applyBpmModulationToParam(const std::string& paramName, bool enabled, int division, int waveform, float phase, float minVal, float maxVal);
@@ -659,6 +680,10 @@ class ofApp : public ofBaseApp{
 	// Preview Panel
 	std::unique_ptr<dragonwaves::PreviewPanel> previewPanel;
 	
+	// Offline render output (headless mode only)
+	std::unique_ptr<dragonwaves::OfflineRenderer> offlineRenderer;
+	void setupOffline();
+	
 	// Modular system helpers
 	void syncGuiToPipeline();
 	void syncGuiToSettingsManager();  // Sync GUI values to SettingsManager before saving